@@ -0,0 +1,295 @@
+/* GStreamer
+ *
+ * gssim-kernels.c: Vectorized inner loops of the SSIM computation.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#include "gssim-kernels.h"
+
+/* The x86 variants are built with target attributes so that they do not
+ * require special compiler flags, and are only used after checking what the
+ * CPU supports */
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define HAVE_X86_KERNELS 1
+#include <immintrin.h>
+#endif
+
+static void
+filter_row_scalar (const gdouble * kernel, gint windowsize, gint half,
+    const gdouble * org, const gdouble * mod, gint start, gint end,
+    gdouble * dest, gint width)
+{
+  gint x, k;
+
+  for (x = start; x < end; x++) {
+    const gdouble *o = &org[x - half], *m = &mod[x - half];
+    gdouble so = 0, sm = 0, soo = 0, smm = 0, som = 0;
+
+    for (k = 0; k < windowsize; k++) {
+      gdouble wo = kernel[k] * o[k], wm = kernel[k] * m[k];
+
+      so += wo;
+      sm += wm;
+      soo += wo * o[k];
+      smm += wm * m[k];
+      som += wo * m[k];
+    }
+
+    dest[GSSIM_SUM_ORG * width + x] = so;
+    dest[GSSIM_SUM_MOD * width + x] = sm;
+    dest[GSSIM_SUM_ORG_ORG * width + x] = soo;
+    dest[GSSIM_SUM_MOD_MOD * width + x] = smm;
+    dest[GSSIM_SUM_ORG_MOD * width + x] = som;
+  }
+}
+
+static void
+add_row_scalar (gdouble * dest, const gdouble * src, gdouble weight, gint n)
+{
+  gint i;
+
+  for (i = 0; i < n; i++)
+    dest[i] += weight * src[i];
+}
+
+static void
+ssim_pixels_scalar (const GssimKernelRow * row, gfloat * ssim, gint start)
+{
+  const gdouble *s_o = &row->sums[GSSIM_SUM_ORG * row->width];
+  const gdouble *s_m = &row->sums[GSSIM_SUM_MOD * row->width];
+  const gdouble *s_oo = &row->sums[GSSIM_SUM_ORG_ORG * row->width];
+  const gdouble *s_mm = &row->sums[GSSIM_SUM_MOD_MOD * row->width];
+  const gdouble *s_om = &row->sums[GSSIM_SUM_ORG_MOD * row->width];
+  gdouble scale = row->scale;
+  gint x;
+
+  for (x = start; x < row->width; x++) {
+    gdouble elsumm = scale * row->x_norm[x] * row->y_norm;
+    gdouble weights = scale * row->x_weights[x] * row->y_weights;
+    gdouble so = scale * s_o[x], sm = scale * s_m[x];
+    gdouble mu_o = so / elsumm, mu_m = sm / elsumm;
+    gdouble sigma_o, sigma_m, sigma_om;
+
+    sigma_o = (scale * s_oo[x] - 2 * mu_o * so + mu_o * mu_o * weights)
+        / elsumm;
+    sigma_m = (scale * s_mm[x] - 2 * mu_m * sm + mu_m * mu_m * weights)
+        / elsumm;
+    sigma_om = (scale * s_om[x] - mu_m * so - mu_o * sm +
+        mu_o * mu_m * weights) / elsumm;
+
+    ssim[x] = (2 * mu_o * mu_m + row->const1) * (2 * sigma_om + row->const2)
+        / ((mu_o * mu_o + mu_m * mu_m + row->const1) * (sigma_o + sigma_m +
+            row->const2));
+  }
+}
+
+static void
+ssim_row_scalar (const GssimKernelRow * row, gfloat * ssim)
+{
+  ssim_pixels_scalar (row, ssim, 0);
+}
+
+static const GssimKernels scalar_kernels = {
+  filter_row_scalar,
+  add_row_scalar,
+  ssim_row_scalar,
+};
+
+#ifdef HAVE_X86_KERNELS
+
+/* Both variants are written with the same macros, over vectors of
+ * VEC_SIZE doubles. The operations are done in the same order as in the
+ * scalar code. */
+#define DEFINE_X86_KERNELS(suffix, isa, vec, VEC_SIZE, set1, loadu, \
+    storeu, add, sub, mul, div, zero, store_floats) \
+\
+__attribute__ ((target (isa))) static void \
+filter_row_##suffix (const gdouble * kernel, gint windowsize, gint half, \
+    const gdouble * org, const gdouble * mod, gint start, gint end, \
+    gdouble * dest, gint width) \
+{ \
+  gint x, k; \
+\
+  for (x = start; x + VEC_SIZE <= end; x += VEC_SIZE) { \
+    const gdouble *o = &org[x - half], *m = &mod[x - half]; \
+    vec so = zero (), sm = zero (), soo = zero (), smm = zero (); \
+    vec som = zero (); \
+\
+    for (k = 0; k < windowsize; k++) { \
+      vec w = set1 (kernel[k]); \
+      vec ok = loadu (&o[k]), mk = loadu (&m[k]); \
+      vec wo = mul (w, ok), wm = mul (w, mk); \
+\
+      so = add (so, wo); \
+      sm = add (sm, wm); \
+      soo = add (soo, mul (wo, ok)); \
+      smm = add (smm, mul (wm, mk)); \
+      som = add (som, mul (wo, mk)); \
+    } \
+\
+    storeu (&dest[GSSIM_SUM_ORG * width + x], so); \
+    storeu (&dest[GSSIM_SUM_MOD * width + x], sm); \
+    storeu (&dest[GSSIM_SUM_ORG_ORG * width + x], soo); \
+    storeu (&dest[GSSIM_SUM_MOD_MOD * width + x], smm); \
+    storeu (&dest[GSSIM_SUM_ORG_MOD * width + x], som); \
+  } \
+\
+  filter_row_scalar (kernel, windowsize, half, org, mod, x, end, dest, \
+      width); \
+} \
+\
+__attribute__ ((target (isa))) static void \
+add_row_##suffix (gdouble * dest, const gdouble * src, gdouble weight, \
+    gint n) \
+{ \
+  vec w = set1 (weight); \
+  gint i; \
+\
+  for (i = 0; i + VEC_SIZE <= n; i += VEC_SIZE) \
+    storeu (&dest[i], add (loadu (&dest[i]), mul (w, loadu (&src[i])))); \
+\
+  add_row_scalar (&dest[i], &src[i], weight, n - i); \
+} \
+\
+__attribute__ ((target (isa))) static void \
+ssim_row_##suffix (const GssimKernelRow * row, gfloat * ssim) \
+{ \
+  const gdouble *s_o = &row->sums[GSSIM_SUM_ORG * row->width]; \
+  const gdouble *s_m = &row->sums[GSSIM_SUM_MOD * row->width]; \
+  const gdouble *s_oo = &row->sums[GSSIM_SUM_ORG_ORG * row->width]; \
+  const gdouble *s_mm = &row->sums[GSSIM_SUM_MOD_MOD * row->width]; \
+  const gdouble *s_om = &row->sums[GSSIM_SUM_ORG_MOD * row->width]; \
+  vec scale = set1 (row->scale), two = set1 (2); \
+  vec y_norm = set1 (row->y_norm), y_weights = set1 (row->y_weights); \
+  vec const1 = set1 (row->const1), const2 = set1 (row->const2); \
+  gint x; \
+\
+  for (x = 0; x + VEC_SIZE <= row->width; x += VEC_SIZE) { \
+    vec elsumm = mul (mul (scale, loadu (&row->x_norm[x])), y_norm); \
+    vec weights = mul (mul (scale, loadu (&row->x_weights[x])), y_weights); \
+    vec so = mul (scale, loadu (&s_o[x])), sm = mul (scale, loadu (&s_m[x])); \
+    vec mu_o = div (so, elsumm), mu_m = div (sm, elsumm); \
+    vec sigma_o, sigma_m, sigma_om, num, den; \
+\
+    sigma_o = div (add (sub (mul (scale, loadu (&s_oo[x])), \
+                mul (mul (two, mu_o), so)), mul (mul (mu_o, mu_o), weights)), \
+        elsumm); \
+    sigma_m = div (add (sub (mul (scale, loadu (&s_mm[x])), \
+                mul (mul (two, mu_m), sm)), mul (mul (mu_m, mu_m), weights)), \
+        elsumm); \
+    sigma_om = div (add (sub (sub (mul (scale, loadu (&s_om[x])), \
+                    mul (mu_m, so)), mul (mu_o, sm)), \
+            mul (mul (mu_o, mu_m), weights)), elsumm); \
+\
+    num = mul (add (mul (mul (two, mu_o), mu_m), const1), \
+        add (mul (two, sigma_om), const2)); \
+    den = mul (add (add (mul (mu_o, mu_o), mul (mu_m, mu_m)), const1), \
+        add (add (sigma_o, sigma_m), const2)); \
+    store_floats (&ssim[x], div (num, den)); \
+  } \
+\
+  ssim_pixels_scalar (row, ssim, x); \
+} \
+\
+static const GssimKernels suffix##_kernels = { \
+  filter_row_##suffix, \
+  add_row_##suffix, \
+  ssim_row_##suffix, \
+};
+
+#define STORE_FLOATS_SSE2(dest, v) \
+  _mm_storel_pi ((__m64 *) (dest), _mm_cvtpd_ps (v))
+#define STORE_FLOATS_AVX2(dest, v) \
+  _mm_storeu_ps ((dest), _mm256_cvtpd_ps (v))
+
+/* *INDENT-OFF* */
+DEFINE_X86_KERNELS (sse2, "sse2", __m128d, 2, _mm_set1_pd, _mm_loadu_pd,
+    _mm_storeu_pd, _mm_add_pd, _mm_sub_pd, _mm_mul_pd, _mm_div_pd,
+    _mm_setzero_pd, STORE_FLOATS_SSE2)
+DEFINE_X86_KERNELS (avx2, "avx2", __m256d, 4, _mm256_set1_pd,
+    _mm256_loadu_pd, _mm256_storeu_pd, _mm256_add_pd, _mm256_sub_pd,
+    _mm256_mul_pd, _mm256_div_pd, _mm256_setzero_pd, STORE_FLOATS_AVX2)
+/* *INDENT-ON* */
+
+#endif /* HAVE_X86_KERNELS */
+
+gboolean
+gssim_simd_is_supported (GssimSimd simd)
+{
+  switch (simd) {
+    case GSSIM_SIMD_NONE:
+      return TRUE;
+#ifdef HAVE_X86_KERNELS
+    case GSSIM_SIMD_SSE2:
+      __builtin_cpu_init ();
+      return __builtin_cpu_supports ("sse2");
+    case GSSIM_SIMD_AVX2:
+      __builtin_cpu_init ();
+      return __builtin_cpu_supports ("avx2");
+#endif
+    default:
+      return FALSE;
+  }
+}
+
+/* The best variant the CPU supports, unless overridden with the
+ * GST_VALIDATE_SSIM_SIMD environment variable (none, sse2 or avx2) */
+GssimSimd
+gssim_simd_detect (void)
+{
+  static gsize simd = 0;
+
+  if (g_once_init_enter (&simd)) {
+    const gchar *forced = g_getenv ("GST_VALIDATE_SSIM_SIMD");
+    GssimSimd detected = GSSIM_SIMD_NONE;
+
+    if (forced && !g_strcmp0 (forced, "avx2"))
+      detected = GSSIM_SIMD_AVX2;
+    else if (forced && !g_strcmp0 (forced, "sse2"))
+      detected = GSSIM_SIMD_SSE2;
+    else if (!forced && gssim_simd_is_supported (GSSIM_SIMD_AVX2))
+      detected = GSSIM_SIMD_AVX2;
+    else if (!forced && gssim_simd_is_supported (GSSIM_SIMD_SSE2))
+      detected = GSSIM_SIMD_SSE2;
+
+    if (!gssim_simd_is_supported (detected))
+      detected = GSSIM_SIMD_NONE;
+
+    /* + 1 so that GSSIM_SIMD_NONE is not 0 */
+    g_once_init_leave (&simd, detected + 1);
+  }
+
+  return simd - 1;
+}
+
+const GssimKernels *
+gssim_get_kernels (GssimSimd simd)
+{
+  if (!gssim_simd_is_supported (simd))
+    return &scalar_kernels;
+
+  switch (simd) {
+#ifdef HAVE_X86_KERNELS
+    case GSSIM_SIMD_SSE2:
+      return &sse2_kernels;
+    case GSSIM_SIMD_AVX2:
+      return &avx2_kernels;
+#endif
+    default:
+      return &scalar_kernels;
+  }
+}
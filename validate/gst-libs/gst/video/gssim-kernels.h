@@ -0,0 +1,77 @@
+/* GStreamer
+ *
+ * gssim-kernels.h: Vectorized inner loops of the SSIM computation.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifndef _GSSIM_KERNELS_H
+#define _GSSIM_KERNELS_H
+
+#include "gssim.h"
+
+G_BEGIN_DECLS
+
+/* Windowed sums computed for each pixel, in this order in the sum arrays */
+enum
+{
+  GSSIM_SUM_ORG,
+  GSSIM_SUM_MOD,
+  GSSIM_SUM_ORG_ORG,
+  GSSIM_SUM_MOD_MOD,
+  GSSIM_SUM_ORG_MOD,
+  GSSIM_N_SUMS
+};
+
+/* Inputs of the similarity computation of a row */
+typedef struct
+{
+  const gdouble *sums;          /* GSSIM_N_SUMS arrays of width values */
+  gint width;
+  const gdouble *x_norm;
+  const gdouble *x_weights;
+  gdouble y_norm;
+  gdouble y_weights;
+  gdouble scale;
+  gdouble const1;
+  gdouble const2;
+} GssimKernelRow;
+
+/* All variants compute bit-identical results, as long as the compiler does
+ * not contract multiplications and additions in the scalar code. */
+typedef struct
+{
+  /* Weighted sums of windowsize pixels for x in [start, end[, reading pixels
+   * x - half to x - half + windowsize - 1 which must all be inside the row */
+  void (*filter_row) (const gdouble * kernel, gint windowsize, gint half,
+      const gdouble * org, const gdouble * mod, gint start, gint end,
+      gdouble * dest, gint width);
+
+  /* dest[i] += weight * src[i] */
+  void (*add_row) (gdouble * dest, const gdouble * src, gdouble weight,
+      gint n);
+
+  /* Similarity of each pixel of a row */
+  void (*ssim_row) (const GssimKernelRow * row, gfloat * ssim);
+} GssimKernels;
+
+GssimSimd gssim_simd_detect (void);
+gboolean gssim_simd_is_supported (GssimSimd simd);
+const GssimKernels * gssim_get_kernels (GssimSimd simd);
+
+G_END_DECLS
+
+#endif
@@ -23,12 +23,21 @@
 #include <glib.h>
 #include <math.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "gssim.h"
+#include "gssim-kernels.h"
 
 typedef gfloat (*SSimWeightFunc) (Gssim * self, gint y, gint x);
 
-typedef struct _SSimWindowCache
+#define N_SUMS GSSIM_N_SUMS
+#define SUM_ORG GSSIM_SUM_ORG
+#define SUM_MOD GSSIM_SUM_MOD
+#define SUM_ORG_ORG GSSIM_SUM_ORG_ORG
+#define SUM_MOD_MOD GSSIM_SUM_MOD_MOD
+#define SUM_ORG_MOD GSSIM_SUM_ORG_MOD
+
+typedef struct _SSimWindow
 {
   gint x_window_start;
   gint x_weight_start;
@@ -37,7 +46,7 @@ typedef struct _SSimWindowCache
   gint y_weight_start;
   gint y_window_end;
   gfloat element_summ;
-} SSimWindowCache;
+} SSimWindow;
 
 struct _GssimPrivate
 {
@@ -45,13 +54,31 @@ struct _GssimPrivate
   gint height;
   gint windowsize;
   gint windowtype;
-  SSimWindowCache *windows;
   gfloat *weights;
+  /* Sums of the weights from (x_weight_start, y_weight_start) to the end of
+   * the window, indexed by y_weight_start * windowsize + x_weight_start */
+  gfloat *element_summs;
   gfloat const1;
   gfloat const2;
   gfloat sigma;
+  guint depth;
+
+  GssimEngine engine;
+  const GssimKernels *kernels;
+
+  /* Separable engine, see gssim_regenerate_kernel() */
+  gdouble *kernel;
+  gdouble kernel_scale;
+  gdouble *x_norm, *y_norm;
+  gdouble *x_weights, *y_weights;
+  gdouble *row_sums;
+  struct _GssimBand *bands;
+  guint n_bands;
 
-  gfloat *orgmu;
+  guint n_threads;
+  GMutex bands_lock;
+  GCond bands_cond;
+  guint pending_bands;
 
   GstVideoConverter *converter;
   GstVideoInfo in_info, out_info;
@@ -67,68 +94,6 @@ enum
   N_PROPS
 };
 
-static void
-gssim_calculate_mu (Gssim * self, guint8 * buf)
-{
-  gint oy, ox, iy, ix;
-
-  for (oy = 0; oy < self->priv->height; oy++) {
-    for (ox = 0; ox < self->priv->width; ox++) {
-      gfloat mu = 0;
-      gfloat elsumm;
-      gint weight_y_base, weight_x_base;
-      gint weight_offset;
-      gint pixel_offset;
-      gint winstart_y;
-      gint wghstart_y;
-      gint winend_y;
-      gint winstart_x;
-      gint wghstart_x;
-      gint winend_x;
-      gfloat weight;
-      gint source_offset;
-
-      source_offset = oy * self->priv->width + ox;
-
-      winstart_x = self->priv->windows[source_offset].x_window_start;
-      wghstart_x = self->priv->windows[source_offset].x_weight_start;
-      winend_x = self->priv->windows[source_offset].x_window_end;
-      winstart_y = self->priv->windows[source_offset].y_window_start;
-      wghstart_y = self->priv->windows[source_offset].y_weight_start;
-      winend_y = self->priv->windows[source_offset].y_window_end;
-      elsumm = self->priv->windows[source_offset].element_summ;
-
-      switch (self->priv->windowtype) {
-        case 0:
-          for (iy = winstart_y; iy <= winend_y; iy++) {
-            pixel_offset = iy * self->priv->width;
-            for (ix = winstart_x; ix <= winend_x; ix++)
-              mu += buf[pixel_offset + ix];
-          }
-          mu = mu / elsumm;
-          break;
-        case 1:
-
-          weight_y_base = wghstart_y - winstart_y;
-          weight_x_base = wghstart_x - winstart_x;
-
-          for (iy = winstart_y; iy <= winend_y; iy++) {
-            pixel_offset = iy * self->priv->width;
-            weight_offset = (weight_y_base + iy) * self->priv->windowsize +
-                weight_x_base;
-            for (ix = winstart_x; ix <= winend_x; ix++) {
-              weight = self->priv->weights[weight_offset + ix];
-              mu += weight * buf[pixel_offset + ix];
-            }
-          }
-          mu = mu / elsumm;
-          break;
-      }
-      self->priv->orgmu[oy * self->priv->width + ox] = mu;
-    }
-  }
-}
-
 static gfloat
 ssim_weight_func_none (Gssim * self, gint y, gint x)
 {
@@ -144,29 +109,57 @@ ssim_weight_func_gauss (Gssim * self, gint y, gint x)
 }
 
 
-static gboolean
-gssim_regenerate_windows (Gssim * self)
+/* Value of the sample at (x, y) */
+static inline guint
+gssim_get_sample (const GssimSamples * samples, gint x, gint y)
 {
-  gint windowiseven;
-  gint y, x, y2, x2;
-  SSimWeightFunc func;
-  gfloat normal_summ = 0;
-  gint normal_count = 0;
+  const guint8 *p = samples->data + (gsize) y * samples->stride +
+      (gsize) x * samples->pstride;
+  guint value;
+
+  if (samples->bits == 8)
+    value = *p;
+  else if (samples->big_endian)
+    value = GST_READ_UINT16_BE (p);
+  else
+    value = GST_READ_UINT16_LE (p);
+
+  return (value >> samples->shift) & ((1 << samples->depth) - 1);
+}
 
-  g_free (self->priv->weights);
+static void
+gssim_load_row (const GssimSamples * samples, gint y, gint width,
+    gdouble * dest)
+{
+  gint x;
+
+  if (samples->bits == 8 && samples->pstride == 1 && samples->depth == 8) {
+    const guint8 *row = samples->data + (gsize) y * samples->stride;
 
-  self->priv->weights =
-      g_new (gfloat, self->priv->windowsize * self->priv->windowsize);
+    for (x = 0; x < width; x++)
+      dest[x] = row[x];
+    return;
+  }
+
+  for (x = 0; x < width; x++)
+    dest[x] = gssim_get_sample (samples, x, y);
+}
 
-  windowiseven =
-      ((gint) self->priv->windowsize / 2) * 2 == self->priv->windowsize ? 1 : 0;
+static void
+gssim_regenerate_weights (Gssim * self)
+{
+  GssimPrivate *priv = self->priv;
+  gint windowsize = priv->windowsize;
+  gint windowiseven;
+  gint y, x, y2, x2;
+  SSimWeightFunc func;
 
-  g_free (self->priv->windows);
+  g_free (priv->weights);
+  priv->weights = g_new (gfloat, windowsize * windowsize);
 
-  self->priv->windows =
-      g_new (SSimWindowCache, self->priv->height * self->priv->width);
+  windowiseven = ((gint) windowsize / 2) * 2 == windowsize ? 1 : 0;
 
-  switch (self->priv->windowtype) {
+  switch (priv->windowtype) {
     case 0:
       func = ssim_weight_func_none;
       break;
@@ -174,129 +167,589 @@ gssim_regenerate_windows (Gssim * self)
       func = ssim_weight_func_gauss;
       break;
     default:
-      self->priv->windowtype = 1;
+      priv->windowtype = 1;
       func = ssim_weight_func_gauss;
   }
 
-  for (y = 0; y < self->priv->windowsize; y++) {
-    gint yoffset = y * self->priv->windowsize;
-    for (x = 0; x < self->priv->windowsize; x++) {
-      self->priv->weights[yoffset + x] =
-          func (self, x - self->priv->windowsize / 2 + windowiseven,
-          y - self->priv->windowsize / 2 + windowiseven);
-      normal_summ += self->priv->weights[yoffset + x];
-      normal_count++;
+  for (y = 0; y < windowsize; y++) {
+    gint yoffset = y * windowsize;
+    for (x = 0; x < windowsize; x++) {
+      priv->weights[yoffset + x] =
+          func (self, x - windowsize / 2 + windowiseven,
+          y - windowsize / 2 + windowiseven);
     }
   }
 
-  for (y = 0; y < self->priv->height; y++) {
-    for (x = 0; x < self->priv->width; x++) {
-      SSimWindowCache win;
-      gint element_count = 0;
+  /* Windows clipped by the frame borders are normalized by the sum of the
+   * weights from the first one applied to a pixel of the frame, which only
+   * depends on how much of the window is clipped at the top and left */
+  g_free (priv->element_summs);
+  priv->element_summs = g_new (gfloat, windowsize * windowsize);
+  for (y = 0; y < windowsize; y++) {
+    for (x = 0; x < windowsize; x++) {
+      gfloat summ = 0;
+
+      for (y2 = y; y2 < windowsize; y2++)
+        for (x2 = x; x2 < windowsize; x2++)
+          summ += priv->weights[y2 * windowsize + x2];
+      priv->element_summs[y * windowsize + x] = summ;
+    }
+  }
 
-      win.x_window_start = x - self->priv->windowsize / 2 + windowiseven;
-      win.x_weight_start = 0;
-      if (win.x_window_start < 0) {
-        win.x_weight_start = -win.x_window_start;
-        win.x_window_start = 0;
-      }
+}
 
-      win.x_window_end = x + self->priv->windowsize / 2;
-      if (win.x_window_end >= self->priv->width)
-        win.x_window_end = self->priv->width - 1;
+/* Computes the window of pixel (x, y) clipped by the frame borders */
+static inline void
+gssim_get_window (Gssim * self, gint x, gint y, SSimWindow * win)
+{
+  GssimPrivate *priv = self->priv;
+  gint windowsize = priv->windowsize;
+  gint windowiseven = ((gint) windowsize / 2) * 2 == windowsize ? 1 : 0;
+
+  win->x_window_start = x - windowsize / 2 + windowiseven;
+  win->x_weight_start = 0;
+  if (win->x_window_start < 0) {
+    win->x_weight_start = -win->x_window_start;
+    win->x_window_start = 0;
+  }
 
-      win.y_window_start = y - self->priv->windowsize / 2 + windowiseven;
-      win.y_weight_start = 0;
-      if (win.y_window_start < 0) {
-        win.y_weight_start = -win.y_window_start;
-        win.y_window_start = 0;
-      }
+  win->x_window_end = x + windowsize / 2;
+  if (win->x_window_end >= priv->width)
+    win->x_window_end = priv->width - 1;
 
-      win.y_window_end = y + self->priv->windowsize / 2;
-      if (win.y_window_end >= self->priv->height)
-        win.y_window_end = self->priv->height - 1;
-
-      win.element_summ = 0;
-      element_count = (win.y_window_end - win.y_window_start + 1) *
-          (win.x_window_end - win.x_window_start + 1);
-      if (element_count == normal_count)
-        win.element_summ = normal_summ;
-      else {
-        for (y2 = win.y_weight_start; y2 < self->priv->windowsize; y2++) {
-          for (x2 = win.x_weight_start; x2 < self->priv->windowsize; x2++) {
-            win.element_summ +=
-                self->priv->weights[y2 * self->priv->windowsize + x2];
-          }
-        }
-      }
-      self->priv->windows[(y * self->priv->width + x)] = win;
+  win->y_window_start = y - windowsize / 2 + windowiseven;
+  win->y_weight_start = 0;
+  if (win->y_window_start < 0) {
+    win->y_weight_start = -win->y_window_start;
+    win->y_window_start = 0;
+  }
+
+  win->y_window_end = y + windowsize / 2;
+  if (win->y_window_end >= priv->height)
+    win->y_window_end = priv->height - 1;
+
+  win->element_summ = priv->element_summs[win->y_weight_start * windowsize +
+      win->x_weight_start];
+}
+
+/* State of a band of rows computed by the separable engine. Bands are
+ * independent so that they can be computed in parallel. */
+typedef struct _GssimBand
+{
+  Gssim *self;
+
+  /* Rows [start, end[ of the frame */
+  gint start, end;
+
+  /* Horizontal sums of the rows covered by a window, plus one so that the box
+   * window can subtract the row leaving the window */
+  gdouble *hsums;
+  /* Vertical sums of the current row */
+  gdouble *vsums;
+  /* Prefix sums of the current row, box window only */
+  gdouble *prefix;
+  gdouble *row_org, *row_mod;
+  gfloat *row_ssim;
+
+  /* Frames being compared */
+  const GssimSamples *org, *mod;
+  guint8 *out;
+  gint out_stride;
+
+  gfloat lowest, highest;
+} GssimBand;
+
+static void
+gssim_free_bands (Gssim * self)
+{
+  GssimPrivate *priv = self->priv;
+  guint i;
+
+  for (i = 0; i < priv->n_bands; i++) {
+    GssimBand *band = &priv->bands[i];
+
+    g_free (band->hsums);
+    g_free (band->vsums);
+    g_free (band->prefix);
+    g_free (band->row_org);
+    g_free (band->row_mod);
+    g_free (band->row_ssim);
+  }
+
+  g_clear_pointer (&priv->bands, g_free);
+  priv->n_bands = 0;
+}
+
+static void
+gssim_free_kernel (Gssim * self)
+{
+  GssimPrivate *priv = self->priv;
+
+  g_clear_pointer (&priv->kernel, g_free);
+  g_clear_pointer (&priv->x_norm, g_free);
+  g_clear_pointer (&priv->y_norm, g_free);
+  g_clear_pointer (&priv->x_weights, g_free);
+  g_clear_pointer (&priv->y_weights, g_free);
+  g_clear_pointer (&priv->row_sums, g_free);
+  gssim_free_bands (self);
+}
+
+/* Fills @norm and @weights for each of the @size positions of a line:
+ * - @norm is the sum of the kernel weights starting from the first weight
+ *   applied to a pixel inside the frame. This matches the `element_summ`
+ *   normalization factor of the reference engine, which does not account for
+ *   the window being clipped at the right and bottom borders.
+ * - @weights is the sum of the kernel weights applied to pixels inside the
+ *   frame. */
+static void
+gssim_compute_line_factors (Gssim * self, gint size, gdouble * norm,
+    gdouble * weights)
+{
+  GssimPrivate *priv = self->priv;
+  gint windowsize = priv->windowsize;
+  gint half = windowsize / 2 - (windowsize % 2 ? 0 : 1);
+  gint i, k;
+
+  for (i = 0; i < size; i++) {
+    gint start = i - half;
+
+    norm[i] = weights[i] = 0;
+    for (k = start < 0 ? -start : 0; k < windowsize; k++) {
+      norm[i] += priv->kernel[k];
+      if (start + k < size)
+        weights[i] += priv->kernel[k];
+    }
+  }
+}
+
+/* Splits the frame in bands of rows, one per thread. Every band filters the
+ * windowsize - 1 rows around it again, so bands are kept reasonably high. */
+static void
+gssim_allocate_bands (Gssim * self)
+{
+  GssimPrivate *priv = self->priv;
+  gint width = priv->width, windowsize = priv->windowsize;
+  gint band_height = MAX (4 * windowsize,
+      (priv->height + priv->n_threads - 1) / priv->n_threads);
+  guint i;
+
+  priv->n_bands = (priv->height + band_height - 1) / band_height;
+  priv->bands = g_new0 (GssimBand, priv->n_bands);
+  for (i = 0; i < priv->n_bands; i++) {
+    GssimBand *band = &priv->bands[i];
+
+    band->self = self;
+    band->start = i * band_height;
+    band->end = MIN (priv->height, band->start + band_height);
+    band->hsums = g_new (gdouble, (windowsize + 1) * N_SUMS * width);
+    band->vsums = g_new (gdouble, N_SUMS * width);
+    if (priv->windowtype == 0)
+      band->prefix = g_new (gdouble, N_SUMS * (width + 1));
+    band->row_org = g_new (gdouble, width);
+    band->row_mod = g_new (gdouble, width);
+    band->row_ssim = g_new (gfloat, width);
+  }
+}
+
+/* The 2-D window weights are kernel_scale * kernel[ky] * kernel[kx], both for
+ * the box window and the gaussian one, so that windowed sums can be computed
+ * with a horizontal and a vertical pass. */
+static void
+gssim_regenerate_kernel (Gssim * self)
+{
+  GssimPrivate *priv = self->priv;
+  gint windowsize = priv->windowsize;
+  gint half = windowsize / 2 - (windowsize % 2 ? 0 : 1);
+  gint k;
+
+  gssim_free_kernel (self);
+
+  if (priv->windowtype != 0)
+    priv->windowtype = 1;
+
+  priv->kernel = g_new (gdouble, windowsize);
+  for (k = 0; k < windowsize; k++) {
+    gdouble d = k - half;
+
+    if (priv->windowtype == 0)
+      priv->kernel[k] = 1;
+    else
+      priv->kernel[k] = exp (-1 * (d * d) / (2 * priv->sigma * priv->sigma));
+  }
+  priv->kernel_scale = priv->windowtype == 0 ? 1 :
+      1 / (priv->sigma * sqrt (2 * G_PI));
+
+  priv->x_norm = g_new (gdouble, priv->width);
+  priv->x_weights = g_new (gdouble, priv->width);
+  gssim_compute_line_factors (self, priv->width, priv->x_norm,
+      priv->x_weights);
+  priv->y_norm = g_new (gdouble, priv->height);
+  priv->y_weights = g_new (gdouble, priv->height);
+  gssim_compute_line_factors (self, priv->height, priv->y_norm,
+      priv->y_weights);
+
+  priv->row_sums = g_new (gdouble, priv->height);
+  gssim_allocate_bands (self);
+}
+
+#define HSUMS_ROW(priv,band,row) \
+  (&(band)->hsums[((row) % ((priv)->windowsize + 1)) * N_SUMS * (priv)->width])
+
+/* Horizontal windowed sums of the pixels in [start, end[ of the current row,
+ * whose windows are clipped by the frame borders */
+static void
+gssim_filter_border (Gssim * self, GssimBand * band, gint start, gint end,
+    gdouble * dest)
+{
+  GssimPrivate *priv = self->priv;
+  gint width = priv->width, windowsize = priv->windowsize;
+  gint half_lo = windowsize / 2 - (windowsize % 2 ? 0 : 1);
+  const gdouble *org = band->row_org, *mod = band->row_mod;
+  gint x, k;
+
+  for (x = start; x < end; x++) {
+    gint kstart = MAX (0, half_lo - x);
+    gint kend = MIN (windowsize - 1, width - 1 - x + half_lo);
+    const gdouble *o = &org[x - half_lo], *m = &mod[x - half_lo];
+    gdouble so = 0, sm = 0, soo = 0, smm = 0, som = 0;
+
+    for (k = kstart; k <= kend; k++) {
+      gdouble wo = priv->kernel[k] * o[k], wm = priv->kernel[k] * m[k];
+
+      so += wo;
+      sm += wm;
+      soo += wo * o[k];
+      smm += wm * m[k];
+      som += wo * m[k];
+    }
+
+    dest[SUM_ORG * width + x] = so;
+    dest[SUM_MOD * width + x] = sm;
+    dest[SUM_ORG_ORG * width + x] = soo;
+    dest[SUM_MOD_MOD * width + x] = smm;
+    dest[SUM_ORG_MOD * width + x] = som;
+  }
+}
+
+/* Computes the horizontal windowed sums of a row of both frames */
+static void
+gssim_filter_row (Gssim * self, GssimBand * band, gint y, gdouble * dest)
+{
+  GssimPrivate *priv = self->priv;
+  gint width = priv->width, windowsize = priv->windowsize;
+  gint half_lo = windowsize / 2 - (windowsize % 2 ? 0 : 1);
+  gint half_hi = windowsize / 2;
+  const gdouble *org = band->row_org, *mod = band->row_mod;
+  gint interior_start, interior_end;
+  gint x, q;
+
+  gssim_load_row (band->org, y, width, band->row_org);
+  gssim_load_row (band->mod, y, width, band->row_mod);
+
+  if (priv->windowtype == 0) {
+    /* Box window: sums are differences of the row prefix sums (1-D integral
+     * image), independent of the window size */
+    gdouble *prefix = band->prefix;
+
+    for (q = 0; q < N_SUMS; q++)
+      prefix[q * (width + 1)] = 0;
+
+    for (x = 0; x < width; x++) {
+      gdouble o = org[x], m = mod[x];
+
+      prefix[SUM_ORG * (width + 1) + x + 1] =
+          prefix[SUM_ORG * (width + 1) + x] + o;
+      prefix[SUM_MOD * (width + 1) + x + 1] =
+          prefix[SUM_MOD * (width + 1) + x] + m;
+      prefix[SUM_ORG_ORG * (width + 1) + x + 1] =
+          prefix[SUM_ORG_ORG * (width + 1) + x] + o * o;
+      prefix[SUM_MOD_MOD * (width + 1) + x + 1] =
+          prefix[SUM_MOD_MOD * (width + 1) + x] + m * m;
+      prefix[SUM_ORG_MOD * (width + 1) + x + 1] =
+          prefix[SUM_ORG_MOD * (width + 1) + x] + o * m;
+    }
+
+    for (x = 0; x < width; x++) {
+      gint start = MAX (0, x - half_lo), end = MIN (width - 1, x + half_hi);
+
+      for (q = 0; q < N_SUMS; q++)
+        dest[q * width + x] = prefix[q * (width + 1) + end + 1] -
+            prefix[q * (width + 1) + start];
+    }
+
+    return;
+  }
+
+  /* Windows of the pixels in [interior_start, interior_end[ fit in the row,
+   * the other ones are clipped */
+  interior_start = MIN (half_lo, width);
+  interior_end = MAX (interior_start, width - half_hi);
+  gssim_filter_border (self, band, 0, interior_start, dest);
+  priv->kernels->filter_row (priv->kernel, windowsize, half_lo,
+      band->row_org, band->row_mod, interior_start, interior_end, dest, width);
+  gssim_filter_border (self, band, interior_end, width, dest);
+}
+
+static void
+gssim_add_row (Gssim * self, GssimBand * band, const gdouble * hsums,
+    gdouble weight)
+{
+  GssimPrivate *priv = self->priv;
+
+  priv->kernels->add_row (band->vsums, hsums, weight, N_SUMS * priv->width);
+}
+
+/* Computes the similarity of the rows of a band, storing the sum of each row
+ * in priv->row_sums */
+static void
+gssim_compute_band (Gssim * self, GssimBand * band)
+{
+  GssimPrivate *priv = self->priv;
+  gint width = priv->width, height = priv->height;
+  gint half_lo = priv->windowsize / 2 - (priv->windowsize % 2 ? 0 : 1);
+  gint half_hi = priv->windowsize / 2;
+  GssimKernelRow row = { 0, };
+  gint next_row = MAX (0, band->start - half_lo);
+  gint x, y;
+
+  row.sums = band->vsums;
+  row.width = width;
+  row.x_norm = priv->x_norm;
+  row.x_weights = priv->x_weights;
+  row.scale = priv->kernel_scale;
+  row.const1 = priv->const1;
+  row.const2 = priv->const2;
+
+  band->lowest = G_MAXFLOAT;
+  band->highest = -G_MAXFLOAT;
+
+  for (y = band->start; y < band->end; y++) {
+    gint first = MAX (0, y - half_lo), last = MIN (height - 1, y + half_hi);
+    gdouble row_ssim = 0;
+
+    for (; next_row <= last; next_row++)
+      gssim_filter_row (self, band, next_row,
+          HSUMS_ROW (priv, band, next_row));
+
+    if (priv->windowtype == 0 && y > band->start) {
+      /* Box window: update the vertical sums with the rows entering and
+       * leaving the window. Sums of integers are exact in double precision,
+       * so this gives the same sums as adding all the rows */
+      if (y + half_hi < height)
+        gssim_add_row (self, band, HSUMS_ROW (priv, band, y + half_hi), 1);
+      if (y - 1 - half_lo >= 0)
+        gssim_add_row (self, band, HSUMS_ROW (priv, band, y - 1 - half_lo),
+            -1);
+    } else {
+      gint r;
+
+      memset (band->vsums, 0, N_SUMS * width * sizeof (gdouble));
+      for (r = first; r <= last; r++)
+        gssim_add_row (self, band, HSUMS_ROW (priv, band, r),
+            priv->kernel[r - y + half_lo]);
+    }
+
+    row.y_norm = priv->y_norm[y];
+    row.y_weights = priv->y_weights[y];
+    priv->kernels->ssim_row (&row, band->row_ssim);
+
+    for (x = 0; x < width; x++) {
+      gfloat ssim = band->row_ssim[x];
+
+      if (band->out)
+        band->out[y * band->out_stride + x] = 127 + ssim * 128;
+      band->lowest = MIN (band->lowest, ssim);
+      band->highest = MAX (band->highest, ssim);
+      row_ssim += ssim;
     }
+
+    priv->row_sums[y] = row_ssim;
+  }
+}
+
+static void
+gssim_band_func (GssimBand * band, gpointer unused)
+{
+  Gssim *self = band->self;
+  GssimPrivate *priv = self->priv;
+
+  gssim_compute_band (self, band);
+
+  g_mutex_lock (&priv->bands_lock);
+  priv->pending_bands--;
+  if (priv->pending_bands == 0)
+    g_cond_signal (&priv->bands_cond);
+  g_mutex_unlock (&priv->bands_lock);
+}
+
+/* The bands of all the instances are computed by a single non-exclusive
+ * pool, so that the luma, chroma and scaled instances of each frame checker
+ * and the checkers running at the same time do not each keep their own
+ * threads around */
+static GThreadPool *
+gssim_get_band_pool (void)
+{
+  static gsize pool = 0;
+
+  if (g_once_init_enter (&pool)) {
+    GThreadPool *band_pool = g_thread_pool_new ((GFunc) gssim_band_func, NULL,
+        MAX (1, (gint) g_get_num_processors () - 1), FALSE, NULL);
+
+    g_once_init_leave (&pool, (gsize) band_pool);
   }
 
-  /* FIXME: while 0.01 and 0.03 are pretty much static, the 255 implies that
-   * we're working with 8-bit-per-color-component format, which may not be true
-   */
-  self->priv->const1 = 0.01 * 255 * 0.01 * 255;
-  self->priv->const2 = 0.03 * 255 * 0.03 * 255;
+  return (GThreadPool *) pool;
+}
+
+/* Computes the same SSIM as the reference engine, with the windowed sums of
+ * the original and modified frames, of their squares and of their product
+ * computed with a horizontal then a vertical pass over a ring of rows. Each
+ * pixel costs O(windowsize) with the gaussian window and O(1) with the box
+ * window, instead of O(windowsize²). Only the horizontal sums of
+ * windowsize + 1 rows are kept in memory for each band.
+ *
+ * Sums are computed in double precision, and the variances are derived from
+ * them as E[(X - mu)²] = (Sxx - 2·mu·Sx + mu²·W) / N. The result matches the
+ * reference engine within GSSIM_SEPARABLE_TOLERANCE.
+ *
+ * The inner loops are vectorized, see gssim-kernels.c, and bands of rows are
+ * computed in parallel. Each pixel is computed the same way whatever the
+ * band it belongs to, and the mean is accumulated row by row in order, so
+ * the results do not depend on the number of threads. */
+static void
+gssim_compare_separable (Gssim * self, const GssimSamples * org,
+    const GssimSamples * mod, guint8 * out, gint out_stride, gfloat * mean,
+    gfloat * lowest, gfloat * highest)
+{
+  GssimPrivate *priv = self->priv;
+  gdouble cumulative_ssim = 0;
+  guint i;
+  gint y;
+
+  if (priv->kernel == NULL)
+    gssim_regenerate_kernel (self);
+
+  for (i = 0; i < priv->n_bands; i++) {
+    priv->bands[i].org = org;
+    priv->bands[i].mod = mod;
+    priv->bands[i].out = out;
+    priv->bands[i].out_stride = out_stride;
+  }
+
+  if (priv->n_bands > 1) {
+    GThreadPool *pool = gssim_get_band_pool ();
+
+    priv->pending_bands = priv->n_bands - 1;
+    for (i = 1; i < priv->n_bands; i++)
+      g_thread_pool_push (pool, &priv->bands[i], NULL);
+  }
+
+  /* The calling thread takes care of the first band */
+  gssim_compute_band (self, &priv->bands[0]);
+
+  if (priv->n_bands > 1) {
+    g_mutex_lock (&priv->bands_lock);
+    while (priv->pending_bands)
+      g_cond_wait (&priv->bands_cond, &priv->bands_lock);
+    g_mutex_unlock (&priv->bands_lock);
+  }
+
+  for (i = 0; i < priv->n_bands; i++) {
+    *lowest = MIN (*lowest, priv->bands[i].lowest);
+    *highest = MAX (*highest, priv->bands[i].highest);
+  }
+
+  for (y = 0; y < priv->height; y++)
+    cumulative_ssim += priv->row_sums[y];
+  *mean = cumulative_ssim / (priv->width * priv->height);
+}
+
+/* Number of bands of rows the separable engine computes in parallel on the
+ * shared band pool, 0 meaning one per processor */
+void
+gssim_set_n_threads (Gssim * self, guint n_threads)
+{
+  GssimPrivate *priv = self->priv;
+
+  if (n_threads == 0)
+    n_threads = g_get_num_processors ();
+
+  if (n_threads == priv->n_threads)
+    return;
+
+  priv->n_threads = n_threads;
+
+  gssim_free_bands (self);
+  if (priv->kernel)
+    gssim_allocate_bands (self);
+}
+
+void
+gssim_set_engine (Gssim * self, GssimEngine engine)
+{
+  self->priv->engine = engine;
+}
+
+/* Selects the variant of the vectorized loops used by the separable engine,
+ * returns %FALSE if the CPU does not support it */
+gboolean
+gssim_set_simd (Gssim * self, GssimSimd simd)
+{
+  if (!gssim_simd_is_supported (simd))
+    return FALSE;
+
+  self->priv->kernels = gssim_get_kernels (simd);
   return TRUE;
 }
 
+/* Sums the whole window of each pixel, the windows and their normalization
+ * factors being computed from the pixel coordinates */
 void
-gssim_compare (Gssim * self, guint8 * org, guint8 * mod,
-    guint8 * out, gfloat * mean, gfloat * lowest, gfloat * highest)
+gssim_compare_samples (Gssim * self, const GssimSamples * org,
+    const GssimSamples * mod, guint8 * out, gint out_stride, gfloat * mean,
+    gfloat * lowest, gfloat * highest)
 {
+  GssimPrivate *priv = self->priv;
   gint oy, ox, iy, ix;
   gfloat cumulative_ssim = 0;
   *lowest = G_MAXFLOAT;
   *highest = -G_MAXFLOAT;
 
-  if (self->priv->windows == NULL)
-    gssim_regenerate_windows (self);
-  gssim_calculate_mu (self, org);
+  if (priv->engine == GSSIM_ENGINE_SEPARABLE) {
+    gssim_compare_separable (self, org, mod, out, out_stride, mean, lowest,
+        highest);
+    return;
+  }
+
+  if (priv->weights == NULL)
+    gssim_regenerate_weights (self);
 
-  for (oy = 0; oy < self->priv->height; oy++) {
-    for (ox = 0; ox < self->priv->width; ox++) {
+  for (oy = 0; oy < priv->height; oy++) {
+    for (ox = 0; ox < priv->width; ox++) {
       gfloat mu_o = 0, mu_m = 0;
       gdouble sigma_o = 0, sigma_m = 0, sigma_om = 0;
       gfloat tmp1, tmp2;
-      gfloat elsumm = 0;
       gint weight_y_base, weight_x_base;
       gint weight_offset;
-      gint pixel_offset;
-      gint winstart_y;
-      gint wghstart_y;
-      gint winend_y;
-      gint winstart_x;
-      gint wghstart_x;
-      gint winend_x;
       gfloat weight;
-      gint source_offset;
-
-      source_offset = oy * self->priv->width + ox;
+      SSimWindow win;
 
-      winstart_x = self->priv->windows[source_offset].x_window_start;
-      wghstart_x = self->priv->windows[source_offset].x_weight_start;
-      winend_x = self->priv->windows[source_offset].x_window_end;
-      winstart_y = self->priv->windows[source_offset].y_window_start;
-      wghstart_y = self->priv->windows[source_offset].y_weight_start;
-      winend_y = self->priv->windows[source_offset].y_window_end;
-      elsumm = self->priv->windows[source_offset].element_summ;
+      gssim_get_window (self, ox, oy, &win);
 
-      switch (self->priv->windowtype) {
+      switch (priv->windowtype) {
         case 0:
-          for (iy = winstart_y; iy <= winend_y; iy++) {
-            pixel_offset = iy * self->priv->width;
-            for (ix = winstart_x; ix <= winend_x; ix++) {
-              mu_m += mod[pixel_offset + ix];
+          for (iy = win.y_window_start; iy <= win.y_window_end; iy++) {
+            for (ix = win.x_window_start; ix <= win.x_window_end; ix++) {
+              mu_o += gssim_get_sample (org, ix, iy);
+              mu_m += gssim_get_sample (mod, ix, iy);
             }
           }
-          mu_m = mu_m / elsumm;
-          mu_o = self->priv->orgmu[oy * self->priv->width + ox];
-          for (iy = winstart_y; iy <= winend_y; iy++) {
-            pixel_offset = iy * self->priv->width;
-            for (ix = winstart_x; ix <= winend_x; ix++) {
-              tmp1 = org[pixel_offset + ix] - mu_o;
-              tmp2 = mod[pixel_offset + ix] - mu_m;
+          mu_o = mu_o / win.element_summ;
+          mu_m = mu_m / win.element_summ;
+          for (iy = win.y_window_start; iy <= win.y_window_end; iy++) {
+            for (ix = win.x_window_start; ix <= win.x_window_end; ix++) {
+              tmp1 = gssim_get_sample (org, ix, iy) - mu_o;
+              tmp2 = gssim_get_sample (mod, ix, iy) - mu_m;
               sigma_o += tmp1 * tmp1;
               sigma_m += tmp2 * tmp2;
               sigma_om += tmp1 * tmp2;
@@ -305,35 +758,30 @@ gssim_compare (Gssim * self, guint8 * org, guint8 * mod,
           break;
         case 1:
 
-          weight_y_base = wghstart_y - winstart_y;
-          weight_x_base = wghstart_x - winstart_x;
+          weight_y_base = win.y_weight_start - win.y_window_start;
+          weight_x_base = win.x_weight_start - win.x_window_start;
 
-          for (iy = winstart_y; iy <= winend_y; iy++) {
-            pixel_offset = iy * self->priv->width;
-            weight_offset = (weight_y_base + iy) * self->priv->windowsize +
+          for (iy = win.y_window_start; iy <= win.y_window_end; iy++) {
+            weight_offset = (weight_y_base + iy) * priv->windowsize +
                 weight_x_base;
-            for (ix = winstart_x; ix <= winend_x; ix++) {
-              weight = self->priv->weights[weight_offset + ix];
-              mu_o += weight * org[pixel_offset + ix];
-              mu_m += weight * mod[pixel_offset + ix];
+            for (ix = win.x_window_start; ix <= win.x_window_end; ix++) {
+              weight = priv->weights[weight_offset + ix];
+              mu_o += weight * gssim_get_sample (org, ix, iy);
+              mu_m += weight * gssim_get_sample (mod, ix, iy);
             }
           }
-          mu_m = mu_m / elsumm;
-          mu_o = self->priv->orgmu[oy * self->priv->width + ox];
-          for (iy = winstart_y; iy <= winend_y; iy++) {
+          mu_o = mu_o / win.element_summ;
+          mu_m = mu_m / win.element_summ;
+          for (iy = win.y_window_start; iy <= win.y_window_end; iy++) {
             gfloat *weights_with_offset;
-            guint8 *org_with_offset, *mod_with_offset;
             gfloat wt1, wt2;
-            pixel_offset = iy * self->priv->width;
-            weight_offset = (weight_y_base + iy) * self->priv->windowsize +
+            weight_offset = (weight_y_base + iy) * priv->windowsize +
                 weight_x_base;
-            weights_with_offset = &self->priv->weights[weight_offset];
-            org_with_offset = &org[pixel_offset];
-            mod_with_offset = &mod[pixel_offset];
-            for (ix = winstart_x; ix <= winend_x; ix++) {
+            weights_with_offset = &priv->weights[weight_offset];
+            for (ix = win.x_window_start; ix <= win.x_window_end; ix++) {
               weight = weights_with_offset[ix];
-              tmp1 = org_with_offset[ix] - mu_o;
-              tmp2 = mod_with_offset[ix] - mu_m;
+              tmp1 = gssim_get_sample (org, ix, iy) - mu_o;
+              tmp2 = gssim_get_sample (mod, ix, iy) - mu_m;
               wt1 = weight * tmp1;
               wt2 = weight * tmp2;
               sigma_o += wt1 * tmp1;
@@ -343,25 +791,50 @@ gssim_compare (Gssim * self, guint8 * org, guint8 * mod,
           }
           break;
       }
-      sigma_o = sqrt (sigma_o / elsumm);
-      sigma_m = sqrt (sigma_m / elsumm);
-      sigma_om = sigma_om / elsumm;
+      sigma_o = sqrt (sigma_o / win.element_summ);
+      sigma_m = sqrt (sigma_m / win.element_summ);
+      sigma_om = sigma_om / win.element_summ;
       tmp1 =
-          (2 * mu_o * mu_m + self->priv->const1) * (2 * sigma_om +
-          self->priv->const2) / ((mu_o * mu_o + mu_m * mu_m +
-              self->priv->const1) * (sigma_o * sigma_o + sigma_m * sigma_m +
-              self->priv->const2));
+          (2 * mu_o * mu_m + priv->const1) * (2 * sigma_om +
+          priv->const2) / ((mu_o * mu_o + mu_m * mu_m +
+              priv->const1) * (sigma_o * sigma_o + sigma_m * sigma_m +
+              priv->const2));
 
       /* SSIM can go negative, that's why it is
          127 + index * 128 instead of index * 255 */
       if (out)
-        out[oy * self->priv->width + ox] = 127 + tmp1 * 128;
+        out[oy * out_stride + ox] = 127 + tmp1 * 128;
       *lowest = MIN (*lowest, tmp1);
       *highest = MAX (*highest, tmp1);
       cumulative_ssim += tmp1;
     }
   }
-  *mean = cumulative_ssim / (self->priv->width * self->priv->height);
+  *mean = cumulative_ssim / (priv->width * priv->height);
+}
+
+/* Compares 8-bit frames whose rows are width bytes long */
+void
+gssim_compare (Gssim * self, guint8 * org, guint8 * mod,
+    guint8 * out, gfloat * mean, gfloat * lowest, gfloat * highest)
+{
+  GssimSamples org_samples = { org, self->priv->width, 1, 8, 8, 0, FALSE };
+  GssimSamples mod_samples = { mod, self->priv->width, 1, 8, 8, 0, FALSE };
+
+  gssim_set_depth (self, 8);
+  gssim_compare_samples (self, &org_samples, &mod_samples, out,
+      self->priv->width, mean, lowest, highest);
+}
+
+/* The stabilizing constants of the SSIM formula are (0.01 * L)² and
+ * (0.03 * L)², L being the dynamic range of the samples */
+void
+gssim_set_depth (Gssim * self, guint depth)
+{
+  gdouble range = (1 << depth) - 1;
+
+  self->priv->depth = depth;
+  self->priv->const1 = 0.01 * range * 0.01 * range;
+  self->priv->const2 = 0.03 * range * 0.03 * range;
 }
 
 gboolean
@@ -373,11 +846,8 @@ gssim_configure (Gssim * self, gint width, gint height)
   self->priv->width = width;
   self->priv->height = height;
 
-  g_free (self->priv->windows);
-  self->priv->windows = NULL;
-
-  g_free (self->priv->orgmu);
-  self->priv->orgmu = g_new (gfloat, width * height);
+  /* Only the separable engine keeps per-line state */
+  gssim_free_kernel (self);
 
   return TRUE;
 }
@@ -415,8 +885,11 @@ gssim_finalize (GObject * object)
   void (*chain_up) (GObject *) =
       ((GObjectClass *) gssim_parent_class)->finalize;
 
-  g_free (self->priv->orgmu);
-  g_free (self->priv->windows);
+  g_free (self->priv->weights);
+  g_free (self->priv->element_summs);
+  gssim_free_kernel (self);
+  g_mutex_clear (&self->priv->bands_lock);
+  g_cond_clear (&self->priv->bands_cond);
 
   chain_up (object);
 }
@@ -438,8 +911,13 @@ gssim_init (Gssim * self)
 
   self->priv->windowsize = 11;
   self->priv->windowtype = 1;
-  self->priv->windows = NULL;
   self->priv->sigma = 1.5;
+  gssim_set_depth (self, 8);
+  self->priv->engine = GSSIM_ENGINE_SEPARABLE;
+  self->priv->kernels = gssim_get_kernels (gssim_simd_detect ());
+  self->priv->n_threads = g_get_num_processors ();
+  g_mutex_init (&self->priv->bands_lock);
+  g_cond_init (&self->priv->bands_cond);
 }
 
 Gssim *
@@ -32,6 +32,63 @@ G_BEGIN_DECLS
 
 typedef struct _GssimPrivate GssimPrivate;
 
+/**
+ * GssimEngine:
+ * @GSSIM_ENGINE_SEPARABLE: Computes the windowed statistics with a ring of
+ * horizontally filtered rows, using prefix sums for the box window and
+ * separable 1-D convolutions for the gaussian one.
+ * @GSSIM_ENGINE_REFERENCE: Sums the whole window for every pixel, mostly useful
+ * to check the results of the separable engine.
+ */
+typedef enum {
+  GSSIM_ENGINE_SEPARABLE,
+  GSSIM_ENGINE_REFERENCE,
+} GssimEngine;
+
+/**
+ * GssimSimd:
+ * @GSSIM_SIMD_NONE: Portable scalar code
+ * @GSSIM_SIMD_SSE2: x86 SSE2
+ * @GSSIM_SIMD_AVX2: x86 AVX2
+ *
+ * Instruction sets the inner loops of the separable engine can use. The best
+ * one the CPU supports is picked at runtime.
+ */
+typedef enum {
+  GSSIM_SIMD_NONE,
+  GSSIM_SIMD_SSE2,
+  GSSIM_SIMD_AVX2,
+} GssimSimd;
+
+/* Maximum difference between the similarities computed by both engines. The
+ * reference engine accumulates the mean in single precision, so on frames
+ * bigger than a few hundred thousand pixels the means can drift further apart
+ * (a few 1e-4 on 1080p frames), the separable engine's one being the accurate one */
+#define GSSIM_SEPARABLE_TOLERANCE 1e-4
+
+/**
+ * GssimSamples:
+ * @data: The first sample
+ * @stride: The number of bytes between rows
+ * @pstride: The number of bytes between samples of a row
+ * @bits: The size of the samples container, 8 or 16 bits
+ * @depth: The number of significant bits of a sample
+ * @shift: The number of bits to shift the container right to get a sample
+ * @big_endian: Whether 16 bits containers are stored in big endian
+ *
+ * Describes where the samples of one component of a frame are, so that any
+ * plane can be compared without converting it first.
+ */
+typedef struct {
+  const guint8 *data;
+  gint stride;
+  gint pstride;
+  guint bits;
+  guint depth;
+  guint shift;
+  gboolean big_endian;
+} GssimSamples;
+
 typedef struct {
   GstObject parent;
 
@@ -55,7 +112,15 @@ Gssim * gssim_new    (void);
 void gssim_compare       (Gssim * self, guint8 * org, guint8 * mod,
                           guint8 * out, gfloat * mean, gfloat * lowest,
                           gfloat * highest);
+void gssim_compare_samples (Gssim * self, const GssimSamples * org,
+                            const GssimSamples * mod, guint8 * out,
+                            gint out_stride, gfloat * mean, gfloat * lowest,
+                            gfloat * highest);
 gboolean gssim_configure (Gssim * self, gint width, gint height);
+void gssim_set_depth     (Gssim * self, guint depth);
+void gssim_set_engine    (Gssim * self, GssimEngine engine);
+gboolean gssim_set_simd  (Gssim * self, GssimSimd simd);
+void gssim_set_n_threads (Gssim * self, guint n_threads);
 
 G_END_DECLS
 
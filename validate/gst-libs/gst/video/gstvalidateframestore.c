@@ -0,0 +1,516 @@
+/* GStreamer
+ *
+ * gstvalidateframestore.c: Stores video frames in a single file.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/* A frame store is a file holding many raw video frames, avoiding the cost
+ * of creating one file per frame. It starts with a 16 bytes magic followed
+ * by the frames, each one preceded by a record header giving its timestamp,
+ * format, size and compression. Records are only ever appended, and the
+ * index of the frames is built by walking the record headers of the mapped
+ * file when it is opened, so a store cut by a crash can still be read up to
+ * its last complete record. Frames are numbered in the order they were
+ * appended. */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <gio/gio.h>
+
+#include "gstvalidateframestore.h"
+
+#define STORE_MAGIC "GSTVALIDATEFRM01"
+#define STORE_MAGIC_SIZE 16
+#define RECORD_MAGIC 0x52465647 /* GVFR */
+/* Records start aligned so that mapped frames are aligned too */
+#define RECORD_ALIGN 16
+
+typedef struct
+{
+  guint32 magic;
+  guint32 compression;
+  guint64 timestamp;
+  guint64 size;
+  guint64 raw_size;
+  guint32 format;
+  guint32 width;
+  guint32 height;
+  guint32 padding;
+} RecordHeader;
+
+G_STATIC_ASSERT (sizeof (RecordHeader) == 48);
+
+typedef struct
+{
+  GstClockTime timestamp;
+  gsize offset;
+  gsize size;
+  gsize raw_size;
+  GstVideoFormat format;
+  gint width, height;
+  GstValidateFrameStoreCompression compression;
+} IndexEntry;
+
+struct _GstValidateFrameStore
+{
+  gchar *path;
+
+  /* Frames appended or found in the store */
+  guint n_frames;
+
+  /* Writing */
+  FILE *file;
+  GMutex lock;
+  GstValidateFrameStoreCompression compression;
+  gboolean failed;
+
+  /* Reading */
+  GMappedFile *mapped;
+  GArray *index;
+};
+
+static GstValidateFrameStore *
+gst_validate_frame_store_new (const gchar * path)
+{
+  GstValidateFrameStore *store = g_new0 (GstValidateFrameStore, 1);
+
+  store->path = g_strdup (path);
+  g_mutex_init (&store->lock);
+
+  return store;
+}
+
+/**
+ * gst_validate_frame_store_create:
+ * @path: The path of the store, overwritten if it exists
+ * @compression: How frames are compressed in the store
+ *
+ * Creates a frame store to append frames to.
+ *
+ * Returns: (transfer full) (nullable): The new store
+ */
+GstValidateFrameStore *
+gst_validate_frame_store_create (const gchar * path,
+    GstValidateFrameStoreCompression compression, GError ** error)
+{
+  GstValidateFrameStore *store;
+  FILE *file = fopen (path, "wb");
+
+  if (!file || fwrite (STORE_MAGIC, STORE_MAGIC_SIZE, 1, file) != 1) {
+    g_set_error (error, G_FILE_ERROR, g_file_error_from_errno (errno),
+        "Could not create %s: %s", path, g_strerror (errno));
+    if (file)
+      fclose (file);
+
+    return NULL;
+  }
+
+  store = gst_validate_frame_store_new (path);
+  store->file = file;
+  store->compression = compression;
+
+  return store;
+}
+
+/* Runs @converter on all of @in_data, returning the converted data whose
+ * size is at most @max_size, or of any size when @max_size is 0 */
+static guint8 *
+_convert_all (GConverter * converter, const guint8 * in_data, gsize in_size,
+    gsize max_size, gsize * out_size, GError ** error)
+{
+  /* One more byte than expected so that the converter can finish */
+  gsize alloc = max_size ? max_size + 1 : in_size / 2 + 64;
+  guint8 *out = g_malloc (alloc);
+  gsize total_read = 0, total_written = 0;
+  GConverterResult res;
+
+  do {
+    gsize bytes_read = 0, bytes_written = 0;
+    GError *err = NULL;
+
+    res = g_converter_convert (converter, in_data + total_read,
+        in_size - total_read, out + total_written, alloc - total_written,
+        G_CONVERTER_INPUT_AT_END, &bytes_read, &bytes_written, &err);
+
+    if (res == G_CONVERTER_ERROR) {
+      if (!max_size && g_error_matches (err, G_IO_ERROR, G_IO_ERROR_NO_SPACE)) {
+        g_error_free (err);
+        alloc *= 2;
+        out = g_realloc (out, alloc);
+        continue;
+      }
+
+      g_propagate_error (error, err);
+      g_free (out);
+
+      return NULL;
+    }
+
+    total_read += bytes_read;
+    total_written += bytes_written;
+    if (res != G_CONVERTER_FINISHED && total_written == alloc) {
+      if (max_size) {
+        g_set_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+            "Converted data is bigger than %" G_GSIZE_FORMAT " bytes",
+            max_size);
+        g_free (out);
+
+        return NULL;
+      }
+
+      alloc *= 2;
+      out = g_realloc (out, alloc);
+    }
+  } while (res != G_CONVERTER_FINISHED);
+
+  *out_size = total_written;
+
+  return out;
+}
+
+/**
+ * gst_validate_frame_store_append:
+ * @timestamp: The timestamp of @frame
+ * @frame: The frame to store
+ *
+ * Appends @frame to @store, in the default layout of its format. Can be
+ * called from several threads.
+ *
+ * Returns: The index of the frame in the store, or -1 on error
+ */
+gint
+gst_validate_frame_store_append (GstValidateFrameStore * store,
+    GstClockTime timestamp, GstVideoFrame * frame, GError ** error)
+{
+  static const guint8 zeros[RECORD_ALIGN] = { 0, };
+  GstVideoInfo info;
+  GstBuffer *copy = NULL;
+  GstMapInfo map;
+  const guint8 *data;
+  guint8 *compressed = NULL;
+  gsize size, padding;
+  RecordHeader header = { 0, };
+  gint index = -1;
+
+  g_return_val_if_fail (store->file != NULL, -1);
+
+  gst_video_info_set_format (&info, GST_VIDEO_FRAME_FORMAT (frame),
+      GST_VIDEO_FRAME_WIDTH (frame), GST_VIDEO_FRAME_HEIGHT (frame));
+
+  /* Frames whose planes are not in the default layout are copied first */
+  if (memcmp (info.offset, frame->info.offset, sizeof (info.offset)) ||
+      memcmp (info.stride, frame->info.stride, sizeof (info.stride))) {
+    GstVideoFrame copy_frame;
+
+    copy = gst_buffer_new_allocate (NULL, info.size, NULL);
+    if (!gst_video_frame_map (&copy_frame, &info, copy, GST_MAP_WRITE)) {
+      g_set_error (error, G_IO_ERROR, G_IO_ERROR_FAILED,
+          "Could not map the copy of the frame");
+      gst_buffer_unref (copy);
+
+      return -1;
+    }
+    gst_video_frame_copy (&copy_frame, frame);
+    gst_video_frame_unmap (&copy_frame);
+
+    gst_buffer_map (copy, &map, GST_MAP_READ);
+    data = map.data;
+  } else {
+    data = GST_VIDEO_FRAME_PLANE_DATA (frame, 0);
+  }
+
+  size = info.size;
+  if (store->compression == GST_VALIDATE_FRAME_STORE_COMPRESSION_DEFLATE) {
+    GConverter *compressor =
+        G_CONVERTER (g_zlib_compressor_new (G_ZLIB_COMPRESSOR_FORMAT_RAW, 1));
+
+    compressed = _convert_all (compressor, data, info.size, 0, &size, error);
+    g_object_unref (compressor);
+    if (!compressed)
+      goto done;
+
+    data = compressed;
+  }
+
+  header.magic = GUINT32_TO_LE (RECORD_MAGIC);
+  header.compression = GUINT32_TO_LE (store->compression);
+  header.timestamp = GUINT64_TO_LE (timestamp);
+  header.size = GUINT64_TO_LE (size);
+  header.raw_size = GUINT64_TO_LE (info.size);
+  header.format = GUINT32_TO_LE (GST_VIDEO_INFO_FORMAT (&info));
+  header.width = GUINT32_TO_LE (GST_VIDEO_INFO_WIDTH (&info));
+  header.height = GUINT32_TO_LE (GST_VIDEO_INFO_HEIGHT (&info));
+  padding = GST_ROUND_UP_N (size, RECORD_ALIGN) - size;
+
+  g_mutex_lock (&store->lock);
+  if (store->failed) {
+    g_set_error (error, G_IO_ERROR, G_IO_ERROR_FAILED,
+        "A previous write to %s failed", store->path);
+  } else if (fwrite (&header, sizeof (header), 1, store->file) != 1 ||
+      (size && fwrite (data, size, 1, store->file) != 1) ||
+      (padding && fwrite (zeros, padding, 1, store->file) != 1)) {
+    /* Later records could not be found after a partial one */
+    store->failed = TRUE;
+    g_set_error (error, G_FILE_ERROR, g_file_error_from_errno (errno),
+        "Could not write to %s: %s", store->path, g_strerror (errno));
+  } else {
+    index = store->n_frames++;
+  }
+  g_mutex_unlock (&store->lock);
+
+done:
+  g_free (compressed);
+  if (copy) {
+    gst_buffer_unmap (copy, &map);
+    gst_buffer_unref (copy);
+  }
+
+  return index;
+}
+
+/**
+ * gst_validate_frame_store_open:
+ * @path: The path of the store
+ *
+ * Maps a frame store to read its frames.
+ *
+ * Returns: (transfer full) (nullable): The store
+ */
+GstValidateFrameStore *
+gst_validate_frame_store_open (const gchar * path, GError ** error)
+{
+  GstValidateFrameStore *store;
+  GMappedFile *mapped = g_mapped_file_new (path, FALSE, error);
+  const gchar *data;
+  gsize length, offset = STORE_MAGIC_SIZE;
+
+  if (!mapped)
+    return NULL;
+
+  data = g_mapped_file_get_contents (mapped);
+  length = g_mapped_file_get_length (mapped);
+  if (length < STORE_MAGIC_SIZE || memcmp (data, STORE_MAGIC,
+          STORE_MAGIC_SIZE)) {
+    g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_INVAL,
+        "%s is not a frame store", path);
+    g_mapped_file_unref (mapped);
+
+    return NULL;
+  }
+
+  store = gst_validate_frame_store_new (path);
+  store->mapped = mapped;
+  store->index = g_array_new (FALSE, FALSE, sizeof (IndexEntry));
+
+  /* Stops at the first incomplete record */
+  while (length - offset >= sizeof (RecordHeader)) {
+    RecordHeader header;
+    IndexEntry entry;
+
+    memcpy (&header, data + offset, sizeof (header));
+    if (GUINT32_FROM_LE (header.magic) != RECORD_MAGIC)
+      break;
+
+    entry.offset = offset + sizeof (header);
+    entry.size = GUINT64_FROM_LE (header.size);
+    if (entry.size > length - entry.offset)
+      break;
+
+    entry.timestamp = GUINT64_FROM_LE (header.timestamp);
+    entry.raw_size = GUINT64_FROM_LE (header.raw_size);
+    entry.format = GUINT32_FROM_LE (header.format);
+    entry.width = GUINT32_FROM_LE (header.width);
+    entry.height = GUINT32_FROM_LE (header.height);
+    entry.compression = GUINT32_FROM_LE (header.compression);
+    g_array_append_val (store->index, entry);
+
+    if (GST_ROUND_UP_N (entry.size, RECORD_ALIGN) >= length - entry.offset)
+      break;
+    offset = entry.offset + GST_ROUND_UP_N (entry.size, RECORD_ALIGN);
+  }
+  store->n_frames = store->index->len;
+
+  return store;
+}
+
+guint
+gst_validate_frame_store_get_n_frames (GstValidateFrameStore * store)
+{
+  return store->n_frames;
+}
+
+GstClockTime
+gst_validate_frame_store_get_timestamp (GstValidateFrameStore * store,
+    guint index)
+{
+  g_return_val_if_fail (store->index != NULL, GST_CLOCK_TIME_NONE);
+  g_return_val_if_fail (index < store->index->len, GST_CLOCK_TIME_NONE);
+
+  return g_array_index (store->index, IndexEntry, index).timestamp;
+}
+
+/**
+ * gst_validate_frame_store_get_frame:
+ * @index: The index of the frame, in the order frames were appended
+ * @frame: (out): The frame, to be unmapped with gst_video_frame_unmap()
+ *
+ * Gets a frame from a store opened with gst_validate_frame_store_open().
+ * Uncompressed frames are not copied, their data is read from the mapped
+ * store. Can be called from several threads.
+ */
+gboolean
+gst_validate_frame_store_get_frame (GstValidateFrameStore * store,
+    guint index, GstVideoFrame * frame, GError ** error)
+{
+  IndexEntry *entry;
+  GstVideoInfo info;
+  GstBuffer *buffer;
+  const guint8 *data;
+
+  g_return_val_if_fail (store->index != NULL, FALSE);
+  g_return_val_if_fail (index < store->index->len, FALSE);
+
+  entry = &g_array_index (store->index, IndexEntry, index);
+  data = (const guint8 *) g_mapped_file_get_contents (store->mapped) +
+      entry->offset;
+
+  gst_video_info_init (&info);
+  if (entry->format == GST_VIDEO_FORMAT_UNKNOWN ||
+      entry->format == GST_VIDEO_FORMAT_ENCODED ||
+      !gst_video_format_get_info (entry->format) ||
+      !gst_video_info_set_format (&info, entry->format, entry->width,
+          entry->height) || info.size != entry->raw_size)
+    goto corrupted;
+
+  if (entry->compression == GST_VALIDATE_FRAME_STORE_COMPRESSION_NONE) {
+    if (entry->size != entry->raw_size)
+      goto corrupted;
+
+    buffer = gst_buffer_new_wrapped_full (GST_MEMORY_FLAG_READONLY,
+        (gpointer) data, entry->size, 0, entry->size,
+        g_mapped_file_ref (store->mapped),
+        (GDestroyNotify) g_mapped_file_unref);
+  } else if (entry->compression ==
+      GST_VALIDATE_FRAME_STORE_COMPRESSION_DEFLATE) {
+    GConverter *decompressor =
+        G_CONVERTER (g_zlib_decompressor_new (G_ZLIB_COMPRESSOR_FORMAT_RAW));
+    guint8 *raw;
+    gsize size;
+
+    raw = _convert_all (decompressor, data, entry->size, entry->raw_size,
+        &size, error);
+    g_object_unref (decompressor);
+    if (!raw)
+      return FALSE;
+
+    if (size != entry->raw_size) {
+      g_free (raw);
+      goto corrupted;
+    }
+
+    buffer = gst_buffer_new_wrapped (raw, size);
+  } else {
+    goto corrupted;
+  }
+
+  if (!gst_video_frame_map (frame, &info, buffer, GST_MAP_READ)) {
+    g_set_error (error, G_IO_ERROR, G_IO_ERROR_FAILED,
+        "Could not map frame %u of %s", index, store->path);
+    gst_buffer_unref (buffer);
+
+    return FALSE;
+  }
+  gst_buffer_unref (buffer);
+
+  return TRUE;
+
+corrupted:
+  g_set_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+      "Frame %u of %s is corrupted", index, store->path);
+
+  return FALSE;
+}
+
+const gchar *
+gst_validate_frame_store_get_path (GstValidateFrameStore * store)
+{
+  return store->path;
+}
+
+/* Also closes the file of stores being written, after which they can be
+ * opened */
+void
+gst_validate_frame_store_free (GstValidateFrameStore * store)
+{
+  if (store->file)
+    fclose (store->file);
+  if (store->mapped)
+    g_mapped_file_unref (store->mapped);
+  if (store->index)
+    g_array_unref (store->index);
+  g_mutex_clear (&store->lock);
+  g_free (store->path);
+  g_free (store);
+}
+
+gboolean
+gst_validate_frame_store_is_store (const gchar * path)
+{
+  return g_str_has_suffix (path, GST_VALIDATE_FRAME_STORE_EXTENSION) &&
+      g_file_test (path, G_FILE_TEST_IS_REGULAR);
+}
+
+/* Frames of stores are named after the store and their index, so that they
+ * can be used where image files are expected */
+gchar *
+gst_validate_frame_store_get_frame_path (const gchar * store_path,
+    guint index)
+{
+  return g_strdup_printf ("%s#%u", store_path, index);
+}
+
+gboolean
+gst_validate_frame_store_parse_frame_path (const gchar * path,
+    gchar ** store_path, guint * index)
+{
+  const gchar *sep = strrchr (path, '#');
+  gchar *end;
+  guint64 value;
+
+  if (!sep || sep == path || !g_ascii_isdigit (sep[1]))
+    return FALSE;
+
+  value = g_ascii_strtoull (sep + 1, &end, 10);
+  if (*end || value > G_MAXUINT)
+    return FALSE;
+
+  *store_path = g_strndup (path, sep - path);
+  if (!g_str_has_suffix (*store_path, GST_VALIDATE_FRAME_STORE_EXTENSION)) {
+    g_clear_pointer (store_path, g_free);
+
+    return FALSE;
+  }
+  *index = value;
+
+  return TRUE;
+}
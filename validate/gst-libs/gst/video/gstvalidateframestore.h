@@ -0,0 +1,70 @@
+/* GStreamer
+ *
+ * gstvalidateframestore.h: Stores video frames in a single file.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifndef _GST_VALIDATE_FRAME_STORE_H
+#define _GST_VALIDATE_FRAME_STORE_H
+
+#include <glib.h>
+#include <gst/gst.h>
+#include <gst/video/video.h>
+
+G_BEGIN_DECLS
+
+#define GST_VALIDATE_FRAME_STORE_EXTENSION ".frames"
+
+typedef struct _GstValidateFrameStore GstValidateFrameStore;
+
+typedef enum {
+  GST_VALIDATE_FRAME_STORE_COMPRESSION_NONE,
+  GST_VALIDATE_FRAME_STORE_COMPRESSION_DEFLATE,
+} GstValidateFrameStoreCompression;
+
+GstValidateFrameStore * gst_validate_frame_store_create     (const gchar * path,
+                                                             GstValidateFrameStoreCompression compression,
+                                                             GError ** error);
+gint gst_validate_frame_store_append                        (GstValidateFrameStore * store,
+                                                             GstClockTime timestamp,
+                                                             GstVideoFrame * frame,
+                                                             GError ** error);
+
+GstValidateFrameStore * gst_validate_frame_store_open       (const gchar * path,
+                                                             GError ** error);
+guint gst_validate_frame_store_get_n_frames                 (GstValidateFrameStore * store);
+GstClockTime gst_validate_frame_store_get_timestamp         (GstValidateFrameStore * store,
+                                                             guint index);
+gboolean gst_validate_frame_store_get_frame                 (GstValidateFrameStore * store,
+                                                             guint index,
+                                                             GstVideoFrame * frame,
+                                                             GError ** error);
+
+const gchar * gst_validate_frame_store_get_path             (GstValidateFrameStore * store);
+
+void gst_validate_frame_store_free                          (GstValidateFrameStore * store);
+
+gboolean gst_validate_frame_store_is_store                  (const gchar * path);
+gchar * gst_validate_frame_store_get_frame_path             (const gchar * store_path,
+                                                             guint index);
+gboolean gst_validate_frame_store_parse_frame_path          (const gchar * path,
+                                                             gchar ** store_path,
+                                                             guint * index);
+
+G_END_DECLS
+
+#endif
@@ -23,9 +23,11 @@
 #include <math.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 
 #include <errno.h>
 #include "gstvalidatessim.h"
+#include "gstvalidateframestore.h"
 #include "gssim.h"
 
 #include <cairo.h>
@@ -40,6 +42,7 @@ GST_DEBUG_CATEGORY_STATIC (GST_CAT_DEFAULT);
 #define SIMILARITY_ISSUE g_quark_from_static_string ("ssim::image-not-similar-enough")
 #define GENERAL_INPUT_ERROR g_quark_from_static_string ("ssim::general-file-error")
 #define WRONG_FORMAT g_quark_from_static_string ("ssim::wrong-format")
+#define MISSING_FRAME g_quark_from_static_string ("ssim::missing-frame")
 
 enum
 {
@@ -55,12 +58,23 @@ typedef struct
   GstVideoInfo out_info;
 } SSimConverterInfo;
 
+/* Number of scales MS-SSIM is computed from */
+#define MS_SSIM_SCALES 5
+
 struct _GstValidateSsimPrivate
 {
   gint width;
   gint height;
 
   Gssim *ssim;
+  /* Compares the chroma planes, whose size can differ from the luma one */
+  Gssim *chroma_ssim;
+  gboolean compare_chroma;
+
+  GstValidateSsimMode mode;
+  /* Compare the luma and chroma of each downscaled level, created when
+   * first used */
+  Gssim *scaled_ssim[MS_SSIM_SCALES - 1][2];
 
   GList *converters;
   GstVideoInfo out_info;
@@ -70,10 +84,86 @@ struct _GstValidateSsimPrivate
   gfloat min_avg_similarity;
   gfloat min_lowest_similarity;
 
+  /* PSNR, in dB, above which frames are accepted and under which they are
+   * rejected without computing their SSIM, 0 to disable */
+  gdouble accept_psnr;
+  gdouble reject_psnr;
+  guint64 n_resolved[GST_VALIDATE_SSIM_N_STAGES];
+
+  /* Protects ref_frames_cache, prefetched_refs and the decoded references
+   * cache */
+  GMutex lock;
+  GCond prefetch_cond;
   GHashTable *ref_frames_cache;
   gint fps_n, fps_d;
+  guint n_threads;
+
+  /* Reference frames being decoded in prefetch_pool, by path */
+  GThreadPool *prefetch_pool;
+  GHashTable *prefetched_refs;
+
+  /* Decoded reference frames by path, the most recently used ones first in
+   * ref_cache_lru, whose total size is kept under ref_cache_max_size */
+  GHashTable *ref_cache;
+  GQueue ref_cache_lru;
+  gsize ref_cache_size;
+  gsize ref_cache_max_size;
+  guint64 ref_cache_hits;
+  guint64 ref_cache_misses;
+
+  /* Frame stores opened to read their frames, by path */
+  GMutex stores_lock;
+  GHashTable *stores;
+};
+
+#define DEFAULT_REF_CACHE_SIZE (256 * 1024 * 1024)
+
+/* Weights of the similarity of each scale in MS-SSIM, from "Multi-scale
+ * structural similarity for image quality assessment" by Wang et al. */
+static const gdouble ms_ssim_weights[MS_SSIM_SCALES] = {
+  0.0448, 0.2856, 0.3001, 0.2363, 0.1333
+};
+
+/* Downscaled levels smaller than this are not compared, the SSIM window
+ * being 11 samples wide */
+#define MIN_SCALE_SIZE 16
+
+static const gchar *mode_names[] = {
+  "full", "decimate-2", "decimate-4", "ms-ssim"
 };
 
+/* A component of a frame, or a downscaled version of it whose samples are
+ * stored in data */
+typedef struct
+{
+  GssimSamples samples;
+  gint width;
+  gint height;
+  guint16 *data;
+} ScaleLevel;
+
+/* Maximum number of reference frames decoded ahead of their comparison */
+#define MAX_PREFETCHED_REFS 16
+
+typedef struct
+{
+  gchar *path;
+  GstVideoFrame frame;
+  gboolean ready;
+  gboolean valid;
+  /* Removed from prefetched_refs while being decoded, the prefetch pool
+   * frees it */
+  gboolean dropped;
+} PrefetchedRef;
+
+typedef struct
+{
+  gchar *path;
+  GstBuffer *buffer;
+  GstVideoInfo info;
+  GList link;
+} CachedRef;
+
 G_DEFINE_TYPE_WITH_CODE (GstValidateSsim, gst_validate_ssim,
     GST_TYPE_OBJECT, G_ADD_PRIVATE (GstValidateSsim)
     G_IMPLEMENT_INTERFACE (GST_TYPE_VALIDATE_REPORTER, NULL));
@@ -259,297 +349,905 @@ _get_format_from_surface (cairo_surface_t * surface)
 #endif
 }
 
-void
-gst_validate_ssim_compare_frames (GstValidateSsim * self,
-    GstVideoFrame * ref_frame, GstVideoFrame * frame, GstBuffer ** outbuf,
-    gfloat * mean, gfloat * lowest, gfloat * highest)
+/* Whether gssim can read the components of both frames in place, without
+ * converting them to I420 first. YUV and gray formats with 8 or 16 bits
+ * containers are supported, at their native depth. Other formats are
+ * converted so that their luma is compared. */
+static gboolean
+gst_validate_ssim_can_compare_natively (GstVideoFrame * ref_frame,
+    GstVideoFrame * frame)
 {
-  gboolean reconf;
-  guint8 *outdata = NULL;
-  GstMapInfo map1, map2, outmap;
+  const GstVideoFormatInfo *finfo = ref_frame->info.finfo;
+  guint i;
 
-  GstVideoFrame converted_frame1, converted_frame2;
-  SSimConverterInfo *convinfo1, *convinfo2;
+  if (GST_VIDEO_FRAME_FORMAT (ref_frame) != GST_VIDEO_FRAME_FORMAT (frame) ||
+      GST_VIDEO_FRAME_WIDTH (ref_frame) != GST_VIDEO_FRAME_WIDTH (frame) ||
+      GST_VIDEO_FRAME_HEIGHT (ref_frame) != GST_VIDEO_FRAME_HEIGHT (frame))
+    return FALSE;
 
-  reconf =
-      gst_validate_ssim_configure (self, ref_frame->info.width,
-      ref_frame->info.height);
+  if (!GST_VIDEO_FORMAT_INFO_IS_YUV (finfo) &&
+      !GST_VIDEO_FORMAT_INFO_IS_GRAY (finfo))
+    return FALSE;
 
-  gst_validate_ssim_configure_converter (self, 0, reconf,
-      ref_frame->info.finfo->format, ref_frame->info.width,
-      ref_frame->info.height);
+  if (GST_VIDEO_FORMAT_INFO_IS_COMPLEX (finfo) ||
+      GST_VIDEO_FORMAT_INFO_IS_TILED (finfo) ||
+      GST_VIDEO_FORMAT_INFO_HAS_PALETTE (finfo))
+    return FALSE;
 
-  gst_validate_ssim_configure_converter (self, 1, reconf,
-      frame->info.finfo->format, frame->info.width, frame->info.height);
+  if (GST_VIDEO_FORMAT_INFO_BITS (finfo) != 8 &&
+      GST_VIDEO_FORMAT_INFO_BITS (finfo) != 16)
+    return FALSE;
 
-  convinfo1 = (SSimConverterInfo *) g_list_nth_data (self->priv->converters, 0);
-  if (convinfo1->converter)
-    gst_validate_ssim_convert (self, convinfo1, ref_frame, &converted_frame1);
-  else
-    converted_frame1 = *ref_frame;
+  for (i = 0; i < GST_VIDEO_FORMAT_INFO_N_COMPONENTS (finfo); i++) {
+    if (GST_VIDEO_FORMAT_INFO_PSTRIDE (finfo, i) <= 0 ||
+        GST_VIDEO_FORMAT_INFO_DEPTH (finfo, i) +
+        GST_VIDEO_FORMAT_INFO_SHIFT (finfo, i) >
+        GST_VIDEO_FORMAT_INFO_BITS (finfo))
+      return FALSE;
+  }
 
-  convinfo2 = (SSimConverterInfo *) g_list_nth_data (self->priv->converters, 1);
-  if (convinfo2->converter)
-    gst_validate_ssim_convert (self, convinfo2, frame, &converted_frame2);
-  else
-    converted_frame2 = *frame;
+  return TRUE;
+}
 
-  if (!gst_buffer_map (converted_frame1.buffer, &map1, GST_MAP_READ)) {
-    GST_VALIDATE_REPORT (self, GENERAL_INPUT_ERROR,
-        "Could not map reference frame");
+static void
+gst_validate_ssim_get_samples (GstVideoFrame * frame, guint comp,
+    GssimSamples * samples)
+{
+  const GstVideoFormatInfo *finfo = frame->info.finfo;
+
+  samples->data = GST_VIDEO_FRAME_COMP_DATA (frame, comp);
+  samples->stride = GST_VIDEO_FRAME_COMP_STRIDE (frame, comp);
+  samples->pstride = GST_VIDEO_FRAME_COMP_PSTRIDE (frame, comp);
+  samples->bits = GST_VIDEO_FORMAT_INFO_BITS (finfo);
+  samples->depth = GST_VIDEO_FORMAT_INFO_DEPTH (finfo, comp);
+  samples->shift = GST_VIDEO_FORMAT_INFO_SHIFT (finfo, comp);
+  samples->big_endian = !GST_VIDEO_FORMAT_INFO_IS_LE (finfo);
+}
 
-    return;
-  }
+static guint
+gst_validate_ssim_get_compared_components (GstValidateSsim * self,
+    GstVideoFrame * frame)
+{
+  if (self->priv->compare_chroma &&
+      GST_VIDEO_FORMAT_INFO_IS_YUV (frame->info.finfo))
+    return 3;
 
-  if (!gst_buffer_map (converted_frame2.buffer, &map2, GST_MAP_READ)) {
-    gst_buffer_unmap (converted_frame1.buffer, &map1);
-    GST_VALIDATE_REPORT (self, GENERAL_INPUT_ERROR,
-        "Could not map compared frame");
+  return 1;
+}
 
-    return;
-  }
+static inline gint
+gst_validate_ssim_read_sample (const GssimSamples * samples,
+    const guint8 * row, gint x)
+{
+  const guint8 *p = row + x * samples->pstride;
+  guint value;
 
-  if (outbuf) {
-    *outbuf = gst_buffer_new_and_alloc (GST_ROUND_UP_4 (self->priv->width) *
-        self->priv->height);
-    if (!gst_buffer_map (*outbuf, &outmap, GST_MAP_WRITE)) {
-      GST_VALIDATE_REPORT (self, GENERAL_INPUT_ERROR,
-          "Could not map output frame");
+  if (samples->bits == 8)
+    value = *p;
+  else if (samples->big_endian)
+    value = GST_READ_UINT16_BE (p);
+  else
+    value = GST_READ_UINT16_LE (p);
 
-      gst_buffer_unref (*outbuf);
-      gst_buffer_unmap (converted_frame1.buffer, &map1);
-      gst_buffer_unmap (converted_frame2.buffer, &map2);
-      *outbuf = NULL;
+  return (value >> samples->shift) & ((1 << samples->depth) - 1);
+}
 
-      return;
-    }
+/* Sum of the squared differences between the samples of a component. Rows
+ * of contiguous 8 bits samples get a loop the compiler can vectorize. */
+static guint64
+gst_validate_ssim_get_squared_error (const GssimSamples * org,
+    const GssimSamples * mod, gint width, gint height)
+{
+  gboolean contiguous = org->bits == 8 && org->depth == 8 &&
+      org->pstride == 1 && mod->pstride == 1;
+  guint64 total = 0;
+  gint x, y;
 
-    outdata = outmap.data;
-  }
+  for (y = 0; y < height; y++) {
+    const guint8 *org_row = org->data + (gsize) y * org->stride;
+    const guint8 *mod_row = mod->data + (gsize) y * mod->stride;
+    guint64 row_total = 0;
 
-  gssim_compare (self->priv->ssim, map1.data, map2.data, outdata, mean,
-      lowest, highest);
+    if (contiguous) {
+      for (x = 0; x < width; x++) {
+        gint diff = (gint) org_row[x] - (gint) mod_row[x];
 
-  gst_buffer_unmap (ref_frame->buffer, &map1);
-  gst_buffer_unmap (frame->buffer, &map2);
+        row_total += (guint) (diff * diff);
+      }
+    } else {
+      for (x = 0; x < width; x++) {
+        gint64 diff = gst_validate_ssim_read_sample (org, org_row, x) -
+            gst_validate_ssim_read_sample (mod, mod_row, x);
 
-  if (convinfo1->converter)
-    gst_video_frame_unmap (&converted_frame1);
-  if (convinfo2->converter)
-    gst_video_frame_unmap (&converted_frame2);
+        row_total += diff * diff;
+      }
+    }
 
-  if (outbuf)
-    gst_buffer_unmap (*outbuf, &outmap);
+    total += row_total;
+  }
+
+  return total;
 }
 
 static gboolean
-gst_validate_ssim_get_frame_from_png (GstValidateSsim * self, const char *file,
-    GstVideoFrame * frame)
+gst_validate_ssim_components_are_identical (const GssimSamples * org,
+    const GssimSamples * mod, gint width, gint height)
 {
-  guint8 *data;
-  GstBuffer *buf;
-  GstVideoInfo info;
-  cairo_surface_t *surface = NULL;
-
-  surface = cairo_image_surface_create_from_png (file);
-  if (surface == NULL
-      || (cairo_surface_status (surface) != CAIRO_STATUS_SUCCESS)) {
-    GST_VALIDATE_REPORT (self, GENERAL_INPUT_ERROR, "Could not open %s: %s",
-        file, cairo_status_to_string (cairo_surface_status (surface)));
+  gsize row_size = (gsize) (width - 1) * org->pstride + org->bits / 8;
+  gint y;
 
+  if (org->pstride != mod->pstride)
     return FALSE;
-  }
-
-  gst_video_info_init (&info);
-  gst_video_info_set_format (&info,
-      _get_format_from_surface (surface),
-      cairo_image_surface_get_width (surface),
-      cairo_image_surface_get_height (surface));
-
-  cairo_surface_flush (surface);
-  data = cairo_image_surface_get_data (surface);
-  buf = gst_buffer_new_wrapped_full (GST_MEMORY_FLAG_READONLY,
-      data, info.size, 0, info.size, surface,
-      (GDestroyNotify) cairo_surface_destroy);
-  if (!gst_video_frame_map (frame, &info, buf, GST_MAP_READ)) {
-    gst_buffer_unref (buf);
-    GST_VALIDATE_REPORT (self, GENERAL_INPUT_ERROR,
-        "Could not map input frame");
 
-    return FALSE;
+  for (y = 0; y < height; y++) {
+    if (memcmp (org->data + (gsize) y * org->stride,
+            mod->data + (gsize) y * mod->stride, row_size))
+      return FALSE;
   }
 
-  gst_buffer_unref (buf);
-
   return TRUE;
 }
 
-static gboolean
-gst_validate_ssim_get_frame_from_file (GstValidateSsim * self, const char *file,
-    GstVideoFrame * frame)
+/* Fills the result image of frames whose SSIM was not computed: white when
+ * they were accepted, and the absolute difference of their luma when they
+ * were rejected, darker pixels being more different */
+static void
+gst_validate_ssim_fill_out (GstVideoFrame * ref_frame, GstVideoFrame * frame,
+    gboolean accepted, guint8 * outdata, gint out_stride)
 {
-  gchar *data;
-  gsize length;
-  GstBuffer *buf;
-  GstVideoInfo info;
-  GstVideoFormat format;
-  gint strv_length, width, height;
-
-  gboolean res = TRUE;
-  gchar **splited_name = NULL, **splited_size = NULL, *strformat;
+  gint width = GST_VIDEO_FRAME_COMP_WIDTH (ref_frame, 0);
+  gint height = GST_VIDEO_FRAME_COMP_HEIGHT (ref_frame, 0);
+  GssimSamples org, mod;
+  gint x, y;
 
-  GError *error = NULL;
+  if (accepted) {
+    for (y = 0; y < height; y++)
+      memset (outdata + (gsize) y * out_stride, 255, width);
 
-  if (g_str_has_suffix (file, ".png")) {
-    return gst_validate_ssim_get_frame_from_png (self, file, frame);
+    return;
   }
 
-  splited_name = g_strsplit (file, ".", -1);
-  strv_length = g_strv_length (splited_name);
+  gst_validate_ssim_get_samples (ref_frame, 0, &org);
+  gst_validate_ssim_get_samples (frame, 0, &mod);
+  for (y = 0; y < height; y++) {
+    const guint8 *org_row = org.data + (gsize) y * org.stride;
+    const guint8 *mod_row = mod.data + (gsize) y * mod.stride;
 
-  strformat = splited_name[strv_length - 1];
-  format = gst_video_format_from_string (strformat);
-  if (format == GST_VIDEO_FORMAT_UNKNOWN) {
-    GST_VALIDATE_REPORT (self, WRONG_FORMAT, "Unknown format: %s", strformat);
+    for (x = 0; x < width; x++) {
+      gint diff = ABS (gst_validate_ssim_read_sample (&org, org_row, x) -
+          gst_validate_ssim_read_sample (&mod, mod_row, x));
 
-    goto fail;
+      if (org.depth > 8)
+        diff >>= org.depth - 8;
+      outdata[(gsize) y * out_stride + x] = 255 - diff;
+    }
   }
+}
 
-  splited_size = g_strsplit (splited_name[strv_length - 2], "x", -1);
-  if (g_strv_length (splited_size) != 2) {
-    GST_VALIDATE_REPORT (self, WRONG_FORMAT,
-        "Can not determine video size from filename: %s ", file);
-
-    goto fail;
+/* Tries to decide whether the frames are similar without computing their
+ * SSIM: bit-identical frames are fully similar, and when PSNR thresholds
+ * are set, frames whose PSNR is above accept_psnr are considered fully
+ * similar and the ones under reject_psnr completely different. */
+static GstValidateSsimStage
+gst_validate_ssim_precheck (GstValidateSsim * self,
+    GstVideoFrame * ref_frame, GstVideoFrame * frame, gfloat * mean,
+    gfloat * lowest, gfloat * highest)
+{
+  guint i, n_components =
+      gst_validate_ssim_get_compared_components (self, ref_frame);
+  gboolean identical = TRUE;
+  guint64 squared_error = 0, n_samples = 0;
+  gdouble mse, max_value, psnr;
+
+  for (i = 0; i < n_components && identical; i++) {
+    GssimSamples org, mod;
+
+    gst_validate_ssim_get_samples (ref_frame, i, &org);
+    gst_validate_ssim_get_samples (frame, i, &mod);
+    identical = gst_validate_ssim_components_are_identical (&org, &mod,
+        GST_VIDEO_FRAME_COMP_WIDTH (ref_frame, i),
+        GST_VIDEO_FRAME_COMP_HEIGHT (ref_frame, i));
   }
 
-  errno = 0;
-  width = g_ascii_strtoull (splited_size[0], NULL, 10);
-  if (errno) {
-    GST_VALIDATE_REPORT (self, WRONG_FORMAT,
-        "Can not determine video size from filename: %s ", file);
+  if (identical) {
+    *mean = *lowest = *highest = 1.0;
 
-    goto fail;
+    return GST_VALIDATE_SSIM_STAGE_IDENTICAL;
   }
 
-  errno = 0;
-  height = g_ascii_strtoull (splited_size[1], NULL, 10);
-  if (errno) {
-    GST_VALIDATE_REPORT (self, WRONG_FORMAT,
-        "Can not determine video size from filename: %s ", file);
+  if (self->priv->accept_psnr <= 0 && self->priv->reject_psnr <= 0)
+    return GST_VALIDATE_SSIM_STAGE_SSIM;
 
-    goto fail;
+  for (i = 0; i < n_components; i++) {
+    gint width = GST_VIDEO_FRAME_COMP_WIDTH (ref_frame, i);
+    gint height = GST_VIDEO_FRAME_COMP_HEIGHT (ref_frame, i);
+    GssimSamples org, mod;
+
+    gst_validate_ssim_get_samples (ref_frame, i, &org);
+    gst_validate_ssim_get_samples (frame, i, &mod);
+    squared_error += gst_validate_ssim_get_squared_error (&org, &mod, width,
+        height);
+    n_samples += (guint64) width * height;
   }
 
-  gst_video_info_init (&info);
-  gst_video_info_set_format (&info, format, width, height);
+  mse = (gdouble) squared_error / n_samples;
+  max_value = (1 << GST_VIDEO_FORMAT_INFO_DEPTH (ref_frame->info.finfo, 0)) - 1;
+  psnr = 10 * log10 (max_value * max_value / mse);
+  GST_LOG_OBJECT (self, "PSNR: %f dB", psnr);
 
-  if (!g_file_get_contents (file, &data, &length, &error)) {
-    GST_VALIDATE_REPORT (self, GENERAL_INPUT_ERROR, "Could not open %s: %s",
-        file, error->message);
-    g_error_free (error);
+  if (self->priv->accept_psnr > 0 && psnr >= self->priv->accept_psnr) {
+    *mean = *lowest = *highest = 1.0;
 
-    goto fail;
+    return GST_VALIDATE_SSIM_STAGE_PSNR_ACCEPTED;
   }
 
-  buf = gst_buffer_new_wrapped (data, length);
-  if (!gst_video_frame_map (frame, &info, buf, GST_MAP_READ)) {
-    gst_buffer_unref (buf);
-    GST_VALIDATE_REPORT (self, GENERAL_INPUT_ERROR,
-        "Could not map input frame");
+  if (self->priv->reject_psnr > 0 && psnr < self->priv->reject_psnr) {
+    *mean = *lowest = *highest = 0.0;
 
-    goto fail;
+    return GST_VALIDATE_SSIM_STAGE_PSNR_REJECTED;
   }
-  gst_buffer_unref (buf);
-
-done:
-  g_strfreev (splited_name);
-  g_strfreev (splited_size);
 
-  return res;
-
-fail:
-  res = FALSE;
-
-  goto done;
+  return GST_VALIDATE_SSIM_STAGE_SSIM;
 }
 
+/* Halves the size of @src, averaging blocks of 2x2 samples. Returns %FALSE
+ * if the level would be too small to be compared. */
 static gboolean
-_filename_get_timestamp (GstValidateSsim * self, const gchar * filename,
-    GstClockTime * ts)
+gst_validate_ssim_downscale (const ScaleLevel * src, ScaleLevel * dest)
 {
-  guint h, m, s, ns;
-  gchar *bname = g_path_get_basename (filename);
-  gchar *other = g_strdup (bname);
-  gboolean res = TRUE;
-
-  if (sscanf (bname, "%" GST_VALIDATE_SSIM_TIME_FORMAT "%s", &h, &m, &s, &ns,
-          other) < 4) {
-    GST_INFO_OBJECT (self, "Can not sscanf %s", bname);
+  gint x, y;
 
-    goto fail;
-  }
+  dest->width = src->width / 2;
+  dest->height = src->height / 2;
+  if (dest->width < MIN_SCALE_SIZE || dest->height < MIN_SCALE_SIZE)
+    return FALSE;
 
-  *ts = (h * 3600 + m * 60 + s) * GST_SECOND + ns;
+  dest->data = g_new (guint16, (gsize) dest->width * dest->height);
+  for (y = 0; y < dest->height; y++) {
+    const guint8 *row0 = src->samples.data + (gsize) 2 * y *
+        src->samples.stride;
+    const guint8 *row1 = row0 + src->samples.stride;
+    guint16 *dest_row = dest->data + (gsize) y * dest->width;
 
-done:
-  g_free (other);
-  g_free (bname);
-  return res;
+    for (x = 0; x < dest->width; x++) {
+      guint sum = gst_validate_ssim_read_sample (&src->samples, row0, 2 * x) +
+          gst_validate_ssim_read_sample (&src->samples, row0, 2 * x + 1) +
+          gst_validate_ssim_read_sample (&src->samples, row1, 2 * x) +
+          gst_validate_ssim_read_sample (&src->samples, row1, 2 * x + 1);
 
-fail:
-  res = FALSE;
-  goto done;
-}
+      dest_row[x] = (sum + 2) / 4;
+    }
+  }
 
-typedef struct
-{
-  gchar *path;
-  GstClockTime ts;
-} Frame;
+  dest->samples.data = (const guint8 *) dest->data;
+  dest->samples.stride = dest->width * sizeof (guint16);
+  dest->samples.pstride = sizeof (guint16);
+  dest->samples.bits = 16;
+  dest->samples.depth = src->samples.depth;
+  dest->samples.shift = 0;
+  dest->samples.big_endian = G_BYTE_ORDER == G_BIG_ENDIAN;
 
-static void
-_free_frame (Frame * frame)
-{
-  g_free (frame->path);
+  return TRUE;
 }
 
-static gint
-_sort_frames (Frame * a, Frame * b)
+/* Compares a component at @level of the pyramids of both frames. The result
+ * image of downscaled levels is scaled back to the size of the frame. */
+static void
+gst_validate_ssim_compare_level (GstValidateSsim * self, guint comp,
+    guint level, const ScaleLevel * org, const ScaleLevel * mod,
+    guint8 * outdata, gint out_stride, gfloat * mean, gfloat * lowest,
+    gfloat * highest)
 {
-  if (a->ts < b->ts)
-    return -1;
-
-  if (a->ts == b->ts)
-    return 0;
+  Gssim *ssim;
+  guint8 *scaled_out = NULL;
+  gint x, y;
 
-  return 1;
-}
+  if (level == 0) {
+    ssim = comp == 0 ? self->priv->ssim : self->priv->chroma_ssim;
+  } else {
+    Gssim **scaled_ssim = &self->priv->scaled_ssim[level - 1][comp > 0];
 
-static Frame *
-_find_frame (GstValidateSsim * self, GArray * frames, GstClockTime ts,
-    gboolean get_next)
-{
-  guint i;
-  Frame *lframe = &g_array_index (frames, Frame, 0);
+    if (!*scaled_ssim) {
+      *scaled_ssim = gssim_new ();
+      gssim_set_n_threads (*scaled_ssim, self->priv->n_threads);
+    }
+    ssim = *scaled_ssim;
+  }
 
-  if (self->priv->fps_n) {
-    gint64 frame_number = gst_util_uint64_scale (ts, self->priv->fps_n,
-        self->priv->fps_d * GST_SECOND);
+  /* The luma of the frame is configured with the size of the frame */
+  if (comp > 0 || level > 0)
+    gssim_configure (ssim, org->width, org->height);
 
-    if (frames->len < frame_number)
-      return NULL;
+  if (outdata && level > 0)
+    scaled_out = g_malloc ((gsize) org->width * org->height);
 
-    return &g_array_index (frames, Frame, frame_number);
-  }
+  gssim_set_depth (ssim, org->samples.depth);
+  gssim_compare_samples (ssim, &org->samples, &mod->samples,
+      level > 0 ? scaled_out : outdata, level > 0 ? org->width : out_stride,
+      mean, lowest, highest);
 
-  if (frames->len == 1) {
-    Frame *iframe = &g_array_index (frames, Frame, 0);
+  if (!scaled_out)
+    return;
 
-    if (iframe->ts == ts)
-      return iframe;
+  for (y = 0; y < self->priv->height; y++) {
+    const guint8 *src = scaled_out +
+        (gsize) MIN (y >> level, org->height - 1) * org->width;
 
-    return NULL;
+    for (x = 0; x < self->priv->width; x++)
+      outdata[(gsize) y * out_stride + x] = src[MIN (x >> level,
+              org->width - 1)];
+  }
+  g_free (scaled_out);
+}
+
+/* Compares the luma of both frames, and their chroma when compare_chroma is
+ * set. The mean is weighted by the number of samples of each component.
+ *
+ * The decimated modes compare a downscaled level of the pyramid of each
+ * component, and MS-SSIM combines the similarities of all its levels, the
+ * lowest and highest similarities being the ones of the full resolution. */
+static void
+gst_validate_ssim_compare_components (GstValidateSsim * self,
+    GstVideoFrame * ref_frame, GstVideoFrame * frame, guint8 * outdata,
+    gint out_stride, gfloat * mean, gfloat * lowest, gfloat * highest)
+{
+  guint i, n_components =
+      gst_validate_ssim_get_compared_components (self, ref_frame);
+  gdouble total = 0, n_samples = 0;
+  guint max_level;
+
+  switch (self->priv->mode) {
+    case GST_VALIDATE_SSIM_MODE_DECIMATE_2:
+      max_level = 1;
+      break;
+    case GST_VALIDATE_SSIM_MODE_DECIMATE_4:
+      max_level = 2;
+      break;
+    case GST_VALIDATE_SSIM_MODE_MS_SSIM:
+      max_level = MS_SSIM_SCALES - 1;
+      break;
+    default:
+      max_level = 0;
+      break;
+  }
+
+  *lowest = G_MAXFLOAT;
+  *highest = -G_MAXFLOAT;
+  for (i = 0; i < n_components; i++) {
+    gint width = GST_VIDEO_FRAME_COMP_WIDTH (ref_frame, i);
+    gint height = GST_VIDEO_FRAME_COMP_HEIGHT (ref_frame, i);
+    ScaleLevel org[MS_SSIM_SCALES], mod[MS_SSIM_SCALES];
+    gfloat comp_mean, comp_lowest = 0, comp_highest = 0;
+    guint level, n_levels = 1;
+
+    org[0].width = mod[0].width = width;
+    org[0].height = mod[0].height = height;
+    gst_validate_ssim_get_samples (ref_frame, i, &org[0].samples);
+    gst_validate_ssim_get_samples (frame, i, &mod[0].samples);
+
+    /* Both frames have the same size so their pyramids have the same
+     * number of levels */
+    while (n_levels <= max_level &&
+        gst_validate_ssim_downscale (&org[n_levels - 1], &org[n_levels])) {
+      gst_validate_ssim_downscale (&mod[n_levels - 1], &mod[n_levels]);
+      n_levels++;
+    }
+
+    if (self->priv->mode == GST_VALIDATE_SSIM_MODE_MS_SSIM) {
+      gdouble product = 1, total_weight = 0;
+
+      for (level = 0; level < n_levels; level++) {
+        gfloat level_mean, level_lowest, level_highest;
+
+        gst_validate_ssim_compare_level (self, i, level, &org[level],
+            &mod[level], i == 0 && level == 0 ? outdata : NULL, out_stride,
+            &level_mean, &level_lowest, &level_highest);
+
+        if (level == 0) {
+          comp_lowest = level_lowest;
+          comp_highest = level_highest;
+        }
+        product *= pow (MAX (level_mean, 0), ms_ssim_weights[level]);
+        total_weight += ms_ssim_weights[level];
+      }
+
+      /* The weights of the levels that were compared sum up to 1 */
+      comp_mean = pow (product, 1 / total_weight);
+    } else {
+      gst_validate_ssim_compare_level (self, i, n_levels - 1,
+          &org[n_levels - 1], &mod[n_levels - 1], i == 0 ? outdata : NULL,
+          out_stride, &comp_mean, &comp_lowest, &comp_highest);
+    }
+
+    for (level = 1; level < n_levels; level++) {
+      g_free (org[level].data);
+      g_free (mod[level].data);
+    }
+
+    *lowest = MIN (*lowest, comp_lowest);
+    *highest = MAX (*highest, comp_highest);
+    total += comp_mean * width * height;
+    n_samples += width * height;
+  }
+
+  *mean = total / n_samples;
+}
+
+void
+gst_validate_ssim_compare_frames (GstValidateSsim * self,
+    GstVideoFrame * ref_frame, GstVideoFrame * frame, GstBuffer ** outbuf,
+    gfloat * mean, gfloat * lowest, gfloat * highest)
+{
+  gboolean reconf;
+  guint8 *outdata = NULL;
+  GstMapInfo outmap;
+  GstValidateSsimStage stage;
+
+  GstVideoFrame converted_frame1, converted_frame2;
+  SSimConverterInfo *convinfo1 = NULL, *convinfo2 = NULL;
+
+  reconf =
+      gst_validate_ssim_configure (self, ref_frame->info.width,
+      ref_frame->info.height);
+
+  if (gst_validate_ssim_can_compare_natively (ref_frame, frame)) {
+    converted_frame1 = *ref_frame;
+    converted_frame2 = *frame;
+  } else {
+    gst_validate_ssim_configure_converter (self, 0, reconf,
+        ref_frame->info.finfo->format, ref_frame->info.width,
+        ref_frame->info.height);
+
+    gst_validate_ssim_configure_converter (self, 1, reconf,
+        frame->info.finfo->format, frame->info.width, frame->info.height);
+
+    convinfo1 =
+        (SSimConverterInfo *) g_list_nth_data (self->priv->converters, 0);
+    if (convinfo1->converter)
+      gst_validate_ssim_convert (self, convinfo1, ref_frame,
+          &converted_frame1);
+    else
+      converted_frame1 = *ref_frame;
+
+    convinfo2 =
+        (SSimConverterInfo *) g_list_nth_data (self->priv->converters, 1);
+    if (convinfo2->converter)
+      gst_validate_ssim_convert (self, convinfo2, frame, &converted_frame2);
+    else
+      converted_frame2 = *frame;
+  }
+
+  if (outbuf) {
+    *outbuf = gst_buffer_new_and_alloc (GST_ROUND_UP_4 (self->priv->width) *
+        self->priv->height);
+    if (!gst_buffer_map (*outbuf, &outmap, GST_MAP_WRITE)) {
+      GST_VALIDATE_REPORT (self, GENERAL_INPUT_ERROR,
+          "Could not map output frame");
+
+      gst_buffer_unref (*outbuf);
+      *outbuf = NULL;
+
+      goto done;
+    }
+
+    outdata = outmap.data;
+  }
+
+  stage = gst_validate_ssim_precheck (self, &converted_frame1,
+      &converted_frame2, mean, lowest, highest);
+  self->priv->n_resolved[stage]++;
+
+  if (stage == GST_VALIDATE_SSIM_STAGE_SSIM)
+    gst_validate_ssim_compare_components (self, &converted_frame1,
+        &converted_frame2, outdata, GST_ROUND_UP_4 (self->priv->width), mean,
+        lowest, highest);
+  else if (outdata)
+    gst_validate_ssim_fill_out (&converted_frame1, &converted_frame2,
+        stage != GST_VALIDATE_SSIM_STAGE_PSNR_REJECTED, outdata,
+        GST_ROUND_UP_4 (self->priv->width));
+
+  if (outbuf)
+    gst_buffer_unmap (*outbuf, &outmap);
+
+done:
+  if (convinfo1 && convinfo1->converter)
+    gst_video_frame_unmap (&converted_frame1);
+  if (convinfo2 && convinfo2->converter)
+    gst_video_frame_unmap (&converted_frame2);
+}
+
+/* Also compare the chroma planes of YUV frames, instead of only their luma */
+void
+gst_validate_ssim_set_compare_chroma (GstValidateSsim * self,
+    gboolean compare_chroma)
+{
+  self->priv->compare_chroma = compare_chroma;
+}
+
+/**
+ * gst_validate_ssim_set_mode:
+ * @mode: How the similarity of frames is computed
+ *
+ * Sets whether the SSIM is computed at the resolution of the frames, on
+ * decimated frames or at several scales, which is faster on big frames.
+ */
+void
+gst_validate_ssim_set_mode (GstValidateSsim * self, GstValidateSsimMode mode)
+{
+  self->priv->mode = mode;
+}
+
+GstValidateSsimMode
+gst_validate_ssim_get_mode (GstValidateSsim * self)
+{
+  return self->priv->mode;
+}
+
+const gchar *
+gst_validate_ssim_mode_to_string (GstValidateSsimMode mode)
+{
+  g_return_val_if_fail (mode < G_N_ELEMENTS (mode_names), NULL);
+
+  return mode_names[mode];
+}
+
+/* Parses the names returned by gst_validate_ssim_mode_to_string() */
+gboolean
+gst_validate_ssim_mode_from_string (const gchar * name,
+    GstValidateSsimMode * mode)
+{
+  guint i;
+
+  for (i = 0; i < G_N_ELEMENTS (mode_names); i++) {
+    if (!g_strcmp0 (name, mode_names[i])) {
+      *mode = i;
+
+      return TRUE;
+    }
+  }
+
+  return FALSE;
+}
+
+/**
+ * gst_validate_ssim_set_psnr_thresholds:
+ * @accept_psnr: The PSNR, in dB, above which frames are considered fully
+ * similar, 0 to always compute their SSIM
+ * @reject_psnr: The PSNR, in dB, under which frames are considered
+ * completely different, 0 to always compute their SSIM
+ *
+ * Sets the thresholds of the PSNR check done before computing the SSIM of
+ * frames that are not bit-identical, which is much cheaper. Frames resolved
+ * by this check get a similarity of 1 or 0.
+ */
+void
+gst_validate_ssim_set_psnr_thresholds (GstValidateSsim * self,
+    gdouble accept_psnr, gdouble reject_psnr)
+{
+  self->priv->accept_psnr = accept_psnr;
+  self->priv->reject_psnr = reject_psnr;
+}
+
+/**
+ * gst_validate_ssim_get_n_resolved_frames:
+ * @stage: A stage of the comparison
+ *
+ * Returns: The number of frame comparisons that were decided by @stage
+ */
+guint64
+gst_validate_ssim_get_n_resolved_frames (GstValidateSsim * self,
+    GstValidateSsimStage stage)
+{
+  g_return_val_if_fail (stage < GST_VALIDATE_SSIM_N_STAGES, 0);
+
+  return self->priv->n_resolved[stage];
+}
+
+/* Prints how many frame comparisons each stage decided */
+void
+gst_validate_ssim_print_resolved_frames (GstValidateSsim * self)
+{
+  guint64 *n_resolved = self->priv->n_resolved;
+
+  gst_validate_printf (NULL,
+      "Frames resolved: %" G_GUINT64_FORMAT " identical, %" G_GUINT64_FORMAT
+      " accepted and %" G_GUINT64_FORMAT " rejected by PSNR, %"
+      G_GUINT64_FORMAT " compared with SSIM\n",
+      n_resolved[GST_VALIDATE_SSIM_STAGE_IDENTICAL],
+      n_resolved[GST_VALIDATE_SSIM_STAGE_PSNR_ACCEPTED],
+      n_resolved[GST_VALIDATE_SSIM_STAGE_PSNR_REJECTED],
+      n_resolved[GST_VALIDATE_SSIM_STAGE_SSIM]);
+}
+
+static GstValidateFrameStore *
+gst_validate_ssim_get_store (GstValidateSsim * self, const gchar * path)
+{
+  GstValidateFrameStore *store;
+  GError *error = NULL;
+
+  g_mutex_lock (&self->priv->stores_lock);
+  store = g_hash_table_lookup (self->priv->stores, path);
+  if (!store) {
+    store = gst_validate_frame_store_open (path, &error);
+    if (store) {
+      g_hash_table_insert (self->priv->stores, g_strdup (path), store);
+    } else {
+      GST_VALIDATE_REPORT (self, GENERAL_INPUT_ERROR, "Could not open %s: %s",
+          path, error->message);
+      g_error_free (error);
+    }
+  }
+  g_mutex_unlock (&self->priv->stores_lock);
+
+  return store;
+}
+
+/* Gets a frame from a path returned by
+ * gst_validate_frame_store_get_frame_path() */
+static gboolean
+gst_validate_ssim_get_frame_from_store (GstValidateSsim * self,
+    const gchar * store_path, guint index, GstVideoFrame * frame)
+{
+  GstValidateFrameStore *store =
+      gst_validate_ssim_get_store (self, store_path);
+  GError *error = NULL;
+
+  if (!store)
+    return FALSE;
+
+  if (index >= gst_validate_frame_store_get_n_frames (store)) {
+    GST_VALIDATE_REPORT (self, GENERAL_INPUT_ERROR,
+        "%s only has %u frames", store_path,
+        gst_validate_frame_store_get_n_frames (store));
+
+    return FALSE;
+  }
+
+  if (!gst_validate_frame_store_get_frame (store, index, frame, &error)) {
+    GST_VALIDATE_REPORT (self, GENERAL_INPUT_ERROR, "%s", error->message);
+    g_error_free (error);
+
+    return FALSE;
+  }
+
+  return TRUE;
+}
+
+static gboolean
+gst_validate_ssim_get_frame_from_png (GstValidateSsim * self, const char *file,
+    GstVideoFrame * frame)
+{
+  guint8 *data;
+  GstBuffer *buf;
+  GstVideoInfo info;
+  cairo_surface_t *surface = NULL;
+
+  surface = cairo_image_surface_create_from_png (file);
+  if (surface == NULL
+      || (cairo_surface_status (surface) != CAIRO_STATUS_SUCCESS)) {
+    GST_VALIDATE_REPORT (self, GENERAL_INPUT_ERROR, "Could not open %s: %s",
+        file, cairo_status_to_string (cairo_surface_status (surface)));
+
+    return FALSE;
+  }
+
+  gst_video_info_init (&info);
+  gst_video_info_set_format (&info,
+      _get_format_from_surface (surface),
+      cairo_image_surface_get_width (surface),
+      cairo_image_surface_get_height (surface));
+
+  cairo_surface_flush (surface);
+  data = cairo_image_surface_get_data (surface);
+  buf = gst_buffer_new_wrapped_full (GST_MEMORY_FLAG_READONLY,
+      data, info.size, 0, info.size, surface,
+      (GDestroyNotify) cairo_surface_destroy);
+  if (!gst_video_frame_map (frame, &info, buf, GST_MAP_READ)) {
+    gst_buffer_unref (buf);
+    GST_VALIDATE_REPORT (self, GENERAL_INPUT_ERROR,
+        "Could not map input frame");
+
+    return FALSE;
+  }
+
+  gst_buffer_unref (buf);
+
+  return TRUE;
+}
+
+static gboolean
+gst_validate_ssim_get_frame_from_file (GstValidateSsim * self, const char *file,
+    GstVideoFrame * frame)
+{
+  gchar *data;
+  gsize length;
+  GstBuffer *buf;
+  GstVideoInfo info;
+  GstVideoFormat format;
+  gint strv_length, width, height;
+
+  gboolean res = TRUE;
+  gchar **splited_name = NULL, **splited_size = NULL, *strformat;
+
+  GError *error = NULL;
+  gchar *store_path;
+  guint index;
+
+  if (gst_validate_frame_store_parse_frame_path (file, &store_path, &index)) {
+    res = gst_validate_ssim_get_frame_from_store (self, store_path, index,
+        frame);
+    g_free (store_path);
+
+    return res;
+  }
+
+  if (g_str_has_suffix (file, ".png")) {
+    return gst_validate_ssim_get_frame_from_png (self, file, frame);
+  }
+
+  splited_name = g_strsplit (file, ".", -1);
+  strv_length = g_strv_length (splited_name);
+
+  strformat = splited_name[strv_length - 1];
+  format = gst_video_format_from_string (strformat);
+  if (format == GST_VIDEO_FORMAT_UNKNOWN) {
+    GST_VALIDATE_REPORT (self, WRONG_FORMAT, "Unknown format: %s", strformat);
+
+    goto fail;
+  }
+
+  splited_size = g_strsplit (splited_name[strv_length - 2], "x", -1);
+  if (g_strv_length (splited_size) != 2) {
+    GST_VALIDATE_REPORT (self, WRONG_FORMAT,
+        "Can not determine video size from filename: %s ", file);
+
+    goto fail;
+  }
+
+  errno = 0;
+  width = g_ascii_strtoull (splited_size[0], NULL, 10);
+  if (errno) {
+    GST_VALIDATE_REPORT (self, WRONG_FORMAT,
+        "Can not determine video size from filename: %s ", file);
+
+    goto fail;
+  }
+
+  errno = 0;
+  height = g_ascii_strtoull (splited_size[1], NULL, 10);
+  if (errno) {
+    GST_VALIDATE_REPORT (self, WRONG_FORMAT,
+        "Can not determine video size from filename: %s ", file);
+
+    goto fail;
+  }
+
+  gst_video_info_init (&info);
+  gst_video_info_set_format (&info, format, width, height);
+
+  if (!g_file_get_contents (file, &data, &length, &error)) {
+    GST_VALIDATE_REPORT (self, GENERAL_INPUT_ERROR, "Could not open %s: %s",
+        file, error->message);
+    g_error_free (error);
+
+    goto fail;
+  }
+
+  buf = gst_buffer_new_wrapped (data, length);
+  if (!gst_video_frame_map (frame, &info, buf, GST_MAP_READ)) {
+    gst_buffer_unref (buf);
+    GST_VALIDATE_REPORT (self, GENERAL_INPUT_ERROR,
+        "Could not map input frame");
+
+    goto fail;
+  }
+  gst_buffer_unref (buf);
+
+done:
+  g_strfreev (splited_name);
+  g_strfreev (splited_size);
+
+  return res;
+
+fail:
+  res = FALSE;
+
+  goto done;
+}
+
+static gboolean
+_filename_get_timestamp (GstValidateSsim * self, const gchar * filename,
+    GstClockTime * ts)
+{
+  guint h, m, s, ns;
+  gchar *bname, *other, *store_path;
+  guint index;
+  gboolean res = TRUE;
+
+  if (gst_validate_frame_store_parse_frame_path (filename, &store_path,
+          &index)) {
+    GstValidateFrameStore *store =
+        gst_validate_ssim_get_store (self, store_path);
+
+    g_free (store_path);
+    if (!store || index >= gst_validate_frame_store_get_n_frames (store))
+      return FALSE;
+
+    *ts = gst_validate_frame_store_get_timestamp (store, index);
+
+    return TRUE;
+  }
+
+  bname = g_path_get_basename (filename);
+  other = g_strdup (bname);
+
+  if (sscanf (bname, "%" GST_VALIDATE_SSIM_TIME_FORMAT "%s", &h, &m, &s, &ns,
+          other) < 4) {
+    GST_INFO_OBJECT (self, "Can not sscanf %s", bname);
+
+    goto fail;
+  }
+
+  *ts = (h * 3600 + m * 60 + s) * GST_SECOND + ns;
+
+done:
+  g_free (other);
+  g_free (bname);
+  return res;
+
+fail:
+  res = FALSE;
+  goto done;
+}
+
+typedef struct
+{
+  gchar *path;
+  GstClockTime ts;
+} Frame;
+
+static void
+_free_frame (Frame * frame)
+{
+  g_free (frame->path);
+}
+
+static gint
+_sort_frames (Frame * a, Frame * b)
+{
+  if (a->ts < b->ts)
+    return -1;
+
+  if (a->ts == b->ts)
+    return 0;
+
+  return 1;
+}
+
+static Frame *
+_find_frame (GstValidateSsim * self, GArray * frames, GstClockTime ts,
+    gboolean get_next)
+{
+  guint i;
+  Frame *lframe = &g_array_index (frames, Frame, 0);
+
+  if (self->priv->fps_n) {
+    gint64 frame_number = gst_util_uint64_scale (ts, self->priv->fps_n,
+        self->priv->fps_d * GST_SECOND);
+
+    if (frames->len < frame_number)
+      return NULL;
+
+    return &g_array_index (frames, Frame, frame_number);
+  }
+
+  if (frames->len == 1) {
+    Frame *iframe = &g_array_index (frames, Frame, 0);
+
+    if (iframe->ts == ts)
+      return iframe;
+
+    return NULL;
   }
 
   for (i = 1; i < frames->len; i++) {
@@ -570,6 +1268,32 @@ _find_frame (GstValidateSsim * self, GArray * frames, GstClockTime ts,
   return NULL;
 }
 
+/* The frames of the store at @ref_file, sorted by timestamp */
+static GArray *
+_get_store_frames (GstValidateSsim * self, const gchar * ref_file)
+{
+  GstValidateFrameStore *store = gst_validate_ssim_get_store (self, ref_file);
+  GArray *frames;
+  guint i, n_frames;
+
+  if (!store)
+    return NULL;
+
+  n_frames = gst_validate_frame_store_get_n_frames (store);
+  frames = g_array_sized_new (TRUE, TRUE, sizeof (Frame), n_frames);
+  g_array_set_clear_func (frames, (GDestroyNotify) _free_frame);
+  for (i = 0; i < n_frames; i++) {
+    Frame iframe;
+
+    iframe.path = gst_validate_frame_store_get_frame_path (ref_file, i);
+    iframe.ts = gst_validate_frame_store_get_timestamp (store, i);
+    g_array_append_val (frames, iframe);
+  }
+  g_array_sort (frames, (GCompareFunc) _sort_frames);
+
+  return frames;
+}
+
 static GArray *
 _get_ref_frame_cache (GstValidateSsim * self, const gchar * ref_file)
 {
@@ -579,9 +1303,22 @@ _get_ref_frame_cache (GstValidateSsim * self, const gchar * ref_file)
   GArray *frames = NULL;
   gchar *ref_dir = NULL;
 
+  /* The frames of stores are cached under the path of the store */
+  if (gst_validate_frame_store_is_store (ref_file)) {
+    g_mutex_lock (&self->priv->lock);
+    frames = g_hash_table_lookup (self->priv->ref_frames_cache, ref_file);
+    if (!frames && (frames = _get_store_frames (self, ref_file)))
+      g_hash_table_insert (self->priv->ref_frames_cache, g_strdup (ref_file),
+          frames);
+    g_mutex_unlock (&self->priv->lock);
+
+    return frames;
+  }
+
   ref_dir = g_path_get_dirname (ref_file);
 
-  frames = g_hash_table_lookup (self->priv->ref_frames_cache, ref_file);
+  g_mutex_lock (&self->priv->lock);
+  frames = g_hash_table_lookup (self->priv->ref_frames_cache, ref_dir);
   if (frames)
     goto done;
 
@@ -625,39 +1362,414 @@ _get_ref_frame_cache (GstValidateSsim * self, const gchar * ref_file)
   }
 
 done:
+  g_mutex_unlock (&self->priv->lock);
   g_clear_object (&ref_dir_file);
   g_free (ref_dir);
 
   return frames;
 }
 
+/* Returns the path of the reference frame for a frame at @ts, @ref_file
+ * being either the path of the reference or a pattern of references */
 static gchar *
 _get_ref_file_path (GstValidateSsim * self, const gchar * ref_file,
-    const gchar * file, gboolean get_next)
+    GstClockTime ts, gboolean get_next)
 {
   Frame *frame;
   GArray *frames;
   gchar *real_ref_file = NULL;
-  GstClockTime file_ts;
 
-  if (!g_strrstr (ref_file, "*"))
+  if (!g_strrstr (ref_file, "*") &&
+      !gst_validate_frame_store_is_store (ref_file))
     return g_strdup (ref_file);
 
-  if (!_filename_get_timestamp (self, file, &file_ts)) {
-    goto done;
-  }
+  if (!GST_CLOCK_TIME_IS_VALID (ts))
+    return NULL;
 
   frames = _get_ref_frame_cache (self, ref_file);
   if (frames) {
-    frame = _find_frame (self, frames, file_ts, get_next);
+    frame = _find_frame (self, frames, ts, get_next);
 
     if (frame)
       real_ref_file = g_strdup (frame->path);
   }
 
+  return real_ref_file;
+}
+
+static void
+_prefetched_ref_free (PrefetchedRef * ref)
+{
+  if (ref->valid)
+    gst_video_frame_unmap (&ref->frame);
+  g_free (ref->path);
+  g_free (ref);
+}
+
+/* Runs in the prefetch pool */
+static void
+_prefetch_ref (PrefetchedRef * ref, GstValidateSsim * self)
+{
+  GstVideoFrame frame;
+  gboolean valid =
+      gst_validate_ssim_get_frame_from_file (self, ref->path, &frame);
+
+  g_mutex_lock (&self->priv->lock);
+  if (valid)
+    ref->frame = frame;
+  ref->valid = valid;
+  ref->ready = TRUE;
+  if (ref->dropped) {
+    g_mutex_unlock (&self->priv->lock);
+    _prefetched_ref_free (ref);
+
+    return;
+  }
+  g_cond_broadcast (&self->priv->prefetch_cond);
+  g_mutex_unlock (&self->priv->lock);
+}
+
+/* Must be called with the lock, when the reference frame of @path is
+ * available from the cache so that prefetching it is useless */
+static void
+_drop_prefetched_ref (GstValidateSsim * self, const gchar * path)
+{
+  PrefetchedRef *ref = g_hash_table_lookup (self->priv->prefetched_refs, path);
+
+  if (!ref)
+    return;
+
+  g_hash_table_steal (self->priv->prefetched_refs, path);
+  if (ref->ready)
+    _prefetched_ref_free (ref);
+  else
+    ref->dropped = TRUE;
+}
+
+static void
+_cached_ref_free (CachedRef * cached)
+{
+  gst_buffer_unref (cached->buffer);
+  g_free (cached->path);
+  g_free (cached);
+}
+
+/* Must be called with the lock */
+static void
+_trim_ref_cache (GstValidateSsim * self)
+{
+  GstValidateSsimPrivate *priv = self->priv;
+
+  while (priv->ref_cache_size > priv->ref_cache_max_size) {
+    CachedRef *cached = g_queue_peek_tail (&priv->ref_cache_lru);
+
+    g_queue_unlink (&priv->ref_cache_lru, &cached->link);
+    priv->ref_cache_size -= gst_buffer_get_size (cached->buffer);
+    g_hash_table_remove (priv->ref_cache, cached->path);
+  }
+}
+
+static void
+_cache_ref_frame (GstValidateSsim * self, const gchar * path,
+    GstVideoFrame * frame)
+{
+  GstValidateSsimPrivate *priv = self->priv;
+  CachedRef *cached;
+  gsize size = gst_buffer_get_size (frame->buffer);
+
+  g_mutex_lock (&priv->lock);
+  if (size > priv->ref_cache_max_size) {
+    g_mutex_unlock (&priv->lock);
+
+    return;
+  }
+
+  /* The frame might have been prefetched while it was being decoded here, or
+   * by another thread */
+  _drop_prefetched_ref (self, path);
+  if (g_hash_table_contains (priv->ref_cache, path)) {
+    g_mutex_unlock (&priv->lock);
+
+    return;
+  }
+
+  cached = g_new0 (CachedRef, 1);
+  cached->path = g_strdup (path);
+  cached->buffer = gst_buffer_ref (frame->buffer);
+  cached->info = frame->info;
+  cached->link.data = cached;
+  g_hash_table_insert (priv->ref_cache, cached->path, cached);
+  g_queue_push_head_link (&priv->ref_cache_lru, &cached->link);
+  priv->ref_cache_size += size;
+  _trim_ref_cache (self);
+  g_mutex_unlock (&priv->lock);
+}
+
+/* Gets the decoded reference frame from the cache or the prefetched ones,
+ * waiting for it to be decoded if needed, or decodes it */
+static gboolean
+_get_ref_frame (GstValidateSsim * self, const gchar * path,
+    GstVideoFrame * frame)
+{
+  PrefetchedRef *ref;
+  CachedRef *cached;
+  gboolean res;
+
+  g_mutex_lock (&self->priv->lock);
+  cached = g_hash_table_lookup (self->priv->ref_cache, path);
+  if (cached) {
+    GstBuffer *buffer = gst_buffer_ref (cached->buffer);
+    GstVideoInfo info = cached->info;
+
+    self->priv->ref_cache_hits++;
+    g_queue_unlink (&self->priv->ref_cache_lru, &cached->link);
+    g_queue_push_head_link (&self->priv->ref_cache_lru, &cached->link);
+    _drop_prefetched_ref (self, path);
+    g_mutex_unlock (&self->priv->lock);
+
+    res = gst_video_frame_map (frame, &info, buffer, GST_MAP_READ);
+    if (!res)
+      GST_VALIDATE_REPORT (self, GENERAL_INPUT_ERROR,
+          "Could not map input frame");
+    gst_buffer_unref (buffer);
+
+    return res;
+  }
+
+  self->priv->ref_cache_misses++;
+  ref = g_hash_table_lookup (self->priv->prefetched_refs, path);
+  if (ref) {
+    /* Owned from now on, so that it can not be dropped while waiting */
+    g_hash_table_steal (self->priv->prefetched_refs, path);
+    while (!ref->ready)
+      g_cond_wait (&self->priv->prefetch_cond, &self->priv->lock);
+  }
+  g_mutex_unlock (&self->priv->lock);
+
+  if (ref) {
+    /* Decoding errors were reported by the prefetch pool */
+    res = ref->valid;
+    *frame = ref->frame;
+    ref->valid = FALSE;
+    _prefetched_ref_free (ref);
+  } else {
+    res = gst_validate_ssim_get_frame_from_file (self, path, frame);
+  }
+
+  if (res)
+    _cache_ref_frame (self, path, frame);
+
+  return res;
+}
+
+/**
+ * gst_validate_ssim_set_reference_cache_size:
+ * @max_size: The maximum size of the cached frames, in bytes
+ *
+ * Sets how much memory can be used to keep decoded reference frames, so that
+ * references compared with several frames are only decoded once. The least
+ * recently used frames are dropped first. 0 disables the cache.
+ */
+void
+gst_validate_ssim_set_reference_cache_size (GstValidateSsim * self,
+    gsize max_size)
+{
+  g_mutex_lock (&self->priv->lock);
+  self->priv->ref_cache_max_size = max_size;
+  _trim_ref_cache (self);
+  g_mutex_unlock (&self->priv->lock);
+}
+
+/**
+ * gst_validate_ssim_get_reference_cache_stats:
+ * @hits: (out) (optional): The number of references taken from the cache
+ * @misses: (out) (optional): The number of references that were decoded
+ */
+void
+gst_validate_ssim_get_reference_cache_stats (GstValidateSsim * self,
+    guint64 * hits, guint64 * misses)
+{
+  g_mutex_lock (&self->priv->lock);
+  if (hits)
+    *hits = self->priv->ref_cache_hits;
+  if (misses)
+    *misses = self->priv->ref_cache_misses;
+  g_mutex_unlock (&self->priv->lock);
+}
+
+/**
+ * gst_validate_ssim_get_n_prefetched_references:
+ *
+ * Returns: The number of reference frames decoded, or being decoded, ahead
+ * of their comparison
+ */
+guint
+gst_validate_ssim_get_n_prefetched_references (GstValidateSsim * self)
+{
+  guint res;
+
+  g_mutex_lock (&self->priv->lock);
+  res = g_hash_table_size (self->priv->prefetched_refs);
+  g_mutex_unlock (&self->priv->lock);
+
+  return res;
+}
+
+/**
+ * gst_validate_ssim_prefetch_reference:
+ * @ref_file: The pattern of the reference files, as passed to
+ * #gst_validate_ssim_compare_frame_with_reference
+ * @position: The position of a frame that will be compared
+ *
+ * Starts decoding the reference of the frame at @position in the background,
+ * so that it is ready when the frame gets compared. Can be called from any
+ * thread.
+ */
+void
+gst_validate_ssim_prefetch_reference (GstValidateSsim * self,
+    const gchar * ref_file, GstClockTime position)
+{
+  PrefetchedRef *ref;
+  gchar *path = _get_ref_file_path (self, ref_file, position, FALSE);
+
+  if (!path)
+    return;
+
+  g_mutex_lock (&self->priv->lock);
+  if (g_hash_table_contains (self->priv->ref_cache, path) ||
+      g_hash_table_contains (self->priv->prefetched_refs, path) ||
+      g_hash_table_size (self->priv->prefetched_refs) >= MAX_PREFETCHED_REFS) {
+    g_mutex_unlock (&self->priv->lock);
+    g_free (path);
+
+    return;
+  }
+
+  ref = g_new0 (PrefetchedRef, 1);
+  ref->path = path;
+  g_hash_table_insert (self->priv->prefetched_refs, ref->path, ref);
+  g_mutex_unlock (&self->priv->lock);
+
+  g_thread_pool_push (self->priv->prefetch_pool, ref, NULL);
+}
+
+/* Reports an issue if the similarities of the frames named @ref_file and
+ * @file are under the minimum ones, saving @outbuf in @outfolder to show
+ * their differences */
+static gboolean
+_check_similarity (GstValidateSsim * self, GstBuffer * outbuf,
+    const gchar * ref_file, const gchar * file, gfloat mean, gfloat lowest,
+    const gchar * outfolder)
+{
+  gchar *output_failure_image = NULL, *failure_info = NULL;
+
+  if (mean >= self->priv->min_avg_similarity &&
+      lowest >= self->priv->min_lowest_similarity)
+    return TRUE;
+
+  if (outbuf)
+    output_failure_image =
+        gst_validate_ssim_save_out (self, outbuf, ref_file, file, outfolder);
+
+  if (output_failure_image)
+    failure_info =
+        g_strdup_printf (" (See %s to check differences in images)",
+        output_failure_image);
+
+  if (mean < self->priv->min_avg_similarity)
+    GST_VALIDATE_REPORT (self, SIMILARITY_ISSUE,
+        "Average similarity '%f' between %s and %s inferior"
+        " than the minimum average: %f%s", mean,
+        ref_file, file, self->priv->min_avg_similarity, failure_info);
+  else
+    GST_VALIDATE_REPORT (self, SIMILARITY_ISSUE,
+        "Lowest similarity '%f' between %s and %s inferior"
+        " than the minimum lowest similarity: %f%s", lowest,
+        ref_file, file, self->priv->min_lowest_similarity, failure_info);
+
+  g_free (failure_info);
+  g_free (output_failure_image);
+
+  return FALSE;
+}
+
+/* Compares @frame, whose file is @file, with its reference. When @ref_file
+ * is a pattern and the average similarity with the reference at @ts is too
+ * low, the following reference is tried too. */
+static gboolean
+_compare_frame_with_reference (GstValidateSsim * self, const gchar * ref_file,
+    GstVideoFrame * frame, GstClockTime ts, const gchar * file,
+    gfloat * mean, gfloat * lowest, gfloat * highest, const gchar * outfolder)
+{
+  GstBuffer *outbuf = NULL, **poutbuf = NULL;
+  gboolean res = TRUE;
+  GstVideoFrame ref_frame;
+  gchar *real_ref_file = NULL;
+
+  real_ref_file = _get_ref_file_path (self, ref_file, ts, FALSE);
+
+  if (!real_ref_file) {
+    GST_VALIDATE_REPORT (self, GENERAL_INPUT_ERROR,
+        "Could find ref file for %s", ref_file);
+    goto fail;
+  }
+
+  if (!_get_ref_frame (self, real_ref_file, &ref_frame))
+    goto fail;
+
+  if (outfolder) {
+    poutbuf = &outbuf;
+  }
+
+  gst_validate_ssim_compare_frames (self, &ref_frame, frame,
+      poutbuf, mean, lowest, highest);
+  gst_video_frame_unmap (&ref_frame);
+
+  if (*mean < self->priv->min_avg_similarity) {
+    GstClockTime ref_ts;
+
+    _filename_get_timestamp (self, real_ref_file, &ref_ts);
+
+    if (g_strcmp0 (ref_file, real_ref_file) && ref_ts != ts) {
+      gchar *tmpref = real_ref_file;
+
+      real_ref_file = _get_ref_file_path (self, ref_file, ts, TRUE);
+
+      GST_VALIDATE_REPORT (self, SIMILARITY_ISSUE_WITH_PREVIOUS,
+          "\nComparing %s with %s failed, (mean %f "
+          " min %f), checking next %s\n",
+          tmpref, file, *mean, *lowest, real_ref_file);
+
+      g_free (tmpref);
+
+      if (!real_ref_file) {
+        GST_VALIDATE_REPORT (self, GENERAL_INPUT_ERROR,
+            "Could find ref file for %s", ref_file);
+        goto fail;
+      }
+
+      res = _compare_frame_with_reference (self, real_ref_file, frame, ts,
+          file, mean, lowest, highest, outfolder);
+      goto done;
+    }
+  }
+
+  if (!_check_similarity (self, outbuf, real_ref_file, file, *mean, *lowest,
+          outfolder))
+    goto fail;
+
 done:
 
-  return real_ref_file;
+  g_free (real_ref_file);
+  if (outbuf)
+    gst_buffer_unref (outbuf);
+
+  return res;
+
+fail:
+  res = FALSE;
+
+  goto done;
 }
 
 static gboolean
@@ -665,133 +1777,251 @@ gst_validate_ssim_compare_image_file (GstValidateSsim * self,
     const gchar * ref_file, const gchar * file, gfloat * mean, gfloat * lowest,
     gfloat * highest, const gchar * outfolder)
 {
-  GstBuffer *outbuf = NULL, **poutbuf = NULL;
-  gboolean res = TRUE;
-  GstVideoFrame ref_frame, frame;
-  gchar *real_ref_file = NULL;
-  gchar *output_failure_image = NULL, *failure_info = NULL;
-
-  real_ref_file = _get_ref_file_path (self, ref_file, file, FALSE);
+  gboolean res;
+  GstVideoFrame frame;
+  GstClockTime ts = GST_CLOCK_TIME_NONE;
 
-  if (!real_ref_file) {
+  if (!_filename_get_timestamp (self, file, &ts) &&
+      (g_strrstr (ref_file, "*") ||
+          gst_validate_frame_store_is_store (ref_file))) {
     GST_VALIDATE_REPORT (self, GENERAL_INPUT_ERROR,
         "Could find ref file for %s", ref_file);
-    goto fail;
-  }
-
-  if (!gst_validate_ssim_get_frame_from_file (self, real_ref_file, &ref_frame))
-    goto fail;
-
-
-  if (!gst_validate_ssim_get_frame_from_file (self, file, &frame)) {
-    gst_video_frame_unmap (&ref_frame);
-
-    goto fail;
-  }
 
-  if (outfolder) {
-    poutbuf = &outbuf;
+    return FALSE;
   }
 
-  gst_validate_ssim_compare_frames (self, &ref_frame, &frame,
-      poutbuf, mean, lowest, highest);
+  if (!gst_validate_ssim_get_frame_from_file (self, file, &frame))
+    return FALSE;
 
-  if (*mean < self->priv->min_avg_similarity) {
-    GstClockTime ref_ts, f_ts;
+  res = _compare_frame_with_reference (self, ref_file, &frame, ts, file, mean,
+      lowest, highest, outfolder);
+  gst_video_frame_unmap (&frame);
 
-    gst_video_frame_unmap (&ref_frame);
-    gst_video_frame_unmap (&frame);
+  return res;
+}
 
-    _filename_get_timestamp (self, real_ref_file, &ref_ts);
-    _filename_get_timestamp (self, file, &f_ts);
+/**
+ * gst_validate_ssim_compare_frame_with_reference:
+ * @ref_file: The path of the reference file, or a pattern whose basename
+ * starts with `*`, in which case the reference is the file of that directory
+ * matching @position
+ * @frame: The frame to check
+ * @position: The position of @frame in the stream
+ * @file: The name used for @frame in reports, and in the name of the
+ * result image
+ *
+ * Compares a frame in memory with its reference, reporting an issue if
+ * they are not similar enough.
+ *
+ * Returns: %TRUE if the frame is similar enough to its reference
+ */
+gboolean
+gst_validate_ssim_compare_frame_with_reference (GstValidateSsim * self,
+    const gchar * ref_file, GstVideoFrame * frame, GstClockTime position,
+    const gchar * file, gfloat * mean, gfloat * lowest, gfloat * highest,
+    const gchar * outfolder)
+{
+  return _compare_frame_with_reference (self, ref_file, frame, position, file,
+      mean, lowest, highest, outfolder);
+}
 
-    if (g_strcmp0 (ref_file, real_ref_file) && ref_ts != f_ts) {
-      gchar *tmpref = real_ref_file;
+/* A file of a directory or a frame of a store to compare */
+typedef struct
+{
+  gchar *name;
+  gchar *ref_file;
+  gchar *compared_file;
+  gboolean found;
 
-      real_ref_file = _get_ref_file_path (self, ref_file, file, TRUE);
+  gboolean done;
+  gboolean passed;
+  gfloat mean, lowest, highest;
+} CheckEntry;
 
-      GST_VALIDATE_REPORT (self, SIMILARITY_ISSUE_WITH_PREVIOUS,
-          "\nComparing %s with %s failed, (mean %f "
-          " min %f), checking next %s\n",
-          tmpref, file, *mean, *lowest, real_ref_file);
+static void
+_check_entry_free (CheckEntry * entry)
+{
+  g_free (entry->name);
+  g_free (entry->ref_file);
+  g_free (entry->compared_file);
+  g_free (entry);
+}
 
-      g_free (tmpref);
+static gint
+_sort_check_entries (CheckEntry ** a, CheckEntry ** b)
+{
+  return g_strcmp0 ((*a)->name, (*b)->name);
+}
 
-      res = gst_validate_ssim_compare_image_file (self,
-          real_ref_file, file, mean, lowest, highest, outfolder);
-      goto done;
-    }
+/* Shared by the threads comparing the entries of a directory or store */
+typedef struct
+{
+  /* Idle checkers, each one only being used by one thread at a time */
+  GAsyncQueue *checkers;
+  const gchar *outfolder;
+
+  GMutex lock;
+  GCond cond;
+} CheckContext;
+
+/* A checker with the same settings as @self, comparing frames with a single
+ * thread as files are compared in parallel */
+static GstValidateSsim *
+gst_validate_ssim_new_checker (GstValidateSsim * self)
+{
+  GstValidateRunner *runner =
+      gst_validate_reporter_get_runner (GST_VALIDATE_REPORTER (self));
+  GstValidateSsim *checker = gst_validate_ssim_new (runner,
+      self->priv->min_avg_similarity, self->priv->min_lowest_similarity,
+      self->priv->fps_n, self->priv->fps_d, 1);
+
+  gst_validate_ssim_set_compare_chroma (checker, self->priv->compare_chroma);
+  gst_validate_ssim_set_mode (checker, self->priv->mode);
+  gst_validate_ssim_set_psnr_thresholds (checker, self->priv->accept_psnr,
+      self->priv->reject_psnr);
+  /* Each reference is only used once */
+  gst_validate_ssim_set_reference_cache_size (checker, 0);
+  if (runner)
+    gst_object_unref (runner);
+
+  return checker;
+}
 
-    if (outbuf)
-      output_failure_image =
-          gst_validate_ssim_save_out (self, outbuf, real_ref_file, file,
-          outfolder);
+static void
+_check_entry (CheckEntry * entry, CheckContext * check)
+{
+  GstValidateSsim *checker = g_async_queue_pop (check->checkers);
 
-    if (output_failure_image)
-      failure_info =
-          g_strdup_printf (" (See %s to check differences in images)",
-          output_failure_image);
+  entry->passed = gst_validate_ssim_compare_image_files (checker,
+      entry->ref_file, entry->compared_file, &entry->mean, &entry->lowest,
+      &entry->highest, check->outfolder);
+  g_async_queue_push (check->checkers, checker);
 
-    GST_VALIDATE_REPORT (self, SIMILARITY_ISSUE,
-        "Average similarity '%f' between %s and %s inferior"
-        " than the minimum average: %f%s", *mean,
-        real_ref_file, file, self->priv->min_avg_similarity, failure_info);
+  g_mutex_lock (&check->lock);
+  entry->done = TRUE;
+  g_cond_broadcast (&check->cond);
+  g_mutex_unlock (&check->lock);
+}
 
-    goto fail;
+/* Compares the entries using up to n_threads threads to compare different
+ * entries at the same time. Entries are reported in order, and the
+ * aggregated results are computed in that order too, so they do not depend
+ * on the number of threads. */
+static gboolean
+_check_entries (GstValidateSsim * self, GPtrArray * entries, gfloat * mean,
+    gfloat * lowest, gfloat * highest, const gchar * outfolder)
+{
+  gint nfiles = 0, nnotfound = 0, nfailures = 0;
+  gboolean res = TRUE;
+  gfloat min_avg = 1.0, min_min = 1.0, total_avg = 0;
+  CheckContext check = { NULL, outfolder };
+  GThreadPool *pool = NULL;
+  guint i, n_checkers;
+
+  n_checkers = MIN (self->priv->n_threads, entries->len);
+  check.checkers = g_async_queue_new_full (gst_object_unref);
+  g_mutex_init (&check.lock);
+  g_cond_init (&check.cond);
+
+  if (n_checkers > 1) {
+    for (i = 0; i < n_checkers; i++)
+      g_async_queue_push (check.checkers,
+          gst_validate_ssim_new_checker (self));
+
+    pool = g_thread_pool_new ((GFunc) _check_entry, &check,
+        n_checkers, FALSE, NULL);
+  } else {
+    g_async_queue_push (check.checkers, gst_object_ref (self));
   }
 
-  if (*lowest < self->priv->min_lowest_similarity) {
-    if (outbuf)
-      output_failure_image =
-          gst_validate_ssim_save_out (self, outbuf, real_ref_file, file,
-          outfolder);
+  for (i = 0; i < entries->len; i++) {
+    CheckEntry *entry = g_ptr_array_index (entries, i);
 
-    if (output_failure_image)
-      failure_info =
-          g_strdup_printf (" (See %s to check differences in images)",
-          output_failure_image);
+    if (!entry->found) {
+      entry->done = TRUE;
+      continue;
+    }
 
-    GST_VALIDATE_REPORT (self, SIMILARITY_ISSUE,
-        "Lowest similarity '%f' between %s and %s inferior"
-        " than the minimum lowest similarity: %f%s", *lowest,
-        real_ref_file, file, self->priv->min_lowest_similarity, failure_info);
+    if (pool)
+      g_thread_pool_push (pool, entry, NULL);
+    else
+      _check_entry (entry, &check);
+  }
 
-    gst_video_frame_unmap (&ref_frame);
-    gst_video_frame_unmap (&frame);
+  for (i = 0; i < entries->len; i++) {
+    CheckEntry *entry = g_ptr_array_index (entries, i);
+
+    g_mutex_lock (&check.lock);
+    while (!entry->done)
+      g_cond_wait (&check.cond, &check.lock);
+    g_mutex_unlock (&check.lock);
+
+    if (!entry->found) {
+      GST_INFO_OBJECT (self, "Could not find file %s", entry->compared_file);
+      nnotfound++;
+      res = FALSE;
+    } else {
+      if (!entry->passed) {
+        nfailures++;
+        res = FALSE;
+      } else {
+        nfiles++;
+      }
 
-    goto fail;
+      *mean = entry->mean;
+      *lowest = entry->lowest;
+      *highest = entry->highest;
+      min_avg = MIN (min_avg, *mean);
+      min_min = MIN (min_min, *lowest);
+      total_avg += *mean;
+    }
+
+    gst_validate_printf (NULL,
+        "<position: %s duration: %" GST_TIME_FORMAT
+        " avg: %f min: %f (Passed: %d failed: %d, %d not found)/>\r",
+        entry->name, GST_TIME_ARGS (GST_CLOCK_TIME_NONE),
+        *mean, *lowest, nfiles, nfailures, nnotfound);
   }
 
-  gst_video_frame_unmap (&ref_frame);
-  gst_video_frame_unmap (&frame);
+  if (pool) {
+    GstValidateSsim *checker;
 
-done:
+    g_thread_pool_free (pool, FALSE, TRUE);
+    while ((checker = g_async_queue_try_pop (check.checkers))) {
+      for (i = 0; i < GST_VALIDATE_SSIM_N_STAGES; i++)
+        self->priv->n_resolved[i] += checker->priv->n_resolved[i];
+      gst_object_unref (checker);
+    }
+  }
+  g_async_queue_unref (check.checkers);
+  g_mutex_clear (&check.lock);
+  g_cond_clear (&check.cond);
 
-  g_free (failure_info);
-  g_free (output_failure_image);
-  g_free (real_ref_file);
-  if (outbuf)
-    gst_buffer_unref (outbuf);
+  if (nfiles + nfailures == 0) {
+    gst_validate_printf (NULL, "\nNo files to verify.\n");
+  } else {
+    gst_validate_printf (NULL,
+        "\nAverage similarity: %f, min_avg: %f, min_min: %f\n",
+        total_avg / (nfiles + nfailures), min_avg, min_min);
+  }
 
   return res;
-
-fail:
-  res = FALSE;
-
-  goto done;
 }
 
+
+/* Compares the files of @ref_dir with the files with the same names in
+ * @compared_dir, in the order of their names */
 static gboolean
 _check_directory (GstValidateSsim * self, const gchar * ref_dir,
     const gchar * compared_dir, gfloat * mean, gfloat * lowest,
     gfloat * highest, const gchar * outfolder)
 {
-  gint nfiles = 0, nnotfound = 0, nfailures = 0;
   gboolean res = TRUE;
   GFileInfo *info;
   GFileEnumerator *fenum;
-  gfloat min_avg = 1.0, min_min = 1.0, total_avg = 0;
   GFile *file = g_file_new_for_path (ref_dir);
+  GPtrArray *entries =
+      g_ptr_array_new_with_free_func ((GDestroyNotify) _check_entry_free);
 
   if (!(fenum = g_file_enumerate_children (file,
               "standard::*", G_FILE_QUERY_INFO_NONE, NULL, NULL))) {
@@ -806,54 +2036,26 @@ _check_directory (GstValidateSsim * self, const gchar * ref_dir,
 
     if (g_file_info_get_file_type (info) == G_FILE_TYPE_REGULAR ||
         g_file_info_get_file_type (info) == G_FILE_TYPE_SYMBOLIC_LINK) {
-      gchar *compared_file = g_build_path (G_DIR_SEPARATOR_S,
-          compared_dir, g_file_info_get_name (info), NULL);
-      gchar *ref_file = NULL;
-
-      if (!g_file_test (compared_file, G_FILE_TEST_IS_REGULAR)) {
-        GST_INFO_OBJECT (self, "Could not find file %s", compared_file);
-        nnotfound++;
-        res = FALSE;
-      } else {
-
-        ref_file =
-            g_build_path (G_DIR_SEPARATOR_S, ref_dir,
-            g_file_info_get_name (info), NULL);
-        if (!gst_validate_ssim_compare_image_files (self, ref_file,
-                compared_file, mean, lowest, highest, outfolder)) {
-          nfailures++;
-          res = FALSE;
-        } else {
-          nfiles++;
-        }
-      }
+      CheckEntry *entry = g_new0 (CheckEntry, 1);
 
-      min_avg = MIN (min_avg, *mean);
-      min_min = MIN (min_min, *lowest);
-      total_avg += *mean;
-      gst_validate_printf (NULL,
-          "<position: %s duration: %" GST_TIME_FORMAT
-          " avg: %f min: %f (Passed: %d failed: %d, %d not found)/>\r",
-          g_file_info_get_display_name (info),
-          GST_TIME_ARGS (GST_CLOCK_TIME_NONE),
-          *mean, *lowest, nfiles, nfailures, nnotfound);
-
-      g_free (compared_file);
-      g_free (ref_file);
+      entry->name = g_strdup (g_file_info_get_display_name (info));
+      entry->compared_file = g_build_path (G_DIR_SEPARATOR_S,
+          compared_dir, g_file_info_get_name (info), NULL);
+      entry->ref_file = g_build_path (G_DIR_SEPARATOR_S, ref_dir,
+          g_file_info_get_name (info), NULL);
+      entry->found =
+          g_file_test (entry->compared_file, G_FILE_TEST_IS_REGULAR);
+      g_ptr_array_add (entries, entry);
     }
 
     g_object_unref (info);
   }
+  g_ptr_array_sort (entries, (GCompareFunc) _sort_check_entries);
 
-  if (nfiles == 0) {
-    gst_validate_printf (NULL, "\nNo files to verify.\n");
-  } else {
-    gst_validate_printf (NULL,
-        "\nAverage similarity: %f, min_avg: %f, min_min: %f\n",
-        total_avg / nfiles, min_avg, min_min);
-  }
+  res = _check_entries (self, entries, mean, lowest, highest, outfolder);
 
 done:
+  g_ptr_array_unref (entries);
   gst_object_unref (file);
   if (fenum)
     gst_object_unref (fenum);
@@ -861,11 +2063,58 @@ done:
   return res;
 }
 
+/* Compares the frames of the store at @store_path, in the order of their
+ * timestamps, with the references matching their timestamps in @ref_file,
+ * a store, a directory or a pattern */
+static gboolean
+_check_frame_store (GstValidateSsim * self, const gchar * ref_file,
+    const gchar * store_path, gfloat * mean, gfloat * lowest,
+    gfloat * highest, const gchar * outfolder)
+{
+  GArray *frames = _get_store_frames (self, store_path);
+  GPtrArray *entries;
+  gchar *ref_pattern;
+  gboolean res;
+  guint i;
+
+  if (!frames)
+    return FALSE;
+
+  if (g_file_test (ref_file, G_FILE_TEST_IS_DIR))
+    ref_pattern = g_build_path (G_DIR_SEPARATOR_S, ref_file, "*", NULL);
+  else
+    ref_pattern = g_strdup (ref_file);
+
+  entries = g_ptr_array_new_with_free_func ((GDestroyNotify) _check_entry_free);
+  for (i = 0; i < frames->len; i++) {
+    Frame *frame = &g_array_index (frames, Frame, i);
+    CheckEntry *entry = g_new0 (CheckEntry, 1);
+
+    entry->name = g_strdup (frame->path);
+    entry->compared_file = g_strdup (frame->path);
+    entry->ref_file = g_strdup (ref_pattern);
+    entry->found = TRUE;
+    g_ptr_array_add (entries, entry);
+  }
+
+  res = _check_entries (self, entries, mean, lowest, highest, outfolder);
+
+  g_ptr_array_unref (entries);
+  g_array_unref (frames);
+  g_free (ref_pattern);
+
+  return res;
+}
+
 gboolean
 gst_validate_ssim_compare_image_files (GstValidateSsim * self,
     const gchar * ref_file, const gchar * file, gfloat * mean, gfloat * lowest,
     gfloat * highest, const gchar * outfolder)
 {
+  if (gst_validate_frame_store_is_store (file))
+    return _check_frame_store (self, ref_file, file, mean, lowest, highest,
+        outfolder);
+
   if (g_file_test (ref_file, G_FILE_TEST_IS_DIR)) {
     if (!g_file_test (file, G_FILE_TEST_IS_DIR)) {
       GST_VALIDATE_REPORT (self, GENERAL_INPUT_ERROR,
@@ -882,6 +2131,287 @@ gst_validate_ssim_compare_image_files (GstValidateSsim * self,
   }
 }
 
+/* Maximum number of decoded frames waiting to be compared in each video */
+#define VIDEO_QUEUE_SIZE 4
+
+/* How long to wait for a frame before checking for errors */
+#define VIDEO_PULL_TIMEOUT (100 * GST_MSECOND)
+
+/* A pipeline decoding the first video stream of a file */
+typedef struct
+{
+  gchar *name;
+  GstElement *pipeline;
+  GstElement *sink;
+  GstBus *bus;
+
+  /* The last pulled frame, and its stream time */
+  GstSample *sample;
+  GstVideoFrame frame;
+  GstClockTime position;
+  guint n_frames;
+} VideoSource;
+
+static gboolean
+_video_source_start (GstValidateSsim * self, VideoSource * source,
+    const gchar * uri)
+{
+  GError *error = NULL;
+  GstElement *decodebin;
+  gchar *desc = g_strdup_printf ("uridecodebin name=decodebin"
+      " caps=video/x-raw expose-all-streams=false"
+      " ! appsink name=sink sync=false caps=video/x-raw max-buffers=%d",
+      VIDEO_QUEUE_SIZE);
+
+  source->name = g_path_get_basename (uri);
+  source->pipeline = gst_parse_launch (desc, &error);
+  g_free (desc);
+
+  if (!source->pipeline) {
+    GST_VALIDATE_REPORT (self, GENERAL_INPUT_ERROR,
+        "Could not create the pipeline decoding %s: %s", uri,
+        error ? error->message : "unknown error");
+    g_clear_error (&error);
+
+    return FALSE;
+  }
+
+  decodebin = gst_bin_get_by_name (GST_BIN (source->pipeline), "decodebin");
+  g_object_set (decodebin, "uri", uri, NULL);
+  gst_object_unref (decodebin);
+
+  source->sink = gst_bin_get_by_name (GST_BIN (source->pipeline), "sink");
+  source->bus = gst_element_get_bus (source->pipeline);
+  if (gst_element_set_state (source->pipeline, GST_STATE_PLAYING) ==
+      GST_STATE_CHANGE_FAILURE) {
+    GST_VALIDATE_REPORT (self, GENERAL_INPUT_ERROR,
+        "Could not start decoding %s", uri);
+
+    return FALSE;
+  }
+
+  return TRUE;
+}
+
+static void
+_video_source_release_frame (VideoSource * source)
+{
+  if (!source->sample)
+    return;
+
+  gst_video_frame_unmap (&source->frame);
+  gst_sample_unref (source->sample);
+  source->sample = NULL;
+}
+
+static void
+_video_source_stop (VideoSource * source)
+{
+  _video_source_release_frame (source);
+
+  if (source->pipeline) {
+    gst_element_set_state (source->pipeline, GST_STATE_NULL);
+    gst_object_unref (source->pipeline);
+  }
+  if (source->sink)
+    gst_object_unref (source->sink);
+  if (source->bus)
+    gst_object_unref (source->bus);
+  g_free (source->name);
+}
+
+/* Replaces the current frame of @source with the next decoded one. Returns
+ * %FALSE at the end of the stream or if decoding failed. */
+static gboolean
+_video_source_pull (GstValidateSsim * self, VideoSource * source)
+{
+  GstSample *sample = NULL;
+  GstBuffer *buffer;
+  GstVideoInfo info;
+  GstSegment *segment;
+
+  _video_source_release_frame (source);
+
+  while (!sample) {
+    GstMessage *message;
+    gboolean eos;
+
+    g_signal_emit_by_name (source->sink, "try-pull-sample",
+        VIDEO_PULL_TIMEOUT, &sample);
+    if (sample)
+      break;
+
+    message = gst_bus_pop_filtered (source->bus, GST_MESSAGE_ERROR);
+    if (message) {
+      GError *error = NULL;
+
+      gst_message_parse_error (message, &error, NULL);
+      GST_VALIDATE_REPORT (self, GENERAL_INPUT_ERROR,
+          "Could not decode %s: %s", source->name, error->message);
+      g_clear_error (&error);
+      gst_message_unref (message);
+
+      return FALSE;
+    }
+
+    g_object_get (source->sink, "eos", &eos, NULL);
+    if (eos)
+      return FALSE;
+  }
+
+  buffer = gst_sample_get_buffer (sample);
+  if (!gst_video_info_from_caps (&info, gst_sample_get_caps (sample)) ||
+      !gst_video_frame_map (&source->frame, &info, buffer, GST_MAP_READ)) {
+    GST_VALIDATE_REPORT (self, GENERAL_INPUT_ERROR,
+        "Could not map frame %u of %s", source->n_frames, source->name);
+    gst_sample_unref (sample);
+
+    return FALSE;
+  }
+
+  segment = gst_sample_get_segment (sample);
+  source->sample = sample;
+  source->position = gst_segment_to_stream_time (segment, GST_FORMAT_TIME,
+      GST_BUFFER_PTS (buffer));
+  source->n_frames++;
+
+  return TRUE;
+}
+
+static void
+_report_missing_frame (GstValidateSsim * self, VideoSource * source,
+    VideoSource * other)
+{
+  GST_VALIDATE_REPORT (self, MISSING_FRAME,
+      "Frame %u of %s at %" GST_TIME_FORMAT " has no matching frame in %s",
+      source->n_frames - 1, source->name, GST_TIME_ARGS (source->position),
+      other->name);
+}
+
+/**
+ * gst_validate_ssim_compare_videos:
+ * @ref_uri: The URI of the reference video
+ * @uri: The URI of the compared video
+ * @sync: How frames of both videos are matched
+ *
+ * Decodes both videos in parallel and compares their frames as they are
+ * decoded, only keeping a few frames of each video in memory. An issue is
+ * reported for each frame that is not similar enough to its reference, and
+ * for each frame that could not be matched.
+ *
+ * Returns: %TRUE if all the frames were matched and similar enough
+ */
+gboolean
+gst_validate_ssim_compare_videos (GstValidateSsim * self,
+    const gchar * ref_uri, const gchar * uri, GstValidateSsimVideoSync sync,
+    gfloat * mean, gfloat * lowest, gfloat * highest, const gchar * outfolder)
+{
+  VideoSource ref = { NULL, };
+  VideoSource compared = { NULL, };
+  gboolean res = TRUE, has_ref, has_compared;
+  gint npassed = 0, nfailures = 0, nmissing = 0;
+  gfloat min_avg = 1.0, min_min = 1.0, total_avg = 0;
+
+  if (!_video_source_start (self, &ref, ref_uri) ||
+      !_video_source_start (self, &compared, uri)) {
+    res = FALSE;
+    goto done;
+  }
+
+  has_ref = _video_source_pull (self, &ref);
+  has_compared = _video_source_pull (self, &compared);
+  while (has_ref && has_compared) {
+    GstBuffer *outbuf = NULL;
+    gchar *ref_name, *name;
+    gboolean passed;
+
+    if (sync == GST_VALIDATE_SSIM_VIDEO_SYNC_PTS &&
+        GST_CLOCK_TIME_IS_VALID (ref.position) &&
+        GST_CLOCK_TIME_IS_VALID (compared.position)) {
+      GstClockTime duration =
+          GST_BUFFER_DURATION (gst_sample_get_buffer (ref.sample));
+      GstClockTime tolerance =
+          GST_CLOCK_TIME_IS_VALID (duration) ? duration / 2 : GST_MSECOND;
+
+      if (ref.position + tolerance < compared.position) {
+        _report_missing_frame (self, &ref, &compared);
+        nmissing++;
+        has_ref = _video_source_pull (self, &ref);
+        continue;
+      }
+
+      if (compared.position + tolerance < ref.position) {
+        _report_missing_frame (self, &compared, &ref);
+        nmissing++;
+        has_compared = _video_source_pull (self, &compared);
+        continue;
+      }
+    }
+
+    gst_validate_ssim_compare_frames (self, &ref.frame, &compared.frame,
+        outfolder ? &outbuf : NULL, mean, lowest, highest);
+
+    ref_name = g_strdup_printf ("%s-%" GST_VALIDATE_SSIM_TIME_FORMAT,
+        ref.name, GST_TIME_ARGS (ref.position));
+    name = g_strdup_printf ("%s-%" GST_VALIDATE_SSIM_TIME_FORMAT,
+        compared.name, GST_TIME_ARGS (compared.position));
+    passed = _check_similarity (self, outbuf, ref_name, name, *mean, *lowest,
+        outfolder);
+    g_free (ref_name);
+    g_free (name);
+    if (outbuf)
+      gst_buffer_unref (outbuf);
+
+    if (passed)
+      npassed++;
+    else
+      nfailures++;
+
+    min_avg = MIN (min_avg, *mean);
+    min_min = MIN (min_min, *lowest);
+    total_avg += *mean;
+
+    gst_validate_printf (NULL,
+        "<position: %" GST_TIME_FORMAT " duration: %" GST_TIME_FORMAT
+        " avg: %f min: %f (Passed: %d failed: %d, %d missing)/>\r",
+        GST_TIME_ARGS (ref.position), GST_TIME_ARGS (GST_CLOCK_TIME_NONE),
+        *mean, *lowest, npassed, nfailures, nmissing);
+
+    has_ref = _video_source_pull (self, &ref);
+    has_compared = _video_source_pull (self, &compared);
+  }
+
+  /* The frames left in one of the videos have no match in the other */
+  for (; has_ref; has_ref = _video_source_pull (self, &ref)) {
+    _report_missing_frame (self, &ref, &compared);
+    nmissing++;
+  }
+  for (; has_compared; has_compared = _video_source_pull (self, &compared)) {
+    _report_missing_frame (self, &compared, &ref);
+    nmissing++;
+  }
+
+  if (nfailures || nmissing)
+    res = FALSE;
+
+  if (npassed + nfailures == 0) {
+    gst_validate_printf (NULL, "\nNo frames to verify.\n");
+    res = FALSE;
+  } else {
+    gst_validate_printf (NULL,
+        "\nAverage similarity: %f, min_avg: %f, min_min: %f"
+        " (%d frames compared, %d missing)\n",
+        total_avg / (npassed + nfailures), min_avg, min_min,
+        npassed + nfailures, nmissing);
+  }
+
+done:
+  _video_source_stop (&ref);
+  _video_source_stop (&compared);
+
+  return res;
+}
+
 static void
 gst_validate_ssim_get_property (GObject * object,
     guint property_id, GValue * value, GParamSpec * pspec)
@@ -921,7 +2451,15 @@ gst_validate_ssim_dispose (GObject * object)
   void (*chain_up) (GObject *) =
       ((GObjectClass *) gst_validate_ssim_parent_class)->dispose;
 
-  gst_object_unref (self->priv->ssim);
+  GstValidateSsimPrivate *priv = self->priv;
+  guint i;
+
+  gst_object_unref (priv->ssim);
+  gst_object_unref (priv->chroma_ssim);
+  for (i = 0; i < G_N_ELEMENTS (priv->scaled_ssim); i++) {
+    gst_clear_object (&priv->scaled_ssim[i][0]);
+    gst_clear_object (&priv->scaled_ssim[i][1]);
+  }
 
   chain_up (object);
 }
@@ -938,7 +2476,14 @@ gst_validate_ssim_finalize (GObject * object)
 
   if (self->priv->outconverter_info.converter)
     gst_video_converter_free (self->priv->outconverter_info.converter);
+  g_thread_pool_free (self->priv->prefetch_pool, FALSE, TRUE);
+  g_hash_table_unref (self->priv->prefetched_refs);
+  g_hash_table_unref (self->priv->ref_cache);
+  g_hash_table_unref (self->priv->stores);
+  g_mutex_clear (&self->priv->stores_lock);
   g_hash_table_unref (self->priv->ref_frames_cache);
+  g_mutex_clear (&self->priv->lock);
+  g_cond_clear (&self->priv->prefetch_cond);
 
   chain_up (object);
 }
@@ -970,6 +2515,13 @@ _register_issues (gpointer data)
           "An error occurred when working with input files",
           GST_VALIDATE_REPORT_LEVEL_CRITICAL));
 
+  gst_validate_issue_register (gst_validate_issue_new (MISSING_FRAME,
+          "A frame of a compared video has no matching frame in the other one",
+          "When comparing videos, frames are matched by their position or"
+          " by their number, depending on the synchronization mode. This"
+          " frame was not matched and could not be compared.",
+          GST_VALIDATE_REPORT_LEVEL_CRITICAL));
+
   gst_validate_issue_register (gst_validate_issue_new (WRONG_FORMAT,
           "The format or dimensions of the compared images do not match",
           "The format or dimensions of the compared images do not match",
@@ -1007,14 +2559,32 @@ gst_validate_ssim_init (GstValidateSsim * self)
   self->priv = gst_validate_ssim_get_instance_private (self);
 
   self->priv->ssim = gssim_new ();
+  self->priv->chroma_ssim = gssim_new ();
   self->priv->ref_frames_cache = g_hash_table_new_full (g_str_hash,
       g_str_equal, g_free, (GDestroyNotify) g_array_unref);
+
+  g_mutex_init (&self->priv->lock);
+  g_cond_init (&self->priv->prefetch_cond);
+  self->priv->prefetched_refs = g_hash_table_new_full (g_str_hash,
+      g_str_equal, NULL, (GDestroyNotify) _prefetched_ref_free);
+  self->priv->prefetch_pool = g_thread_pool_new ((GFunc) _prefetch_ref, self,
+      1, FALSE, NULL);
+
+  self->priv->ref_cache = g_hash_table_new_full (g_str_hash, g_str_equal,
+      NULL, (GDestroyNotify) _cached_ref_free);
+  self->priv->ref_cache_max_size = DEFAULT_REF_CACHE_SIZE;
+
+  g_mutex_init (&self->priv->stores_lock);
+  self->priv->stores = g_hash_table_new_full (g_str_hash, g_str_equal,
+      g_free, (GDestroyNotify) gst_validate_frame_store_free);
 }
 
+/* @n_threads is the number of threads used to compare each frame, 0 meaning
+ * one per processor */
 GstValidateSsim *
 gst_validate_ssim_new (GstValidateRunner * runner,
     gfloat min_avg_similarity, gfloat min_lowest_similarity,
-    gint fps_n, gint fps_d)
+    gint fps_n, gint fps_d, guint n_threads)
 {
   GstValidateSsim *self =
       g_object_new (GST_VALIDATE_SSIM_TYPE, "validate-runner", runner, NULL);
@@ -1023,6 +2593,9 @@ gst_validate_ssim_new (GstValidateRunner * runner,
   self->priv->min_lowest_similarity = min_lowest_similarity;
   self->priv->fps_n = fps_n;
   self->priv->fps_d = fps_d;
+  self->priv->n_threads = n_threads ? n_threads : g_get_num_processors ();
+  gssim_set_n_threads (self->priv->ssim, n_threads);
+  gssim_set_n_threads (self->priv->chroma_ssim, n_threads);
 
   gst_validate_reporter_set_name (GST_VALIDATE_REPORTER (self),
       g_strdup ("gst-validate-images-checker"));
@@ -47,6 +47,59 @@ typedef struct {
   GstObjectClass parent;
 } GstValidateSsimClass;
 
+/**
+ * GstValidateSsimMode:
+ * @GST_VALIDATE_SSIM_MODE_FULL: Computes the SSIM at the resolution of the
+ * frames
+ * @GST_VALIDATE_SSIM_MODE_DECIMATE_2: Computes the SSIM of the frames
+ * downscaled by 2 in both directions
+ * @GST_VALIDATE_SSIM_MODE_DECIMATE_4: Computes the SSIM of the frames
+ * downscaled by 4 in both directions
+ * @GST_VALIDATE_SSIM_MODE_MS_SSIM: Computes the multi-scale SSIM, combining
+ * the SSIM of the frames at 5 scales
+ *
+ * How the similarity of frames is computed.
+ */
+typedef enum {
+  GST_VALIDATE_SSIM_MODE_FULL,
+  GST_VALIDATE_SSIM_MODE_DECIMATE_2,
+  GST_VALIDATE_SSIM_MODE_DECIMATE_4,
+  GST_VALIDATE_SSIM_MODE_MS_SSIM,
+} GstValidateSsimMode;
+
+/**
+ * GstValidateSsimVideoSync:
+ * @GST_VALIDATE_SSIM_VIDEO_SYNC_PTS: Frames are matched by their stream time
+ * @GST_VALIDATE_SSIM_VIDEO_SYNC_FRAME_NUMBER: Frames are matched by their
+ * number
+ *
+ * How the frames of compared videos are matched.
+ */
+typedef enum {
+  GST_VALIDATE_SSIM_VIDEO_SYNC_PTS,
+  GST_VALIDATE_SSIM_VIDEO_SYNC_FRAME_NUMBER,
+} GstValidateSsimVideoSync;
+
+/**
+ * GstValidateSsimStage:
+ * @GST_VALIDATE_SSIM_STAGE_IDENTICAL: The compared samples are bit-identical
+ * @GST_VALIDATE_SSIM_STAGE_PSNR_ACCEPTED: The PSNR is above the accepting
+ * threshold
+ * @GST_VALIDATE_SSIM_STAGE_PSNR_REJECTED: The PSNR is under the rejecting
+ * threshold
+ * @GST_VALIDATE_SSIM_STAGE_SSIM: The SSIM of the frames was computed
+ *
+ * The checks frames go through, from the cheapest one, until one of them
+ * decides whether they are similar.
+ */
+typedef enum {
+  GST_VALIDATE_SSIM_STAGE_IDENTICAL,
+  GST_VALIDATE_SSIM_STAGE_PSNR_ACCEPTED,
+  GST_VALIDATE_SSIM_STAGE_PSNR_REJECTED,
+  GST_VALIDATE_SSIM_STAGE_SSIM,
+  GST_VALIDATE_SSIM_N_STAGES,
+} GstValidateSsimStage;
+
 #define GST_VALIDATE_SSIM_TIME_FORMAT "u-%02u-%02u.%09u"
 
 #define GST_VALIDATE_SSIM_TYPE (gst_validate_ssim_get_type ())
@@ -62,7 +115,8 @@ GstValidateSsim * gst_validate_ssim_new         (GstValidateRunner *runner,
                                                  gfloat min_avg_similarity,
                                                  gfloat min_lowest_similarity,
                                                  gint fps_n,
-                                                 gint fps_d);
+                                                 gint fps_d,
+                                                 guint n_threads);
 
 gboolean gst_validate_ssim_compare_image_files  (GstValidateSsim *self, const gchar *ref_file,
                                                  const gchar * file, gfloat * mean, gfloat * lowest,
@@ -72,6 +126,43 @@ void gst_validate_ssim_compare_frames           (GstValidateSsim * self, GstVide
                                                  GstVideoFrame *frame, GstBuffer **outbuf,
                                                  gfloat * mean, gfloat * lowest, gfloat * highest);
 
+gboolean gst_validate_ssim_compare_videos       (GstValidateSsim * self, const gchar * ref_uri,
+                                                 const gchar * uri, GstValidateSsimVideoSync sync,
+                                                 gfloat * mean, gfloat * lowest, gfloat * highest,
+                                                 const gchar * outfolder);
+
+gboolean gst_validate_ssim_compare_frame_with_reference (GstValidateSsim * self, const gchar * ref_file,
+                                                 GstVideoFrame * frame, GstClockTime position,
+                                                 const gchar * file, gfloat * mean, gfloat * lowest,
+                                                 gfloat * highest, const gchar * outfolder);
+
+void gst_validate_ssim_prefetch_reference       (GstValidateSsim * self, const gchar * ref_file,
+                                                 GstClockTime position);
+
+guint gst_validate_ssim_get_n_prefetched_references (GstValidateSsim * self);
+
+void gst_validate_ssim_set_compare_chroma       (GstValidateSsim * self, gboolean compare_chroma);
+
+void gst_validate_ssim_set_mode                 (GstValidateSsim * self, GstValidateSsimMode mode);
+
+GstValidateSsimMode gst_validate_ssim_get_mode  (GstValidateSsim * self);
+
+const gchar * gst_validate_ssim_mode_to_string  (GstValidateSsimMode mode);
+
+gboolean gst_validate_ssim_mode_from_string     (const gchar * name, GstValidateSsimMode * mode);
+
+void gst_validate_ssim_set_psnr_thresholds     (GstValidateSsim * self, gdouble accept_psnr,
+                                                 gdouble reject_psnr);
+
+guint64 gst_validate_ssim_get_n_resolved_frames (GstValidateSsim * self, GstValidateSsimStage stage);
+
+void gst_validate_ssim_print_resolved_frames    (GstValidateSsim * self);
+
+void gst_validate_ssim_set_reference_cache_size (GstValidateSsim * self, gsize max_size);
+
+void gst_validate_ssim_get_reference_cache_stats (GstValidateSsim * self, guint64 * hits,
+                                                 guint64 * misses);
+
 G_END_DECLS
 
 #endif
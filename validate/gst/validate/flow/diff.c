@@ -0,0 +1,234 @@
+/* GStreamer
+ *
+ * diff.c: Unified diff of validateflow logs.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "diff.h"
+
+#include <string.h>
+
+#define COLOR_RESET "\033[0m"
+#define COLOR_HUNK "\033[36m"
+#define COLOR_DELETE "\033[31m"
+#define COLOR_INSERT "\033[32m"
+
+typedef enum
+{
+  DIFF_EQUAL,
+  DIFF_DELETE,
+  DIFF_INSERT,
+} DiffOp;
+
+/* Computes the shortest edit script from @a to @b using Myers' greedy
+ * algorithm. For each edit distance d, the furthest reaching x of the
+ * diagonals -d-1..d+1 is saved so that the path can be backtracked, which
+ * takes O((N+M)·D) time and O(D²) memory. */
+static GArray *
+compute_edit_script (gchar ** a, guint n, gchar ** b, guint m)
+{
+  gint max = n + m;
+  gint *v = g_new0 (gint, 2 * max + 3) + max + 1;
+  GArray *trace = g_array_new (FALSE, FALSE, sizeof (gint));
+  GArray *trace_offsets = g_array_new (FALSE, FALSE, sizeof (guint));
+  GArray *ops = g_array_new (FALSE, FALSE, sizeof (guint8));
+  gint d, k, x, y;
+
+  for (d = 0; d <= max; d++) {
+    guint offset = trace->len;
+
+    g_array_append_val (trace_offsets, offset);
+    g_array_append_vals (trace, &v[-d - 1], 2 * d + 3);
+
+    for (k = -d; k <= d; k += 2) {
+      if (k == -d || (k != d && v[k - 1] < v[k + 1]))
+        x = v[k + 1];
+      else
+        x = v[k - 1] + 1;
+      y = x - k;
+
+      while (x < (gint) n && y < (gint) m && !strcmp (a[x], b[y])) {
+        x++;
+        y++;
+      }
+      v[k] = x;
+
+      if (x >= (gint) n && y >= (gint) m)
+        goto backtrack;
+    }
+  }
+
+backtrack:
+  x = n;
+  y = m;
+  for (; d >= 0; d--) {
+    gint *prev_v = &g_array_index (trace, gint,
+        g_array_index (trace_offsets, guint, d)) + d + 1;
+    gint prev_k, prev_x, prev_y;
+    guint8 op;
+
+    k = x - y;
+    if (k == -d || (k != d && prev_v[k - 1] < prev_v[k + 1]))
+      prev_k = k + 1;
+    else
+      prev_k = k - 1;
+    prev_x = prev_v[prev_k];
+    prev_y = prev_x - prev_k;
+
+    while (x > prev_x && y > prev_y) {
+      op = DIFF_EQUAL;
+      g_array_append_val (ops, op);
+      x--;
+      y--;
+    }
+
+    if (d > 0) {
+      op = x == prev_x ? DIFF_INSERT : DIFF_DELETE;
+      g_array_append_val (ops, op);
+    }
+
+    x = prev_x;
+    y = prev_y;
+  }
+
+  g_free (v - max - 1);
+  g_array_free (trace, TRUE);
+  g_array_free (trace_offsets, TRUE);
+
+  /* Ops were collected from the end */
+  for (k = 0; k < (gint) ops->len / 2; k++) {
+    guint8 tmp = g_array_index (ops, guint8, k);
+
+    g_array_index (ops, guint8, k) =
+        g_array_index (ops, guint8, ops->len - k - 1);
+    g_array_index (ops, guint8, ops->len - k - 1) = tmp;
+  }
+
+  return ops;
+}
+
+static void
+append_line (GString * dest, gchar prefix, const gchar * line,
+    const gchar * color)
+{
+  if (color)
+    g_string_append (dest, color);
+  g_string_append_c (dest, prefix);
+  g_string_append (dest, line);
+  if (color)
+    g_string_append (dest, COLOR_RESET);
+  g_string_append_c (dest, '\n');
+}
+
+/* Appends a unified diff of @expected and @actual, similar to `diff -u`,
+ * whose first lines are at @first_line in both files. At most @context
+ * unchanged lines are shown around each change, and the diff is cut once it
+ * gets bigger than @max_size bytes. */
+void
+validate_flow_diff (GString * dest, const gchar * expected_name,
+    const gchar * actual_name, gchar ** expected, guint n_expected,
+    gchar ** actual, guint n_actual, gsize first_line, guint context,
+    gsize max_size, gboolean colored)
+{
+  GArray *ops = compute_edit_script (expected, n_expected, actual, n_actual);
+  guint8 *op = (guint8 *) ops->data;
+  guint *a_index = g_new (guint, ops->len + 1);
+  guint *b_index = g_new (guint, ops->len + 1);
+  gsize start_len = dest->len;
+  guint i, a = 0, b = 0;
+
+  /* Index of the expected and actual lines each op applies to */
+  for (i = 0; i <= ops->len; i++) {
+    a_index[i] = a;
+    b_index[i] = b;
+    if (i < ops->len) {
+      if (op[i] != DIFF_INSERT)
+        a++;
+      if (op[i] != DIFF_DELETE)
+        b++;
+    }
+  }
+
+  g_string_append_printf (dest, "--- %s\n+++ %s\n", expected_name,
+      actual_name);
+
+  i = 0;
+  while (i < ops->len) {
+    guint start, end, last_change, j;
+    guint a_count, b_count;
+    gsize a_line, b_line;
+
+    if (op[i] == DIFF_EQUAL) {
+      i++;
+      continue;
+    }
+
+    /* Extend the hunk while changes are close enough for their contexts to
+     * overlap */
+    last_change = i;
+    for (j = i; j < ops->len; j++) {
+      if (op[j] != DIFF_EQUAL)
+        last_change = j;
+      else if (j - last_change > 2 * context)
+        break;
+    }
+
+    start = i > context ? i - context : 0;
+    end = MIN (last_change + context + 1, ops->len);
+    a_count = a_index[end] - a_index[start];
+    b_count = b_index[end] - b_index[start];
+    a_line = first_line + a_index[start] - (a_count ? 0 : 1);
+    b_line = first_line + b_index[start] - (b_count ? 0 : 1);
+
+    g_string_append_printf (dest,
+        "%s@@ -%" G_GSIZE_FORMAT ",%u +%" G_GSIZE_FORMAT ",%u @@%s\n",
+        colored ? COLOR_HUNK : "", a_line, a_count, b_line, b_count,
+        colored ? COLOR_RESET : "");
+
+    for (j = start; j < end; j++) {
+      if (dest->len - start_len > max_size) {
+        g_string_append (dest, "[... diff truncated ...]\n");
+        goto done;
+      }
+
+      switch (op[j]) {
+        case DIFF_EQUAL:
+          append_line (dest, ' ', expected[a_index[j]], NULL);
+          break;
+        case DIFF_DELETE:
+          append_line (dest, '-', expected[a_index[j]],
+              colored ? COLOR_DELETE : NULL);
+          break;
+        case DIFF_INSERT:
+          append_line (dest, '+', actual[b_index[j]],
+              colored ? COLOR_INSERT : NULL);
+          break;
+      }
+    }
+
+    i = end;
+  }
+
+done:
+  g_free (a_index);
+  g_free (b_index);
+  g_array_free (ops, TRUE);
+}
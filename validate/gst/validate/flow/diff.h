@@ -0,0 +1,28 @@
+/* GStreamer
+ *
+ * diff.h: Unified diff of validateflow logs.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __GST_VALIDATE_FLOW_DIFF_H__
+#define __GST_VALIDATE_FLOW_DIFF_H__
+
+#include <glib.h>
+
+void validate_flow_diff(GString* dest, const gchar* expected_name, const gchar* actual_name, gchar** expected, guint n_expected, gchar** actual, guint n_actual, gsize first_line, guint context, gsize max_size, gboolean colored);
+
+#endif // __GST_VALIDATE_FLOW_DIFF_H__
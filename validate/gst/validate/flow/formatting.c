@@ -38,8 +38,24 @@
 #include "../../gst/validate/gst-validate-utils.h"
 
 typedef void (*Uint64Formatter) (gchar * dest, guint64 time);
-G_LOCK_DEFINE (checksums_as_id_lock);
-static GstStructure *checksums_as_id = NULL;
+
+/* Content ids only need to tell buffers apart, MD5 is much cheaper than the
+ * SHA-1 used for regular checksums */
+#define CONTENT_ID_CHECKSUM G_CHECKSUM_MD5
+#define CONTENT_ID_N_SHARDS 16
+
+typedef struct
+{
+  GMutex lock;
+  /* Binary digest -> id */
+  GHashTable *ids;
+} ContentIdShard;
+
+struct _ValidateFlowContentIds
+{
+  ContentIdShard shards[CONTENT_ID_N_SHARDS];
+  gint next_id;
+};
 
 #define CONSTIFY(strv) ((const gchar * const *) strv)
 
@@ -55,6 +71,16 @@ use_field (const gchar * field, gchar ** logged, gchar ** ignored)
   return TRUE;
 }
 
+/* Appends the "name=" prefix of a field, preceded by a separator unless it
+ * is the first field written since @start */
+static void
+append_field_name (GString * dest, gsize start, const gchar * name)
+{
+  if (dest->len > start)
+    g_string_append_len (dest, ", ", 2);
+  g_string_append (dest, name);
+  g_string_append_c (dest, '=');
+}
 
 void
 format_time (gchar * dest_str, guint64 time)
@@ -72,70 +98,206 @@ format_number (gchar * dest_str, guint64 number)
   g_sprintf (dest_str, "%" G_GUINT64_FORMAT, number);
 }
 
-gchar *
-validate_flow_format_segment (const GstSegment * segment,
+static guint
+content_id_digest_hash (gconstpointer digest)
+{
+  guint hash;
+
+  /* The digest is already uniformly distributed */
+  memcpy (&hash, digest, sizeof (hash));
+  return hash;
+}
+
+static gboolean
+content_id_digest_equal (gconstpointer a, gconstpointer b)
+{
+  return !memcmp (a, b, VALIDATE_FLOW_CONTENT_ID_DIGEST_SIZE);
+}
+
+ValidateFlowContentIds *
+validate_flow_content_ids_new (void)
+{
+  ValidateFlowContentIds *content_ids = g_new0 (ValidateFlowContentIds, 1);
+  gint i;
+
+  for (i = 0; i < CONTENT_ID_N_SHARDS; i++) {
+    g_mutex_init (&content_ids->shards[i].lock);
+    content_ids->shards[i].ids =
+        g_hash_table_new_full (content_id_digest_hash, content_id_digest_equal,
+        g_free, NULL);
+  }
+
+  return content_ids;
+}
+
+void
+validate_flow_content_ids_free (ValidateFlowContentIds * content_ids)
+{
+  gint i;
+
+  for (i = 0; i < CONTENT_ID_N_SHARDS; i++) {
+    g_mutex_clear (&content_ids->shards[i].lock);
+    g_hash_table_unref (content_ids->shards[i].ids);
+  }
+  g_free (content_ids);
+}
+
+gint
+validate_flow_content_ids_get (ValidateFlowContentIds * content_ids,
+    const guint8 * digest)
+{
+  /* Use a different part of the digest than the hash table does */
+  ContentIdShard *shard =
+      &content_ids->shards[digest[VALIDATE_FLOW_CONTENT_ID_DIGEST_SIZE - 1] %
+      CONTENT_ID_N_SHARDS];
+  gpointer id;
+
+  g_mutex_lock (&shard->lock);
+  if (!g_hash_table_lookup_extended (shard->ids, digest, NULL, &id)) {
+    guint8 *key = g_malloc (VALIDATE_FLOW_CONTENT_ID_DIGEST_SIZE);
+
+    memcpy (key, digest, VALIDATE_FLOW_CONTENT_ID_DIGEST_SIZE);
+    id = GINT_TO_POINTER (g_atomic_int_add (&content_ids->next_id, 1));
+    g_hash_table_insert (shard->ids, key, id);
+  }
+  g_mutex_unlock (&shard->lock);
+
+  return GPOINTER_TO_INT (id);
+}
+
+guint
+validate_flow_buffer_fields_from_structs (GstStructure * logged_fields_struct,
+    GstStructure * ignored_fields_struct)
+{
+  static const struct
+  {
+    const gchar *name;
+    ValidateFlowBufferFields field;
+  } fields[] = {
+    {"dts", VALIDATE_FLOW_BUFFER_FIELD_DTS},
+    {"pts", VALIDATE_FLOW_BUFFER_FIELD_PTS},
+    {"dur", VALIDATE_FLOW_BUFFER_FIELD_DUR},
+    {"flags", VALIDATE_FLOW_BUFFER_FIELD_FLAGS},
+    {"meta", VALIDATE_FLOW_BUFFER_FIELD_META},
+  };
+  guint i, mask = 0;
+  gchar **logged_fields =
+      logged_fields_struct ? gst_validate_utils_get_strv (logged_fields_struct,
+      "buffer") : NULL;
+  gchar **ignored_fields =
+      ignored_fields_struct ?
+      gst_validate_utils_get_strv (ignored_fields_struct, "buffer") : NULL;
+
+  for (i = 0; i < G_N_ELEMENTS (fields); i++) {
+    if (use_field (fields[i].name, logged_fields, ignored_fields))
+      mask |= fields[i].field;
+  }
+
+  if (logged_fields && g_strv_contains (CONSTIFY (logged_fields), "checksum"))
+    mask |= VALIDATE_FLOW_BUFFER_FIELD_CHECKSUM;
+
+  g_strfreev (logged_fields);
+  g_strfreev (ignored_fields);
+
+  return mask;
+}
+
+GHashTable *
+validate_flow_event_fields_table_new (GstStructure * fields_struct)
+{
+  GHashTable *table;
+  gint i, n_fields;
+
+  if (!fields_struct)
+    return NULL;
+
+  table = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+      (GDestroyNotify) g_strfreev);
+  n_fields = gst_structure_n_fields (fields_struct);
+  for (i = 0; i < n_fields; i++) {
+    const gchar *event_type = gst_structure_nth_field_name (fields_struct, i);
+
+    g_hash_table_insert (table, g_strdup (event_type),
+        gst_validate_utils_get_strv (fields_struct, event_type));
+  }
+
+  return table;
+}
+
+void
+validate_flow_format_segment (GString * dest, const GstSegment * segment,
     gchar ** logged_fields, gchar ** ignored_fields)
 {
   Uint64Formatter uint64_format;
-  gchar *segment_str;
-  gchar *parts[12];
-  GString *format;
-  gchar start_str[32], offset_str[32], stop_str[32], time_str[32], base_str[32],
-      position_str[32], duration_str[32];
-  int parts_index = 0;
+  gchar value_str[32];
+  gsize start = dest->len;
 
   uint64_format =
       segment->format == GST_FORMAT_TIME ? format_time : format_number;
-  uint64_format (start_str, segment->start);
-  uint64_format (offset_str, segment->offset);
-  uint64_format (stop_str, segment->stop);
-  uint64_format (time_str, segment->time);
-  uint64_format (base_str, segment->base);
-  uint64_format (position_str, segment->position);
-  uint64_format (duration_str, segment->duration);
-
-  format = g_string_new (gst_format_get_name (segment->format));
-  format = g_string_ascii_up (format);
-
-  if (use_field ("format", logged_fields, ignored_fields))
-    parts[parts_index++] = g_strdup_printf ("format=%s", format->str);
-
-  if (use_field ("start", logged_fields, ignored_fields))
-    parts[parts_index++] = g_strdup_printf ("start=%s", start_str);
-
-  if (use_field ("offset", logged_fields, ignored_fields))
-    parts[parts_index++] = g_strdup_printf ("offset=%s", offset_str);
-
-  if (use_field ("stop", logged_fields, ignored_fields))
-    parts[parts_index++] = g_strdup_printf ("stop=%s", stop_str);
-
-  if (segment->rate != 1.0)
-    parts[parts_index++] = g_strdup_printf ("rate=%f", segment->rate);
-  if (segment->applied_rate != 1.0)
-    parts[parts_index++] =
-        g_strdup_printf ("applied_rate=%f", segment->applied_rate);
-
-  if (segment->flags && use_field ("flags", logged_fields, ignored_fields))
-    parts[parts_index++] = g_strdup_printf ("flags=0x%02x", segment->flags);
-
-  if (use_field ("time", logged_fields, ignored_fields))
-    parts[parts_index++] = g_strdup_printf ("time=%s", time_str);
-  if (use_field ("base", logged_fields, ignored_fields))
-    parts[parts_index++] = g_strdup_printf ("base=%s", base_str);
-  if (use_field ("position", logged_fields, ignored_fields))
-    parts[parts_index++] = g_strdup_printf ("position=%s", position_str);
-  if (GST_CLOCK_TIME_IS_VALID (segment->duration)
-      && use_field ("duration", logged_fields, ignored_fields))
-    parts[parts_index++] = g_strdup_printf ("duration=%s", duration_str);
-  parts[parts_index] = NULL;
 
-  segment_str = g_strjoinv (", ", parts);
+  if (use_field ("format", logged_fields, ignored_fields)) {
+    gsize i;
 
-  while (parts_index > 0)
-    g_free (parts[--parts_index]);
-  g_string_free (format, TRUE);
+    append_field_name (dest, start, "format");
+    i = dest->len;
+    g_string_append (dest, gst_format_get_name (segment->format));
+    for (; i < dest->len; i++)
+      dest->str[i] = g_ascii_toupper (dest->str[i]);
+  }
+
+  if (use_field ("start", logged_fields, ignored_fields)) {
+    append_field_name (dest, start, "start");
+    uint64_format (value_str, segment->start);
+    g_string_append (dest, value_str);
+  }
+
+  if (use_field ("offset", logged_fields, ignored_fields)) {
+    append_field_name (dest, start, "offset");
+    uint64_format (value_str, segment->offset);
+    g_string_append (dest, value_str);
+  }
 
-  return segment_str;
+  if (use_field ("stop", logged_fields, ignored_fields)) {
+    append_field_name (dest, start, "stop");
+    uint64_format (value_str, segment->stop);
+    g_string_append (dest, value_str);
+  }
+
+  if (segment->rate != 1.0) {
+    append_field_name (dest, start, "rate");
+    g_string_append_printf (dest, "%f", segment->rate);
+  }
+  if (segment->applied_rate != 1.0) {
+    append_field_name (dest, start, "applied_rate");
+    g_string_append_printf (dest, "%f", segment->applied_rate);
+  }
+
+  if (segment->flags && use_field ("flags", logged_fields, ignored_fields)) {
+    append_field_name (dest, start, "flags");
+    g_string_append_printf (dest, "0x%02x", segment->flags);
+  }
+
+  if (use_field ("time", logged_fields, ignored_fields)) {
+    append_field_name (dest, start, "time");
+    uint64_format (value_str, segment->time);
+    g_string_append (dest, value_str);
+  }
+  if (use_field ("base", logged_fields, ignored_fields)) {
+    append_field_name (dest, start, "base");
+    uint64_format (value_str, segment->base);
+    g_string_append (dest, value_str);
+  }
+  if (use_field ("position", logged_fields, ignored_fields)) {
+    append_field_name (dest, start, "position");
+    uint64_format (value_str, segment->position);
+    g_string_append (dest, value_str);
+  }
+  if (GST_CLOCK_TIME_IS_VALID (segment->duration)
+      && use_field ("duration", logged_fields, ignored_fields)) {
+    append_field_name (dest, start, "duration");
+    uint64_format (value_str, segment->duration);
+    g_string_append (dest, value_str);
+  }
 }
 
 static gboolean
@@ -148,263 +310,326 @@ structure_only_given_keys (GQuark field_id, GValue * value,
 }
 
 static void
-gpointer_free (gpointer pointer_location)
+append_structure (GString * dest, const GstStructure * structure)
 {
-  g_free (*(void **) pointer_location);
+  gchar *structure_str = gst_structure_to_string (structure);
+
+  g_string_append (dest, structure_str);
+  g_free (structure_str);
 }
 
-gchar *
-validate_flow_format_caps (const GstCaps * caps, gchar ** keys_to_print)
+void
+validate_flow_format_caps (GString * dest, const GstCaps * caps,
+    gchar ** keys_to_print)
 {
   guint i;
-  GArray *structures_strv = g_array_new (TRUE, FALSE, sizeof (gchar *));
-  gchar *caps_str;
-
-  g_array_set_clear_func (structures_strv, gpointer_free);
 
   /* A single GstCaps can contain several caps structures (although only one is
    * used in most cases). We will print them separated with spaces. */
   for (i = 0; i < gst_caps_get_size (caps); i++) {
-    GstStructure *structure =
-        gst_structure_copy (gst_caps_get_structure (caps, i));
-    gchar *structure_str;
-    gst_structure_filter_and_map_in_place (structure, structure_only_given_keys,
-        (gpointer) keys_to_print);
-    structure_str = gst_structure_to_string (structure);
-    g_array_append_val (structures_strv, structure_str);
-    gst_structure_free (structure);
-  }
+    const GstStructure *structure = gst_caps_get_structure (caps, i);
+
+    if (i)
+      g_string_append_c (dest, ' ');
+
+    if (keys_to_print) {
+      GstStructure *filtered = gst_structure_copy (structure);
 
-  caps_str = g_strjoinv (" ", (gchar **) structures_strv->data);
-  g_array_free (structures_strv, TRUE);
-  return caps_str;
+      gst_structure_filter_and_map_in_place (filtered,
+          structure_only_given_keys, (gpointer) keys_to_print);
+      append_structure (dest, filtered);
+      gst_structure_free (filtered);
+    } else {
+      append_structure (dest, structure);
+    }
+  }
 }
 
+static GFlagsClass *
+buffer_flags_class (void)
+{
+  static GFlagsClass *flags_class = NULL;
 
-static gchar *
-buffer_get_flags_string (GstBuffer * buffer)
+  if (g_once_init_enter (&flags_class)) {
+    g_once_init_leave (&flags_class,
+        G_FLAGS_CLASS (g_type_class_ref (gst_buffer_flags_get_type ())));
+  }
+
+  return flags_class;
+}
+
+static void
+append_buffer_flags (GString * dest, gsize start, GstBuffer * buffer)
 {
-  GFlagsClass *flags_class =
-      G_FLAGS_CLASS (g_type_class_ref (gst_buffer_flags_get_type ()));
+  GFlagsClass *flags_class = buffer_flags_class ();
   GstBufferFlags flags = GST_BUFFER_FLAGS (buffer);
-  GString *string = NULL;
+  gboolean first = TRUE;
 
   while (1) {
     GFlagsValue *value = g_flags_get_first_value (flags_class, flags);
     if (!value)
       break;
 
-    if (string == NULL)
-      string = g_string_new (NULL);
+    if (first)
+      append_field_name (dest, start, "flags");
     else
-      g_string_append (string, " ");
+      g_string_append_c (dest, ' ');
+    first = FALSE;
 
-    g_string_append (string, value->value_nick);
+    g_string_append (dest, value->value_nick);
     flags &= ~value->value;
   }
-
-  return (string != NULL) ? g_string_free (string, FALSE) : NULL;
 }
 
-/* Returns a newly-allocated string describing the metas on this buffer, or NULL */
-static gchar *
-buffer_get_meta_string (GstBuffer * buffer)
+/* Appends the metas on this buffer, if any */
+static void
+append_buffer_metas (GString * dest, gsize start, GstBuffer * buffer)
 {
   gpointer state = NULL;
   GstMeta *meta;
-  GString *s = NULL;
+  gboolean first = TRUE;
 
   while ((meta = gst_buffer_iterate_meta (buffer, &state))) {
-    const gchar *desc = g_type_name (meta->info->type);
-
-    if (s == NULL)
-      s = g_string_new (NULL);
+    if (first)
+      append_field_name (dest, start, "meta");
     else
-      g_string_append (s, ", ");
+      g_string_append_len (dest, ", ", 2);
+    first = FALSE;
 
     if (meta->info->api == GST_VIDEO_REGION_OF_INTEREST_META_API_TYPE) {
       GstVideoRegionOfInterestMeta *roi = (GstVideoRegionOfInterestMeta *) meta;
-      g_string_append_printf (s,
+      g_string_append_printf (dest,
           "GstVideoRegionOfInterestMeta[x=%" G_GUINT32_FORMAT ", y=%"
           G_GUINT32_FORMAT ", width=%" G_GUINT32_FORMAT ", height=%"
           G_GUINT32_FORMAT "]", roi->x, roi->y, roi->w, roi->h);
     } else {
-      g_string_append (s, desc);
+      g_string_append (dest, g_type_name (meta->info->type));
     }
   }
+}
+
+static void
+append_time_field (GString * dest, gsize start, const gchar * name,
+    GstClockTime time)
+{
+  gchar time_str[32];
 
-  return (s != NULL) ? g_string_free (s, FALSE) : NULL;
+  append_field_name (dest, start, name);
+  format_time (time_str, time);
+  g_string_append (dest, time_str);
+}
+
+gboolean
+validate_flow_buffer_needs_checksum (gint checksum_type, guint fields)
+{
+  return checksum_type != CHECKSUM_TYPE_NONE
+      || (fields & VALIDATE_FLOW_BUFFER_FIELD_CHECKSUM);
+}
+
+/* Formats @size bytes as space separated "0xNN" values, 5 chars per byte */
+static gchar *
+format_content_hex (const guint8 * data, gsize size)
+{
+  static const gchar hex_digits[] = "0123456789abcdef";
+  gchar *content, *c;
+  gsize i;
+
+  if (!size)
+    return g_strdup ("");
+
+  content = c = g_malloc (size * 5);
+  for (i = 0; i < size; i++) {
+    c[0] = '0';
+    c[1] = 'x';
+    c[2] = hex_digits[data[i] >> 4];
+    c[3] = hex_digits[data[i] & 0xf];
+    c[4] = ' ';
+    c += 5;
+  }
+  /* Replace the last separator with the terminating NUL */
+  content[size * 5 - 1] = '\0';
+
+  return content;
 }
 
 gchar *
-validate_flow_format_buffer (GstBuffer * buffer, gint checksum_type,
-    GstStructure * logged_fields_struct, GstStructure * ignored_fields_struct)
+validate_flow_buffer_checksum (GstBuffer * buffer, gint checksum_type)
 {
-  gchar *flags_str, *meta_str, *buffer_str;
-  gchar *buffer_parts[7];
-  int buffer_parts_index = 0;
   GstMapInfo map;
-  gchar **logged_fields =
-      logged_fields_struct ? gst_validate_utils_get_strv (logged_fields_struct,
-      "buffer") : NULL;
-  gchar **ignored_fields =
-      ignored_fields_struct ?
-      gst_validate_utils_get_strv (ignored_fields_struct, "buffer") : NULL;
+  gchar *sum;
 
-  if (checksum_type != CHECKSUM_TYPE_NONE || (logged_fields
-          && g_strv_contains (CONSTIFY (logged_fields), "checksum"))) {
-    if (!gst_buffer_map (buffer, &map, GST_MAP_READ)) {
-      GST_ERROR ("Buffer could not be mapped.");
-    } else if (checksum_type == CHECKSUM_TYPE_CONTENT_HEX) {
-      gint i;
-      GString *content = g_string_new ("content=");
-
-      for (i = 0; i < map.size; i++) {
-        if (i)
-          g_string_append_c (content, ' ');
-        g_string_append_printf (content, "0x%02x", map.data[i]);
-      }
-
-      buffer_parts[buffer_parts_index++] = g_string_free (content, FALSE);
-    } else {
-      gchar *sum =
-          g_compute_checksum_for_data (checksum_type ==
-          CHECKSUM_TYPE_AS_ID ? G_CHECKSUM_SHA1 : checksum_type, map.data,
-          map.size);
-      gst_buffer_unmap (buffer, &map);
-
-      if (checksum_type == CHECKSUM_TYPE_AS_ID) {
-        gint id;
-
-        G_LOCK (checksums_as_id_lock);
-        if (!checksums_as_id)
-          checksums_as_id = gst_structure_new_empty ("checksums-id");
-        if (!gst_structure_get_int (checksums_as_id, sum, &id)) {
-          id = gst_structure_n_fields (checksums_as_id);
-          gst_structure_set (checksums_as_id, sum, G_TYPE_INT, id, NULL);
-        }
-        G_UNLOCK (checksums_as_id_lock);
-
-        buffer_parts[buffer_parts_index++] =
-            g_strdup_printf ("content-id=%d", id);
-      } else {
-        buffer_parts[buffer_parts_index++] =
-            g_strdup_printf ("checksum=%s", sum);
-      }
-      g_free (sum);
-    }
+  if (!gst_buffer_map (buffer, &map, GST_MAP_READ)) {
+    GST_ERROR ("Buffer could not be mapped.");
+    return NULL;
   }
 
-  if (GST_CLOCK_TIME_IS_VALID (buffer->dts)
-      && use_field ("dts", logged_fields, ignored_fields)) {
-    gchar time_str[32];
-    format_time (time_str, buffer->dts);
-    buffer_parts[buffer_parts_index++] = g_strdup_printf ("dts=%s", time_str);
+  if (checksum_type == CHECKSUM_TYPE_CONTENT_HEX) {
+    sum = format_content_hex (map.data, map.size);
+  } else if (checksum_type == CHECKSUM_TYPE_AS_ID) {
+    GChecksum *checksum = g_checksum_new (CONTENT_ID_CHECKSUM);
+    gsize digest_len = VALIDATE_FLOW_CONTENT_ID_DIGEST_SIZE;
+
+    sum = g_malloc (digest_len);
+    g_checksum_update (checksum, map.data, map.size);
+    g_checksum_get_digest (checksum, (guint8 *) sum, &digest_len);
+    g_checksum_free (checksum);
+  } else {
+    /* Logging the checksum field without a checksum type uses the same
+     * default as `buffers-checksum=true` */
+    if (checksum_type == CHECKSUM_TYPE_NONE)
+      checksum_type = G_CHECKSUM_SHA1;
+
+    sum = g_compute_checksum_for_data (checksum_type, map.data, map.size);
   }
+  gst_buffer_unmap (buffer, &map);
 
-  if (GST_CLOCK_TIME_IS_VALID (buffer->pts)
-      && use_field ("pts", logged_fields, ignored_fields)) {
-    gchar time_str[32];
-    format_time (time_str, buffer->pts);
-    buffer_parts[buffer_parts_index++] = g_strdup_printf ("pts=%s", time_str);
+  return sum;
+}
+
+void
+validate_flow_format_buffer_checksum (GString * dest, gint checksum_type,
+    const gchar * checksum, ValidateFlowContentIds * content_ids)
+{
+  gsize start = dest->len;
+
+  if (checksum_type == CHECKSUM_TYPE_CONTENT_HEX) {
+    append_field_name (dest, start, "content");
+    g_string_append (dest, checksum);
+  } else if (checksum_type == CHECKSUM_TYPE_AS_ID) {
+    gint id =
+        validate_flow_content_ids_get (content_ids, (const guint8 *) checksum);
+    gchar id_str[16];
+
+    append_field_name (dest, start, "content-id");
+    g_snprintf (id_str, sizeof (id_str), "%d", id);
+    g_string_append (dest, id_str);
+  } else {
+    append_field_name (dest, start, "checksum");
+    g_string_append (dest, checksum);
   }
+}
+
+void
+validate_flow_format_buffer_fields (GString * dest, gsize start,
+    GstBuffer * buffer, guint fields)
+{
+  if (GST_CLOCK_TIME_IS_VALID (buffer->dts)
+      && (fields & VALIDATE_FLOW_BUFFER_FIELD_DTS))
+    append_time_field (dest, start, "dts", buffer->dts);
+
+  if (GST_CLOCK_TIME_IS_VALID (buffer->pts)
+      && (fields & VALIDATE_FLOW_BUFFER_FIELD_PTS))
+    append_time_field (dest, start, "pts", buffer->pts);
 
   if (GST_CLOCK_TIME_IS_VALID (buffer->duration)
-      && use_field ("dur", logged_fields, ignored_fields)) {
-    gchar time_str[32];
-    format_time (time_str, buffer->duration);
-    buffer_parts[buffer_parts_index++] = g_strdup_printf ("dur=%s", time_str);
-  }
+      && (fields & VALIDATE_FLOW_BUFFER_FIELD_DUR))
+    append_time_field (dest, start, "dur", buffer->duration);
+
+  if (fields & VALIDATE_FLOW_BUFFER_FIELD_FLAGS)
+    append_buffer_flags (dest, start, buffer);
 
-  flags_str = buffer_get_flags_string (buffer);
-  if (flags_str && use_field ("flags", logged_fields, ignored_fields)) {
-    buffer_parts[buffer_parts_index++] =
-        g_strdup_printf ("flags=%s", flags_str);
+  if (fields & VALIDATE_FLOW_BUFFER_FIELD_META)
+    append_buffer_metas (dest, start, buffer);
+}
+
+void
+validate_flow_format_buffer (GString * dest, GstBuffer * buffer,
+    gint checksum_type, guint fields, ValidateFlowContentIds * content_ids)
+{
+  gsize start = dest->len;
+
+  if (validate_flow_buffer_needs_checksum (checksum_type, fields)) {
+    gchar *sum = validate_flow_buffer_checksum (buffer, checksum_type);
+
+    if (sum) {
+      validate_flow_format_buffer_checksum (dest, checksum_type, sum,
+          content_ids);
+      g_free (sum);
+    }
   }
 
-  meta_str = buffer_get_meta_string (buffer);
-  if (meta_str && use_field ("meta", logged_fields, ignored_fields))
-    buffer_parts[buffer_parts_index++] = g_strdup_printf ("meta=%s", meta_str);
+  validate_flow_format_buffer_fields (dest, start, buffer, fields);
+
+  if (dest->len == start)
+    g_string_append (dest, "(empty)");
+}
 
-  buffer_parts[buffer_parts_index] = NULL;
-  buffer_str =
-      buffer_parts_index > 0 ? g_strjoinv (", ",
-      buffer_parts) : g_strdup ("(empty)");
+static gboolean
+structure_has_any_field (const GstStructure * structure, gchar ** fields)
+{
+  gint i;
 
-  g_free (meta_str);
-  g_free (flags_str);
-  while (buffer_parts_index > 0)
-    g_free (buffer_parts[--buffer_parts_index]);
+  for (i = 0; fields[i]; i++) {
+    if (gst_structure_has_field (structure, fields[i]))
+      return TRUE;
+  }
 
-  return buffer_str;
+  return FALSE;
 }
 
-gchar *
-validate_flow_format_event (GstEvent * event,
+gboolean
+validate_flow_format_event (GString * dest, GstEvent * event,
     const gchar * const *caps_properties,
-    GstStructure * logged_fields_struct,
-    GstStructure * ignored_fields_struct,
+    GHashTable * logged_fields_table,
+    GHashTable * ignored_fields_table,
     const gchar * const *ignored_event_types,
     const gchar * const *logged_event_types)
 {
   const gchar *event_type;
-  gchar *structure_string;
-  gchar *event_string;
+  const GstStructure *structure;
   gchar **ignored_fields;
   gchar **logged_fields;
 
   event_type = gst_event_type_get_name (GST_EVENT_TYPE (event));
 
   if (logged_event_types && !g_strv_contains (logged_event_types, event_type))
-    return NULL;
+    return FALSE;
 
   if (ignored_event_types && g_strv_contains (ignored_event_types, event_type))
-    return NULL;
+    return FALSE;
 
-  logged_fields =
-      logged_fields_struct ? gst_validate_utils_get_strv (logged_fields_struct,
-      event_type) : NULL;
-  ignored_fields =
-      ignored_fields_struct ?
-      gst_validate_utils_get_strv (ignored_fields_struct, event_type) : NULL;
+  logged_fields = logged_fields_table ?
+      g_hash_table_lookup (logged_fields_table, event_type) : NULL;
+  ignored_fields = ignored_fields_table ?
+      g_hash_table_lookup (ignored_fields_table, event_type) : NULL;
+
+  g_string_append (dest, event_type);
+  g_string_append_len (dest, ": ", 2);
+
+  structure = gst_event_get_structure (event);
   if (GST_EVENT_TYPE (event) == GST_EVENT_SEGMENT) {
     const GstSegment *segment;
     gst_event_parse_segment (event, &segment);
-    structure_string =
-        validate_flow_format_segment (segment, logged_fields, ignored_fields);
+    validate_flow_format_segment (dest, segment, logged_fields,
+        ignored_fields);
   } else if (GST_EVENT_TYPE (event) == GST_EVENT_CAPS) {
     GstCaps *caps;
     gst_event_parse_caps (event, &caps);
 
-    structure_string =
-        validate_flow_format_caps (caps,
+    validate_flow_format_caps (dest, caps,
         logged_fields ? logged_fields : (gchar **) caps_properties);
-  } else if (!gst_event_get_structure (event)) {
-    structure_string = g_strdup ("(no structure)");
-  } else {
-    GstStructure *printable =
-        gst_structure_copy (gst_event_get_structure (event));
-
-    if (logged_fields) {
-      gst_structure_filter_and_map_in_place (printable,
-          (GstStructureFilterMapFunc) structure_only_given_keys, logged_fields);
-    } else {
-      if (ignored_fields) {
-        gint i = 0;
-        gchar *field;
-
-        for (field = ignored_fields[i]; field; field = ignored_fields[++i])
-          gst_structure_remove_field (printable, field);
-      }
-    }
-
-    structure_string = gst_structure_to_string (printable);
+  } else if (!structure) {
+    g_string_append (dest, "(no structure)");
+  } else if (logged_fields) {
+    GstStructure *printable = gst_structure_copy (structure);
+
+    gst_structure_filter_and_map_in_place (printable,
+        (GstStructureFilterMapFunc) structure_only_given_keys, logged_fields);
+    append_structure (dest, printable);
     gst_structure_free (printable);
+  } else if (ignored_fields
+      && structure_has_any_field (structure, ignored_fields)) {
+    GstStructure *printable = gst_structure_copy (structure);
+    gint i;
+
+    for (i = 0; ignored_fields[i]; i++)
+      gst_structure_remove_field (printable, ignored_fields[i]);
+    append_structure (dest, printable);
+    gst_structure_free (printable);
+  } else {
+    /* Nothing to filter out, serialize the event structure as is */
+    append_structure (dest, structure);
   }
 
-  event_string = g_strdup_printf ("%s: %s", event_type, structure_string);
-  g_strfreev (logged_fields);
-  g_strfreev (ignored_fields);
-  g_free (structure_string);
-  return event_string;
+  return TRUE;
 }
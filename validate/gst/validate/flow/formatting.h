@@ -29,14 +29,49 @@
 #define CHECKSUM_TYPE_NONE -2
 #define CHECKSUM_TYPE_CONTENT_HEX -3
 
+/* Size of the binary digests returned by validate_flow_buffer_checksum() for
+ * CHECKSUM_TYPE_AS_ID */
+#define VALIDATE_FLOW_CONTENT_ID_DIGEST_SIZE 16
+
+/* Maps buffer digests to sequential ids, in the order they are first seen */
+typedef struct _ValidateFlowContentIds ValidateFlowContentIds;
+
+typedef enum
+{
+  VALIDATE_FLOW_BUFFER_FIELD_CHECKSUM = 1 << 0,
+  VALIDATE_FLOW_BUFFER_FIELD_DTS = 1 << 1,
+  VALIDATE_FLOW_BUFFER_FIELD_PTS = 1 << 2,
+  VALIDATE_FLOW_BUFFER_FIELD_DUR = 1 << 3,
+  VALIDATE_FLOW_BUFFER_FIELD_FLAGS = 1 << 4,
+  VALIDATE_FLOW_BUFFER_FIELD_META = 1 << 5,
+} ValidateFlowBufferFields;
+
 void format_time(gchar* dest_str, guint64 time);
 
-gchar* validate_flow_format_segment(const GstSegment* segment, gchar** logged_fields, gchar** ignored_fields);
+ValidateFlowContentIds* validate_flow_content_ids_new(void);
+
+void validate_flow_content_ids_free(ValidateFlowContentIds* content_ids);
+
+gint validate_flow_content_ids_get(ValidateFlowContentIds* content_ids, const guint8* digest);
+
+guint validate_flow_buffer_fields_from_structs(GstStructure* logged_fields_struct, GstStructure* ignored_fields_struct);
+
+GHashTable* validate_flow_event_fields_table_new(GstStructure* fields_struct);
+
+void validate_flow_format_segment(GString* dest, const GstSegment* segment, gchar** logged_fields, gchar** ignored_fields);
+
+void validate_flow_format_caps(GString* dest, const GstCaps* caps, gchar **keys_to_print);
+
+gboolean validate_flow_buffer_needs_checksum(gint checksum_type, guint fields);
+
+gchar* validate_flow_buffer_checksum(GstBuffer* buffer, gint checksum_type);
+
+void validate_flow_format_buffer_checksum(GString* dest, gint checksum_type, const gchar* checksum, ValidateFlowContentIds* content_ids);
 
-gchar* validate_flow_format_caps (const GstCaps* caps, gchar **keys_to_print);
+void validate_flow_format_buffer_fields(GString* dest, gsize start, GstBuffer* buffer, guint fields);
 
-gchar* validate_flow_format_buffer(GstBuffer* buffer, gboolean add_checksum, GstStructure* logged_fields_struct, GstStructure* ignored_fields_struct);
+void validate_flow_format_buffer(GString* dest, GstBuffer* buffer, gint checksum_type, guint fields, ValidateFlowContentIds* content_ids);
 
-gchar* validate_flow_format_event(GstEvent* event, const gchar* const* caps_properties, GstStructure* logged_event_fields, GstStructure* ignored_event_fields, const gchar* const* ignored_event_types, const gchar* const* logged_event_types);
+gboolean validate_flow_format_event(GString* dest, GstEvent* event, const gchar* const* caps_properties, GHashTable* logged_fields, GHashTable* ignored_fields, const gchar* const* ignored_event_types, const gchar* const* logged_event_types);
 
 #endif // __GST_VALIDATE_FLOW_FORMATTING_H__
@@ -33,6 +33,7 @@
 #include "../gst-validate-report.h"
 #include "../gst-validate-internal.h"
 #include "formatting.h"
+#include "diff.h"
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>
@@ -79,6 +80,7 @@ struct _ValidateFlowOverride
   const gchar *pad_name;
   gboolean record_buffers;
   gint checksum_type;
+  ValidateFlowContentIds *content_ids;
   gchar *expectations_dir;
   gchar *actual_results_dir;
   gboolean error_writing_file;
@@ -86,6 +88,12 @@ struct _ValidateFlowOverride
   GstStructure *ignored_fields;
   GstStructure *logged_fields;
 
+  /* Precomputed from logged_fields and ignored_fields so that formatting
+   * does not need to look them up for each buffer and event */
+  guint buffer_fields;
+  GHashTable *logged_event_fields;
+  GHashTable *ignored_event_fields;
+
   gchar **logged_event_types;
   gchar **ignored_event_types;
 
@@ -95,14 +103,55 @@ struct _ValidateFlowOverride
   gboolean was_attached;
   GstStructure *config;
 
+  /* Whether the expectations and actual results files are gzip streams */
+  gboolean compressed;
+
+  guint diff_context;
+  gsize diff_max_size;
+
   /* output_file will refer to the expectations file if it did not exist,
    * or to the actual results file otherwise. */
   gchar *output_file_path;
-  FILE *output_file;
+  GOutputStream *output_file;
   GMutex output_file_mutex;
 
+  /* Reused for every logged line, protected by output_file_mutex */
+  GString *line;
+
+  /* Buffer checksums are computed in checksum_pool. Lines are queued in
+   * pending_lines in stream order and written as soon as all the lines
+   * before them are ready, see validate_flow_override_flush_pending_unlocked */
+  GThreadPool *checksum_pool;
+  gsize max_pending_bytes;
+  gsize pending_bytes;
+  GQueue pending_lines;
+  GMutex pending_lock;
+  GCond pending_cond;
 };
 
+typedef struct
+{
+  gboolean is_buffer;
+  gboolean ready;
+
+  /* For buffers: the buffer to checksum, released once hashed */
+  GstBuffer *buffer;
+  gsize size;
+  gchar *checksum;
+
+  /* The whole line for events, or the formatted buffer fields following the
+   * checksum for buffers */
+  GString *line;
+} ValidateFlowPendingLine;
+
+#define DEFAULT_CHECKSUM_MAX_PENDING_BYTES (64 * 1024 * 1024)
+#define OUTPUT_BUFFER_SIZE (64 * 1024)
+#define GZIP_SUFFIX ".gz"
+#define DEFAULT_DIFF_CONTEXT 3
+#define DEFAULT_DIFF_MAX_SIZE (64 * 1024)
+/* Maximum number of lines compared after the first mismatch */
+#define DIFF_WINDOW_LINES 1024
+
 GList *all_overrides = NULL;
 
 static void validate_flow_override_finalize (GObject * object);
@@ -119,6 +168,12 @@ G_DEFINE_TYPE (ValidateFlowOverride, validate_flow_override,
 void
 validate_flow_override_init (ValidateFlowOverride * self)
 {
+  g_mutex_init (&self->output_file_mutex);
+  self->line = g_string_sized_new (256);
+
+  g_queue_init (&self->pending_lines);
+  g_mutex_init (&self->pending_lock);
+  g_cond_init (&self->pending_cond);
 }
 
 void
@@ -146,35 +201,138 @@ validate_flow_override_class_init (ValidateFlowOverrideClass * klass)
           GST_VALIDATE_REPORT_LEVEL_CRITICAL));
 }
 
-/* *INDENT-OFF* */
-G_GNUC_PRINTF (2, 0)
-/* *INDENT-ON* */
+/* Must be called with output_file_mutex held */
+static void
+validate_flow_override_write_line_unlocked (ValidateFlowOverride * flow,
+    GString * line)
+{
+  GError *error = NULL;
+
+  if (!flow->error_writing_file
+      && !g_output_stream_write_all (flow->output_file, line->str, line->len,
+          NULL, NULL, &error)) {
+    GST_ERROR_OBJECT (flow, "Writing to file %s failed: %s",
+        flow->output_file_path, error->message);
+    g_error_free (error);
+    flow->error_writing_file = TRUE;
+  }
+}
+
+static void
+validate_flow_pending_line_free (ValidateFlowPendingLine * pending)
+{
+  gst_clear_buffer (&pending->buffer);
+  g_free (pending->checksum);
+  g_string_free (pending->line, TRUE);
+  g_slice_free (ValidateFlowPendingLine, pending);
+}
 
+/* Writes the ready lines at the head of pending_lines, stopping at the first
+ * buffer whose checksum is still being computed so that the output keeps the
+ * stream order. Must be called with pending_lock held */
 static void
-validate_flow_override_vprintf (ValidateFlowOverride * flow, const char *format,
-    va_list ap)
+validate_flow_override_flush_pending_unlocked (ValidateFlowOverride * flow)
 {
+  ValidateFlowPendingLine *pending;
+
   g_mutex_lock (&flow->output_file_mutex);
-  if (!flow->error_writing_file && vfprintf (flow->output_file, format, ap) < 0) {
-    GST_ERROR_OBJECT (flow, "Writing to file %s failed",
-        flow->output_file_path);
-    flow->error_writing_file = TRUE;
+  while ((pending = g_queue_peek_head (&flow->pending_lines))
+      && pending->ready) {
+    g_queue_pop_head (&flow->pending_lines);
+
+    if (pending->is_buffer) {
+      g_string_assign (flow->line, "buffer: ");
+      if (pending->checksum)
+        validate_flow_format_buffer_checksum (flow->line, flow->checksum_type,
+            pending->checksum, flow->content_ids);
+
+      if (pending->line->len) {
+        if (pending->checksum)
+          g_string_append_len (flow->line, ", ", 2);
+        g_string_append_len (flow->line, pending->line->str,
+            pending->line->len);
+      } else if (!pending->checksum) {
+        g_string_append (flow->line, "(empty)");
+      }
+      g_string_append_c (flow->line, '\n');
+
+      validate_flow_override_write_line_unlocked (flow, flow->line);
+      flow->pending_bytes -= pending->size;
+    } else {
+      validate_flow_override_write_line_unlocked (flow, pending->line);
+    }
+
+    validate_flow_pending_line_free (pending);
   }
   g_mutex_unlock (&flow->output_file_mutex);
+
+  g_cond_broadcast (&flow->pending_cond);
 }
 
-/* *INDENT-OFF* */
-G_GNUC_PRINTF (2, 3)
-/* *INDENT-ON* */
+static void
+validate_flow_override_checksum_func (ValidateFlowPendingLine * pending,
+    ValidateFlowOverride * flow)
+{
+  gchar *checksum =
+      validate_flow_buffer_checksum (pending->buffer, flow->checksum_type);
+
+  gst_clear_buffer (&pending->buffer);
+
+  g_mutex_lock (&flow->pending_lock);
+  pending->checksum = checksum;
+  pending->ready = TRUE;
+  validate_flow_override_flush_pending_unlocked (flow);
+  g_mutex_unlock (&flow->pending_lock);
+}
 
+/* Waits until all the queued lines have been written */
 static void
-validate_flow_override_printf (ValidateFlowOverride * flow, const char *format,
-    ...)
+validate_flow_override_drain (ValidateFlowOverride * flow)
 {
-  va_list ap;
-  va_start (ap, format);
-  validate_flow_override_vprintf (flow, format, ap);
-  va_end (ap);
+  if (!flow->checksum_pool)
+    return;
+
+  g_mutex_lock (&flow->pending_lock);
+  while (!g_queue_is_empty (&flow->pending_lines))
+    g_cond_wait (&flow->pending_cond, &flow->pending_lock);
+  g_mutex_unlock (&flow->pending_lock);
+}
+
+static void
+validate_flow_override_write_text (ValidateFlowOverride * flow,
+    const gchar * text)
+{
+  g_mutex_lock (&flow->pending_lock);
+  if (g_queue_is_empty (&flow->pending_lines)) {
+    g_mutex_lock (&flow->output_file_mutex);
+    g_string_assign (flow->line, text);
+    validate_flow_override_write_line_unlocked (flow, flow->line);
+    g_mutex_unlock (&flow->output_file_mutex);
+  } else {
+    ValidateFlowPendingLine *pending = g_slice_new0 (ValidateFlowPendingLine);
+
+    pending->line = g_string_new (text);
+    pending->ready = TRUE;
+    g_queue_push_tail (&flow->pending_lines, pending);
+  }
+  g_mutex_unlock (&flow->pending_lock);
+}
+
+static gboolean
+validate_flow_override_format_event_line (ValidateFlowOverride * flow,
+    GString * line, GstEvent * event)
+{
+  g_string_assign (line, "event ");
+  if (!validate_flow_format_event (line, event,
+          (const gchar * const *) flow->caps_properties,
+          flow->logged_event_fields,
+          flow->ignored_event_fields,
+          (const gchar * const *) flow->ignored_event_types,
+          (const gchar * const *) flow->logged_event_types))
+    return FALSE;
+
+  g_string_append_c (line, '\n');
+  return TRUE;
 }
 
 static void
@@ -182,22 +340,32 @@ validate_flow_override_event_handler (GstValidateOverride * override,
     GstValidateMonitor * pad_monitor, GstEvent * event)
 {
   ValidateFlowOverride *flow = VALIDATE_FLOW_OVERRIDE (override);
-  gchar *event_string;
 
   if (flow->error_writing_file)
     return;
 
-  event_string = validate_flow_format_event (event,
-      (const gchar * const *) flow->caps_properties,
-      flow->logged_fields,
-      flow->ignored_fields,
-      (const gchar * const *) flow->ignored_event_types,
-      (const gchar * const *) flow->logged_event_types);
-
-  if (event_string) {
-    validate_flow_override_printf (flow, "event %s\n", event_string);
-    g_free (event_string);
+  g_mutex_lock (&flow->pending_lock);
+  if (g_queue_is_empty (&flow->pending_lines)) {
+    g_mutex_lock (&flow->output_file_mutex);
+    if (validate_flow_override_format_event_line (flow, flow->line, event))
+      validate_flow_override_write_line_unlocked (flow, flow->line);
+    g_mutex_unlock (&flow->output_file_mutex);
+  } else {
+    /* Some buffers before this event are still being checksummed */
+    GString *line = g_string_new (NULL);
+
+    if (validate_flow_override_format_event_line (flow, line, event)) {
+      ValidateFlowPendingLine *pending =
+          g_slice_new0 (ValidateFlowPendingLine);
+
+      pending->line = line;
+      pending->ready = TRUE;
+      g_queue_push_tail (&flow->pending_lines, pending);
+    } else {
+      g_string_free (line, TRUE);
+    }
   }
+  g_mutex_unlock (&flow->pending_lock);
 }
 
 static void
@@ -205,15 +373,43 @@ validate_flow_override_buffer_handler (GstValidateOverride * override,
     GstValidateMonitor * pad_monitor, GstBuffer * buffer)
 {
   ValidateFlowOverride *flow = VALIDATE_FLOW_OVERRIDE (override);
-  gchar *buffer_str;
+  ValidateFlowPendingLine *pending;
 
   if (flow->error_writing_file || !flow->record_buffers)
     return;
 
-  buffer_str = validate_flow_format_buffer (buffer, flow->checksum_type,
-      flow->logged_fields, flow->ignored_fields);
-  validate_flow_override_printf (flow, "buffer: %s\n", buffer_str);
-  g_free (buffer_str);
+  if (!flow->checksum_pool) {
+    g_mutex_lock (&flow->output_file_mutex);
+    g_string_assign (flow->line, "buffer: ");
+    validate_flow_format_buffer (flow->line, buffer, flow->checksum_type,
+        flow->buffer_fields, flow->content_ids);
+    g_string_append_c (flow->line, '\n');
+    validate_flow_override_write_line_unlocked (flow, flow->line);
+    g_mutex_unlock (&flow->output_file_mutex);
+
+    return;
+  }
+
+  /* Everything but the checksum is formatted right away, the buffer is only
+   * kept alive until it has been hashed */
+  pending = g_slice_new0 (ValidateFlowPendingLine);
+  pending->is_buffer = TRUE;
+  pending->buffer = gst_buffer_ref (buffer);
+  pending->size = gst_buffer_get_size (buffer);
+  pending->line = g_string_new (NULL);
+  validate_flow_format_buffer_fields (pending->line, 0, buffer,
+      flow->buffer_fields);
+
+  g_mutex_lock (&flow->pending_lock);
+  /* Bound the memory held by in-flight buffers, one is always accepted */
+  while (flow->pending_bytes
+      && flow->pending_bytes + pending->size > flow->max_pending_bytes)
+    g_cond_wait (&flow->pending_cond, &flow->pending_lock);
+  flow->pending_bytes += pending->size;
+  g_queue_push_tail (&flow->pending_lines, pending);
+  g_mutex_unlock (&flow->pending_lock);
+
+  g_thread_pool_push (flow->checksum_pool, pending, NULL);
 }
 
 static gchar *
@@ -286,6 +482,9 @@ validate_flow_override_new (GstStructure * config)
   if (flow->checksum_type != CHECKSUM_TYPE_NONE)
     flow->record_buffers = TRUE;
 
+  if (flow->checksum_type == CHECKSUM_TYPE_AS_ID)
+    flow->content_ids = validate_flow_content_ids_new ();
+
   /* caps-properties: Caps events can include many dfferent properties, but
    * many of these may be irrelevant for some tests. If this option is set,
    * only the listed properties will be written to the expectation log. */
@@ -336,6 +535,44 @@ validate_flow_override_new (GstStructure * config)
     flow->logged_fields = NULL;
   }
 
+  flow->buffer_fields =
+      validate_flow_buffer_fields_from_structs (flow->logged_fields,
+      flow->ignored_fields);
+  flow->logged_event_fields =
+      validate_flow_event_fields_table_new (flow->logged_fields);
+  flow->ignored_event_fields =
+      validate_flow_event_fields_table_new (flow->ignored_fields);
+
+  /* checksum-threads: Number of threads computing buffer checksums, 0 to
+   * compute them in the streaming thread. Defaults to the number of
+   * processors. */
+  if (flow->record_buffers
+      && validate_flow_buffer_needs_checksum (flow->checksum_type,
+          flow->buffer_fields)) {
+    gint n_threads = g_get_num_processors ();
+    gint max_pending_bytes = DEFAULT_CHECKSUM_MAX_PENDING_BYTES;
+
+    if (gst_structure_has_field (config, "checksum-threads")
+        && (!gst_structure_get_int (config, "checksum-threads", &n_threads)
+            || n_threads < 0))
+      gst_validate_error_structure (config,
+          "checksum-threads should be a positive integer");
+
+    /* checksum-max-pending-bytes: Maximum size of the buffers waiting for
+     * their checksum before the streaming thread gets blocked. */
+    if (gst_structure_has_field (config, "checksum-max-pending-bytes")
+        && (!gst_structure_get_int (config, "checksum-max-pending-bytes",
+                &max_pending_bytes) || max_pending_bytes < 0))
+      gst_validate_error_structure (config,
+          "checksum-max-pending-bytes should be a positive integer");
+
+    flow->max_pending_bytes = max_pending_bytes;
+    if (n_threads > 0)
+      flow->checksum_pool =
+          g_thread_pool_new ((GFunc) validate_flow_override_checksum_func,
+          flow, n_threads, FALSE, NULL);
+  }
+
   /* expectations-dir: Path to the directory where the expectations will be
    * written if they don't exist, relative to the current working directory.
    * By default the current working directory is used. */
@@ -368,6 +605,65 @@ validate_flow_override_new (GstStructure * config)
     g_free (pad_name_safe);
   }
 
+  /* compress: Either `none` or `gzip`. By default gzip is used when only a
+   * gzip compressed expectations file exists. */
+  {
+    const gchar *compress = gst_structure_get_string (config, "compress");
+
+    if (compress) {
+      if (!g_strcmp0 (compress, "gzip"))
+        flow->compressed = TRUE;
+      else if (g_strcmp0 (compress, "none"))
+        gst_validate_error_structure (config,
+            "Invalid value for compress: %s", compress);
+    } else if (gst_structure_has_field (config, "compress")) {
+      gst_validate_error_structure (config,
+          "Invalid value type for `compress`: '%s' instead of 'string'",
+          G_VALUE_TYPE_NAME (gst_structure_get_value (config, "compress")));
+    } else if (!g_file_test (flow->expectations_file_path,
+            G_FILE_TEST_EXISTS)) {
+      gchar *compressed_path =
+          g_strconcat (flow->expectations_file_path, GZIP_SUFFIX, NULL);
+
+      flow->compressed = g_file_test (compressed_path, G_FILE_TEST_EXISTS);
+      g_free (compressed_path);
+    }
+
+    if (flow->compressed) {
+      gchar *tmp = flow->expectations_file_path;
+
+      flow->expectations_file_path = g_strconcat (tmp, GZIP_SUFFIX, NULL);
+      g_free (tmp);
+
+      tmp = flow->actual_results_file_path;
+      flow->actual_results_file_path = g_strconcat (tmp, GZIP_SUFFIX, NULL);
+      g_free (tmp);
+    }
+  }
+
+  /* diff-context: Number of unchanged lines shown around the differences
+   * when the logs don't match. */
+  {
+    gint diff_context = DEFAULT_DIFF_CONTEXT;
+    gint diff_max_size = DEFAULT_DIFF_MAX_SIZE;
+
+    if (gst_structure_has_field (config, "diff-context")
+        && (!gst_structure_get_int (config, "diff-context", &diff_context)
+            || diff_context < 0))
+      gst_validate_error_structure (config,
+          "diff-context should be a positive integer");
+
+    /* diff-max-size: Maximum size in bytes of the printed diff. */
+    if (gst_structure_has_field (config, "diff-max-size")
+        && (!gst_structure_get_int (config, "diff-max-size", &diff_max_size)
+            || diff_max_size < 0))
+      gst_validate_error_structure (config,
+          "diff-max-size should be a positive integer");
+
+    flow->diff_context = diff_context;
+    flow->diff_max_size = diff_max_size;
+  }
+
   flow->was_attached = FALSE;
 
   gst_validate_override_register_by_name (flow->pad_name, override);
@@ -423,11 +719,103 @@ validate_flow_setup_files (ValidateFlowOverride * flow, gint default_generate)
     g_free (directory_path);
   }
 
-  flow->output_file = fopen (flow->output_file_path, "w");
+  {
+    GFile *file = g_file_new_for_path (flow->output_file_path);
+    GOutputStream *stream;
+    GError *error = NULL;
+
+    /* Not using g_file_replace() so that partial logs are kept if the test
+     * crashes */
+    g_file_delete (file, NULL, NULL);
+    stream = G_OUTPUT_STREAM (g_file_create (file, G_FILE_CREATE_NONE, NULL,
+            &error));
+    if (!stream)
+      gst_validate_abort ("Could not open for writing: %s Reason: %s",
+          flow->output_file_path, error->message);
+
+    if (flow->compressed) {
+      GConverter *compressor =
+          G_CONVERTER (g_zlib_compressor_new (G_ZLIB_COMPRESSOR_FORMAT_GZIP,
+              -1));
+      GOutputStream *compressed_stream =
+          g_converter_output_stream_new (stream, compressor);
+
+      g_object_unref (compressor);
+      g_object_unref (stream);
+      stream = compressed_stream;
+    }
+
+    flow->output_file =
+        g_buffered_output_stream_new_sized (stream, OUTPUT_BUFFER_SIZE);
+    g_object_unref (stream);
+    g_object_unref (file);
+  }
+}
+
+static void
+validate_flow_close_output_file (ValidateFlowOverride * flow)
+{
+  GError *error = NULL;
+
   if (!flow->output_file)
-    gst_validate_abort ("Could not open for writing: %s",
-        flow->output_file_path);
+    return;
 
+  g_mutex_lock (&flow->output_file_mutex);
+  if (!g_output_stream_close (flow->output_file, NULL, &error)
+      && !flow->error_writing_file) {
+    GST_ERROR_OBJECT (flow, "Writing to file %s failed: %s",
+        flow->output_file_path, error->message);
+    flow->error_writing_file = TRUE;
+  }
+  g_clear_error (&error);
+  g_clear_object (&flow->output_file);
+  g_mutex_unlock (&flow->output_file_mutex);
+}
+
+static GDataInputStream *
+validate_flow_open_log (ValidateFlowOverride * flow, const gchar * path,
+    const gchar * description)
+{
+  GFile *file = g_file_new_for_path (path);
+  GError *error = NULL;
+  GInputStream *stream = G_INPUT_STREAM (g_file_read (file, NULL, &error));
+  GDataInputStream *data_stream;
+
+  if (!stream)
+    gst_validate_abort ("Failed to open %s: %s Reason: %s", description, path,
+        error->message);
+  g_object_unref (file);
+
+  if (flow->compressed) {
+    GConverter *decompressor =
+        G_CONVERTER (g_zlib_decompressor_new (G_ZLIB_COMPRESSOR_FORMAT_GZIP));
+    GInputStream *decompressed_stream =
+        g_converter_input_stream_new (stream, decompressor);
+
+    g_object_unref (decompressor);
+    g_object_unref (stream);
+    stream = decompressed_stream;
+  }
+
+  data_stream = g_data_input_stream_new (stream);
+  g_data_input_stream_set_newline_type (data_stream,
+      G_DATA_STREAM_NEWLINE_TYPE_LF);
+  g_object_unref (stream);
+
+  return data_stream;
+}
+
+/* Returns the next line of @stream or NULL at the end of the stream */
+static gchar *
+validate_flow_read_line (GDataInputStream * stream, const gchar * path)
+{
+  GError *error = NULL;
+  gchar *line = g_data_input_stream_read_line (stream, NULL, NULL, &error);
+
+  if (error)
+    gst_validate_abort ("Failed to read %s Reason: %s", path, error->message);
+
+  return line;
 }
 
 static void
@@ -448,59 +836,6 @@ validate_flow_override_attached (GstValidateOverride * override)
   flow->was_attached = TRUE;
 }
 
-static void
-run_diff (const gchar * expected_file, const gchar * actual_file)
-{
-  GError *error = NULL;
-  GSubprocess *process =
-      g_subprocess_new (G_SUBPROCESS_FLAGS_STDOUT_PIPE, &error, "diff", "-u",
-      "--", expected_file, actual_file, NULL);
-  gchar *stdout_text = NULL;
-
-  g_subprocess_communicate_utf8 (process, NULL, NULL, &stdout_text, NULL,
-      &error);
-  if (!error) {
-    gboolean colored = gst_validate_has_colored_output ();
-    GSubprocess *process2;
-    gchar *fname = NULL;
-    gint f = g_file_open_tmp ("XXXXXX.diff", &fname, NULL);
-
-    if (f > 0) {
-      gchar *tmpstdout;
-      g_file_set_contents (fname, stdout_text, -1, NULL);
-      close (f);
-
-      process2 =
-          g_subprocess_new (G_SUBPROCESS_FLAGS_STDOUT_PIPE, &error, "bat", "-l",
-          "diff", "--paging", "never", "--color", colored ? "always" : "never",
-          fname, NULL);
-
-      g_subprocess_communicate_utf8 (process2, NULL, NULL, &tmpstdout, NULL,
-          &error);
-      if (!error) {
-        g_free (stdout_text);
-        stdout_text = tmpstdout;
-      } else {
-        colored = FALSE;
-        GST_DEBUG ("Could not use bat: %s", error->message);
-        g_clear_error (&error);
-      }
-      g_clear_object (&process2);
-      g_free (fname);
-    }
-
-    fprintf (stderr, "%s%s%s\n",
-        !colored ? "``` diff\n" : "", stdout_text, !colored ? "\n```" : "");
-  } else {
-    fprintf (stderr, "Cannot show more details, failed to run diff: %s",
-        error->message);
-    g_error_free (error);
-  }
-
-  g_object_unref (process);
-  g_free (stdout_text);
-}
-
 static const gchar *
 _line_to_show (gchar ** lines, gsize i)
 {
@@ -518,29 +853,88 @@ _line_to_show (gchar ** lines, gsize i)
   }
 }
 
+/* Returns the NULL terminated lines around the first mismatch: the matching
+ * lines before it followed by at most DIFF_WINDOW_LINES lines from @stream,
+ * starting with @line. */
+static GPtrArray *
+read_diff_window (GQueue * context_lines, const gchar * line,
+    GDataInputStream * stream, const gchar * path, gboolean * truncated)
+{
+  GPtrArray *lines = g_ptr_array_new_with_free_func (g_free);
+  GList *tmp;
+  gchar *next_line;
+
+  for (tmp = context_lines->head; tmp; tmp = tmp->next)
+    g_ptr_array_add (lines, g_strdup (tmp->data));
+
+  *truncated = FALSE;
+  if (line) {
+    guint n_read = 1;
+
+    g_ptr_array_add (lines, g_strdup (line));
+    while ((next_line = validate_flow_read_line (stream, path))) {
+      if (n_read++ == DIFF_WINDOW_LINES) {
+        *truncated = TRUE;
+        g_free (next_line);
+        break;
+      }
+      g_ptr_array_add (lines, next_line);
+    }
+  }
+  g_ptr_array_add (lines, NULL);
+
+  return lines;
+}
+
 static void
-show_mismatch_error (ValidateFlowOverride * flow, gchar ** lines_expected,
-    gchar ** lines_actual, gsize line_index)
+show_mismatch_error (ValidateFlowOverride * flow, GQueue * context_lines,
+    GDataInputStream * expected_stream, GDataInputStream * actual_stream,
+    const gchar * line_expected, const gchar * line_actual, gsize line_index)
 {
-  const gchar *line_expected = _line_to_show (lines_expected, line_index);
-  const gchar *line_actual = _line_to_show (lines_actual, line_index);
+  gboolean colored = gst_validate_has_colored_output ();
+  gboolean expected_truncated, actual_truncated;
+  GPtrArray *lines_expected, *lines_actual;
+  GString *diff;
+  guint n_context = context_lines->length;
+
+  lines_expected = read_diff_window (context_lines, line_expected,
+      expected_stream, flow->expectations_file_path, &expected_truncated);
+  lines_actual = read_diff_window (context_lines, line_actual,
+      actual_stream, flow->actual_results_file_path, &actual_truncated);
 
   GST_VALIDATE_REPORT (flow, VALIDATE_FLOW_MISMATCH,
       "Mismatch error in pad %s, line %" G_GSIZE_FORMAT
       ". Expected:\n%s\nActual:\n%s\n", flow->pad_name, line_index + 1,
-      line_expected, line_actual);
-
-  run_diff (flow->expectations_file_path, flow->actual_results_file_path);
+      _line_to_show ((gchar **) lines_expected->pdata, n_context),
+      _line_to_show ((gchar **) lines_actual->pdata, n_context));
+
+  diff = g_string_new (NULL);
+  validate_flow_diff (diff, flow->expectations_file_path,
+      flow->actual_results_file_path, (gchar **) lines_expected->pdata,
+      lines_expected->len - 1, (gchar **) lines_actual->pdata,
+      lines_actual->len - 1, line_index + 1 - n_context, flow->diff_context,
+      flow->diff_max_size, colored);
+  if (expected_truncated || actual_truncated)
+    g_string_append_printf (diff, "[... only the first %d lines after the "
+        "mismatch were compared ...]\n", DIFF_WINDOW_LINES);
+
+  fprintf (stderr, "%s%s%s\n",
+      !colored ? "``` diff\n" : "", diff->str, !colored ? "```" : "");
+
+  g_string_free (diff, TRUE);
+  g_ptr_array_unref (lines_expected);
+  g_ptr_array_unref (lines_actual);
 }
 
 static void
 runner_stopping (GstValidateRunner * runner, ValidateFlowOverride * flow)
 {
-  gchar **lines_expected, **lines_actual;
+  GDataInputStream *expected_stream, *actual_stream;
+  GQueue context_lines = G_QUEUE_INIT;
   gsize i = 0;
 
-  fclose (flow->output_file);
-  flow->output_file = NULL;
+  validate_flow_override_drain (flow);
+  validate_flow_close_output_file (flow);
 
   if (!flow->was_attached) {
     GST_VALIDATE_REPORT (flow, VALIDATE_FLOW_NOT_ATTACHED,
@@ -550,58 +944,51 @@ runner_stopping (GstValidateRunner * runner, ValidateFlowOverride * flow)
   }
 
   if (flow->mode == VALIDATE_FLOW_MODE_WRITING_EXPECTATIONS) {
-    gst_validate_skip_test ("wrote expectation files for %s.\n",
+    gst_validate_runner_skip_test (runner, "wrote expectation files for %s.\n",
         flow->pad_name);
 
     return;
   }
 
-  {
-    gchar *contents;
-    GError *error = NULL;
-    g_file_get_contents (flow->expectations_file_path, &contents, NULL, &error);
-    if (error) {
-      gst_validate_abort ("Failed to open expectations file: %s Reason: %s",
-          flow->expectations_file_path, error->message);
-    }
-    lines_expected = g_strsplit (contents, "\n", 0);
-    g_free (contents);
-  }
-
-  {
-    gchar *contents;
-    GError *error = NULL;
-    g_file_get_contents (flow->actual_results_file_path, &contents, NULL,
-        &error);
-    if (error) {
-      gst_validate_abort ("Failed to open actual results file: %s Reason: %s",
-          flow->actual_results_file_path, error->message);
-    }
-    lines_actual = g_strsplit (contents, "\n", 0);
-    g_free (contents);
-  }
+  expected_stream = validate_flow_open_log (flow, flow->expectations_file_path,
+      "expectations file");
+  actual_stream = validate_flow_open_log (flow, flow->actual_results_file_path,
+      "actual results file");
 
   gst_validate_printf (flow, "Checking that flow %s matches expected flow %s\n",
       flow->expectations_file_path, flow->actual_results_file_path);
 
-  for (i = 0; lines_expected[i] && lines_actual[i]; i++) {
-    if (g_strcmp0 (lines_expected[i], lines_actual[i])) {
-      show_mismatch_error (flow, lines_expected, lines_actual, i);
+  /* Both logs are compared line by line without loading them in memory, only
+   * the last matching lines are kept as context for the diff */
+  for (i = 0;; i++) {
+    gchar *line_expected = validate_flow_read_line (expected_stream,
+        flow->expectations_file_path);
+    gchar *line_actual = validate_flow_read_line (actual_stream,
+        flow->actual_results_file_path);
+
+    if (g_strcmp0 (line_expected, line_actual)) {
+      show_mismatch_error (flow, &context_lines, expected_stream,
+          actual_stream, line_expected, line_actual, i);
+      g_free (line_expected);
+      g_free (line_actual);
       goto stop;
     }
+
+    g_free (line_actual);
+    if (!line_expected)
+      break;
+
+    g_queue_push_tail (&context_lines, line_expected);
+    if (context_lines.length > flow->diff_context)
+      g_free (g_queue_pop_head (&context_lines));
   }
   gst_validate_printf (flow, "OK\n");
-  if (!lines_expected[i] && lines_actual[i]) {
-    show_mismatch_error (flow, lines_expected, lines_actual, i);
-    goto stop;
-  } else if (lines_expected[i] && !lines_actual[i]) {
-    show_mismatch_error (flow, lines_expected, lines_actual, i);
-    goto stop;
-  }
 
 stop:
-  g_strfreev (lines_expected);
-  g_strfreev (lines_actual);
+  g_queue_foreach (&context_lines, (GFunc) g_free, NULL);
+  g_queue_clear (&context_lines);
+  g_object_unref (expected_stream);
+  g_object_unref (actual_stream);
 }
 
 static void
@@ -610,18 +997,34 @@ validate_flow_override_finalize (GObject * object)
   ValidateFlowOverride *flow = VALIDATE_FLOW_OVERRIDE (object);
 
   all_overrides = g_list_remove (all_overrides, flow);
+  if (flow->checksum_pool) {
+    validate_flow_override_drain (flow);
+    g_thread_pool_free (flow->checksum_pool, FALSE, TRUE);
+  }
   g_free (flow->actual_results_dir);
   g_free (flow->actual_results_file_path);
   g_free (flow->expectations_dir);
   g_free (flow->expectations_file_path);
+  /* Closing the output file logs its path on errors */
+  validate_flow_close_output_file (flow);
   g_free (flow->output_file_path);
-  if (flow->output_file)
-    fclose (flow->output_file);
+  if (flow->content_ids)
+    validate_flow_content_ids_free (flow->content_ids);
   g_strfreev (flow->caps_properties);
   g_strfreev (flow->logged_event_types);
   g_strfreev (flow->ignored_event_types);
   if (flow->ignored_fields)
     gst_structure_free (flow->ignored_fields);
+  if (flow->logged_fields)
+    gst_structure_free (flow->logged_fields);
+  if (flow->logged_event_fields)
+    g_hash_table_unref (flow->logged_event_fields);
+  if (flow->ignored_event_fields)
+    g_hash_table_unref (flow->ignored_event_fields);
+  g_string_free (flow->line, TRUE);
+  g_mutex_clear (&flow->output_file_mutex);
+  g_mutex_clear (&flow->pending_lock);
+  g_cond_clear (&flow->pending_cond);
 
   G_OBJECT_CLASS (validate_flow_override_parent_class)->finalize (object);
 }
@@ -630,20 +1033,19 @@ static gboolean
 _execute_checkpoint (GstValidateScenario * scenario, GstValidateAction * action)
 {
   GList *i;
-  gchar *checkpoint_name =
-      g_strdup (gst_structure_get_string (action->structure, "text"));
+  const gchar *checkpoint_name =
+      gst_structure_get_string (action->structure, "text");
+  gchar *checkpoint_line = checkpoint_name ?
+      g_strdup_printf ("\nCHECKPOINT: %s\n\n", checkpoint_name) :
+      g_strdup ("\nCHECKPOINT\n\n");
 
   for (i = all_overrides; i; i = i->next) {
     ValidateFlowOverride *flow = (ValidateFlowOverride *) i->data;
 
-    if (checkpoint_name)
-      validate_flow_override_printf (flow, "\nCHECKPOINT: %s\n\n",
-          checkpoint_name);
-    else
-      validate_flow_override_printf (flow, "\nCHECKPOINT\n\n");
+    validate_flow_override_write_text (flow, checkpoint_line);
   }
 
-  g_free (checkpoint_name);
+  g_free (checkpoint_line);
   return TRUE;
 }
 
@@ -25,6 +25,8 @@
 #include <gst/gst.h>
 #include "gst-validate-scenario.h"
 #include "gst-validate-monitor.h"
+#include "gst-validate-utils.h"
+#include <gio/gio.h>
 #include <json-glib/json-glib.h>
 
 extern G_GNUC_INTERNAL GstDebugCategory *gstvalidate_debug;
@@ -55,12 +57,18 @@ G_GNUC_INTERNAL gchar** gst_validate_scenario_get_include_paths(const gchar* rel
 G_GNUC_INTERNAL void _priv_validate_override_registry_deinit(void);
 
 G_GNUC_INTERNAL GstValidateReportingDetails gst_validate_runner_get_default_reporting_details (GstValidateRunner *runner);
+G_GNUC_INTERNAL GstClockTime gst_validate_runner_get_start_time (GstValidateRunner *runner);
 
 G_GNUC_INTERNAL GstValidateMonitor * gst_validate_get_monitor (GObject *object);
 G_GNUC_INTERNAL void gst_validate_init_runner (void);
 G_GNUC_INTERNAL void gst_validate_deinit_runner (void);
 G_GNUC_INTERNAL void gst_validate_report_deinit (void);
 G_GNUC_INTERNAL gboolean gst_validate_send (JsonNode * root);
+G_GNUC_INTERNAL gboolean gst_validate_write_message (GOutputStream * ostream, JsonNode * root, GError ** error);
+G_GNUC_INTERNAL GSocketConnection * gst_validate_connect_to_server (const gchar * uuid);
+G_GNUC_INTERNAL void gst_validate_runner_send (GstValidateRunner * runner, JsonNode * root);
+G_GNUC_INTERNAL gboolean gst_validate_runner_has_server (GstValidateRunner * runner);
+G_GNUC_INTERNAL void gst_validate_skip_test_valist (GstValidateRunner * runner, const gchar * format, va_list va_args);
 G_GNUC_INTERNAL void gst_validate_set_test_file_globals (GstStructure* meta, const gchar* testfile, gboolean use_fakesinks);
 G_GNUC_INTERNAL gboolean gst_validate_get_test_file_scenario (GList** structs, const gchar** scenario_name, gchar** original_name);
 G_GNUC_INTERNAL GstValidateScenario* gst_validate_scenario_from_structs (GstValidateRunner* runner, GstElement* pipeline, GList* structures,
@@ -68,6 +76,15 @@ G_GNUC_INTERNAL GstValidateScenario* gst_validate_scenario_from_structs (GstVali
 G_GNUC_INTERNAL GList* gst_validate_get_config (const gchar *structname);
 G_GNUC_INTERNAL GList * gst_validate_get_test_file_expected_issues (void);
 
+G_GNUC_INTERNAL GstValidateExpression * gst_validate_get_compiled_expression (const gchar * expr, gchar ** error);
+G_GNUC_INTERNAL gdouble gst_validate_evaluate_expression (const gchar * expr, GstValidateParseVariableFunc variable_func, gpointer user_data, gchar ** error);
+G_GNUC_INTERNAL void gst_validate_precompile_expression (const gchar * expr);
+G_GNUC_INTERNAL void gst_validate_structure_precompile_expressions (GstStructure * structure);
+G_GNUC_INTERNAL void gst_validate_expression_cache_clear (void);
+
+typedef GstStructure * (*GstValidateStructuresMetaFunc) (GList * structures);
+G_GNUC_INTERNAL GstStructure * gst_validate_structs_get_meta_from_gfile (GFile * structured_file, GstValidateGetIncludePathsFunc get_include_paths_func, GstValidateStructuresMetaFunc meta_func);
+
 G_GNUC_INTERNAL gboolean gst_validate_extra_checks_init (void);
 G_GNUC_INTERNAL gboolean gst_validate_flow_init (void);
 #endif
@@ -156,6 +156,7 @@ print_position (GstValidateMonitor * monitor)
 {
   GstQuery *query;
   gint64 position, duration;
+  GstValidateRunner *runner;
   GstElement *pipeline =
       GST_ELEMENT (gst_validate_monitor_get_pipeline (monitor));
 
@@ -191,7 +192,11 @@ print_position (GstValidateMonitor * monitor)
     gst_query_parse_segment (query, &rate, NULL, NULL, NULL);
   gst_query_unref (query);
 
-  gst_validate_print_position (position, duration, rate, NULL);
+  runner = gst_validate_reporter_get_runner (GST_VALIDATE_REPORTER (monitor));
+  gst_validate_print_position_for_runner (runner, position, duration, rate,
+      NULL);
+  if (runner)
+    gst_object_unref (runner);
 
 done:
   gst_object_unref (pipeline);
@@ -583,8 +588,15 @@ _bus_handler (GstBus * bus, GstMessage * message,
 
       if (g_error_matches (err, GST_CORE_ERROR, GST_CORE_ERROR_MISSING_PLUGIN)) {
         if (!gst_validate_fail_on_missing_plugin ()) {
-          gst_validate_skip_test ("missing plugin: %s -- Debug message: %s\n",
-              err->message, debug);
+          GstValidateRunner *runner =
+              gst_validate_reporter_get_runner (GST_VALIDATE_REPORTER
+              (monitor));
+
+          gst_validate_runner_skip_test (runner,
+              "missing plugin: %s -- Debug message: %s\n", err->message,
+              debug);
+          if (runner)
+            gst_object_unref (runner);
         } else {
           GST_VALIDATE_REPORT (monitor, MISSING_PLUGIN,
               "Error: %s -- Debug message: %s", err->message, debug);
@@ -647,6 +659,7 @@ _bus_handler (GstBus * bus, GstMessage * message,
     case GST_MESSAGE_BUFFERING:
     {
       JsonBuilder *jbuilder = json_builder_new ();
+      GstValidateRunner *runner;
       GstBufferingMode mode;
       gint percent;
 
@@ -686,7 +699,11 @@ _bus_handler (GstBus * bus, GstMessage * message,
       json_builder_add_int_value (jbuilder, percent);
       json_builder_end_object (jbuilder);
 
-      gst_validate_send (json_builder_get_root (jbuilder));
+      runner =
+          gst_validate_reporter_get_runner (GST_VALIDATE_REPORTER (monitor));
+      gst_validate_runner_send (runner, json_builder_get_root (jbuilder));
+      if (runner)
+        gst_object_unref (runner);
       g_object_unref (jbuilder);
       break;
     }
@@ -47,7 +47,6 @@ static FILE **log_files = NULL;
 static gboolean output_is_tty = TRUE;
 
 /* Tcp server for communications with gst-validate-launcher */
-GSocketClient *socket_client = NULL;
 GSocketConnection *server_connection = NULL;
 GOutputStream *server_ostream = NULL;
 
@@ -476,17 +475,17 @@ gst_validate_report_load_issues (void)
       _("gst_pad_pull_range has to be called from the sinkpad task thread."));
 }
 
+/* Writes @root to @ostream the way gst-validate-launcher expects messages,
+ * prefixed by their length */
 gboolean
-gst_validate_send (JsonNode * root)
+gst_validate_write_message (GOutputStream * ostream, JsonNode * root,
+    GError ** error)
 {
-  gboolean res = FALSE;
+  gboolean res;
   JsonGenerator *jgen;
   gsize message_length;
   gchar *object, *message;
-  GError *error = NULL;
-
-  if (!server_ostream)
-    goto done;
+  GError *flush_error = NULL;
 
   jgen = json_generator_new ();
   json_generator_set_root (jgen, root);
@@ -496,31 +495,40 @@ gst_validate_send (JsonNode * root)
   GST_WRITE_UINT32_BE (message, message_length);
   strcpy (&message[4], object);
   g_free (object);
+  g_object_unref (jgen);
+
+  res = g_output_stream_write_all (ostream, message, message_length + 4,
+      NULL, NULL, error);
+  g_free (message);
+
+  if (res && !g_output_stream_flush (ostream, NULL, &flush_error)) {
+    GST_ERROR ("ERROR: Can't flush stream: %s", flush_error->message);
+    g_error_free (flush_error);
+  }
+
+  return res;
+}
 
-  res = g_output_stream_write_all (server_ostream, message, message_length + 4,
-      NULL, NULL, &error);
+gboolean
+gst_validate_send (JsonNode * root)
+{
+  GError *error = NULL;
 
-  if (!res) {
+  if (!server_ostream)
+    goto done;
+
+  if (!gst_validate_write_message (server_ostream, root, &error)) {
     if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_PENDING)) {
       GST_DEBUG ("Stream was busy, trying again later.");
 
-      g_free (message);
-      g_object_unref (jgen);
-      if (error)
-        g_error_free (error);
+      g_error_free (error);
       g_idle_add ((GSourceFunc) gst_validate_send, root);
       return G_SOURCE_REMOVE;
     }
 
     GST_ERROR ("ERROR: Can't write to remote: %s", error->message);
-  } else if (!g_output_stream_flush (server_ostream, NULL, &error)) {
-    GST_ERROR ("ERROR: Can't flush stream: %s", error->message);
-  }
-
-  g_free (message);
-  g_object_unref (jgen);
-  if (error)
     g_error_free (error);
+  }
 
 done:
   json_node_free (root);
@@ -528,10 +536,68 @@ done:
   return G_SOURCE_REMOVE;
 }
 
+/* Connects to the gst-validate-launcher server set in GST_VALIDATE_SERVER and
+ * tells it that the test identified by @uuid started, so that everything
+ * written on the returned connection is attributed to that test */
+GSocketConnection *
+gst_validate_connect_to_server (const gchar * uuid)
+{
+  const gchar *server_env = g_getenv ("GST_VALIDATE_SERVER");
+  GSocketConnection *connection = NULL;
+  GstUri *server_uri;
+
+  if (!server_env)
+    return NULL;
+
+  if (!uuid) {
+    GST_INFO ("No GST_VALIDATE_UUID specified !");
+    return NULL;
+  }
+
+  server_uri = gst_uri_from_string (server_env);
+  if (server_uri && !g_strcmp0 (gst_uri_get_scheme (server_uri), "tcp")) {
+    GSocketClient *socket_client = g_socket_client_new ();
+
+    connection = g_socket_client_connect_to_host (socket_client,
+        gst_uri_get_host (server_uri), gst_uri_get_port (server_uri),
+        NULL, NULL);
+    g_object_unref (socket_client);
+
+    if (connection) {
+      JsonNode *root;
+      GError *err = NULL;
+      JsonBuilder *jbuilder = json_builder_new ();
+
+      json_builder_begin_object (jbuilder);
+      json_builder_set_member_name (jbuilder, "uuid");
+      json_builder_add_string_value (jbuilder, uuid);
+      json_builder_set_member_name (jbuilder, "started");
+      json_builder_add_boolean_value (jbuilder, TRUE);
+      json_builder_end_object (jbuilder);
+
+      root = json_builder_get_root (jbuilder);
+      if (!gst_validate_write_message (g_io_stream_get_output_stream
+              (G_IO_STREAM (connection)), root, &err)) {
+        GST_ERROR ("ERROR: Can't write to remote: %s", err->message);
+        g_clear_error (&err);
+      }
+      json_node_free (root);
+      g_object_unref (jbuilder);
+    }
+  } else {
+    GST_ERROR ("Server URI not valid: %s", server_env);
+  }
+
+  if (server_uri)
+    gst_uri_unref (server_uri);
+
+  return connection;
+}
+
 void
 gst_validate_report_init (void)
 {
-  const gchar *var, *file_env, *server_env, *uuid;
+  const gchar *var, *file_env;
   const GDebugKey keys[] = {
     {"fatal_criticals", GST_VALIDATE_FATAL_CRITICALS},
     {"fatal_warnings", GST_VALIDATE_FATAL_WARNINGS},
@@ -562,47 +628,11 @@ gst_validate_report_init (void)
   output_is_tty = isatty (1);
 #endif
 
-  server_env = g_getenv ("GST_VALIDATE_SERVER");
-  uuid = g_getenv ("GST_VALIDATE_UUID");
-
-  if (server_env && !uuid) {
-    GST_INFO ("No GST_VALIDATE_UUID specified !");
-  } else if (server_env) {
-    GstUri *server_uri = gst_uri_from_string (server_env);
-
-    if (server_uri && !g_strcmp0 (gst_uri_get_scheme (server_uri), "tcp")) {
-      JsonBuilder *jbuilder;
-      GError *err = NULL;
-      socket_client = g_socket_client_new ();
-
-      server_connection = g_socket_client_connect_to_host (socket_client,
-          gst_uri_get_host (server_uri), gst_uri_get_port (server_uri),
-          NULL, &err);
-
-      if (!server_connection) {
-        g_clear_error (&err);
-        g_clear_object (&socket_client);
-
-      } else {
-        server_ostream =
-            g_io_stream_get_output_stream (G_IO_STREAM (server_connection));
-        jbuilder = json_builder_new ();
-        json_builder_begin_object (jbuilder);
-        json_builder_set_member_name (jbuilder, "uuid");
-        json_builder_add_string_value (jbuilder, uuid);
-        json_builder_set_member_name (jbuilder, "started");
-        json_builder_add_boolean_value (jbuilder, TRUE);
-        json_builder_end_object (jbuilder);
-
-        gst_validate_send (json_builder_get_root (jbuilder));
-        g_object_unref (jbuilder);
-      }
-
-      gst_uri_unref (server_uri);
-    } else {
-      GST_ERROR ("Server URI not valid: %s", server_env);
-    }
-  }
+  server_connection =
+      gst_validate_connect_to_server (g_getenv ("GST_VALIDATE_UUID"));
+  if (server_connection)
+    server_ostream =
+        g_io_stream_get_output_stream (G_IO_STREAM (server_connection));
 
   file_env = g_getenv ("GST_VALIDATE_FILE");
   if (file_env != NULL && *file_env != '\0') {
@@ -654,7 +684,6 @@ gst_validate_report_deinit (void)
     server_ostream = NULL;
   }
 
-  g_clear_object (&socket_client);
   g_clear_object (&server_connection);
 }
 
@@ -788,8 +817,10 @@ gst_validate_report_new (GstValidateIssue * issue,
   report->reporter_name = g_strdup (gst_validate_reporter_get_name (reporter));
   report->message = g_strdup (message);
   g_mutex_init (&report->shadow_reports_lock);
-  report->timestamp =
-      gst_util_get_timestamp () - _gst_validate_report_start_time;
+  /* Runners of tests sharing the process count from the start of the test */
+  report->timestamp = gst_util_get_timestamp () - (runner ?
+      gst_validate_runner_get_start_time (runner) :
+      _gst_validate_report_start_time);
   report->level = issue->default_level;
   report->reporting_level = GST_VALIDATE_SHOW_UNKNOWN;
 
@@ -1280,10 +1311,22 @@ gst_validate_report_add_repeated_report (GstValidateReport * report,
       gst_validate_report_ref (repeated_report));
 }
 
-
+/**
+ * gst_validate_print_position_for_runner:
+ * @runner: (allow-none): The #GstValidateRunner of the test the position is
+ * printed for
+ * @position: The position
+ * @duration: The duration
+ * @rate: The playback rate
+ * @extra_info: (transfer full) (allow-none): Text printed after the position
+ *
+ * Same as gst_validate_print_position() but for the test @runner was created
+ * for, see gst_validate_runner_new_for_test().
+ */
 void
-gst_validate_print_position (GstClockTime position, GstClockTime duration,
-    gdouble rate, gchar * extra_info)
+gst_validate_print_position_for_runner (GstValidateRunner * runner,
+    GstClockTime position, GstClockTime duration, gdouble rate,
+    gchar * extra_info)
 {
   JsonBuilder *jbuilder;
 
@@ -1292,8 +1335,10 @@ gst_validate_print_position (GstClockTime position, GstClockTime duration,
       " speed: %f %s/>%c", GST_TIME_ARGS (position), GST_TIME_ARGS (duration),
       rate, extra_info ? extra_info : "", output_is_tty ? '\r' : '\n');
 
-  if (!server_ostream)
+  if (!server_ostream && !gst_validate_runner_has_server (runner)) {
+    g_free (extra_info);
     return;
+  }
 
   jbuilder = json_builder_new ();
   json_builder_begin_object (jbuilder);
@@ -1307,24 +1352,28 @@ gst_validate_print_position (GstClockTime position, GstClockTime duration,
   json_builder_add_double_value (jbuilder, rate);
   json_builder_end_object (jbuilder);
 
-  gst_validate_send (json_builder_get_root (jbuilder));
+  gst_validate_runner_send (runner, json_builder_get_root (jbuilder));
   g_object_unref (jbuilder);
 
   g_free (extra_info);
 }
 
 void
-gst_validate_skip_test (const gchar * format, ...)
+gst_validate_print_position (GstClockTime position, GstClockTime duration,
+    gdouble rate, gchar * extra_info)
 {
-  JsonBuilder *jbuilder;
-  va_list va_args;
-  gchar *tmp;
+  gst_validate_print_position_for_runner (NULL, position, duration, rate,
+      extra_info);
+}
 
-  va_start (va_args, format);
-  tmp = gst_info_strdup_vprintf (format, va_args);
-  va_end (va_args);
+void
+gst_validate_skip_test_valist (GstValidateRunner * runner,
+    const gchar * format, va_list va_args)
+{
+  JsonBuilder *jbuilder;
+  gchar *tmp = gst_info_strdup_vprintf (format, va_args);
 
-  if (!server_ostream) {
+  if (!server_ostream && !gst_validate_runner_has_server (runner)) {
     gchar *f = g_strconcat ("ok 1 # SKIP ", tmp, NULL);
 
     g_free (tmp);
@@ -1341,10 +1390,20 @@ gst_validate_skip_test (const gchar * format, ...)
   json_builder_end_object (jbuilder);
   g_free (tmp);
 
-  gst_validate_send (json_builder_get_root (jbuilder));
+  gst_validate_runner_send (runner, json_builder_get_root (jbuilder));
   g_object_unref (jbuilder);
 }
 
+void
+gst_validate_skip_test (const gchar * format, ...)
+{
+  va_list va_args;
+
+  va_start (va_args, format);
+  gst_validate_skip_test_valist (NULL, format, va_args);
+  va_end (va_args);
+}
+
 static void
 print_issue (gpointer key, GstValidateIssue * issue, gpointer user_data)
 {
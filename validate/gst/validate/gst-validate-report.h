@@ -313,6 +313,9 @@ GST_VALIDATE_API
 GstValidateReportLevel gst_validate_report_level_from_name (const gchar *level_name);
 GST_VALIDATE_API
 void gst_validate_print_position(GstClockTime position, GstClockTime duration, gdouble rate, gchar* extra_info);
+GST_VALIDATE_API
+void gst_validate_print_position_for_runner (GstValidateRunner * runner, GstClockTime position,
+                                             GstClockTime duration, gdouble rate, gchar * extra_info);
 GST_VALIDATE_API void gst_validate_print_issues (void);
 
 GST_VALIDATE_API
@@ -95,6 +95,14 @@ struct _GstValidateRunnerPrivate
   gchar **pipeline_names_strv;
 
   GList *expected_issues;
+
+  /* Connection to gst-validate-launcher for runners created with
+   * gst_validate_runner_new_for_test(), protected by send_lock */
+  GMutex send_lock;
+  GSocketConnection *server_connection;
+
+  /* What the timestamps of the reports and dot files count from */
+  GstClockTime start_time;
 };
 
 /* Describes the reporting level to apply to a name pattern */
@@ -331,6 +339,12 @@ gst_validate_runner_finalize (GObject * object)
 
   g_mutex_clear (&runner->priv->mutex);
 
+  if (runner->priv->server_connection)
+    g_io_stream_close (G_IO_STREAM (runner->priv->server_connection), NULL,
+        NULL);
+  g_clear_object (&runner->priv->server_connection);
+  g_mutex_clear (&runner->priv->send_lock);
+
   g_free (runner->priv->pipeline_names);
   g_strfreev (runner->priv->pipeline_names_strv);
 
@@ -443,11 +457,14 @@ static void
 gst_validate_runner_init (GstValidateRunner * runner)
 {
   runner->priv = gst_validate_runner_get_instance_private (runner);
+  g_mutex_init (&runner->priv->send_lock);
 
   runner->priv->reports_by_type = g_hash_table_new (g_direct_hash,
       g_direct_equal);
 
   runner->priv->default_level = GST_VALIDATE_SHOW_DEFAULT;
+  runner->priv->start_time =
+      _priv_start_time ? _priv_start_time : gst_util_get_timestamp ();
   _init_report_levels (runner);
 
   runner->priv->expected_issues = gst_validate_get_test_file_expected_issues ();
@@ -459,6 +476,22 @@ gst_validate_runner_init (GstValidateRunner * runner)
       GST_TYPE_MOCKDECRYPTOR);
 }
 
+static GstValidateRunner *
+_create_runner (void)
+{
+  GstValidateRunner *runner;
+
+  if (first_runner) {
+    runner = first_runner;
+    first_runner = NULL;
+  } else {
+    runner = g_object_new (GST_TYPE_VALIDATE_RUNNER, NULL);
+    runner->priv->user_created = TRUE;
+  }
+
+  return runner;
+}
+
 /**
  * gst_validate_runner_new:
  *
@@ -471,20 +504,15 @@ gst_validate_runner_new (void)
 {
   GstValidateRunner *runner;
 
-  if (first_runner) {
-    runner = first_runner;
-    first_runner = NULL;
-  } else if (element_created) {
+  if (!first_runner && element_created) {
     gst_validate_abort
         ("Should never create a GstValidateRunner after a GstElement "
         "has been created in the same process.");
 
     return NULL;
-  } else {
-    runner = g_object_new (GST_TYPE_VALIDATE_RUNNER, NULL);
-    runner->priv->user_created = TRUE;
   }
 
+  runner = _create_runner ();
   {
     GstValidateOverrideRegistry *registry =
         gst_validate_override_registry_get ();
@@ -502,6 +530,46 @@ gst_validate_runner_new (void)
   return runner;
 }
 
+/**
+ * gst_validate_runner_new_for_test:
+ * @uuid: (allow-none): The UUID gst-validate-launcher identifies the test with
+ *
+ * Create a new #GstValidateRunner for one of the tests run in the same
+ * process, after pipelines of the previous ones have been created.
+ *
+ * When @uuid is set and gst-validate-launcher is listening for results
+ * (`GST_VALIDATE_SERVER`), the reports of the runner and the actions executed
+ * by the scenarios of its monitors are sent to the launcher as coming from
+ * that test, instead of the one set in `GST_VALIDATE_UUID`.
+ *
+ * Contrary to gst_validate_runner_new(), the overrides registered for the
+ * whole process are not set to report to the new runner, as they would then
+ * stop reporting to the runners of the tests still running. Call
+ * gst_validate_reporter_set_runner() on them when only one test runs at a
+ * time.
+ *
+ * The timestamps of the reports of the runner, and of the dot files dumped on
+ * its issues, count from its creation instead of the initialization of
+ * GstValidate.
+ *
+ * Returns: A newly created #GstValidateRunner
+ */
+GstValidateRunner *
+gst_validate_runner_new_for_test (const gchar * uuid)
+{
+  /* Contrary to gst_validate_runner_new() elements might already have been
+   * created, which is fine as user created runners do not monitor pipelines
+   * automatically */
+  GstValidateRunner *runner = _create_runner ();
+
+  runner->priv->start_time = gst_util_get_timestamp ();
+
+  if (uuid)
+    runner->priv->server_connection = gst_validate_connect_to_server (uuid);
+
+  return runner;
+}
+
 /*
  * gst_validate_runner_get_default_reporting_level:
  *
@@ -568,7 +636,8 @@ synthesize_reports (GstValidateRunner * runner, GstValidateReport * report)
 }
 
 static void
-_dot_pipeline (GstValidateReport * report, GstStructure * config)
+_dot_pipeline (GstValidateRunner * runner, GstValidateReport * report,
+    GstStructure * config)
 {
   GstPipeline *pipeline = gst_validate_reporter_get_pipeline (report->reporter);
 
@@ -578,7 +647,7 @@ _dot_pipeline (GstValidateReport * report, GstStructure * config)
         g_path_get_basename (gst_validate_reporter_get_name (report->reporter));
     report->dotfile_name =
         g_strdup_printf ("%" GST_TIME_FORMAT "-validate-report-%s-on-%s-%s",
-        GST_TIME_ARGS (GST_CLOCK_DIFF (_priv_start_time,
+        GST_TIME_ARGS (GST_CLOCK_DIFF (runner->priv->start_time,
                 gst_util_get_timestamp ())),
         gst_validate_report_level_get_name (report->level), reporter_basename,
         g_quark_to_string (report->issue->issue_id));
@@ -605,7 +674,7 @@ gst_validate_runner_maybe_dot_pipeline (GstValidateRunner * runner,
   if (report->level == GST_VALIDATE_REPORT_LEVEL_CRITICAL ||
       gst_validate_report_check_abort (report)) {
 
-    _dot_pipeline (report, NULL);
+    _dot_pipeline (runner, report, NULL);
     return;
   }
 
@@ -625,7 +694,7 @@ gst_validate_runner_maybe_dot_pipeline (GstValidateRunner * runner,
           GST_VALIDATE_REPORT_LEVEL_CRITICAL;
 
       if (level >= report->level) {
-        _dot_pipeline (report, config->data);
+        _dot_pipeline (runner, report, config->data);
 
         return;
       }
@@ -695,8 +764,8 @@ gst_validate_runner_add_report (GstValidateRunner * runner,
     report->level = GST_VALIDATE_REPORT_LEVEL_EXPECTED;
   }
 
-  gst_validate_send (json_boxed_serialize (GST_MINI_OBJECT_TYPE (report),
-          report));
+  gst_validate_runner_send (runner,
+      json_boxed_serialize (GST_MINI_OBJECT_TYPE (report), report));
   gst_validate_runner_maybe_dot_pipeline (runner, report);
 
   details = reporter_details =
@@ -942,9 +1011,80 @@ gst_validate_runner_exit (GstValidateRunner * runner, gboolean print_result)
       (GDestroyNotify) gst_structure_free);
   runner->priv->expected_issues = NULL;
 
+  /* Let gst-validate-launcher know the test is over */
+  g_mutex_lock (&runner->priv->send_lock);
+  if (runner->priv->server_connection) {
+    g_io_stream_close (G_IO_STREAM (runner->priv->server_connection), NULL,
+        NULL);
+    g_clear_object (&runner->priv->server_connection);
+  }
+  g_mutex_unlock (&runner->priv->send_lock);
+
   return ret;
 }
 
+/**
+ * gst_validate_runner_skip_test:
+ * @runner: (allow-none): The #GstValidateRunner of the test to skip
+ * @format: The reason why the test is skipped, printf style
+ * @...: The parameters of @format
+ *
+ * Same as gst_validate_skip_test() but for the test @runner was created for,
+ * see gst_validate_runner_new_for_test().
+ */
+void
+gst_validate_runner_skip_test (GstValidateRunner * runner,
+    const gchar * format, ...)
+{
+  va_list va_args;
+
+  va_start (va_args, format);
+  gst_validate_skip_test_valist (runner, format, va_args);
+  va_end (va_args);
+}
+
+/* Sends @root to gst-validate-launcher as coming from the test of @runner,
+ * or of the process if @runner was not created for a specific test */
+void
+gst_validate_runner_send (GstValidateRunner * runner, JsonNode * root)
+{
+  GError *err = NULL;
+  gboolean sent = FALSE;
+
+  if (runner) {
+    g_mutex_lock (&runner->priv->send_lock);
+    if (runner->priv->server_connection) {
+      if (!gst_validate_write_message (g_io_stream_get_output_stream
+              (G_IO_STREAM (runner->priv->server_connection)), root, &err)) {
+        GST_ERROR_OBJECT (runner, "Can't write to remote: %s", err->message);
+        g_clear_error (&err);
+      }
+      sent = TRUE;
+    }
+    g_mutex_unlock (&runner->priv->send_lock);
+  }
+
+  if (sent)
+    json_node_free (root);
+  else
+    gst_validate_send (root);
+}
+
+gboolean
+gst_validate_runner_has_server (GstValidateRunner * runner)
+{
+  gboolean res;
+
+  if (!runner)
+    return FALSE;
+
+  g_mutex_lock (&runner->priv->send_lock);
+  res = runner->priv->server_connection != NULL;
+  g_mutex_unlock (&runner->priv->send_lock);
+
+  return res;
+}
+
 void
 gst_validate_init_runner (void)
 {
@@ -969,6 +1109,14 @@ gst_validate_runner_get_default_reporting_details (GstValidateRunner * runner)
   return runner->priv->default_level;
 }
 
+GstClockTime
+gst_validate_runner_get_start_time (GstValidateRunner * runner)
+{
+  g_return_val_if_fail (GST_IS_VALIDATE_RUNNER (runner), _priv_start_time);
+
+  return runner->priv->start_time;
+}
+
 #ifdef __GST_VALIDATE_PLUGIN
 static gboolean
 plugin_init (GstPlugin * plugin)
@@ -78,6 +78,8 @@ GType		gst_validate_runner_get_type		(void);
 
 GST_VALIDATE_API
 GstValidateRunner *   gst_validate_runner_new               (void);
+GST_VALIDATE_API
+GstValidateRunner *   gst_validate_runner_new_for_test      (const gchar * uuid);
 
 GST_VALIDATE_API
 void            gst_validate_runner_add_report  (GstValidateRunner * runner, GstValidateReport * report);
@@ -91,6 +93,8 @@ GST_VALIDATE_API
 int             gst_validate_runner_printf (GstValidateRunner * runner);
 GST_VALIDATE_API
 int             gst_validate_runner_exit (GstValidateRunner * runner, gboolean print_result);
+GST_VALIDATE_API
+void            gst_validate_runner_skip_test (GstValidateRunner * runner, const gchar * format, ...) G_GNUC_PRINTF (2, 3);
 
 GST_VALIDATE_API
 GstValidateReportingDetails gst_validate_runner_get_default_reporting_level (GstValidateRunner *runner);
@@ -140,9 +140,12 @@ enum
 static guint scenario_signals[LAST_SIGNAL] = { 0 };
 
 static GList *action_types = NULL;
+/* GQuark of the type name -> GstValidateActionType, owned by action_types */
+static GHashTable *action_types_table = NULL;
 static void gst_validate_scenario_dispose (GObject * object);
 static void gst_validate_scenario_finalize (GObject * object);
 static GstValidateActionType *_find_action_type (const gchar * type_name);
+static GstValidateActionType *_action_get_type (GstValidateAction * action);
 static GstValidateExecuteActionReturn
 _fill_action (GstValidateScenario * scenario, GstValidateAction * action,
     GstStructure * structure, gboolean add_to_lists);
@@ -236,6 +239,12 @@ struct _GstValidateScenarioPrivate
   gboolean handles_state;
 
   guint execute_actions_source_id;      /* MT safe. Protect with SCENARIO_LOCK */
+  /* Set when the playback time of the next action is waited for on the
+   * pipeline clock, or when it will only be reached after a state change,
+   * instead of checking the position on idle. MT safe. Protect with
+   * SCENARIO_LOCK */
+  gboolean waiting_playback_time;
+  GstClockID playback_time_clock_id;
   guint wait_id;
   guint signal_handler_id;
   guint action_execution_interval;
@@ -389,6 +398,14 @@ struct _GstValidateActionPrivate
   GWeakRef scenario;
   gboolean needs_playback_parsing;
   gboolean pending_set_done;
+
+  /* Set once preparing the action replaced the variables of its structure,
+   * so that escaped `\$(` references it left are not expanded again */
+  gboolean variables_resolved;
+
+  /* Resolved when the action is created so executing it does not need to
+   * look the type up again */
+  GstValidateActionType *action_type;
 };
 
 static JsonNode *
@@ -438,7 +455,7 @@ _action_copy (GstValidateAction * act)
 {
   GstValidateScenario *scenario = gst_validate_action_get_scenario (act);
   GstValidateAction *copy = gst_validate_action_new (scenario,
-      _find_action_type (act->type), NULL, FALSE);
+      _action_get_type (act), NULL, FALSE);
 
   gst_object_unref (scenario);
 
@@ -455,6 +472,7 @@ _action_copy (GstValidateAction * act)
   copy->action_number = act->action_number;
   copy->playback_time = act->playback_time;
   copy->priv->timeout = act->priv->timeout;
+  copy->priv->variables_resolved = act->priv->variables_resolved;
   GST_VALIDATE_ACTION_LINENO (copy) = GST_VALIDATE_ACTION_LINENO (act);
   GST_VALIDATE_ACTION_FILENAME (copy) =
       g_strdup (GST_VALIDATE_ACTION_FILENAME (act));
@@ -499,6 +517,7 @@ _action_free (GstValidateAction * action)
     gst_structure_free (action->priv->main_structure);
 
   g_weak_ref_clear (&action->priv->scenario);
+  gst_clear_mini_object ((GstMiniObject **) & action->priv->action_type);
   g_free (GST_VALIDATE_ACTION_FILENAME (action));
   g_free (GST_VALIDATE_ACTION_DEBUG (action));
 
@@ -542,6 +561,9 @@ gst_validate_action_new (GstValidateScenario * scenario,
   action->priv->timeout = GST_CLOCK_TIME_NONE;
   action->priv->state = GST_VALIDATE_EXECUTE_ACTION_NONE;
   action->type = action_type->name;
+  action->priv->action_type =
+      GST_VALIDATE_ACTION_TYPE (gst_mini_object_ref (GST_MINI_OBJECT
+          (action_type)));
   action->repeat = -1;
 
   g_weak_ref_set (&action->priv->scenario, scenario);
@@ -559,12 +581,29 @@ gst_validate_action_new (GstValidateScenario * scenario,
   return action;
 }
 
+/* Sends @root to gst-validate-launcher for the test @scenario is part of */
+static void
+_send_for_scenario (GstValidateScenario * scenario, JsonNode * root)
+{
+  GstValidateRunner *runner = scenario ?
+      gst_validate_reporter_get_runner (GST_VALIDATE_REPORTER (scenario)) :
+      NULL;
+
+  gst_validate_runner_send (runner, root);
+  if (runner)
+    gst_object_unref (runner);
+}
+
 gboolean
 _action_check_and_set_printed (GstValidateAction * action)
 {
   if (action->priv->printed == FALSE) {
-    gst_validate_send (json_boxed_serialize (GST_MINI_OBJECT_TYPE
-            (action), action));
+    GstValidateScenario *scenario = gst_validate_action_get_scenario (action);
+
+    _send_for_scenario (scenario,
+        json_boxed_serialize (GST_MINI_OBJECT_TYPE (action), action));
+    if (scenario)
+      gst_object_unref (scenario);
 
     action->priv->printed = TRUE;
 
@@ -628,15 +667,33 @@ gst_validate_action_type_new (void)
 static GstValidateActionType *
 _find_action_type (const gchar * type_name)
 {
-  GList *tmp;
+  GQuark quark;
 
-  for (tmp = action_types; tmp; tmp = tmp->next) {
-    GstValidateActionType *atype = (GstValidateActionType *) tmp->data;
-    if (g_strcmp0 (atype->name, type_name) == 0)
-      return atype;
+  if (!action_types_table || !type_name)
+    return NULL;
+
+  /* Names that were never interned can't be registered types */
+  if (!(quark = g_quark_try_string (type_name)))
+    return NULL;
+
+  return g_hash_table_lookup (action_types_table, GUINT_TO_POINTER (quark));
+}
+
+static GstValidateActionType *
+_action_get_type (GstValidateAction * action)
+{
+  GstValidateActionType *type = action->priv->action_type;
+
+  if (type && !g_strcmp0 (type->name, action->type))
+    return type;
+
+  type = _find_action_type (action->type);
+  if (type) {
+    gst_mini_object_replace ((GstMiniObject **) & action->priv->action_type,
+        GST_MINI_OBJECT (type));
   }
 
-  return NULL;
+  return type;
 }
 
 static void
@@ -840,7 +897,8 @@ _reset_sink_information (GstValidateSinkInformation * sinkinfo)
  * action. It will first try to retrieve the value as a double,
  * then get it as a string and execute any formula taking into account
  * the 'position' and 'duration' variables. And it will always convert that
- * value to a GstClockTime.
+ * value to a GstClockTime. Variables referenced in the string are replaced
+ * first, unless preparing the action already did.
  *
  * Returns: %TRUE if the time value could be retrieved/computed or %FALSE otherwise
  */
@@ -864,14 +922,17 @@ gst_validate_action_get_clocktime (GstValidateScenario * scenario,
     }
 
     _update_well_known_vars (scenario);
-    strval =
-        gst_validate_replace_variables_in_string (action, scenario->priv->vars,
-        tmpvalue);
+    if (action->priv->variables_resolved)
+      strval = g_strdup (tmpvalue);
+    else
+      strval =
+          gst_validate_replace_variables_in_string (action,
+          scenario->priv->vars, tmpvalue);
     if (!strval)
       return FALSE;
 
     val =
-        gst_validate_utils_parse_expression (strval, _set_variable_func,
+        gst_validate_evaluate_expression (strval, _set_variable_func,
         scenario, &error);
     if (error) {
       GST_WARNING ("Error while parsing %s: %s (%" GST_PTR_FORMAT ")",
@@ -2145,12 +2206,33 @@ done:
   return res;
 }
 
+/* Minimum time between two checks of the position when the playback time of
+ * an action is waited for on the clock */
+#define MIN_PLAYBACK_TIME_WAIT (GST_MSECOND)
+
+/* Must be called with SCENARIO_LOCK taken */
+static void
+_cancel_playback_time_wait (GstValidateScenario * scenario)
+{
+  GstValidateScenarioPrivate *priv = scenario->priv;
+
+  if (priv->playback_time_clock_id) {
+    gst_clock_id_unschedule (priv->playback_time_clock_id);
+    gst_clock_id_unref (priv->playback_time_clock_id);
+    priv->playback_time_clock_id = NULL;
+  }
+  priv->waiting_playback_time = FALSE;
+}
+
 static inline gboolean
 _add_execute_actions_gsource (GstValidateScenario * scenario)
 {
   GstValidateScenarioPrivate *priv = scenario->priv;
 
   SCENARIO_LOCK (scenario);
+  /* Whatever triggered this may have changed when the playback time of the
+   * next action is reached, so check the position again */
+  _cancel_playback_time_wait (scenario);
   if (priv->execute_actions_source_id == 0 && priv->wait_id == 0
       && priv->signal_handler_id == 0 && priv->message_type == NULL) {
     if (!scenario->priv->action_execution_interval)
@@ -2171,6 +2253,179 @@ _add_execute_actions_gsource (GstValidateScenario * scenario)
   return FALSE;
 }
 
+static gboolean
+_playback_time_reached (GstValidateScenario * scenario)
+{
+  GST_DEBUG_OBJECT (scenario, "Playback time of the next action reached");
+  _add_execute_actions_gsource (scenario);
+
+  return G_SOURCE_REMOVE;
+}
+
+static gboolean
+_playback_time_wait_cancelled (GstValidateScenario * scenario)
+{
+  return G_SOURCE_REMOVE;
+}
+
+static void
+_free_weak_ref (GWeakRef * ref)
+{
+  g_weak_ref_clear (ref);
+  g_free (ref);
+}
+
+/* Called from the clock thread. The scenario is only released from the main
+ * thread, where it has to be finalized. */
+static gboolean
+_playback_time_clock_cb (GstClock * clock, GstClockTime time, GstClockID id,
+    GWeakRef * ref)
+{
+  GstValidateScenario *scenario = g_weak_ref_get (ref);
+  gboolean reached = FALSE;
+
+  if (!scenario)
+    return TRUE;
+
+  SCENARIO_LOCK (scenario);
+  /* Otherwise the wait was cancelled while this was being called */
+  if (scenario->priv->playback_time_clock_id == id) {
+    gst_clock_id_unref (scenario->priv->playback_time_clock_id);
+    scenario->priv->playback_time_clock_id = NULL;
+    reached = TRUE;
+  }
+  SCENARIO_UNLOCK (scenario);
+
+  g_idle_add_full (G_PRIORITY_DEFAULT_IDLE, reached ?
+      (GSourceFunc) _playback_time_reached :
+      (GSourceFunc) _playback_time_wait_cancelled, scenario, gst_object_unref);
+
+  return TRUE;
+}
+
+/* Clock time at which the sinks will reach @stream_time according to their
+ * current segment, or GST_CLOCK_TIME_NONE if unknown.
+ * Must be called with SCENARIO_LOCK taken */
+static GstClockTime
+_get_clock_time_from_segment (GstValidateScenario * scenario,
+    GstElement * pipeline, GstClockTime stream_time)
+{
+  GList *tmp;
+
+  for (tmp = scenario->priv->sinks; tmp; tmp = tmp->next) {
+    GstValidateSinkInformation *sink_info = tmp->data;
+    GstSegment *segment = &sink_info->segment;
+    guint64 running_time;
+
+    if (segment->format != GST_FORMAT_TIME ||
+        sink_info->segment_seqnum != scenario->priv->current_seqnum)
+      continue;
+
+    running_time = gst_segment_to_running_time (segment, GST_FORMAT_TIME,
+        gst_segment_position_from_stream_time (segment, GST_FORMAT_TIME,
+            stream_time));
+    if (!GST_CLOCK_TIME_IS_VALID (running_time))
+      continue;
+
+    return gst_element_get_base_time (pipeline) + running_time;
+  }
+
+  return GST_CLOCK_TIME_NONE;
+}
+
+/* Instead of checking the position on idle until the playback time of @act
+ * is reached, waits on the pipeline clock for the time at which it will be
+ * reached. The wait is cancelled, and the position checked again, on seeks,
+ * segment and state changes. In PAUSED, the position is only checked again
+ * after a state change.
+ *
+ * Returns: %FALSE if the position has to be checked again on idle */
+static gboolean
+_schedule_playback_time_wait (GstValidateScenario * scenario,
+    GstValidateAction * act, GstClockTime position, gdouble rate)
+{
+  GstValidateScenarioPrivate *priv = scenario->priv;
+  GstElement *pipeline;
+  GstClock *clock = NULL;
+  GstClockTime target, remaining, segment_target;
+  GWeakRef *ref;
+  gboolean res = FALSE;
+
+  if (priv->action_execution_interval || rate == 0 ||
+      !GST_CLOCK_TIME_IS_VALID (act->playback_time) ||
+      !GST_CLOCK_TIME_IS_VALID (position))
+    return FALSE;
+
+  if (rate > 0 && position < act->playback_time)
+    remaining = act->playback_time - position;
+  else if (rate < 0 && position > act->playback_time)
+    remaining = position - act->playback_time;
+  else
+    return FALSE;
+
+  pipeline = gst_validate_scenario_get_pipeline (scenario);
+  if (!pipeline)
+    return FALSE;
+
+  if (GST_STATE_PENDING (pipeline) != GST_STATE_VOID_PENDING)
+    goto done;
+
+  if (GST_STATE (pipeline) == GST_STATE_PAUSED) {
+    GST_DEBUG_OBJECT (scenario, "Paused, waiting for a state change to reach"
+        " %" GST_TIME_FORMAT, GST_TIME_ARGS (act->playback_time));
+
+    SCENARIO_LOCK (scenario);
+    _cancel_playback_time_wait (scenario);
+    priv->waiting_playback_time = TRUE;
+    goto remove_source;
+  }
+
+  clock = gst_element_get_clock (pipeline);
+  /* Waiting on a test clock would interfere with the 'wait, on-clock=true'
+   * action, which waits for the ids of the pipeline */
+  if (GST_STATE (pipeline) != GST_STATE_PLAYING || !clock ||
+      GST_IS_TEST_CLOCK (clock))
+    goto done;
+
+  /* The position reaches the playback time after the remaining duration,
+   * or later if the sinks are late according to their segment */
+  target = gst_clock_get_time (clock) +
+      MAX ((GstClockTime) (remaining / ABS (rate)), MIN_PLAYBACK_TIME_WAIT);
+
+  SCENARIO_LOCK (scenario);
+  segment_target = _get_clock_time_from_segment (scenario, pipeline,
+      act->playback_time);
+  if (GST_CLOCK_TIME_IS_VALID (segment_target))
+    target = MAX (target, segment_target);
+
+  GST_DEBUG_OBJECT (scenario, "Waiting until %" GST_TIME_FORMAT
+      " on the clock to reach %" GST_TIME_FORMAT, GST_TIME_ARGS (target),
+      GST_TIME_ARGS (act->playback_time));
+
+  _cancel_playback_time_wait (scenario);
+  priv->waiting_playback_time = TRUE;
+  priv->playback_time_clock_id = gst_clock_new_single_shot_id (clock, target);
+  ref = g_new0 (GWeakRef, 1);
+  g_weak_ref_init (ref, scenario);
+  gst_clock_id_wait_async (priv->playback_time_clock_id,
+      (GstClockCallback) _playback_time_clock_cb, ref,
+      (GDestroyNotify) _free_weak_ref);
+
+remove_source:
+  if (priv->execute_actions_source_id) {
+    g_source_remove (priv->execute_actions_source_id);
+    priv->execute_actions_source_id = 0;
+  }
+  SCENARIO_UNLOCK (scenario);
+  res = TRUE;
+
+done:
+  gst_clear_object (&clock);
+  gst_object_unref (pipeline);
+
+  return res;
+}
+
 static gboolean
 _get_position (GstValidateScenario * scenario,
     GstValidateAction * act, GstClockTime * position)
@@ -2315,7 +2570,7 @@ _should_execute_action (GstValidateScenario * scenario, GstValidateAction * act,
   pipeline = gst_validate_scenario_get_pipeline (scenario);
   if (pipeline == NULL) {
 
-    if (!(GST_VALIDATE_ACTION_GET_TYPE (act)->flags &
+    if (!(_action_get_type (act)->flags &
             GST_VALIDATE_ACTION_TYPE_DOESNT_NEED_PIPELINE)) {
       GST_VALIDATE_REPORT_ACTION (scenario, act,
           SCENARIO_ACTION_EXECUTION_ERROR,
@@ -2489,7 +2744,7 @@ _fill_action (GstValidateScenario * scenario, GstValidateAction * action,
   gboolean optional, needs_parsing = FALSE;
 
   action->type = gst_structure_get_name (structure);
-  action_type = _find_action_type (action->type);
+  action_type = _action_get_type (action);
 
   if (!action_type) {
     GST_ERROR_OBJECT (scenario, "Action type %s no found",
@@ -2552,7 +2807,7 @@ _fill_action (GstValidateScenario * scenario, GstValidateAction * action,
     return res;
 
   if (priv != NULL) {
-    GstValidateActionType *type = _find_action_type (action->type);
+    GstValidateActionType *type = _action_get_type (action);
     gboolean can_execute_on_addition =
         type->flags & GST_VALIDATE_ACTION_TYPE_CAN_EXECUTE_ON_ADDITION
         && !GST_CLOCK_TIME_IS_VALID (action->playback_time)
@@ -2684,12 +2939,13 @@ execute_next_action_full (GstValidateScenario * scenario, GstMessage * message)
   }
 
   if (!_should_execute_action (scenario, act, position, rate)) {
-    _add_execute_actions_gsource (scenario);
+    if (!_schedule_playback_time_wait (scenario, act, position, rate))
+      _add_execute_actions_gsource (scenario);
 
     return G_SOURCE_CONTINUE;
   }
 
-  type = _find_action_type (act->type);
+  type = _action_get_type (act);
 
   GST_DEBUG_OBJECT (scenario, "Executing %" GST_PTR_FORMAT
       " at %" GST_TIME_FORMAT, act->structure, GST_TIME_ARGS (position));
@@ -3591,7 +3847,7 @@ gst_validate_action_setup_repeat (GstValidateScenario * scenario,
     return FALSE;
   }
 
-  repeat = gst_validate_utils_parse_expression (repeat_expr, _set_variable_func,
+  repeat = gst_validate_evaluate_expression (repeat_expr, _set_variable_func,
       scenario, &error);
   if (error) {
     gst_validate_error_structure (action, "Invalid value for 'repeat': %s",
@@ -3627,7 +3883,7 @@ gst_validate_action_default_prepare_func (GstValidateAction * action)
   gint i;
   GstClockTime tmp;
   GstValidateExecuteActionReturn res = GST_VALIDATE_EXECUTE_ACTION_OK;
-  GstValidateActionType *type = gst_validate_get_action_type (action->type);
+  GstValidateActionType *type = _action_get_type (action);
   GstValidateScenario *scenario = gst_validate_action_get_scenario (action);
 
   _update_well_known_vars (scenario);
@@ -3641,6 +3897,7 @@ gst_validate_action_default_prepare_func (GstValidateAction * action)
         action->repeat, NULL);
   gst_validate_structure_resolve_variables (action, action->structure,
       scenario->priv->vars);
+  action->priv->variables_resolved = TRUE;
   for (i = 0; type->parameters[i].name; i++) {
     if (type->parameters[i].types
         && g_str_has_suffix (type->parameters[i].types, "(GstClockTime)"))
@@ -3650,7 +3907,6 @@ gst_validate_action_default_prepare_func (GstValidateAction * action)
 
 
 done:
-  gst_clear_mini_object ((GstMiniObject **) & type);
   if (scenario)
     gst_object_unref (scenario);
 
@@ -3951,7 +4207,8 @@ message_cb (GstBus * bus, GstMessage * message, GstValidateScenario * scenario)
           gst_validate_action_set_done (priv->actions->data);
       }
 
-      if (old_state == GST_STATE_READY && state == GST_STATE_PAUSED)
+      if ((old_state == GST_STATE_READY && state == GST_STATE_PAUSED) ||
+          priv->waiting_playback_time)
         _add_execute_actions_gsource (scenario);
 
       /* GstBin only send a new latency message when reaching PLAYING if
@@ -4120,6 +4377,7 @@ message_cb (GstBus * bus, GstMessage * message, GstValidateScenario * scenario)
       s = gst_message_get_structure (message);
       if (gst_structure_has_name (s, "validate-segment")) {
         GstValidateSinkInformation *sink_info;
+        gboolean waiting_playback_time;
 
         SCENARIO_LOCK (scenario);
         sink_info =
@@ -4139,7 +4397,12 @@ message_cb (GstBus * bus, GstMessage * message, GstValidateScenario * scenario)
           gst_segment_copy_into (segment, &sink_info->segment);
           _validate_sink_information (scenario);
         }
+        waiting_playback_time = priv->waiting_playback_time;
         SCENARIO_UNLOCK (scenario);
+
+        /* The rate or the position may have changed */
+        if (waiting_playback_time)
+          _add_execute_actions_gsource (scenario);
       }
     }
     default:
@@ -4173,6 +4436,39 @@ _action_type_has_parameter (GstValidateActionType * atype,
   return FALSE;
 }
 
+static void
+_precompile_field (GstStructure * structure, const gchar * fieldname)
+{
+  const gchar *value = gst_structure_get_string (structure, fieldname);
+
+  if (value)
+    gst_validate_precompile_expression (value);
+}
+
+/* Compiles the expressions the action will evaluate when it is executed,
+ * they are then only evaluated, which matters for looping scenarios */
+static void
+_precompile_action_expressions (GstValidateActionType * action_type,
+    GstStructure * structure)
+{
+  guint i;
+
+  gst_validate_structure_precompile_expressions (structure);
+  _precompile_field (structure, "playback-time");
+  _precompile_field (structure, "playback_time");
+  _precompile_field (structure, "repeat");
+
+  if (!action_type->parameters)
+    return;
+
+  for (i = 0; action_type->parameters[i].name; i++) {
+    if (action_type->parameters[i].types
+        && g_str_has_suffix (action_type->parameters[i].types,
+            "(GstClockTime)"))
+      _precompile_field (structure, action_type->parameters[i].name);
+  }
+}
+
 static gboolean
 gst_validate_scenario_load_structures (GstValidateScenario * scenario,
     GList * structures, gboolean * is_config, gchar * origin_file)
@@ -4252,6 +4548,7 @@ gst_validate_scenario_load_structures (GstValidateScenario * scenario,
       }
     }
 
+    _precompile_action_expressions (action_type, structure);
     action = gst_validate_action_new (scenario, action_type, structure, TRUE);
     if (action->priv->state == GST_VALIDATE_EXECUTE_ACTION_ERROR) {
       GST_ERROR_OBJECT (scenario, "Newly created action: %" GST_PTR_FORMAT
@@ -4568,7 +4865,8 @@ gst_validate_scenario_init (GstValidateScenario * scenario)
 static void
 gst_validate_scenario_dispose (GObject * object)
 {
-  GstValidateScenarioPrivate *priv = GST_VALIDATE_SCENARIO (object)->priv;
+  GstValidateScenario *self = GST_VALIDATE_SCENARIO (object);
+  GstValidateScenarioPrivate *priv = self->priv;
 
   g_weak_ref_clear (&priv->ref_pipeline);
 
@@ -4580,6 +4878,10 @@ gst_validate_scenario_dispose (GObject * object)
 
   gst_object_replace ((GstObject **) & priv->clock, NULL);
 
+  SCENARIO_LOCK (self);
+  _cancel_playback_time_wait (self);
+  SCENARIO_UNLOCK (self);
+
   G_OBJECT_CLASS (gst_validate_scenario_parent_class)->dispose (object);
 }
 
@@ -4717,7 +5019,7 @@ _element_added_cb (GstBin * bin, GstElement * element,
         action, action->type);
     if (should_execute_action (element, action)) {
       GstValidateActionType *action_type;
-      action_type = _find_action_type (action->type);
+      action_type = _action_get_type (action);
       GST_DEBUG_OBJECT (element, "Executing set-property action");
       if (gst_validate_execute_action (action_type, action)) {
         if (!gst_structure_has_field_typed (action->structure,
@@ -4933,6 +5235,19 @@ gst_validate_scenario_check_and_set_needs_clock_sync (GList * structures,
   return needs_clock_sync;
 }
 
+static GstStructure *
+_get_scenario_meta (GList * structures)
+{
+  GstStructure *meta = NULL;
+
+  gst_validate_scenario_check_and_set_needs_clock_sync (structures, &meta);
+  if (meta)
+    gst_structure_remove_fields (meta, "__lineno__", "__filename__",
+        "__debug__", NULL);
+
+  return meta;
+}
+
 static gboolean
 _parse_scenario (GFile * f, GKeyFile * kf)
 {
@@ -4940,15 +5255,11 @@ _parse_scenario (GFile * f, GKeyFile * kf)
   gchar *path = g_file_get_path (f);
 
   if (g_str_has_suffix (path, GST_VALIDATE_SCENARIO_SUFFIX)) {
-    GstStructure *meta = NULL;
-    GList *tmp, *structures = gst_validate_structs_parse_from_gfile (f,
+    /* Cached along with the structures of the scenario, so unchanged
+     * scenarios don't need to be parsed again */
+    GstStructure *meta = gst_validate_structs_get_meta_from_gfile (f,
         (GstValidateGetIncludePathsFunc)
-        gst_validate_scenario_get_include_paths);
-
-    gst_validate_scenario_check_and_set_needs_clock_sync (structures, &meta);
-    for (tmp = structures; tmp; tmp = tmp->next)
-      gst_structure_remove_fields (tmp->data, "__lineno__", "__filename__",
-          "__debug__", NULL);
+        gst_validate_scenario_get_include_paths, _get_scenario_meta);
 
     if (meta) {
       KeyFileGroupName kfg;
@@ -4956,15 +5267,12 @@ _parse_scenario (GFile * f, GKeyFile * kf)
       kfg.group_name = g_file_get_path (f);
       kfg.kf = kf;
 
-      gst_structure_remove_fields (meta, "__lineno__", "__filename__",
-          "__debug__", NULL);
       gst_structure_foreach (meta,
           (GstStructureForeachFunc) _add_description, &kfg);
       gst_structure_free (meta);
     } else {
       g_key_file_set_string (kf, path, "noinfo", "nothing");
     }
-    g_list_free_full (structures, (GDestroyNotify) gst_structure_free);
 
     ret = TRUE;
   }
@@ -5660,6 +5968,7 @@ _execute_stop (GstValidateScenario * scenario, GstValidateAction * action)
 
   bus = gst_element_get_bus (pipeline);
   SCENARIO_LOCK (scenario);
+  _cancel_playback_time_wait (scenario);
   if (priv->execute_actions_source_id) {
     g_source_remove (priv->execute_actions_source_id);
     priv->execute_actions_source_id = 0;
@@ -5681,7 +5990,7 @@ _execute_stop (GstValidateScenario * scenario, GstValidateAction * action)
       if (remaining_action == action)
         continue;
 
-      type = _find_action_type (remaining_action->type);
+      type = _action_get_type (remaining_action);
 
       tmpconcat = actions;
 
@@ -5754,7 +6063,7 @@ _action_set_done (GstValidateAction * action)
       ((gdouble) action->priv->execution_duration / GST_SECOND));
   json_builder_end_object (jbuild);
 
-  gst_validate_send (json_builder_get_root (jbuild));
+  _send_for_scenario (scenario, json_builder_get_root (jbuild));
   g_object_unref (jbuild);
 
   action->priv->pending_set_done = FALSE;
@@ -5958,6 +6267,9 @@ gst_validate_register_action_type_dynamic (GstPlugin * plugin,
   type->flags = flags;
   type->rank = rank;
 
+  if (!action_types_table)
+    action_types_table = g_hash_table_new (NULL, NULL);
+
   if ((tmptype = _find_action_type (type_name))) {
     if (tmptype->rank <= rank) {
       action_types = g_list_remove (action_types, tmptype);
@@ -5969,8 +6281,11 @@ gst_validate_register_action_type_dynamic (GstPlugin * plugin,
     }
   }
 
-  if (type != tmptype)
+  if (type != tmptype) {
     action_types = g_list_append (action_types, type);
+    g_hash_table_insert (action_types_table,
+        GUINT_TO_POINTER (g_quark_from_string (type_name)), type);
+  }
 
   if (plugin) {
     GList *plugin_action_types = g_object_steal_data (G_OBJECT (plugin),
@@ -7007,6 +7322,7 @@ register_action_types (void)
 void
 gst_validate_scenario_deinit (void)
 {
+  g_clear_pointer (&action_types_table, g_hash_table_unref);
   _free_action_types (action_types);
   action_types = NULL;
 }
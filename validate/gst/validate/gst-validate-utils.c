@@ -28,6 +28,7 @@
 #include <string.h>
 #include <stdlib.h>
 #include <glib.h>
+#include <glib/gstdio.h>
 
 #ifdef G_OS_UNIX
 #include <glib-unix.h>
@@ -47,30 +48,97 @@
 #define PARSER_MAX_TOKEN_SIZE 256
 #define PARSER_MAX_ARGUMENT_COUNT 10
 
-static GRegex *_variables_regex = NULL;
+#define STRUCTURES_CACHE_VERSION 3
+
+#define MAX_NESTED_VARIABLES 16
+#define MAX_VARIABLE_EXPANSION_DEPTH 32
+
 static GstStructure *global_vars = NULL;
 
 static GQuark debug_quark = 0;
 static GQuark lineno_quark = 0;
 static GQuark filename_quark = 0;
 
+#define EXPRESSION_CACHE_MAX_SIZE 4096
+#define EXPRESSION_MAX_STACK_VARIABLES 16
+
+typedef enum
+{
+  EXPRESSION_NUMBER,
+  EXPRESSION_VARIABLE,
+  EXPRESSION_NEGATE,
+  EXPRESSION_ADD,
+  EXPRESSION_SUBTRACT,
+  EXPRESSION_MULTIPLY,
+  EXPRESSION_DIVIDE,
+  EXPRESSION_POWER,
+  EXPRESSION_LESS,
+  EXPRESSION_GREATER,
+  EXPRESSION_LESS_EQUAL,
+  EXPRESSION_GREATER_EQUAL,
+  EXPRESSION_EQUAL,
+  EXPRESSION_NOT_EQUAL,
+  EXPRESSION_AND,
+  EXPRESSION_OR,
+  EXPRESSION_MIN,
+  EXPRESSION_MAX,
+} ExpressionOp;
+
+typedef struct
+{
+  ExpressionOp op;
+
+  /* Index of the operands in the node array, children always come before
+   * their parent */
+  gint left;
+  gint right;
+
+  union
+  {
+    gdouble number;
+    guint slot;
+  } v;
+} ExpressionNode;
+
+struct _GstValidateExpression
+{
+  gint refcount;
+
+  ExpressionNode *nodes;
+  guint n_nodes;
+  gint root;
+
+  /* Name of the variable bound to each slot */
+  gchar **variables;
+  guint n_variables;
+};
+
 typedef struct
 {
   const gchar *str;
   gint len;
   gint pos;
   jmp_buf err_jmp_buf;
-  const gchar *error;
-  void *user_data;
-  GstValidateParseVariableFunc variable_func;
+  gchar *error;
+
+  GArray *nodes;
+  GPtrArray *variables;
 } MathParser;
 
-static gdouble _read_power (MathParser * parser);
+static GHashTable *expression_cache = NULL;
+G_LOCK_DEFINE_STATIC (expression_cache);
+
+static gint _read_power (MathParser * parser);
 
 static void
-_error (MathParser * parser, const gchar * err)
+_error (MathParser * parser, const gchar * format, ...)
 {
-  parser->error = err;
+  va_list args;
+
+  va_start (args, format);
+  parser->error = g_strdup_vprintf (format, args);
+  va_end (args);
+
   longjmp (parser->err_jmp_buf, 1);
 }
 
@@ -101,6 +169,128 @@ _next (MathParser * parser)
   return '\0';
 }
 
+static void
+_read_token_char (MathParser * parser, gchar * token, gint * pos)
+{
+  if (*pos >= PARSER_MAX_TOKEN_SIZE - 1)
+    _error (parser, "Token too long");
+
+  token[(*pos)++] = _next (parser);
+}
+
+static gdouble
+_apply_operator (ExpressionOp op, gdouble v0, gdouble v1)
+{
+  switch (op) {
+    case EXPRESSION_ADD:
+      return v0 + v1;
+    case EXPRESSION_SUBTRACT:
+      return v0 - v1;
+    case EXPRESSION_MULTIPLY:
+      return v0 * v1;
+    case EXPRESSION_DIVIDE:
+      return v0 / v1;
+    case EXPRESSION_POWER:
+      return pow (v0, v1);
+    case EXPRESSION_LESS:
+      return (v0 < v1) ? 1.0 : 0.0;
+    case EXPRESSION_GREATER:
+      return (v0 > v1) ? 1.0 : 0.0;
+    case EXPRESSION_LESS_EQUAL:
+      return (v0 <= v1) ? 1.0 : 0.0;
+    case EXPRESSION_GREATER_EQUAL:
+      return (v0 >= v1) ? 1.0 : 0.0;
+    case EXPRESSION_EQUAL:
+      return (fabs (v0 - v1) < PARSER_BOOLEAN_EQUALITY_THRESHOLD) ? 1.0 : 0.0;
+    case EXPRESSION_NOT_EQUAL:
+      return (fabs (v0 - v1) > PARSER_BOOLEAN_EQUALITY_THRESHOLD) ? 1.0 : 0.0;
+    case EXPRESSION_AND:
+      return (fabs (v0) >= PARSER_BOOLEAN_EQUALITY_THRESHOLD
+          && fabs (v1) >= PARSER_BOOLEAN_EQUALITY_THRESHOLD) ? 1.0 : 0.0;
+    case EXPRESSION_OR:
+      return (fabs (v0) >= PARSER_BOOLEAN_EQUALITY_THRESHOLD
+          || fabs (v1) >= PARSER_BOOLEAN_EQUALITY_THRESHOLD) ? 1.0 : 0.0;
+    case EXPRESSION_MIN:
+      return MIN (v0, v1);
+    case EXPRESSION_MAX:
+      return MAX (v0, v1);
+    default:
+      g_assert_not_reached ();
+  }
+
+  return 0.0;
+}
+
+static gint
+_add_number (MathParser * parser, gdouble number)
+{
+  ExpressionNode node = { EXPRESSION_NUMBER, -1, -1 };
+
+  node.v.number = number;
+  g_array_append_val (parser->nodes, node);
+
+  return parser->nodes->len - 1;
+}
+
+static gint
+_add_variable (MathParser * parser, const gchar * name)
+{
+  ExpressionNode node = { EXPRESSION_VARIABLE, -1, -1 };
+  guint slot;
+
+  for (slot = 0; slot < parser->variables->len; slot++) {
+    if (!g_strcmp0 (g_ptr_array_index (parser->variables, slot), name))
+      break;
+  }
+
+  if (slot == parser->variables->len)
+    g_ptr_array_add (parser->variables, g_strdup (name));
+
+  node.v.slot = slot;
+  g_array_append_val (parser->nodes, node);
+
+  return parser->nodes->len - 1;
+}
+
+#define NODE(parser, i) (&g_array_index ((parser)->nodes, ExpressionNode, i))
+
+static gint
+_add_negate (MathParser * parser, gint operand)
+{
+  ExpressionNode node = { EXPRESSION_NEGATE, operand, -1 };
+
+  if (NODE (parser, operand)->op == EXPRESSION_NUMBER) {
+    NODE (parser, operand)->v.number = -NODE (parser, operand)->v.number;
+
+    return operand;
+  }
+
+  g_array_append_val (parser->nodes, node);
+
+  return parser->nodes->len - 1;
+}
+
+static gint
+_add_operator (MathParser * parser, ExpressionOp op, gint left, gint right)
+{
+  ExpressionNode node = { op, left, right };
+
+  /* Fold constants, the right operand was parsed after the left one so
+   * everything after the left node belongs to it and can be dropped */
+  if (NODE (parser, left)->op == EXPRESSION_NUMBER
+      && NODE (parser, right)->op == EXPRESSION_NUMBER) {
+    NODE (parser, left)->v.number = _apply_operator (op,
+        NODE (parser, left)->v.number, NODE (parser, right)->v.number);
+    g_array_set_size (parser->nodes, left + 1);
+
+    return left;
+  }
+
+  g_array_append_val (parser->nodes, node);
+
+  return parser->nodes->len - 1;
+}
+
 static gdouble
 _read_double (MathParser * parser)
 {
@@ -110,30 +300,30 @@ _read_double (MathParser * parser)
 
   c = _peek (parser);
   if (c == '+' || c == '-')
-    token[pos++] = _next (parser);
+    _read_token_char (parser, token, &pos);
 
   while (isdigit (_peek (parser)))
-    token[pos++] = _next (parser);
+    _read_token_char (parser, token, &pos);
 
   c = _peek (parser);
   if (c == '.')
-    token[pos++] = _next (parser);
+    _read_token_char (parser, token, &pos);
 
   while (isdigit (_peek (parser)))
-    token[pos++] = _next (parser);
+    _read_token_char (parser, token, &pos);
 
   c = _peek (parser);
   if (c == 'e' || c == 'E') {
-    token[pos++] = _next (parser);
+    _read_token_char (parser, token, &pos);
 
     c = _peek (parser);
     if (c == '+' || c == '-') {
-      token[pos++] = _next (parser);
+      _read_token_char (parser, token, &pos);
     }
   }
 
   while (isdigit (_peek (parser)))
-    token[pos++] = _next (parser);
+    _read_token_char (parser, token, &pos);
 
   token[pos] = '\0';
 
@@ -143,10 +333,10 @@ _read_double (MathParser * parser)
   return val;
 }
 
-static gdouble
+static gint
 _read_term (MathParser * parser)
 {
-  gdouble v0;
+  gint v0;
   gchar c;
 
   v0 = _read_power (parser);
@@ -155,28 +345,29 @@ _read_term (MathParser * parser)
   while (c == '*' || c == '/') {
     _next (parser);
     if (c == '*') {
-      v0 *= _read_power (parser);
+      v0 = _add_operator (parser, EXPRESSION_MULTIPLY, v0,
+          _read_power (parser));
     } else if (c == '/') {
-      v0 /= _read_power (parser);
+      v0 = _add_operator (parser, EXPRESSION_DIVIDE, v0, _read_power (parser));
     }
     c = _peek (parser);
   }
   return v0;
 }
 
-static gdouble
+static gint
 _read_expr (MathParser * parser)
 {
-  gdouble v0 = 0.0;
+  gint v0;
   gchar c;
 
   c = _peek (parser);
   if (c == '+' || c == '-') {
     _next (parser);
     if (c == '+')
-      v0 += _read_term (parser);
-    else if (c == '-')
-      v0 -= _read_term (parser);
+      v0 = _read_term (parser);
+    else
+      v0 = _add_negate (parser, _read_term (parser));
   } else {
     v0 = _read_term (parser);
   }
@@ -185,9 +376,10 @@ _read_expr (MathParser * parser)
   while (c == '+' || c == '-') {
     _next (parser);
     if (c == '+') {
-      v0 += _read_term (parser);
+      v0 = _add_operator (parser, EXPRESSION_ADD, v0, _read_term (parser));
     } else if (c == '-') {
-      v0 -= _read_term (parser);
+      v0 = _add_operator (parser, EXPRESSION_SUBTRACT, v0,
+          _read_term (parser));
     }
 
     c = _peek (parser);
@@ -196,11 +388,12 @@ _read_expr (MathParser * parser)
   return v0;
 }
 
-static gdouble
+static gint
 _read_boolean_comparison (MathParser * parser)
 {
   gchar c, oper[] = { '\0', '\0', '\0' };
-  gdouble v0, v1;
+  gint v0, v1;
+  ExpressionOp op = EXPRESSION_LESS;
 
 
   v0 = _read_expr (parser);
@@ -215,25 +408,27 @@ _read_boolean_comparison (MathParser * parser)
     v1 = _read_expr (parser);
 
     if (g_strcmp0 (oper, "<") == 0) {
-      v0 = (v0 < v1) ? 1.0 : 0.0;
+      op = EXPRESSION_LESS;
     } else if (g_strcmp0 (oper, ">") == 0) {
-      v0 = (v0 > v1) ? 1.0 : 0.0;
+      op = EXPRESSION_GREATER;
     } else if (g_strcmp0 (oper, "<=") == 0) {
-      v0 = (v0 <= v1) ? 1.0 : 0.0;
+      op = EXPRESSION_LESS_EQUAL;
     } else if (g_strcmp0 (oper, ">=") == 0) {
-      v0 = (v0 >= v1) ? 1.0 : 0.0;
+      op = EXPRESSION_GREATER_EQUAL;
     } else {
       _error (parser, "Unknown operation!");
     }
+    v0 = _add_operator (parser, op, v0, v1);
   }
   return v0;
 }
 
-static gdouble
+static gint
 _read_boolean_equality (MathParser * parser)
 {
   gchar c, oper[] = { '\0', '\0', '\0' };
-  gdouble v0, v1;
+  gint v0, v1;
+  ExpressionOp op = EXPRESSION_EQUAL;
 
   v0 = _read_boolean_comparison (parser);
   c = _peek (parser);
@@ -254,21 +449,22 @@ _read_boolean_equality (MathParser * parser)
     }
     v1 = _read_boolean_comparison (parser);
     if (g_strcmp0 (oper, "==") == 0) {
-      v0 = (fabs (v0 - v1) < PARSER_BOOLEAN_EQUALITY_THRESHOLD) ? 1.0 : 0.0;
+      op = EXPRESSION_EQUAL;
     } else if (g_strcmp0 (oper, "!=") == 0) {
-      v0 = (fabs (v0 - v1) > PARSER_BOOLEAN_EQUALITY_THRESHOLD) ? 1.0 : 0.0;
+      op = EXPRESSION_NOT_EQUAL;
     } else {
       _error (parser, "Unknown operation!");
     }
+    v0 = _add_operator (parser, op, v0, v1);
   }
   return v0;
 }
 
-static gdouble
+static gint
 _read_boolean_and (MathParser * parser)
 {
   gchar c;
-  gdouble v0, v1;
+  gint v0, v1;
 
   v0 = _read_boolean_equality (parser);
 
@@ -282,8 +478,7 @@ _read_boolean_and (MathParser * parser)
     _next (parser);
 
     v1 = _read_boolean_equality (parser);
-    v0 = (fabs (v0) >= PARSER_BOOLEAN_EQUALITY_THRESHOLD
-        && fabs (v1) >= PARSER_BOOLEAN_EQUALITY_THRESHOLD) ? 1.0 : 0.0;
+    v0 = _add_operator (parser, EXPRESSION_AND, v0, v1);
 
     c = _peek (parser);
   }
@@ -291,11 +486,11 @@ _read_boolean_and (MathParser * parser)
   return v0;
 }
 
-static gdouble
+static gint
 _read_boolean_or (MathParser * parser)
 {
   gchar c;
-  gdouble v0, v1;
+  gint v0, v1;
 
   v0 = _read_boolean_and (parser);
 
@@ -307,8 +502,7 @@ _read_boolean_or (MathParser * parser)
       _error (parser, "Expected '|' to follow '|' in logical or operation!");
     _next (parser);
     v1 = _read_boolean_and (parser);
-    v0 = (fabs (v0) >= PARSER_BOOLEAN_EQUALITY_THRESHOLD
-        || fabs (v1) >= PARSER_BOOLEAN_EQUALITY_THRESHOLD) ? 1.0 : 0.0;
+    v0 = _add_operator (parser, EXPRESSION_OR, v0, v1);
     c = _peek (parser);
   }
 
@@ -316,41 +510,40 @@ _read_boolean_or (MathParser * parser)
 }
 
 static gboolean
-_init (MathParser * parser, const gchar * str,
-    GstValidateParseVariableFunc variable_func, void *user_data)
+_init (MathParser * parser, const gchar * str)
 {
   parser->str = str;
   parser->len = strlen (str) + 1;
   parser->pos = 0;
   parser->error = NULL;
-  parser->user_data = user_data;
-  parser->variable_func = variable_func;
+  parser->nodes = g_array_new (FALSE, FALSE, sizeof (ExpressionNode));
+  parser->variables = g_ptr_array_new_with_free_func (g_free);
 
   return TRUE;
 }
 
-static gdouble
+static gint
 _parse (MathParser * parser)
 {
-  gdouble result = 0.0;
+  gint root;
 
   if (!setjmp (parser->err_jmp_buf)) {
-    result = _read_expr (parser);
+    root = _read_expr (parser);
     if (parser->pos < parser->len - 1) {
       _error (parser,
           "Failed to reach end of input expression, likely malformed input");
     } else
-      return result;
+      return root;
   }
 
-  return -1.0;
+  return -1;
 }
 
-static gdouble
+static gint
 _read_argument (MathParser * parser)
 {
   gchar c;
-  gdouble val;
+  gint val;
 
   val = _read_expr (parser);
   c = _peek (parser);
@@ -360,63 +553,53 @@ _read_argument (MathParser * parser)
   return val;
 }
 
-static gdouble
+static gint
 _read_builtin (MathParser * parser)
 {
-  gdouble v0 = 0.0, v1 = 0.0;
+  gint v0, v1;
   gchar c, token[PARSER_MAX_TOKEN_SIZE];
   gint pos = 0;
 
   c = _peek (parser);
   if (isalpha (c) || c == '_' || c == '$') {
     while (isalpha (c) || isdigit (c) || c == '_' || c == '$') {
-      token[pos++] = _next (parser);
+      _read_token_char (parser, token, &pos);
       c = _peek (parser);
     }
     token[pos] = '\0';
 
     if (_peek (parser) == '(') {
+      ExpressionOp op = EXPRESSION_MIN;
+
       _next (parser);
       if (g_strcmp0 (token, "min") == 0) {
-        v0 = _read_argument (parser);
-        v1 = _read_argument (parser);
-        v0 = MIN (v0, v1);
+        op = EXPRESSION_MIN;
       } else if (g_strcmp0 (token, "max") == 0) {
-        v0 = _read_argument (parser);
-        v1 = _read_argument (parser);
-        v0 = MAX (v0, v1);
+        op = EXPRESSION_MAX;
       } else {
-        gchar *tmp =
-            g_strdup_printf ("Tried to call unknown built-in function: %s",
-            token);
-        _error (parser, tmp);
-        g_free (tmp);
+        _error (parser, "Tried to call unknown built-in function: %s", token);
       }
+      v0 = _read_argument (parser);
+      v1 = _read_argument (parser);
+      v0 = _add_operator (parser, op, v0, v1);
 
       if (_next (parser) != ')')
         _error (parser, "Expected ')' in built-in call!");
     } else {
-      if (parser->variable_func != NULL
-          && parser->variable_func (token, &v1, parser->user_data)) {
-        v0 = v1;
-      } else {
-        gchar *err =
-            g_strdup_printf ("Could not look up value for variable %s!", token);
-        _error (parser, err);
-        g_free (err);
-      }
+      /* Bound to a value when the expression is evaluated */
+      v0 = _add_variable (parser, token);
     }
   } else {
-    v0 = _read_double (parser);
+    v0 = _add_number (parser, _read_double (parser));
   }
 
   return v0;
 }
 
-static gdouble
+static gint
 _read_parenthesis (MathParser * parser)
 {
-  gdouble val;
+  gint val;
 
   if (_peek (parser) == '(') {
     _next (parser);
@@ -431,18 +614,18 @@ _read_parenthesis (MathParser * parser)
   return val;
 }
 
-static gdouble
+static gint
 _read_unary (MathParser * parser)
 {
   gchar c;
-  gdouble v0 = 0.0;
+  gint v0 = -1;
 
   c = _peek (parser);
   if (c == '!') {
     _error (parser, "Expected '+' or '-' for unary expression, got '!'");
   } else if (c == '-') {
     _next (parser);
-    v0 = -_read_parenthesis (parser);
+    v0 = _add_negate (parser, _read_parenthesis (parser));
   } else if (c == '+') {
     _next (parser);
     v0 = _read_parenthesis (parser);
@@ -452,10 +635,11 @@ _read_unary (MathParser * parser)
   return v0;
 }
 
-static gdouble
+static gint
 _read_power (MathParser * parser)
 {
-  gdouble v0, v1 = 1.0, s = 1.0;
+  gint v0, v1;
+  gboolean negative = FALSE;
 
   v0 = _read_unary (parser);
 
@@ -463,42 +647,275 @@ _read_power (MathParser * parser)
     _next (parser);
     if (_peek (parser) == '-') {
       _next (parser);
-      s = -1.0;
+      negative = TRUE;
     }
-    v1 = s * _read_power (parser);
-    v0 = pow (v0, v1);
+    v1 = _read_power (parser);
+    if (negative)
+      v1 = _add_negate (parser, v1);
+    v0 = _add_operator (parser, EXPRESSION_POWER, v0, v1);
   }
 
   return v0;
 }
 
+static gdouble
+_evaluate_node (const GstValidateExpression * expression, gint index,
+    const gdouble * values)
+{
+  const ExpressionNode *node = &expression->nodes[index];
+
+  switch (node->op) {
+    case EXPRESSION_NUMBER:
+      return node->v.number;
+    case EXPRESSION_VARIABLE:
+      return values[node->v.slot];
+    case EXPRESSION_NEGATE:
+      return -_evaluate_node (expression, node->left, values);
+    default:
+      return _apply_operator (node->op,
+          _evaluate_node (expression, node->left, values),
+          _evaluate_node (expression, node->right, values));
+  }
+}
+
 /**
- * gst_validate_utils_parse_expression: (skip):
+ * gst_validate_utils_compile_expression: (skip):
+ * @expr: The expression to compile
+ * @error: (out) (optional) (transfer full): The parsing error, if any
+ *
+ * Parses @expr once so that it can be evaluated many times with
+ * #gst_validate_expression_evaluate. Variables are only looked up when the
+ * expression is evaluated.
+ *
+ * Returns: (transfer full) (nullable): The compiled expression or %NULL if
+ * @expr could not be parsed
  */
-gdouble
-gst_validate_utils_parse_expression (const gchar * expr,
-    GstValidateParseVariableFunc variable_func, gpointer user_data,
-    gchar ** error)
+GstValidateExpression *
+gst_validate_utils_compile_expression (const gchar * expr, gchar ** error)
 {
-  gdouble val;
+  gint root;
   MathParser parser;
+  GstValidateExpression *expression = NULL;
   gchar **spl = g_strsplit (expr, " ", -1);
   gchar *expr_nospace = g_strjoinv ("", spl);
 
-  _init (&parser, expr_nospace, variable_func, user_data);
-  val = _parse (&parser);
+  _init (&parser, expr_nospace);
+  root = _parse (&parser);
   g_strfreev (spl);
   g_free (expr_nospace);
 
-  if (error) {
-    if (parser.error)
-      *error = g_strdup (parser.error);
-    else
+  if (root >= 0) {
+    expression = g_new0 (GstValidateExpression, 1);
+    expression->refcount = 1;
+    expression->root = root;
+    expression->n_nodes = parser.nodes->len;
+    expression->nodes = (ExpressionNode *) g_array_free (parser.nodes, FALSE);
+    expression->n_variables = parser.variables->len;
+    g_ptr_array_add (parser.variables, NULL);
+    expression->variables =
+        (gchar **) g_ptr_array_free (parser.variables, FALSE);
+  } else {
+    g_array_free (parser.nodes, TRUE);
+    g_ptr_array_free (parser.variables, TRUE);
+  }
+
+  if (error)
+    *error = parser.error;
+  else
+    g_free (parser.error);
+
+  return expression;
+}
+
+/**
+ * gst_validate_expression_evaluate: (skip):
+ * @expression: The #GstValidateExpression to evaluate
+ * @variable_func: (allow-none): The function used to get the value of the
+ * variables of @expression
+ * @user_data: The data passed to @variable_func
+ * @error: (out) (optional) (transfer full): The evaluation error, if any
+ *
+ * Returns: The value of @expression, or -1.0 if one of its variables could
+ * not be looked up
+ */
+gdouble
+gst_validate_expression_evaluate (GstValidateExpression * expression,
+    GstValidateParseVariableFunc variable_func, gpointer user_data,
+    gchar ** error)
+{
+  gdouble stack_values[EXPRESSION_MAX_STACK_VARIABLES];
+  gdouble *values = stack_values;
+  gdouble res = -1.0;
+  guint i;
+
+  if (error)
+    *error = NULL;
+
+  if (expression->n_variables > G_N_ELEMENTS (stack_values))
+    values = g_new (gdouble, expression->n_variables);
+
+  for (i = 0; i < expression->n_variables; i++) {
+    if (variable_func == NULL
+        || !variable_func (expression->variables[i], &values[i], user_data)) {
+      if (error)
+        *error = g_strdup_printf ("Could not look up value for variable %s!",
+            expression->variables[i]);
+
+      goto done;
+    }
+  }
+
+  res = _evaluate_node (expression, expression->root, values);
+
+done:
+  if (values != stack_values)
+    g_free (values);
+
+  return res;
+}
+
+/**
+ * gst_validate_expression_ref: (skip):
+ */
+GstValidateExpression *
+gst_validate_expression_ref (GstValidateExpression * expression)
+{
+  g_atomic_int_inc (&expression->refcount);
+
+  return expression;
+}
+
+/**
+ * gst_validate_expression_unref: (skip):
+ */
+void
+gst_validate_expression_unref (GstValidateExpression * expression)
+{
+  if (!g_atomic_int_dec_and_test (&expression->refcount))
+    return;
+
+  g_free (expression->nodes);
+  g_strfreev (expression->variables);
+  g_free (expression);
+}
+
+/**
+ * gst_validate_utils_parse_expression: (skip):
+ */
+gdouble
+gst_validate_utils_parse_expression (const gchar * expr,
+    GstValidateParseVariableFunc variable_func, gpointer user_data,
+    gchar ** error)
+{
+  gdouble val = -1.0;
+  GstValidateExpression *expression =
+      gst_validate_utils_compile_expression (expr, error);
+
+  if (expression) {
+    val = gst_validate_expression_evaluate (expression, variable_func,
+        user_data, error);
+    gst_validate_expression_unref (expression);
+  }
+
+  return val;
+}
+
+/* Returns the compiled version of @expr, only parsing it the first time it
+ * is seen. */
+GstValidateExpression *
+gst_validate_get_compiled_expression (const gchar * expr, gchar ** error)
+{
+  GstValidateExpression *expression;
+
+  G_LOCK (expression_cache);
+  if (!expression_cache)
+    expression_cache = g_hash_table_new_full (g_str_hash, g_str_equal,
+        g_free, (GDestroyNotify) gst_validate_expression_unref);
+
+  expression = g_hash_table_lookup (expression_cache, expr);
+  if (expression) {
+    gst_validate_expression_ref (expression);
+    G_UNLOCK (expression_cache);
+
+    if (error)
       *error = NULL;
+
+    return expression;
+  }
+  G_UNLOCK (expression_cache);
+
+  expression = gst_validate_utils_compile_expression (expr, error);
+  if (!expression)
+    return NULL;
+
+  G_LOCK (expression_cache);
+  /* Expressions where variables got substituted by their values can all be
+   * different, don't let them grow the cache forever */
+  if (g_hash_table_size (expression_cache) >= EXPRESSION_CACHE_MAX_SIZE)
+    g_hash_table_remove_all (expression_cache);
+  g_hash_table_replace (expression_cache, g_strdup (expr),
+      gst_validate_expression_ref (expression));
+  G_UNLOCK (expression_cache);
+
+  return expression;
+}
+
+/* Same as gst_validate_utils_parse_expression() but using the cache of
+ * compiled expressions */
+gdouble
+gst_validate_evaluate_expression (const gchar * expr,
+    GstValidateParseVariableFunc variable_func, gpointer user_data,
+    gchar ** error)
+{
+  gdouble val = -1.0;
+  GstValidateExpression *expression =
+      gst_validate_get_compiled_expression (expr, error);
+
+  if (expression) {
+    val = gst_validate_expression_evaluate (expression, variable_func,
+        user_data, error);
+    gst_validate_expression_unref (expression);
   }
+
   return val;
 }
 
+/* Compiles @expr ahead of its evaluation. References to variables are
+ * compiled as the name of the variable, which is what
+ * gst_validate_replace_variables_in_string() leaves for variables holding
+ * doubles, such as `position` and `duration`. */
+void
+gst_validate_precompile_expression (const gchar * expr)
+{
+  GString *compiled = g_string_sized_new (strlen (expr));
+  GstValidateExpression *expression;
+  const gchar *c;
+
+  for (c = expr; *c; c++) {
+    const gchar *end;
+
+    if (c[0] == '$' && c[1] == '(' && (end = strchr (c, ')'))) {
+      g_string_append_len (compiled, c + 2, end - c - 2);
+      c = end;
+    } else {
+      g_string_append_c (compiled, *c);
+    }
+  }
+
+  expression = gst_validate_get_compiled_expression (compiled->str, NULL);
+  if (expression)
+    gst_validate_expression_unref (expression);
+  g_string_free (compiled, TRUE);
+}
+
+void
+gst_validate_expression_cache_clear (void)
+{
+  G_LOCK (expression_cache);
+  g_clear_pointer (&expression_cache, g_hash_table_unref);
+  G_UNLOCK (expression_cache);
+}
+
 /**
  * gst_validate_utils_flags_from_str:
  * @type: The #GType of the flags we are trying to retrieve the flags from
@@ -588,11 +1005,132 @@ gst_validate_has_colored_output (void)
 #endif
 }
 
+/* Files a parsed file depends on, with their stamps when they were read */
+typedef struct
+{
+  gboolean cacheable;
+  GPtrArray *files;
+  GPtrArray *stamps;
+} StructuresDependencies;
+
+/* Files modified less than this many seconds ago can still be rewritten
+ * without their modification time changing, depending on the resolution of
+ * the timestamps of their filesystem */
+#define STRUCTURES_CACHE_MTIME_SLACK 2
+
+/* Returns the modification time, size and inode of @path, setting @recent if
+ * the modification time can't be trusted to change along with the content */
+static gchar *
+_get_file_stat_stamp (const gchar * path, gboolean * recent)
+{
+  GStatBuf st;
+  gint64 mtime_nsec = 0;
+
+  if (g_stat (path, &st) < 0)
+    return NULL;
+
+#ifdef HAVE_STRUCT_STAT_ST_MTIM
+  mtime_nsec = st.st_mtim.tv_nsec;
+#endif
+  *recent = (gint64) st.st_mtime >=
+      g_get_real_time () / G_USEC_PER_SEC - STRUCTURES_CACHE_MTIME_SLACK;
+
+  return g_strdup_printf ("%" G_GINT64_FORMAT ".%09" G_GINT64_FORMAT ":%"
+      G_GINT64_FORMAT ":%" G_GUINT64_FORMAT, (gint64) st.st_mtime, mtime_nsec,
+      (gint64) st.st_size, (guint64) st.st_ino);
+}
+
+static gchar *
+_get_file_checksum (const gchar * path)
+{
+  gchar *content, *res;
+  gsize size;
+
+  if (!g_file_get_contents (path, &content, &size, NULL))
+    return NULL;
+
+  res = g_compute_checksum_for_data (G_CHECKSUM_SHA1, (const guchar *) content,
+      size);
+  g_free (content);
+
+  return res;
+}
+
+/* The stat data of @path, followed by the checksum of its content when its
+ * modification time is too recent to be trusted */
+static gchar *
+_get_file_stamp (const gchar * path)
+{
+  gboolean recent;
+  gchar *checksum, *res, *stamp = _get_file_stat_stamp (path, &recent);
+
+  if (!stamp)
+    return g_strdup ("missing");
+
+  if (!recent)
+    return stamp;
+
+  checksum = _get_file_checksum (path);
+  res = g_strdup_printf ("%s#%s", stamp, GST_STR_NULL (checksum));
+  g_free (checksum);
+  g_free (stamp);
+
+  return res;
+}
+
+/* Only reads the content of the files whose stamp has a checksum. Once their
+ * modification time can be trusted, they are parsed again so that the cache
+ * gets a stamp without it. */
+static gboolean
+_file_stamp_matches (const gchar * path, const gchar * stamp)
+{
+  gboolean recent, res;
+  const gchar *checksum = strchr (stamp, '#');
+  gchar *stat_stamp = _get_file_stat_stamp (path, &recent), *content_checksum;
+
+  if (!stat_stamp)
+    return !g_strcmp0 (stamp, "missing");
+
+  res = checksum ? (gssize) strlen (stat_stamp) == checksum - stamp &&
+      !strncmp (stamp, stat_stamp, checksum - stamp) :
+      !g_strcmp0 (stamp, stat_stamp);
+  g_free (stat_stamp);
+  if (!res || !checksum)
+    return res;
+
+  if (!recent)
+    return FALSE;
+
+  content_checksum = _get_file_checksum (path);
+  res = !g_strcmp0 (checksum + 1, content_checksum);
+  g_free (content_checksum);
+
+  return res;
+}
+
+static void
+_add_dependency (StructuresDependencies * deps, GFile * file)
+{
+  gchar *path;
+
+  if (!deps)
+    return;
+
+  if (!(path = g_file_get_path (file))) {
+    deps->cacheable = FALSE;
+    return;
+  }
+
+  g_ptr_array_add (deps->stamps, _get_file_stamp (path));
+  g_ptr_array_add (deps->files, path);
+}
+
 /* Parse file that contains a list of GStructures */
 #define GST_STRUCT_LINE_CONTINUATION_CHARS ",{\\["
 static GList *
 _file_get_structures (GFile * file, gchar ** err,
-    GstValidateGetIncludePathsFunc get_include_paths_func)
+    GstValidateGetIncludePathsFunc get_include_paths_func,
+    StructuresDependencies * deps)
 {
   gsize size;
 
@@ -619,6 +1157,7 @@ _file_get_structures (GFile * file, gchar ** err,
 
 
   filename = g_file_get_path (file);
+  _add_dependency (deps, file);
   /* TODO Handle GCancellable */
   if (!g_file_load_contents (file, NULL, &content, &size, NULL, &error)) {
     if (errstr && !get_include_paths_func)
@@ -774,6 +1313,10 @@ _file_get_structures (GFile * file, gchar ** err,
               if (g_file_query_exists (included, NULL))
                 break;
 
+              /* The include would change if that file was created */
+              if (include_dirs[i + 1])
+                _add_dependency (deps, included);
+
               /* We let the last attempt fail and report an error in the
                * including code path */
             }
@@ -784,7 +1327,7 @@ _file_get_structures (GFile * file, gchar ** err,
           g_free (included_path);
 
           tmpstructures = _file_get_structures (included, &included_err,
-              get_include_paths_func);
+              get_include_paths_func, deps);
           if (included_err) {
             if (errstr) {
               gchar *c;
@@ -849,6 +1392,292 @@ failed:
   goto done;
 }
 
+static void
+_structures_dependencies_init (StructuresDependencies * deps)
+{
+  deps->cacheable = TRUE;
+  deps->files = g_ptr_array_new_with_free_func (g_free);
+  deps->stamps = g_ptr_array_new_with_free_func (g_free);
+}
+
+static void
+_structures_dependencies_clear (StructuresDependencies * deps)
+{
+  g_ptr_array_unref (deps->files);
+  g_ptr_array_unref (deps->stamps);
+}
+
+static gchar *
+_get_structures_cache_path (const gchar * path)
+{
+  gchar *checksum, *res;
+  const gchar *dir = g_getenv ("GST_VALIDATE_STRUCTURES_CACHE_DIR");
+
+  if (!g_strcmp0 (dir, "none"))
+    return NULL;
+
+  checksum = g_compute_checksum_for_string (G_CHECKSUM_SHA1, path, -1);
+  if (dir && *dir)
+    res = g_build_filename (dir, checksum, NULL);
+  else
+    res = g_build_filename (g_get_user_cache_dir (),
+        "gstreamer-" GST_API_VERSION, "validate", "structures", checksum,
+        NULL);
+  g_free (checksum);
+
+  return res;
+}
+
+/* What else than the files themselves decides how includes are resolved */
+static gchar *
+_get_structures_cache_context (const gchar * path,
+    GstValidateGetIncludePathsFunc get_include_paths_func)
+{
+  gchar *res, *dirs_str = NULL;
+  gchar **dirs =
+      get_include_paths_func ? get_include_paths_func (path) : NULL;
+
+  if (dirs)
+    dirs_str = g_strjoinv (G_SEARCHPATH_SEPARATOR_S, dirs);
+  res = g_strdup_printf ("%s|%s", GST_STR_NULL (dirs_str),
+      GST_STR_NULL (g_getenv ("GST_VALIDATE_SCENARIOS_PATH")));
+
+  g_strfreev (dirs);
+  g_free (dirs_str);
+
+  return res;
+}
+
+/* Returns the cache entry of @path if none of the files it was parsed from
+ * changed since it was written */
+static GKeyFile *
+_load_structures_cache (const gchar * cache_path, const gchar * path,
+    const gchar * context)
+{
+  gsize i, n_files = 0, n_stamps = 0;
+  gchar **files = NULL, **stamps = NULL;
+  gchar *cached_path = NULL, *cached_context = NULL;
+  GKeyFile *kf = g_key_file_new ();
+
+  if (!g_key_file_load_from_file (kf, cache_path, G_KEY_FILE_NONE, NULL))
+    goto invalid;
+
+  if (g_key_file_get_integer (kf, "cache", "version", NULL) !=
+      STRUCTURES_CACHE_VERSION)
+    goto invalid;
+
+  cached_path = g_key_file_get_string (kf, "cache", "path", NULL);
+  cached_context = g_key_file_get_string (kf, "cache", "context", NULL);
+  if (g_strcmp0 (cached_path, path) || g_strcmp0 (cached_context, context))
+    goto invalid;
+
+  files = g_key_file_get_string_list (kf, "cache", "files", &n_files, NULL);
+  stamps = g_key_file_get_string_list (kf, "cache", "stamps", &n_stamps, NULL);
+  if (!files || !stamps || n_files != n_stamps)
+    goto invalid;
+
+  for (i = 0; i < n_files; i++) {
+    if (!_file_stamp_matches (files[i], stamps[i]))
+      goto invalid;
+  }
+
+done:
+  g_strfreev (files);
+  g_strfreev (stamps);
+  g_free (cached_path);
+  g_free (cached_context);
+
+  return kf;
+
+invalid:
+  g_clear_pointer (&kf, g_key_file_free);
+  goto done;
+}
+
+static gboolean
+_get_cached_structures (GKeyFile * kf, GList ** structures)
+{
+  gsize i, n_strs = 0;
+  GList *res = NULL;
+  gchar **strs =
+      g_key_file_get_string_list (kf, "cache", "structures", &n_strs, NULL);
+
+  for (i = 0; i < n_strs; i++) {
+    GstStructure *structure = gst_structure_from_string (strs[i], NULL);
+
+    if (!structure) {
+      g_list_free_full (res, (GDestroyNotify) gst_structure_free);
+      g_strfreev (strs);
+
+      return FALSE;
+    }
+    res = g_list_prepend (res, structure);
+  }
+  g_strfreev (strs);
+
+  *structures = g_list_reverse (res);
+
+  return TRUE;
+}
+
+static GstStructure *
+_get_cached_meta (GKeyFile * kf)
+{
+  GstStructure *meta = NULL;
+  gchar *meta_str = g_key_file_get_string (kf, "cache", "meta", NULL);
+
+  if (meta_str && *meta_str)
+    meta = gst_structure_from_string (meta_str, NULL);
+  g_free (meta_str);
+
+  return meta;
+}
+
+static void
+_write_structures_cache (const gchar * cache_path, GKeyFile * kf)
+{
+  gsize size;
+  gchar *dir = g_path_get_dirname (cache_path);
+  gchar *data = g_key_file_to_data (kf, &size, NULL);
+
+  /* Written to a temporary file then renamed, so test processes running in
+   * parallel never read half written entries */
+  if (g_mkdir_with_parents (dir, 0755) < 0
+      || !g_file_set_contents (cache_path, data, size, NULL))
+    GST_INFO ("Could not write structures cache %s", cache_path);
+
+  g_free (data);
+  g_free (dir);
+}
+
+static GKeyFile *
+_create_structures_cache (const gchar * path, const gchar * context,
+    StructuresDependencies * deps, GList * structures)
+{
+  GList *tmp;
+  GKeyFile *kf;
+  GPtrArray *strs;
+
+  if (!deps->cacheable)
+    return NULL;
+
+  strs = g_ptr_array_new_with_free_func (g_free);
+  for (tmp = structures; tmp; tmp = tmp->next) {
+    gchar *str = gst_structure_to_string (tmp->data);
+    GstStructure *parsed = gst_structure_from_string (str, NULL);
+    gboolean roundtrips = parsed && gst_structure_is_equal (parsed, tmp->data);
+
+    g_clear_pointer (&parsed, gst_structure_free);
+    g_ptr_array_add (strs, str);
+
+    if (!roundtrips) {
+      GST_INFO ("%s can't be cached, `%s` can't be deserialized", path, str);
+      g_ptr_array_unref (strs);
+
+      return NULL;
+    }
+  }
+
+  kf = g_key_file_new ();
+  g_key_file_set_integer (kf, "cache", "version", STRUCTURES_CACHE_VERSION);
+  g_key_file_set_string (kf, "cache", "path", path);
+  g_key_file_set_string (kf, "cache", "context", context);
+  g_key_file_set_string_list (kf, "cache", "files",
+      (const gchar * const *) deps->files->pdata, deps->files->len);
+  g_key_file_set_string_list (kf, "cache", "stamps",
+      (const gchar * const *) deps->stamps->pdata, deps->stamps->len);
+  g_key_file_set_string_list (kf, "cache", "structures",
+      (const gchar * const *) strs->pdata, strs->len);
+  g_ptr_array_unref (strs);
+
+  return kf;
+}
+
+/* Same as _file_get_structures() but going through the structures cache, in
+ * which case the meta structure computed by @meta_func can also be cached,
+ * and the structures are only loaded if @structures is not %NULL */
+static void
+_file_get_structures_cached (GFile * file, gchar ** err,
+    GstValidateGetIncludePathsFunc get_include_paths_func, GList ** structures,
+    GstValidateStructuresMetaFunc meta_func, GstStructure ** meta)
+{
+  GKeyFile *kf = NULL;
+  GList *structs = NULL;
+  gboolean has_meta, write = FALSE;
+  StructuresDependencies deps;
+  gchar *path = g_file_get_path (file), *context = NULL, *meta_str = NULL;
+  gchar *cache_path = path ? _get_structures_cache_path (path) : NULL;
+
+  if (err)
+    *err = NULL;
+
+  if (!cache_path) {
+    structs = _file_get_structures (file, err, get_include_paths_func, NULL);
+    if (meta_func)
+      *meta = meta_func (structs);
+    goto done;
+  }
+
+  context = _get_structures_cache_context (path, get_include_paths_func);
+  kf = _load_structures_cache (cache_path, path, context);
+  has_meta = kf && meta_func
+      && g_key_file_has_key (kf, "cache", "meta", NULL);
+  if (has_meta && !structures) {
+    *meta = _get_cached_meta (kf);
+    goto done;
+  }
+
+  if (kf && !_get_cached_structures (kf, &structs))
+    g_clear_pointer (&kf, g_key_file_free);
+
+  if (kf) {
+    GST_DEBUG ("Using cached structures for %s", path);
+    if (has_meta) {
+      *meta = _get_cached_meta (kf);
+      goto done;
+    }
+  } else {
+    gchar *parse_err = NULL;
+
+    /* Without @err, parsing stops at the first error and returns no
+     * structures, which must not end up in the cache */
+    _structures_dependencies_init (&deps);
+    structs = _file_get_structures (file, err ? &parse_err : NULL,
+        get_include_paths_func, &deps);
+    if (err && !parse_err)
+      kf = _create_structures_cache (path, context, &deps, structs);
+    _structures_dependencies_clear (&deps);
+    write = kf != NULL;
+
+    if (err)
+      *err = parse_err;
+  }
+
+  if (meta_func) {
+    *meta = meta_func (structs);
+    if (kf) {
+      meta_str = *meta ? gst_structure_to_string (*meta) : g_strdup ("");
+      g_key_file_set_string (kf, "cache", "meta", meta_str);
+      write = TRUE;
+    }
+  }
+
+  if (write)
+    _write_structures_cache (cache_path, kf);
+
+done:
+  if (structures)
+    *structures = structs;
+  else
+    g_list_free_full (structs, (GDestroyNotify) gst_structure_free);
+
+  g_clear_pointer (&kf, g_key_file_free);
+  g_free (meta_str);
+  g_free (context);
+  g_free (cache_path);
+  g_free (path);
+}
+
 static GList *
 _get_structures (const gchar * structured_file, gchar ** file_path,
     GstValidateGetIncludePathsFunc get_include_paths_func, gchar ** err)
@@ -867,7 +1696,8 @@ _get_structures (const gchar * structured_file, gchar ** file_path,
   if (file_path)
     *file_path = g_file_get_path (file);
 
-  structs = _file_get_structures (file, err, get_include_paths_func);
+  _file_get_structures_cached (file, err, get_include_paths_func, &structs,
+      NULL, NULL);
 
   g_object_unref (file);
 
@@ -905,7 +1735,8 @@ gst_validate_structs_parse_from_gfile (GFile * structured_file,
   gchar *err = NULL;
   GList *res;
 
-  res = _file_get_structures (structured_file, &err, get_include_paths_func);
+  _file_get_structures_cached (structured_file, &err, get_include_paths_func,
+      &res, NULL, NULL);
   if (err)
     gst_validate_abort ("Could not get structures from %s:\n%s\n",
         g_file_get_uri (structured_file), err);
@@ -913,6 +1744,26 @@ gst_validate_structs_parse_from_gfile (GFile * structured_file,
   return res;
 }
 
+/* Returns the structure computed by @meta_func from the structures of
+ * @structured_file, only computing it again if the file or one of its
+ * includes changed */
+GstStructure *
+gst_validate_structs_get_meta_from_gfile (GFile * structured_file,
+    GstValidateGetIncludePathsFunc get_include_paths_func,
+    GstValidateStructuresMetaFunc meta_func)
+{
+  gchar *err = NULL;
+  GstStructure *meta = NULL;
+
+  _file_get_structures_cached (structured_file, &err, get_include_paths_func,
+      NULL, meta_func, &meta);
+  if (err)
+    gst_validate_abort ("Could not get structures from %s:\n%s\n",
+        g_file_get_uri (structured_file), err);
+
+  return meta;
+}
+
 gboolean
 gst_validate_element_has_klass (GstElement * element, const gchar * klass)
 {
@@ -1208,90 +2059,162 @@ gst_validate_element_matches_target (GstElement * element, GstStructure * s)
 }
 
 static gchar *
-gst_structure_get_value_as_string (GstStructure * structure,
-    const gchar * field)
+_value_to_string (const GValue * val)
 {
-  const GValue *val = gst_structure_get_value (structure, field);
-
-  if (!val)
-    return NULL;
-
   if (G_VALUE_HOLDS_STRING (val))
     return g_value_dup_string (val);
 
   return gst_value_serialize (val);
 }
 
-gchar *
-gst_validate_replace_variables_in_string (gpointer source,
-    GstStructure * local_vars, const gchar * in_string)
+static gchar *
+_get_variable_value (GstStructure * local_vars, const gchar * varname)
 {
-  gint varname_len;
-  GMatchInfo *match_info = NULL;
-  gchar *tmpstring, *string = g_strdup (in_string);
+  const GValue *val;
+  gchar *res;
+  GQuark quark = g_quark_try_string (varname);
 
-  if (!_variables_regex)
-    _variables_regex = g_regex_new ("\\$\\((\\w+)\\)", 0, 0, NULL);
+  /* Field names are interned, so a name that never was can't be set */
+  if (!quark)
+    return NULL;
 
-  gst_validate_set_globals (NULL);
+  if (local_vars && (val = gst_structure_id_get_value (local_vars, quark))) {
+    /* Left for the expression parser to look it up */
+    if (G_VALUE_TYPE (val) == G_TYPE_DOUBLE)
+      return g_strdup (varname);
 
-  while (g_regex_match (_variables_regex, string, 0, &match_info)) {
-    gchar *var_value = NULL;
+    if ((res = _value_to_string (val)))
+      return res;
+  }
 
-    if (g_match_info_matches (match_info)) {
-      GRegex *replace_regex;
-      gchar *tmp, *varname, *pvarname = g_match_info_fetch (match_info, 0);
+  if ((val = gst_structure_id_get_value (global_vars, quark)))
+    return _value_to_string (val);
 
-      varname_len = strlen (pvarname);
-      varname = g_malloc (sizeof (gchar) * (varname_len - 2));
-      strncpy (varname, &pvarname[2], varname_len - 3);
-      varname[varname_len - 3] = '\0';
+  return NULL;
+}
 
-      if (local_vars && gst_structure_has_field_typed (local_vars, varname,
-              G_TYPE_DOUBLE)) {
-        var_value = g_strdup (varname);
-      } else {
-        if (local_vars)
-          var_value = gst_structure_get_value_as_string (local_vars, varname);
-
-        if (!var_value)
-          var_value = gst_structure_get_value_as_string (global_vars, varname);
-
-        if (!var_value) {
-          gst_validate_error_structure (source,
-              "Trying to use undefined variable `%s`.\n"
-              "  Available vars:\n"
-              "    - locals%s\n"
-              "    - globals%s\n",
-              varname, gst_structure_to_string (local_vars),
-              gst_structure_to_string (global_vars));
-
-          return NULL;
-        }
+static gboolean
+_is_variable_name (const gchar * name, gsize len)
+{
+  gsize i;
+
+  if (!len)
+    return FALSE;
+
+  for (i = 0; i < len; i++) {
+    if (!g_ascii_isalnum (name[i]) && name[i] != '_')
+      return FALSE;
+  }
+
+  return TRUE;
+}
+
+/* Appends @in to @out, replacing the variables it references in a single
+ * pass. The values of variables are themselves expanded, and so are names
+ * built from other variables, like `$(uri_$(index))`, whose innermost
+ * reference is replaced first. `\$(` is copied as `$(` without being
+ * expanded. */
+static gboolean
+_replace_variables (gpointer source, GstStructure * local_vars,
+    const gchar * in, GString * out, guint depth)
+{
+  const gchar *c;
+  gsize starts[MAX_NESTED_VARIABLES];
+  guint n_starts = 0;
+
+  if (depth > MAX_VARIABLE_EXPANSION_DEPTH) {
+    gst_validate_error_structure (source,
+        "Too many levels of variables expanding to variables in `%s`, "
+        "is a variable referencing itself?", in);
+
+    return FALSE;
+  }
+
+  for (c = in; *c; c++) {
+    if (c[0] == '\\' && c[1] == '$' && c[2] == '(') {
+      g_string_append_len (out, "$(", 2);
+      n_starts = 0;
+      c += 2;
+    } else if (c[0] == '$' && c[1] == '(') {
+      if (n_starts == G_N_ELEMENTS (starts))
+        n_starts = 0;
+
+      starts[n_starts++] = out->len;
+      g_string_append_len (out, "$(", 2);
+      c++;
+    } else if (c[0] == ')' && n_starts) {
+      gboolean res;
+      gchar *varname, *var_value;
+      gsize start = starts[--n_starts];
+      const gchar *name = out->str + start + 2;
+      gsize len = out->len - start - 2;
+
+      if (!_is_variable_name (name, len)) {
+        /* Not a reference, and neither are the ones containing it */
+        g_string_append_c (out, ')');
+        n_starts = 0;
+        continue;
       }
 
-      tmp = g_strdup_printf ("\\$\\(%s\\)", varname);
-      replace_regex = g_regex_new (tmp, 0, 0, NULL);
-      g_free (tmp);
-      tmpstring = string;
-      string =
-          g_regex_replace_literal (replace_regex, string, -1, 0, var_value, 0,
-          NULL);
+      varname = g_strndup (name, len);
+      if (!(var_value = _get_variable_value (local_vars, varname))) {
+        gchar *locals = local_vars ? gst_structure_to_string (local_vars) :
+            NULL;
+        gchar *globals = gst_structure_to_string (global_vars);
+
+        gst_validate_error_structure (source,
+            "Trying to use undefined variable `%s`.\n"
+            "  Available vars:\n"
+            "    - locals%s\n"
+            "    - globals%s\n", varname, locals, globals);
+        g_free (locals);
+        g_free (globals);
+        g_free (varname);
+
+        return FALSE;
+      }
 
       GST_INFO ("Setting variable %s to %s", varname, var_value);
-      g_free (tmpstring);
+      g_string_truncate (out, start);
+      res = _replace_variables (source, local_vars, var_value, out, depth + 1);
       g_free (var_value);
-      g_regex_unref (replace_regex);
-      g_free (pvarname);
       g_free (varname);
+
+      if (!res)
+        return FALSE;
+    } else {
+      if (n_starts && !g_ascii_isalnum (*c) && *c != '_')
+        n_starts = 0;
+
+      g_string_append_c (out, *c);
     }
-    g_clear_pointer (&match_info, g_match_info_free);
   }
 
-  if (match_info)
-    g_match_info_free (match_info);
+  return TRUE;
+}
+
+gchar *
+gst_validate_replace_variables_in_string (gpointer source,
+    GstStructure * local_vars, const gchar * in_string)
+{
+  GString *string;
+
+  if (!in_string)
+    return NULL;
+
+  if (!strstr (in_string, "$("))
+    return g_strdup (in_string);
+
+  gst_validate_set_globals (NULL);
+
+  string = g_string_sized_new (strlen (in_string) + 1);
+  if (!_replace_variables (source, local_vars, in_string, string, 0)) {
+    g_string_free (string, TRUE);
 
-  return string;
+    return NULL;
+  }
+
+  return g_string_free (string, FALSE);
 }
 
 typedef struct
@@ -1300,21 +2223,17 @@ typedef struct
   GstStructure *local_vars;
 } ReplaceData;
 
-static void
-_resolve_expression (gpointer source, GValue * value)
+/* Returns the expression in @value if it has the `expr(...)` form */
+static gchar *
+_get_expression (const gchar * value)
 {
-  gdouble new_value;
-  GMatchInfo *match_info = NULL;
-  gchar *error = NULL;
   gchar *v, *expr, *tmp;
 
-  g_assert (G_VALUE_HOLDS_STRING (value));
-
-  tmp = expr = v = g_value_dup_string (value);
+  tmp = expr = v = g_strdup (value);
   tmp = skip_spaces (tmp);
   expr = strstr (v, "expr(");
   if (expr != tmp)
-    goto done;
+    goto fail;
 
   expr = &expr[5];
   tmp = &expr[strlen (expr) - 1];
@@ -1322,10 +2241,33 @@ _resolve_expression (gpointer source, GValue * value)
     tmp--;
 
   if (tmp == expr || *tmp != ')')
-    goto done;
+    goto fail;
 
   *tmp = '\0';
-  new_value = gst_validate_utils_parse_expression (expr, NULL, NULL, &error);
+  expr = g_strdup (expr);
+  g_free (v);
+
+  return expr;
+
+fail:
+  g_free (v);
+  return NULL;
+}
+
+static void
+_resolve_expression (gpointer source, GValue * value)
+{
+  gdouble new_value;
+  gchar *error = NULL;
+  gchar *expr;
+
+  g_assert (G_VALUE_HOLDS_STRING (value));
+
+  expr = _get_expression (g_value_get_string (value));
+  if (!expr)
+    return;
+
+  new_value = gst_validate_evaluate_expression (expr, NULL, NULL, &error);
   if (error)
     gst_validate_error_structure (source, "Could not parse expression %s: %s",
         expr, error);
@@ -1333,9 +2275,33 @@ _resolve_expression (gpointer source, GValue * value)
   g_value_init (value, G_TYPE_DOUBLE);
   g_value_set_double (value, new_value);
 
-done:
-  g_free (v);
-  g_clear_pointer (&match_info, g_match_info_free);
+  g_free (error);
+  g_free (expr);
+}
+
+static gboolean
+_precompile_field_expression (GQuark field_id, const GValue * value,
+    gpointer unused)
+{
+  gchar *expr;
+
+  if (!G_VALUE_HOLDS_STRING (value))
+    return TRUE;
+
+  if ((expr = _get_expression (g_value_get_string (value)))) {
+    gst_validate_precompile_expression (expr);
+    g_free (expr);
+  }
+
+  return TRUE;
+}
+
+/* Compiles the `expr(...)` fields of @structure so that resolving its
+ * variables only has to evaluate them */
+void
+gst_validate_structure_precompile_expressions (GstStructure * structure)
+{
+  gst_structure_foreach (structure, _precompile_field_expression, NULL);
 }
 
 static gboolean
@@ -36,12 +36,26 @@ typedef int (*GstValidateParseVariableFunc) (const gchar *name,
 
 typedef gchar** (*GstValidateGetIncludePathsFunc)(const gchar* includer_file);
 
+typedef struct _GstValidateExpression GstValidateExpression;
+
 GST_VALIDATE_API
 gdouble gst_validate_utils_parse_expression (const gchar *expr,
                                              GstValidateParseVariableFunc variable_func,
                                              gpointer user_data,
                                              gchar **error);
 GST_VALIDATE_API
+GstValidateExpression * gst_validate_utils_compile_expression (const gchar *expr,
+                                                               gchar **error);
+GST_VALIDATE_API
+gdouble gst_validate_expression_evaluate    (GstValidateExpression *expression,
+                                             GstValidateParseVariableFunc variable_func,
+                                             gpointer user_data,
+                                             gchar **error);
+GST_VALIDATE_API
+GstValidateExpression * gst_validate_expression_ref (GstValidateExpression *expression);
+GST_VALIDATE_API
+void gst_validate_expression_unref          (GstValidateExpression *expression);
+GST_VALIDATE_API
 guint gst_validate_utils_flags_from_str     (GType type, const gchar * str_flags);
 GST_VALIDATE_API
 gboolean gst_validate_utils_enum_from_str   (GType type,
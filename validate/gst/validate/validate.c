@@ -467,6 +467,7 @@ gst_validate_deinit (void)
   gst_validate_deinit_runner ();
 
   gst_validate_scenario_deinit ();
+  gst_validate_expression_cache_clear ();
 
   g_clear_object (&_gst_validate_registry_default);
 
@@ -682,6 +682,7 @@ class GstValidateSimpleTest(GstValidateTest):
 
 
 class GstValidateLaunchTest(GstValidateTest):
+    FORK_SERVER_SUPPORTED = True
 
     def __init__(self, classname, options, reporter, pipeline_desc,
                  timeout=DEFAULT_TIMEOUT, scenario=None,
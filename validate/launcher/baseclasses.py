@@ -19,6 +19,7 @@
 
 """ Class representing tests and test managers. """
 
+import array
 import importlib.util
 import json
 import os
@@ -26,8 +27,10 @@ import sys
 import re
 import copy
 import shlex
+import socket
 import socketserver
 import struct
+import tempfile
 import time
 from . import utils
 import signal
@@ -79,6 +82,160 @@ EXITING_SIGNALS.update({(v, k) for k, v in EXITING_SIGNALS.items()})
 CI_ARTIFACTS_URL = os.environ.get('CI_ARTIFACTS_URL')
 
 
+class ForkServerProcess(object):
+
+    """ A test forked by a ForkServer, exposing the subset of subprocess.Popen
+    used by the tests. """
+
+    def __init__(self, sock):
+        self.sock = sock
+        self.pid = None
+        self.returncode = None
+        self._buffer = b''
+        self._lock = threading.Lock()
+
+        while self.pid is None and self.returncode is None:
+            self._update(None)
+
+    def _update(self, timeout):
+        with self._lock:
+            if self.sock is None:
+                return
+
+            self.sock.settimeout(timeout)
+            try:
+                data = self.sock.recv(4096)
+            except (socket.timeout, BlockingIOError):
+                return
+            except OSError:
+                data = b''
+
+            if not data:
+                # The process handling the test died before reporting how
+                # the test exited.
+                self.sock.close()
+                self.sock = None
+                if self.returncode is None:
+                    self.returncode = 1
+                return
+
+            self._buffer += data
+            while len(self._buffer) >= 4:
+                size = struct.unpack('>I', self._buffer[:4])[0]
+                if len(self._buffer) < size + 4:
+                    break
+
+                message = json.loads(self._buffer[4:size + 4].decode())
+                self._buffer = self._buffer[size + 4:]
+                self.pid = message.get('pid', self.pid)
+                self.returncode = message.get('returncode', self.returncode)
+
+    def poll(self):
+        if self.returncode is None:
+            self._update(0)
+
+        return self.returncode
+
+    def wait(self):
+        while self.returncode is None:
+            self._update(0.1)
+
+        return self.returncode
+
+    def send_signal(self, sig):
+        if self.pid and self.returncode is None:
+            os.kill(self.pid, sig)
+
+    def terminate(self):
+        self.send_signal(signal.SIGTERM)
+
+    def kill(self):
+        self.send_signal(signal.SIGKILL)
+
+
+class ForkServer(Loggable):
+
+    """ A process of @application which initializes GStreamer and
+    GstValidate once, then forks itself for each test it gets requests for, see
+    `gst-validate-1.0 --fork-server`. """
+
+    _servers = {}
+    _lock = threading.Lock()
+
+    def __init__(self, application, options):
+        Loggable.__init__(self)
+
+        self.application = application
+        self.tmpdir = tempfile.mkdtemp(prefix='gst-validate-fork-server-')
+        self.socket_path = os.path.join(self.tmpdir, 'socket')
+        self.logfile = os.path.join(options.logsdir, 'fork-server-%s.log' %
+                                    os.path.basename(application))
+        self.out = open(self.logfile, 'w')
+
+        env = os.environ.copy()
+        # Each test connects to the launcher from its own process
+        for var in ['GST_VALIDATE_SERVER', 'GST_VALIDATE_UUID']:
+            env.pop(var, None)
+
+        self.info("Starting fork server: %s", self.socket_path)
+        self.process = subprocess.Popen([application, '--fork-server',
+                                         self.socket_path],
+                                        stdout=self.out, stderr=self.out,
+                                        env=env)
+
+        # The socket only shows up once it accepts connections
+        while not os.path.exists(self.socket_path):
+            if self.process.poll() is not None:
+                self.stop()
+                raise RuntimeError("Fork server exited, check %s" % self.logfile)
+            time.sleep(0.01)
+
+    @classmethod
+    def get(cls, application, options):
+        with cls._lock:
+            if application not in cls._servers:
+                try:
+                    cls._servers[application] = ForkServer(application, options)
+                except (OSError, RuntimeError) as e:
+                    printc("Could not start fork server for %s, spawning"
+                           " processes instead: %s" % (application, e),
+                           Colors.WARNING)
+                    cls._servers[application] = None
+
+            return cls._servers[application]
+
+    @classmethod
+    def stop_all(cls):
+        with cls._lock:
+            for server in cls._servers.values():
+                if server:
+                    server.stop()
+            cls._servers = {}
+
+    def spawn(self, command, out, env, cwd):
+        request = json.dumps({
+            'args': command,
+            'env': env,
+            'cwd': cwd or os.getcwd(),
+        }).encode()
+        data = struct.pack('>I', len(request)) + request
+
+        out.flush()
+        sock = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+        sock.connect(self.socket_path)
+        # The test outputs to @out, passed along with the start of the request
+        sock.sendmsg([data[:4]], [(socket.SOL_SOCKET, socket.SCM_RIGHTS,
+                                   array.array('i', [out.fileno()]))])
+        sock.sendall(data[4:])
+
+        return ForkServerProcess(sock)
+
+    def stop(self):
+        utils.kill_subprocess(self, self.process, DEFAULT_TIMEOUT)
+        self.out.close()
+        shutil.rmtree(self.tmpdir, ignore_errors=True)
+
+
 class Test(Loggable):
 
     """ A class representing a particular test. """
@@ -500,18 +657,27 @@ class Test(Loggable):
         else:
             preexec_fn = None
 
-        self.process = subprocess.Popen(self.command,
-                                        stderr=self.out,
-                                        stdout=self.out,
-                                        env=self.proc_env,
-                                        cwd=self.workdir,
-                                        preexec_fn=preexec_fn)
+        fork_server = self.get_fork_server()
+        if fork_server:
+            self.process = fork_server.spawn(self.command, self.out,
+                                             self.proc_env, self.workdir)
+        else:
+            self.process = subprocess.Popen(self.command,
+                                            stderr=self.out,
+                                            stdout=self.out,
+                                            env=self.proc_env,
+                                            cwd=self.workdir,
+                                            preexec_fn=preexec_fn)
         self.process.wait()
         if self.result is not Result.TIMEOUT:
             if self.process.returncode == 0:
                 self.run_external_checks()
             self.queue.put(None)
 
+    def get_fork_server(self):
+        """ Returns the ForkServer to run the test with, if any """
+        return None
+
     def get_valgrind_suppression_file(self, subdir, name):
         p = get_data_file(subdir, name)
         if p:
@@ -817,6 +983,8 @@ class GstValidateTest(Test):
 
     """ A class representing a particular test. """
     HARD_TIMEOUT_FACTOR = 5
+    # Whether the application can run the test from a fork server
+    FORK_SERVER_SUPPORTED = False
     fault_sig_regex = re.compile("<Caught SIGNAL: .*>")
     needs_gst_inspect = set()
 
@@ -907,6 +1075,16 @@ class GstValidateTest(Test):
     def get_current_value(self):
         return self.position
 
+    def get_fork_server(self):
+        if not self.FORK_SERVER_SUPPORTED or not self.options.fork_server:
+            return None
+
+        if self.options.gdb or self.options.valgrind or self.options.rr \
+                or utils.is_windows() or self.command[0] != self.application:
+            return None
+
+        return ForkServer.get(self.application, self.options)
+
     def get_subproc_env(self):
         subproc_env = os.environ.copy()
 
@@ -1996,6 +2174,7 @@ class _TestsLauncher(Loggable):
         os.environ["GST_VALIDATE_SERVER"] = "tcp://localhost:%s" % self.serverport
 
     def _stop_server(self):
+        ForkServer.stop_all()
         if self.server:
             self.server.shutdown()
             self.server_thread.join()
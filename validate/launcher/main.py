@@ -204,6 +204,7 @@ class LauncherConfig(Loggable):
         self.gdb = False
         self.no_display = False
         self.rr = False
+        self.fork_server = False
         self.xunit_file = None
         self.main_dir = utils.DEFAULT_MAIN_DIR
         self.output_dir = None
@@ -487,6 +488,11 @@ class LauncherConfig(Loggable):
         parser.add_argument("-vg", "--valgrind", dest="valgrind",
                             action="store_true",
                             help="Run the tests inside Valgrind")
+        parser.add_argument("--fork-server", dest="fork_server",
+                            action="store_true",
+                            help="Run the tests supporting it from a fork server"
+                            " initializing GStreamer only once instead of"
+                            " spawning a new process for each of them")
         parser.add_argument("-rr", "--rr", dest="rr",
                             action="store_true",
                             help="Run the tests inside rr record")
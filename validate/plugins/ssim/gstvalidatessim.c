@@ -33,6 +33,7 @@
 #include <gst/video/video.h>
 
 #include "../../gst-libs/gst/video/gstvalidatessim.h"
+#include "../../gst-libs/gst/video/gstvalidateframestore.h"
 #include "../../gst/validate/gst-validate-report.h"
 #include "../../gst/validate/gst-validate-pad-monitor.h"
 #include "../../gst/validate/gst-validate-reporter.h"
@@ -45,6 +46,7 @@
 #define SSIM_SAVING_ERROR g_quark_from_static_string ("validatessim::saving-error")
 #define MONITOR_DATA g_quark_from_static_string ("validate-ssim-monitor-data")
 #define NOT_ATTACHED g_quark_from_static_string ("validatessim::not-attached")
+#define SSIM_FRAME_DROPPED g_quark_from_static_string ("validatessim::frame-dropped")
 
 typedef struct _ValidateSsimOverridePrivate ValidateSsimOverridePrivate;
 
@@ -67,6 +69,11 @@ typedef struct
   gchar *path;
   GstClockTime position;
   guint width, height;
+
+  /* Result of the online comparison, @path only exists if it failed */
+  gboolean compared;
+  gboolean passed;
+  gfloat mean, lowest;
 } Frame;
 
 static void
@@ -75,6 +82,24 @@ free_frame (Frame * frame)
   g_free (frame->path);
 }
 
+/* A frame being converted and saved by the dump thread pool */
+typedef struct
+{
+  GstBuffer *buffer;
+  GstVideoInfo in_info;
+  GstVideoInfo out_info;
+  gboolean convert;
+  guint converter_cookie;
+
+  /* The store the frame is appended to, if any */
+  GstValidateFrameStore *store;
+
+  Frame frame;
+  gboolean done;
+  /* Whether @frame is added to the dumped frames */
+  gboolean keep;
+} DumpJob;
+
 struct _ValidateSsimOverridePrivate
 {
   gchar *outdir;
@@ -83,10 +108,39 @@ struct _ValidateSsimOverridePrivate
 
   gboolean is_attached;
 
-  GstVideoConverter *converter;
   GstCaps *last_caps;
   GstVideoInfo in_info;
   GstVideoInfo out_info;
+  gboolean convert;
+
+  /* Frames are converted and saved in a thread pool, and added to
+   * @frames in the order they were dumped */
+  GThreadPool *dump_pool;
+  GMutex dump_lock;
+  GCond dump_cond;
+  GQueue pending_dumps;
+  guint dump_queue_depth;
+  gboolean drop_frames;
+  /* Converters for the current formats that are not in use, invalidated by
+   * bumping @converter_cookie */
+  GSList *idle_converters;
+  guint converter_cookie;
+  /* Names of all the dumped files, including the ones being saved */
+  GHashTable *frame_names;
+
+  /* Compares frames with their reference as soon as they are dumped when
+   * 'online-comparison' is set, only saving the ones that fail. Comparisons
+   * are serialized by @ssim_lock, each one using several threads already. */
+  gboolean online;
+  GstValidateSsim *ssim;
+  GMutex ssim_lock;
+  GstValidateSsimMode ssim_mode;
+
+  /* With 'output-frame-store', frames are appended to one store per pad
+   * instead of being saved in their own file */
+  gboolean use_frame_stores;
+  GstValidateFrameStoreCompression store_compression;
+  GHashTable *frame_stores;
 
   GArray *frames;
   GstClockTime recurrence;
@@ -116,6 +170,77 @@ G_DEFINE_TYPE_WITH_PRIVATE (ValidateSsimOverride, validate_ssim_override,
     GST_TYPE_VALIDATE_OVERRIDE)
 /*  *INDENT-ON* */
 
+static void _dump_frame (DumpJob * job, ValidateSsimOverride * self);
+
+/* Waits until all the dumped frames have been saved and added to
+ * priv->frames */
+static void
+_wait_for_dumps (ValidateSsimOverride * self)
+{
+  ValidateSsimOverridePrivate *priv = self->priv;
+
+  g_mutex_lock (&priv->dump_lock);
+  while (!g_queue_is_empty (&priv->pending_dumps))
+    g_cond_wait (&priv->dump_cond, &priv->dump_lock);
+  g_mutex_unlock (&priv->dump_lock);
+}
+
+/* Returns the pattern of the reference files for @width x @height frames */
+static gchar *
+_get_ref_path (ValidateSsimOverride * self, guint width, guint height)
+{
+  gchar *refname, *ref_path;
+  const gchar *compared_files_dir =
+      gst_structure_get_string (self->priv->config,
+      "reference-images-dir");
+
+  if (self->priv->ref_format == GST_VIDEO_FORMAT_ENCODED)
+    refname = g_strdup_printf ("*.%s", self->priv->ref_ext);
+  else
+    refname = g_strdup_printf ("*.%dx%d.%s", width, height,
+        self->priv->ref_ext);
+
+  ref_path = g_build_path (G_DIR_SEPARATOR_S, compared_files_dir,
+      refname, NULL);
+  g_free (refname);
+
+  return ref_path;
+}
+
+static GstValidateSsim *
+_create_ssim (ValidateSsimOverride * self, GstValidateRunner * runner)
+{
+  GstValidateSsim *ssim;
+  gdouble min_avg_similarity = 0.95, min_lowest_similarity = -1.0;
+  gdouble accept_psnr = 0, reject_psnr = 0;
+  gint fps_n = 0, fps_d = 1, jobs = 0, cache_size;
+  gboolean compare_chroma = FALSE;
+
+  gst_structure_get_double (self->priv->config, "min-avg-priority",
+      &min_avg_similarity);
+  gst_structure_get_double (self->priv->config, "min-lowest-priority",
+      &min_lowest_similarity);
+
+  gst_structure_get_fraction (self->priv->config, "framerate", &fps_n, &fps_d);
+  gst_structure_get_int (self->priv->config, "jobs", &jobs);
+  ssim =
+      gst_validate_ssim_new (runner, min_avg_similarity, min_lowest_similarity,
+      fps_n, fps_d, MAX (jobs, 0));
+  gst_structure_get_boolean (self->priv->config, "compare-chroma",
+      &compare_chroma);
+  gst_validate_ssim_set_compare_chroma (ssim, compare_chroma);
+  gst_validate_ssim_set_mode (ssim, self->priv->ssim_mode);
+  gst_structure_get_double (self->priv->config, "accept-psnr", &accept_psnr);
+  gst_structure_get_double (self->priv->config, "reject-psnr", &reject_psnr);
+  gst_validate_ssim_set_psnr_thresholds (ssim, accept_psnr, reject_psnr);
+  if (gst_structure_get_int (self->priv->config, "reference-cache-size",
+          &cache_size))
+    gst_validate_ssim_set_reference_cache_size (ssim,
+        (gsize) MAX (cache_size, 0) * 1024 * 1024);
+
+  return ssim;
+}
+
 static void
 runner_stopping (GstValidateRunner * runner, ValidateSsimOverride * self)
 {
@@ -124,12 +249,15 @@ runner_stopping (GstValidateRunner * runner, ValidateSsimOverride * self)
   guint i, nfiles;
   gfloat mssim = 0, lowest = 1, highest = -1, total_avg = 0;
   gint npassed = 0, nfailures = 0;
-  gdouble min_avg_similarity = 0.95, min_lowest_similarity = -1.0,
-      min_avg = 1.0, min_min = 1.0;
+  gdouble min_avg = 1.0, min_min = 1.0;
+  guint64 cache_hits, cache_misses;
   const gchar *compared_files_dir =
       gst_structure_get_string (self->priv->config,
       "reference-images-dir");
-  gint fps_n = 0, fps_d = 1;
+
+  _wait_for_dumps (self);
+  /* Closing the stores lets them be read */
+  g_hash_table_remove_all (self->priv->frame_stores);
 
   if (!self->priv->is_attached) {
     gchar *config_str = gst_structure_to_string (self->priv->config);
@@ -143,39 +271,42 @@ runner_stopping (GstValidateRunner * runner, ValidateSsimOverride * self)
     return;
   }
 
-  gst_validate_printf (self,
-      "Running frame comparison between images from '%s' and '%s' %s%s.\n",
-      compared_files_dir, self->priv->outdir,
-      self->priv->result_outdir ? ". Issues can be visialized in " :
-      " (set 'result-output-dir' in the config file to visualize the result)",
-      self->priv->result_outdir ? self->priv->result_outdir : "");
+  if (self->priv->ssim)
+    gst_validate_printf (self,
+        "Frames were compared with the images from '%s' while running%s%s.\n",
+        compared_files_dir,
+        self->priv->result_outdir ? ". Issues can be visialized in " :
+        " (set 'result-output-dir' in the config file to visualize the result)",
+        self->priv->result_outdir ? self->priv->result_outdir : "");
+  else
+    gst_validate_printf (self,
+        "Running frame comparison between images from '%s' and '%s' %s%s.\n",
+        compared_files_dir, self->priv->outdir,
+        self->priv->result_outdir ? ". Issues can be visialized in " :
+        " (set 'result-output-dir' in the config file to visualize the result)",
+        self->priv->result_outdir ? self->priv->result_outdir : "");
 
-  gst_structure_get_double (self->priv->config, "min-avg-priority",
-      &min_avg_similarity);
-  gst_structure_get_double (self->priv->config, "min-lowest-priority",
-      &min_lowest_similarity);
-
-  gst_structure_get_fraction (self->priv->config, "framerate", &fps_n, &fps_d);
-  ssim =
-      gst_validate_ssim_new (runner, min_avg_similarity, min_lowest_similarity,
-      fps_n, fps_d);
+  ssim = self->priv->ssim ? gst_object_ref (self->priv->ssim) :
+      _create_ssim (self, runner);
 
   nfiles = self->priv->frames->len;
   for (i = 0; i < nfiles; i++) {
     Frame *frame = &g_array_index (self->priv->frames, Frame, i);
-    gchar *refname, *ref_path, *bname = g_path_get_basename (frame->path);
+    gboolean passed;
 
-    if (self->priv->ref_format == GST_VIDEO_FORMAT_ENCODED)
-      refname = g_strdup_printf ("*.%s", self->priv->ref_ext);
-    else
-      refname = g_strdup_printf ("*.%dx%d.%s", frame->width, frame->height,
-          self->priv->ref_ext);
+    if (frame->compared) {
+      passed = frame->passed;
+      mssim = frame->mean;
+      lowest = frame->lowest;
+    } else {
+      gchar *ref_path = _get_ref_path (self, frame->width, frame->height);
 
-    ref_path = g_build_path (G_DIR_SEPARATOR_S, compared_files_dir,
-        refname, NULL);
+      passed = gst_validate_ssim_compare_image_files (ssim, ref_path,
+          frame->path, &mssim, &lowest, &highest, self->priv->result_outdir);
+      g_free (ref_path);
+    }
 
-    if (!gst_validate_ssim_compare_image_files (ssim, ref_path, frame->path,
-            &mssim, &lowest, &highest, self->priv->result_outdir))
+    if (!passed)
       nfailures++;
     else
       npassed++;
@@ -183,15 +314,25 @@ runner_stopping (GstValidateRunner * runner, ValidateSsimOverride * self)
     min_avg = MIN (min_avg, mssim);
     min_min = MIN (lowest, min_min);
     total_avg += mssim;
-    gst_validate_print_position (frame->position, GST_CLOCK_TIME_NONE, 1.0,
+    gst_validate_print_position_for_runner (runner, frame->position,
+        GST_CLOCK_TIME_NONE, 1.0,
         g_strdup_printf (" %d / %d avg: %f min: %f (Passed: %d failed: %d)",
             i + 1, nfiles, mssim, lowest, npassed, nfailures));
-    g_free (bname);
   }
 
   gst_validate_printf (NULL,
-      "\nAverage similarity: %f, min_avg: %f, min_min: %f\n",
-      total_avg / nfiles, min_avg, min_min);
+      "\nAverage similarity: %f, min_avg: %f, min_min: %f (%s mode)\n",
+      total_avg / nfiles, min_avg, min_min,
+      gst_validate_ssim_mode_to_string (gst_validate_ssim_get_mode (ssim)));
+
+  gst_validate_ssim_get_reference_cache_stats (ssim, &cache_hits,
+      &cache_misses);
+  gst_validate_printf (NULL,
+      "Reference frames cache: %" G_GUINT64_FORMAT " hits, %"
+      G_GUINT64_FORMAT " misses\n", cache_hits, cache_misses);
+  gst_validate_ssim_print_resolved_frames (ssim);
+
+  gst_object_unref (ssim);
 }
 
 static void
@@ -202,13 +343,19 @@ _runner_set (GObject * object, GParamSpec * pspec, gpointer user_data)
       gst_validate_reporter_get_runner (GST_VALIDATE_REPORTER (self));
 
   g_signal_connect (runner, "stopping", G_CALLBACK (runner_stopping), self);
+
+  if (self->priv->online && !self->priv->ssim &&
+      gst_structure_has_field (self->priv->config, "reference-images-dir"))
+    self->priv->ssim = _create_ssim (self, runner);
+
   gst_object_unref (runner);
 }
 
 static ValidateSsimOverride *
 validate_ssim_override_new (GstStructure * config)
 {
-  const gchar *format;
+  const gchar *format, *policy, *compression, *mode;
+  gint queue_depth;
   ValidateSsimOverride *self = g_object_new (VALIDATE_SSIM_OVERRIDE_TYPE, NULL);
 
   self->priv->outdir =
@@ -272,6 +419,47 @@ validate_ssim_override_new (GstStructure * config)
   gst_validate_utils_get_clocktime (config, "check-recurrence",
       &self->priv->recurrence);
 
+  if (gst_structure_get_int (config, "dump-queue-depth", &queue_depth))
+    self->priv->dump_queue_depth = MAX (queue_depth, 1);
+
+  gst_structure_get_boolean (config, "online-comparison",
+      &self->priv->online);
+
+  gst_structure_get_boolean (config, "output-frame-store",
+      &self->priv->use_frame_stores);
+  compression = gst_structure_get_string (config, "frame-store-compression");
+  if (!g_strcmp0 (compression, "deflate")) {
+    self->priv->store_compression =
+        GST_VALIDATE_FRAME_STORE_COMPRESSION_DEFLATE;
+  } else if (compression && g_strcmp0 (compression, "none")) {
+    GST_ERROR ("Unknown frame-store-compression: %s", compression);
+
+    gst_object_unref (self);
+
+    return NULL;
+  }
+
+  mode = gst_structure_get_string (config, "ssim-mode");
+  if (mode && !gst_validate_ssim_mode_from_string (mode,
+          &self->priv->ssim_mode)) {
+    GST_ERROR ("Unknown ssim-mode: %s", mode);
+
+    gst_object_unref (self);
+
+    return NULL;
+  }
+
+  policy = gst_structure_get_string (config, "dump-queue-policy");
+  if (!g_strcmp0 (policy, "drop")) {
+    self->priv->drop_frames = TRUE;
+  } else if (policy && g_strcmp0 (policy, "block")) {
+    GST_ERROR ("Unknown dump-queue-policy: %s", policy);
+
+    gst_object_unref (self);
+
+    return NULL;
+  }
+
   g_signal_connect (self, "notify::validate-runner", G_CALLBACK (_runner_set),
       NULL);
 
@@ -377,8 +565,16 @@ _finalize (GObject * object)
   const gchar *filename = NULL;
   GError *error = NULL;
 
-  if (priv->converter)
-    gst_video_converter_free (priv->converter);
+  /* Waits for the frames being saved */
+  g_thread_pool_free (priv->dump_pool, FALSE, TRUE);
+  g_slist_free_full (priv->idle_converters,
+      (GDestroyNotify) gst_video_converter_free);
+  g_hash_table_unref (priv->frame_names);
+  g_hash_table_unref (priv->frame_stores);
+  gst_clear_object (&priv->ssim);
+  g_mutex_clear (&priv->ssim_lock);
+  g_mutex_clear (&priv->dump_lock);
+  g_cond_clear (&priv->dump_cond);
 
   if (priv->last_caps)
     gst_caps_unref (priv->last_caps);
@@ -443,6 +639,13 @@ validate_ssim_override_class_init (ValidateSsimOverrideClass * klass)
           "The ValidateSSim plugin could not save PNG file",
           GST_VALIDATE_REPORT_LEVEL_CRITICAL));
 
+  gst_validate_issue_register (gst_validate_issue_new (SSIM_FRAME_DROPPED,
+          "The ValidateSSim plugin dropped a frame it should have saved",
+          "Saving frames could not keep up with the pipeline and the"
+          " 'dump-queue-policy' is 'drop'. Increase 'dump-queue-depth' or use"
+          " the 'block' policy to save all frames.",
+          GST_VALIDATE_REPORT_LEVEL_WARNING));
+
   gst_validate_issue_register (gst_validate_issue_new
       (NOT_ATTACHED,
           "The ssim override was never attached.",
@@ -458,6 +661,18 @@ validate_ssim_override_init (ValidateSsimOverride * self)
   self->priv->needs_reconfigure = TRUE;
   self->priv->frames = g_array_new (TRUE, TRUE, sizeof (Frame));
   g_array_set_clear_func (self->priv->frames, (GDestroyNotify) free_frame);
+
+  g_mutex_init (&self->priv->dump_lock);
+  g_mutex_init (&self->priv->ssim_lock);
+  g_cond_init (&self->priv->dump_cond);
+  g_queue_init (&self->priv->pending_dumps);
+  self->priv->dump_queue_depth = 2 * g_get_num_processors ();
+  self->priv->dump_pool = g_thread_pool_new ((GFunc) _dump_frame, self,
+      g_get_num_processors (), FALSE, NULL);
+  self->priv->frame_names =
+      g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+  self->priv->frame_stores = g_hash_table_new_full (NULL, NULL, NULL,
+      (GDestroyNotify) gst_validate_frame_store_free);
 }
 
 static gboolean
@@ -477,10 +692,15 @@ _set_videoconvert (ValidateSsimOverride * o,
 
   gst_video_info_init (&priv->in_info);
   gst_video_info_init (&priv->out_info);
-  if (priv->converter) {
-    gst_video_converter_free (priv->converter);
-    priv->converter = NULL;
-  }
+  priv->convert = FALSE;
+
+  /* Frames already queued keep converting with their own formats */
+  g_mutex_lock (&priv->dump_lock);
+  priv->converter_cookie++;
+  g_slist_free_full (priv->idle_converters,
+      (GDestroyNotify) gst_video_converter_free);
+  priv->idle_converters = NULL;
+  g_mutex_unlock (&priv->dump_lock);
 
   if (!gst_video_info_from_caps (&priv->in_info, priv->last_caps)) {
     GST_VALIDATE_REPORT (o, SSIM_WRONG_FORMAT,
@@ -509,8 +729,7 @@ _set_videoconvert (ValidateSsimOverride * o,
   priv->out_info.fps_d = priv->in_info.fps_d;
   priv->out_info.fps_n = priv->in_info.fps_n;
 
-  priv->converter = gst_video_converter_new (&priv->in_info,
-      &priv->out_info, NULL);
+  priv->convert = TRUE;
 
   return TRUE;
 
@@ -519,15 +738,7 @@ _set_videoconvert (ValidateSsimOverride * o,
 static gboolean
 has_frame (ValidateSsimOverride * self, gchar * name)
 {
-  guint i;
-  GArray *frames = self->priv->frames;
-
-  for (i = 0; i < frames->len; ++i) {
-    if (g_strcmp0 (g_array_index (frames, Frame, i).path, name) == 0)
-      return TRUE;
-  }
-
-  return FALSE;
+  return g_hash_table_contains (self->priv->frame_names, name);
 }
 
 
@@ -563,6 +774,7 @@ _get_filename (ValidateSsimOverride * self, GstValidatePadMonitor * monitor,
     outname = g_build_path (G_DIR_SEPARATOR_S, self->priv->outdir, s, NULL);
     g_free (s);
   }
+  g_hash_table_add (self->priv->frame_names, g_strdup (outname));
 
   return outname;
 }
@@ -631,13 +843,248 @@ _save_frame (ValidateSsimOverride * self, GstVideoFrame * frame,
   return res;
 }
 
+static GstVideoConverter *
+_acquire_converter (ValidateSsimOverride * self, DumpJob * job)
+{
+  ValidateSsimOverridePrivate *priv = self->priv;
+  GstVideoConverter *converter = NULL;
+
+  g_mutex_lock (&priv->dump_lock);
+  if (job->converter_cookie == priv->converter_cookie
+      && priv->idle_converters) {
+    converter = priv->idle_converters->data;
+    priv->idle_converters =
+        g_slist_delete_link (priv->idle_converters, priv->idle_converters);
+  }
+  g_mutex_unlock (&priv->dump_lock);
+
+  if (!converter)
+    converter = gst_video_converter_new (&job->in_info, &job->out_info, NULL);
+
+  return converter;
+}
+
+static void
+_release_converter (ValidateSsimOverride * self, DumpJob * job,
+    GstVideoConverter * converter)
+{
+  ValidateSsimOverridePrivate *priv = self->priv;
+
+  g_mutex_lock (&priv->dump_lock);
+  if (job->converter_cookie == priv->converter_cookie) {
+    priv->idle_converters = g_slist_prepend (priv->idle_converters, converter);
+    converter = NULL;
+  }
+  g_mutex_unlock (&priv->dump_lock);
+
+  if (converter)
+    gst_video_converter_free (converter);
+}
+
+/* Marks @job as done and adds all the frames kept in a row from the head of
+ * the pending queue to priv->frames, so they keep the order they were dumped
+ * in whichever order the thread pool finished them */
+static void
+_complete_dump (ValidateSsimOverride * self, DumpJob * job, gboolean keep)
+{
+  ValidateSsimOverridePrivate *priv = self->priv;
+
+  g_mutex_lock (&priv->dump_lock);
+  job->done = TRUE;
+  job->keep = keep;
+  while ((job = g_queue_peek_head (&priv->pending_dumps)) && job->done) {
+    g_queue_pop_head (&priv->pending_dumps);
+
+    if (job->keep)
+      g_array_append_val (priv->frames, job->frame);
+    else
+      free_frame (&job->frame);
+    g_free (job);
+  }
+  g_cond_broadcast (&priv->dump_cond);
+  g_mutex_unlock (&priv->dump_lock);
+}
+
+/* Saves the frame of @job in its own file or appends it to its store, in
+ * which case the frame path is replaced by the path of the frame in the
+ * store */
+static gboolean
+_write_frame (ValidateSsimOverride * self, DumpJob * job,
+    GstVideoFrame * frame)
+{
+  GError *error = NULL;
+  gint index;
+
+  if (!job->store)
+    return _save_frame (self, frame, job->frame.path);
+
+  index = gst_validate_frame_store_append (job->store, job->frame.position,
+      frame, &error);
+  if (index < 0) {
+    GST_VALIDATE_REPORT (self, SSIM_SAVING_ERROR,
+        "Could not save frame at %" GST_TIME_FORMAT ": %s",
+        GST_TIME_ARGS (job->frame.position), error->message);
+    g_error_free (error);
+
+    return FALSE;
+  }
+
+  g_free (job->frame.path);
+  job->frame.path = gst_validate_frame_store_get_frame_path
+      (gst_validate_frame_store_get_path (job->store), index);
+
+  return TRUE;
+}
+
+/* Runs in the dump thread pool */
+static void
+_dump_frame (DumpJob * job, ValidateSsimOverride * self)
+{
+  GstVideoFrame frame;
+  gboolean keep = FALSE;
+
+  if (job->convert) {
+    GstVideoFrame inframe;
+    GstVideoConverter *converter;
+    GstBuffer *outbuf;
+
+    if (!gst_video_frame_map (&inframe, &job->in_info, job->buffer,
+            GST_MAP_READ)) {
+      GST_VALIDATE_REPORT (self, SSIM_CONVERSION_ERROR,
+          "Could not map the videoframe %p", job->buffer);
+
+      goto done;
+    }
+
+    outbuf = gst_buffer_new_allocate (NULL, job->out_info.size, NULL);
+    if (!gst_video_frame_map (&frame, &job->out_info, outbuf, GST_MAP_WRITE)) {
+      GST_VALIDATE_REPORT (self, SSIM_CONVERSION_ERROR,
+          "Could not map the outbuffer %p", outbuf);
+
+      gst_video_frame_unmap (&inframe);
+      gst_buffer_unref (outbuf);
+      goto done;
+    }
+    gst_buffer_unref (outbuf);
+
+    converter = _acquire_converter (self, job);
+    gst_video_converter_frame (converter, &inframe, &frame);
+    _release_converter (self, job, converter);
+    gst_video_frame_unmap (&inframe);
+  } else {
+    if (!gst_video_frame_map (&frame, &job->in_info, job->buffer,
+            GST_MAP_READ)) {
+      GST_VALIDATE_REPORT (self, SSIM_CONVERSION_ERROR,
+          "Could not map the buffer %p", job->buffer);
+
+      goto done;
+    }
+  }
+
+  if (self->priv->ssim) {
+    gchar *ref_path = _get_ref_path (self, job->frame.width,
+        job->frame.height);
+    gfloat highest;
+
+    g_mutex_lock (&self->priv->ssim_lock);
+    job->frame.passed =
+        gst_validate_ssim_compare_frame_with_reference (self->priv->ssim,
+        ref_path, &frame, job->frame.position, job->frame.path,
+        &job->frame.mean, &job->frame.lowest, &highest,
+        self->priv->result_outdir);
+    g_mutex_unlock (&self->priv->ssim_lock);
+    g_free (ref_path);
+
+    /* Only failing frames are written, to be inspected */
+    job->frame.compared = TRUE;
+    keep = TRUE;
+    if (!job->frame.passed)
+      _write_frame (self, job, &frame);
+  } else {
+    keep = _write_frame (self, job, &frame);
+  }
+  gst_video_frame_unmap (&frame);
+
+done:
+  gst_buffer_unref (job->buffer);
+  job->buffer = NULL;
+  _complete_dump (self, job, keep);
+}
+
+/* Returns the store the frames of @pad_monitor are appended to, creating it
+ * the first time */
+static GstValidateFrameStore *
+_get_frame_store (ValidateSsimOverride * self,
+    GstValidatePadMonitor * pad_monitor)
+{
+  GstValidateFrameStore *store =
+      g_hash_table_lookup (self->priv->frame_stores, pad_monitor);
+  GstPad *pad;
+  gchar *name, *path;
+  GError *error = NULL;
+
+  if (store)
+    return store;
+
+  pad = GST_PAD (gst_validate_monitor_get_target (GST_VALIDATE_MONITOR
+          (pad_monitor)));
+  name = g_strdup_printf ("%s-%s" GST_VALIDATE_FRAME_STORE_EXTENSION,
+      GST_DEBUG_PAD_NAME (pad));
+  path = g_build_filename (self->priv->outdir, name, NULL);
+  gst_object_unref (pad);
+
+  store = gst_validate_frame_store_create (path,
+      self->priv->store_compression, &error);
+  if (store) {
+    g_hash_table_insert (self->priv->frame_stores, pad_monitor, store);
+  } else {
+    GST_VALIDATE_REPORT (self, SSIM_SAVING_ERROR, "%s", error->message);
+    g_error_free (error);
+  }
+
+  g_free (name);
+  g_free (path);
+
+  return store;
+}
+
+/* Number of upcoming frames whose reference is decoded ahead */
+#define N_PREFETCHED_FRAMES 2
+
+/* Starts decoding the references of the frames expected to be dumped after
+ * the one at @position */
+static void
+_prefetch_next_references (ValidateSsimOverride * self, GstBuffer * buffer,
+    GstClockTime position)
+{
+  ValidateSsimOverridePrivate *priv = self->priv;
+  GstClockTime step = GST_BUFFER_DURATION (buffer);
+  gchar *ref_path;
+  gint i;
+
+  if (!GST_CLOCK_TIME_IS_VALID (step) && priv->in_info.fps_n > 0)
+    step = gst_util_uint64_scale_int (GST_SECOND, priv->in_info.fps_d,
+        priv->in_info.fps_n);
+  if (GST_CLOCK_TIME_IS_VALID (priv->recurrence))
+    step = GST_CLOCK_TIME_IS_VALID (step) ?
+        MAX (step, priv->recurrence) : priv->recurrence;
+  if (!GST_CLOCK_TIME_IS_VALID (step) || step == 0 ||
+      !GST_CLOCK_TIME_IS_VALID (position))
+    return;
+
+  ref_path = _get_ref_path (self, priv->in_info.width, priv->in_info.height);
+  for (i = 1; i <= N_PREFETCHED_FRAMES; i++)
+    gst_validate_ssim_prefetch_reference (priv->ssim, ref_path,
+        position + i * step);
+  g_free (ref_path);
+}
+
 static void
 _handle_buffer (GstValidateOverride * override,
     GstValidatePadMonitor * pad_monitor, GstBuffer * buffer)
 {
-  gchar *outname = NULL;
-  GstVideoFrame frame;
-  Frame iframe;
+  DumpJob *job;
+  GstValidateFrameStore *store = NULL;
 
   ValidateSsimOverride *o = VALIDATE_SSIM_OVERRIDE (override);
   ValidateSsimOverridePrivate *priv = o->priv;
@@ -656,50 +1103,52 @@ _handle_buffer (GstValidateOverride * override,
 
   if (priv->needs_reconfigure) {
     priv->needs_reconfigure = !_set_videoconvert (o, pad_monitor);
+    if (priv->needs_reconfigure)
+      return;
   }
 
-  if (priv->converter) {
-    GstVideoFrame inframe;
-    GstBuffer *outbuf;
-
-    if (!gst_video_frame_map (&inframe, &priv->in_info, buffer, GST_MAP_READ)) {
-      GST_VALIDATE_REPORT (o, SSIM_CONVERSION_ERROR,
-          "Could not map the videoframe %p", buffer);
-
-      return;
-    }
+  if (priv->use_frame_stores && !(store = _get_frame_store (o, pad_monitor)))
+    return;
 
-    outbuf = gst_buffer_new_allocate (NULL, priv->out_info.size, NULL);
-    if (!gst_video_frame_map (&frame, &priv->out_info, outbuf, GST_MAP_WRITE)) {
-      GST_VALIDATE_REPORT (o, SSIM_CONVERSION_ERROR,
-          "Could not map the outbuffer %p", outbuf);
+  /* Before queueing the frame, so that the dump jobs find the references
+   * being decoded instead of decoding them again */
+  if (priv->ssim)
+    _prefetch_next_references (o, buffer, position);
+
+  /* Converting and saving the frame happens in the dump thread pool, only
+   * wait (or drop the frame) when too many frames are already queued */
+  g_mutex_lock (&priv->dump_lock);
+  while (g_queue_get_length (&priv->pending_dumps) >= priv->dump_queue_depth) {
+    if (priv->drop_frames) {
+      g_mutex_unlock (&priv->dump_lock);
+      GST_VALIDATE_REPORT (o, SSIM_FRAME_DROPPED,
+          "Dropped frame at %" GST_TIME_FORMAT ", %u frames are already"
+          " being saved", GST_TIME_ARGS (position), priv->dump_queue_depth);
 
-      gst_buffer_unref (outbuf);
-      return;
-    }
-    gst_buffer_unref (outbuf);
-    gst_video_converter_frame (priv->converter, &inframe, &frame);
-    gst_video_frame_unmap (&inframe);
-  } else {
-    if (!gst_video_frame_map (&frame, &priv->in_info, buffer, GST_MAP_WRITE)) {
-      GST_VALIDATE_REPORT (o, SSIM_CONVERSION_ERROR,
-          "Could not map the buffer %p", buffer);
       return;
     }
-  }
-
-  outname = _get_filename (o, pad_monitor, position);
-  if (_save_frame (o, &frame, outname)) {
-    priv->last_dump_position = position;
 
-    iframe.position = position;
-    iframe.path = outname;
-    iframe.width = priv->in_info.width;
-    iframe.height = priv->in_info.height;
-    g_array_append_val (priv->frames, iframe);
+    g_cond_wait (&priv->dump_cond, &priv->dump_lock);
   }
 
-  gst_video_frame_unmap (&frame);
+  job = g_new0 (DumpJob, 1);
+  /* Holding a reference makes downstream elements copy the buffer before
+   * modifying it */
+  job->buffer = gst_buffer_ref (buffer);
+  job->in_info = priv->in_info;
+  job->out_info = priv->out_info;
+  job->convert = priv->convert;
+  job->converter_cookie = priv->converter_cookie;
+  job->store = store;
+  job->frame.path = _get_filename (o, pad_monitor, position);
+  job->frame.position = position;
+  job->frame.width = priv->in_info.width;
+  job->frame.height = priv->in_info.height;
+  g_queue_push_tail (&priv->pending_dumps, job);
+  g_mutex_unlock (&priv->dump_lock);
+
+  priv->last_dump_position = position;
+  g_thread_pool_push (priv->dump_pool, job, NULL);
 }
 
 static void
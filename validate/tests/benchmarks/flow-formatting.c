@@ -0,0 +1,125 @@
+/* GStreamer
+ *
+ * flow-formatting.c: Measures how many buffers and events validateflow
+ * can format per second.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <gst/gst.h>
+#include "../../gst/validate/flow/formatting.h"
+
+#define N_BUFFERS 1000000
+#define N_CHECKSUMMED_BUFFERS 100000
+#define N_EVENTS 100000
+
+static void
+print_result (const gchar * what, guint n, GstClockTime start)
+{
+  GstClockTime elapsed = gst_util_get_timestamp () - start;
+
+  g_print ("%-24s %8u in %" GST_TIME_FORMAT " (%.0f/s)\n", what, n,
+      GST_TIME_ARGS (elapsed), (gdouble) n * GST_SECOND / MAX (elapsed, 1));
+}
+
+static void
+bench_buffers (const gchar * what, gint checksum_type, guint fields, guint n)
+{
+  GString *line = g_string_sized_new (256);
+  GstBuffer *buffer = gst_buffer_new_allocate (NULL, 4096, NULL);
+  ValidateFlowContentIds *content_ids = validate_flow_content_ids_new ();
+  GstClockTime start;
+  guint i;
+
+  gst_buffer_memset (buffer, 0, 0x42, 4096);
+  GST_BUFFER_FLAG_SET (buffer, GST_BUFFER_FLAG_DISCONT);
+  GST_BUFFER_DURATION (buffer) = GST_SECOND / 1000;
+
+  start = gst_util_get_timestamp ();
+  for (i = 0; i < n; i++) {
+    GST_BUFFER_PTS (buffer) = GST_BUFFER_DTS (buffer) = i * GST_SECOND / 1000;
+    g_string_assign (line, "buffer: ");
+    gst_buffer_memset (buffer, 0, i % 256, 1);
+    validate_flow_format_buffer (line, buffer, checksum_type, fields,
+        content_ids);
+  }
+  print_result (what, n, start);
+
+  validate_flow_content_ids_free (content_ids);
+  gst_buffer_unref (buffer);
+  g_string_free (line, TRUE);
+}
+
+static void
+bench_events (GHashTable * ignored_fields)
+{
+  GString *line = g_string_sized_new (256);
+  GstSegment segment;
+  GstEvent *events[4];
+  GstClockTime start;
+  guint i;
+
+  gst_segment_init (&segment, GST_FORMAT_TIME);
+  events[0] = gst_event_new_stream_start ("benchmark-stream");
+  events[1] = gst_event_new_caps (gst_caps_from_string
+      ("audio/x-raw, format=S16LE, rate=48000, channels=2,"
+          " layout=interleaved"));
+  events[2] = gst_event_new_segment (&segment);
+  events[3] = gst_event_new_flush_stop (TRUE);
+
+  start = gst_util_get_timestamp ();
+  for (i = 0; i < N_EVENTS; i++) {
+    g_string_assign (line, "event ");
+    validate_flow_format_event (line, events[i % G_N_ELEMENTS (events)],
+        NULL, NULL, ignored_fields, NULL, NULL);
+  }
+  print_result ("events", N_EVENTS, start);
+
+  for (i = 0; i < G_N_ELEMENTS (events); i++)
+    gst_event_unref (events[i]);
+  g_string_free (line, TRUE);
+}
+
+int
+main (int argc, char **argv)
+{
+  GstStructure *ignored;
+  GHashTable *ignored_fields;
+  guint fields;
+
+  gst_init (&argc, &argv);
+
+  /* Same defaults as a validateflow override without any field config */
+  ignored = gst_structure_new_from_string ("ignored,stream-start={stream-id}");
+  ignored_fields = validate_flow_event_fields_table_new (ignored);
+  fields = validate_flow_buffer_fields_from_structs (NULL, ignored);
+
+  bench_buffers ("buffers", CHECKSUM_TYPE_NONE, fields, N_BUFFERS);
+  bench_buffers ("buffers (sha1)", G_CHECKSUM_SHA1, fields,
+      N_CHECKSUMMED_BUFFERS);
+  bench_buffers ("buffers (as-id)", CHECKSUM_TYPE_AS_ID, fields,
+      N_CHECKSUMMED_BUFFERS);
+  bench_events (ignored_fields);
+
+  g_hash_table_unref (ignored_fields);
+  gst_structure_free (ignored);
+
+  return 0;
+}
@@ -0,0 +1,165 @@
+/* GStreamer
+ *
+ * variables-substitution.c: Compares the substitution of variables in
+ * strings with the regex based implementation it replaced.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+#include <gst/gst.h>
+#include <gst/validate/validate.h>
+#include <gst/validate/gst-validate-utils.h>
+
+#define N_VARIABLES 20
+#define N_ITERATIONS 10000
+#define N_LONG_ITERATIONS 200
+
+/* The previous implementation, restarting from the beginning of the string
+ * and compiling a regex for each variable it replaces */
+static gchar *
+regex_replace_variables_in_string (GstStructure * local_vars,
+    const gchar * in_string)
+{
+  static GRegex *variables_regex = NULL;
+  GMatchInfo *match_info = NULL;
+  gchar *tmpstring, *string = g_strdup (in_string);
+
+  if (!variables_regex)
+    variables_regex = g_regex_new ("\\$\\((\\w+)\\)", 0, 0, NULL);
+
+  while (g_regex_match (variables_regex, string, 0, &match_info)) {
+    GRegex *replace_regex;
+    gchar *tmp, *var_value, *varname = g_match_info_fetch (match_info, 1);
+    const GValue *val = gst_structure_get_value (local_vars, varname);
+
+    if (!val) {
+      g_free (varname);
+      g_free (string);
+      g_match_info_free (match_info);
+
+      return NULL;
+    }
+
+    if (G_VALUE_HOLDS_STRING (val))
+      var_value = g_value_dup_string (val);
+    else if (G_VALUE_TYPE (val) == G_TYPE_DOUBLE)
+      var_value = g_strdup (varname);
+    else
+      var_value = gst_value_serialize (val);
+
+    tmp = g_strdup_printf ("\\$\\(%s\\)", varname);
+    replace_regex = g_regex_new (tmp, 0, 0, NULL);
+    g_free (tmp);
+    tmpstring = string;
+    string = g_regex_replace_literal (replace_regex, string, -1, 0, var_value,
+        0, NULL);
+
+    g_free (tmpstring);
+    g_free (var_value);
+    g_free (varname);
+    g_regex_unref (replace_regex);
+    g_clear_pointer (&match_info, g_match_info_free);
+  }
+  g_clear_pointer (&match_info, g_match_info_free);
+
+  return string;
+}
+
+static void
+print_result (const gchar * what, guint n, GstClockTime start)
+{
+  GstClockTime elapsed = gst_util_get_timestamp () - start;
+
+  g_print ("%-32s %8u in %" GST_TIME_FORMAT " (%.0f/s)\n", what, n,
+      GST_TIME_ARGS (elapsed), (gdouble) n * GST_SECOND / MAX (elapsed, 1));
+}
+
+static void
+bench (const gchar * what, GstStructure * vars, const gchar * string, guint n)
+{
+  gchar *expected, *res, *name;
+  GstClockTime start;
+  guint i;
+
+  expected = regex_replace_variables_in_string (vars, string);
+  res = gst_validate_replace_variables_in_string (NULL, vars, string);
+  if (g_strcmp0 (expected, res))
+    g_error ("%s: got `%s` instead of `%s`", what, res, expected);
+  g_free (expected);
+  g_free (res);
+
+  name = g_strdup_printf ("%s (regex)", what);
+  start = gst_util_get_timestamp ();
+  for (i = 0; i < n; i++)
+    g_free (regex_replace_variables_in_string (vars, string));
+  print_result (name, n, start);
+  g_free (name);
+
+  name = g_strdup_printf ("%s (single pass)", what);
+  start = gst_util_get_timestamp ();
+  for (i = 0; i < n; i++)
+    g_free (gst_validate_replace_variables_in_string (NULL, vars, string));
+  print_result (name, n, start);
+  g_free (name);
+}
+
+int
+main (int argc, char **argv)
+{
+  GstStructure *vars;
+  GString *many, *long_string;
+  guint i;
+
+  gst_init (&argc, &argv);
+  gst_validate_init ();
+
+  vars = gst_structure_new ("vars", "position", G_TYPE_DOUBLE, 1.0, NULL);
+  many = g_string_new (NULL);
+  for (i = 0; i < N_VARIABLES; i++) {
+    gchar *varname = g_strdup_printf ("var%u", i);
+    gchar *value = g_strdup_printf ("value-%u", i);
+
+    gst_structure_set (vars, varname, G_TYPE_STRING, value, NULL);
+    g_string_append_printf (many, "$(%s)/", varname);
+    g_free (varname);
+    g_free (value);
+  }
+
+  long_string = g_string_new (NULL);
+  for (i = 0; i < 50; i++)
+    g_string_append_printf (long_string,
+        "set-property, target-element-name=element%u, property-name=uri,"
+        " property-value=\"file://$(var%u)/$(var%u).mkv\" ", i,
+        i % N_VARIABLES, (i + 1) % N_VARIABLES);
+
+  bench ("no variable", vars, "seek, start=10.0, flags=accurate+flush",
+      N_ITERATIONS);
+  bench ("one variable", vars, "$(position) + 5.0", N_ITERATIONS);
+  bench ("many variables", vars, many->str, N_ITERATIONS);
+  bench ("long string", vars, long_string->str, N_LONG_ITERATIONS);
+
+  g_string_free (many, TRUE);
+  g_string_free (long_string, TRUE);
+  gst_structure_free (vars);
+  gst_validate_deinit ();
+
+  return 0;
+}
@@ -0,0 +1,134 @@
+/* GstValidate
+ *
+ * batch.c: Checks running several tests in a single gst-validate process.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <string.h>
+#include <sys/wait.h>
+#include <glib/gstdio.h>
+#include <gst/check/gstcheck.h>
+
+static const gchar *batch_tests =
+    "test, name=first, pipeline=\"fakesrc num-buffers=10 ! fakesink\"\n"
+    "test, name=error, pipeline=\"fakesrc num-buffers=10"
+    " ! identity error-after=5 ! fakesink\"\n"
+    "test, name=missing, pipeline=\"validatenonexistingelement ! fakesink\"\n"
+    "test, name=second, pipeline=\"fakesrc num-buffers=10 ! fakesink\"\n";
+
+/* Runs gst-validate on a batch file made of @tests, with the environment
+ * variable @env_var set to @env_value if any. Returns its exit code, with
+ * its output in @output */
+static gint
+run_batch (const gchar * tests, const gchar * jobs, const gchar * env_var,
+    const gchar * env_value, gchar ** output)
+{
+  gchar *dir = g_dir_make_tmp ("validatebatch-XXXXXX", NULL);
+  gchar *path = g_build_filename (dir, "tests.batch", NULL);
+  gchar *argv[] = { (gchar *) GST_VALIDATE_TOOL, (gchar *) "--batch", path,
+    (gchar *) "--batch-jobs", (gchar *) jobs, NULL
+  };
+  gchar **envp = g_get_environ ();
+  GError *err = NULL;
+  gint status;
+
+  fail_unless (g_file_set_contents (path, tests, -1, NULL));
+  envp = g_environ_unsetenv (envp, "GST_VALIDATE_SCENARIO");
+  envp = g_environ_unsetenv (envp, "GST_VALIDATE_CONFIG");
+  if (env_var)
+    envp = g_environ_setenv (envp, env_var, env_value, TRUE);
+
+  fail_unless (g_spawn_sync (NULL, argv, envp, G_SPAWN_STDERR_TO_DEV_NULL,
+          NULL, NULL, output, NULL, &status, &err), "Could not run %s: %s",
+      GST_VALIDATE_TOOL, err ? err->message : "");
+  fail_unless (WIFEXITED (status));
+
+  g_remove (path);
+  g_rmdir (dir);
+  g_strfreev (envp);
+  g_free (path);
+  g_free (dir);
+
+  return WEXITSTATUS (status);
+}
+
+static void
+check_contains (const gchar * output, const gchar * str)
+{
+  fail_unless (strstr (output, str) != NULL, "'%s' not found in: %s", str,
+      output);
+}
+
+GST_START_TEST (test_batch_results)
+{
+  gchar *output = NULL;
+
+  /* A single failing test fails the batch */
+  fail_unless_equals_int (run_batch (batch_tests, "2", NULL, NULL, &output),
+      1);
+
+  check_contains (output, "Test first PASSED (Return value: 0)");
+  check_contains (output, "Test second PASSED (Return value: 0)");
+  check_contains (output, "Test error FAILED");
+  check_contains (output, "Test missing SKIPPED");
+  check_contains (output, "4 tests: 2 passed, 1 failed, 1 skipped");
+  g_free (output);
+
+  fail_unless_equals_int (run_batch ("test, name=first,"
+          " pipeline=\"fakesrc num-buffers=10 ! fakesink\"\n", "2", NULL, NULL,
+          &output), 0);
+  check_contains (output, "1 tests: 1 passed, 0 failed, 0 skipped");
+  g_free (output);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_batch_overrides)
+{
+  gchar *dir = g_dir_make_tmp ("validatebatch-XXXXXX", NULL);
+  gchar *config = g_strdup_printf ("validateflow, pad=fakesink0:sink,"
+      " expectations-dir=\"%s\", actual-results-dir=\"%s\"", dir, dir);
+  gchar *output = NULL;
+
+  /* Reports of overrides shared by tests running at once could not be told
+   * apart */
+  fail_unless_equals_int (run_batch (batch_tests, "2", "GST_VALIDATE_CONFIG",
+          config, &output), 1);
+  fail_if (strstr (output, "Test first"), "Tests were run: %s", output);
+  g_free (output);
+
+  g_rmdir (dir);
+  g_free (config);
+  g_free (dir);
+}
+
+GST_END_TEST;
+
+static Suite *
+gst_validate_suite (void)
+{
+  Suite *s = suite_create ("batch");
+  TCase *tc_chain = tcase_create ("batch");
+  suite_add_tcase (s, tc_chain);
+
+  tcase_add_test (tc_chain, test_batch_results);
+  tcase_add_test (tc_chain, test_batch_overrides);
+
+  return s;
+}
+
+GST_CHECK_MAIN (gst_validate);
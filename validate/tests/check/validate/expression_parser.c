@@ -29,6 +29,51 @@ GST_START_TEST (test_expression_parser)
 
 GST_END_TEST;
 
+static int
+get_structure_var (const gchar * name, double *value, gpointer udata)
+{
+  return gst_structure_get_double ((GstStructure *) udata, name, value);
+}
+
+GST_START_TEST (test_compiled_expression)
+{
+  gchar *error = NULL;
+  GstStructure *vars = gst_structure_new ("vars",
+      "position", G_TYPE_DOUBLE, 2.0, "duration", G_TYPE_DOUBLE, 1.0, NULL);
+  GstValidateExpression *expression =
+      gst_validate_utils_compile_expression
+      ("min(10, (duration - 0.5) / 0.5) + position * (2 ^ 2)", &error);
+
+  fail_unless (expression);
+  fail_if (error);
+
+  fail_unless_equals_float (gst_validate_expression_evaluate (expression,
+          get_structure_var, vars, &error), 9);
+  fail_if (error);
+
+  /* Variables are bound again at each evaluation */
+  gst_structure_set (vars, "position", G_TYPE_DOUBLE, 10.0, "duration",
+      G_TYPE_DOUBLE, 20.0, NULL);
+  fail_unless_equals_float (gst_validate_expression_evaluate (expression,
+          get_structure_var, vars, &error), 50);
+  fail_if (error);
+
+  gst_structure_remove_field (vars, "duration");
+  fail_unless_equals_float (gst_validate_expression_evaluate (expression,
+          get_structure_var, vars, &error), -1.0);
+  fail_unless (error);
+  g_clear_pointer (&error, g_free);
+
+  gst_validate_expression_unref (expression);
+  gst_structure_free (vars);
+
+  fail_if (gst_validate_utils_compile_expression ("10 / (2", &error));
+  fail_unless (error);
+  g_free (error);
+}
+
+GST_END_TEST;
+
 static Suite *
 gst_validate_suite (void)
 {
@@ -43,6 +88,7 @@ gst_validate_suite (void)
   g_setenv ("GST_VALIDATE_REPORTING_DETAILS", "all", TRUE);
   gst_validate_init ();
   tcase_add_test (tc_chain, test_expression_parser);
+  tcase_add_test (tc_chain, test_compiled_expression);
   gst_validate_deinit ();
 
   return s;
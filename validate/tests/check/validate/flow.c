@@ -0,0 +1,423 @@
+/* GstValidate
+ *
+ * flow.c: Checks the logs written by validateflow.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <glib/gstdio.h>
+#include <gio/gio.h>
+#include <gst/validate/validate.h>
+#include <gst/check/gstcheck.h>
+#include "../../../gst/validate/flow/formatting.h"
+#include "../../../gst/validate/flow/diff.h"
+
+#define N_BUFFERS 30
+
+/* Runs @pipeline_desc until EOS in a child process, as validateflow reads
+ * its configuration when GstValidate is initialized. The output of the
+ * child goes to @output_path if set. Returns the exit code of
+ * gst_validate_runner_exit(), 18 when critical issues were reported */
+static gint
+run_flow_pipeline (const gchar * dir, const gchar * configs,
+    const gchar * pipeline_desc, const gchar * output_path)
+{
+  gchar *config_path = g_build_filename (dir, "flow.config", NULL);
+  gint status;
+  pid_t pid;
+
+  fail_unless (g_file_set_contents (config_path, configs, -1, NULL));
+
+  fflush (stdout);
+  fflush (stderr);
+  pid = fork ();
+  fail_unless (pid >= 0);
+  if (pid == 0) {
+    GstValidateRunner *runner;
+    GstValidateMonitor *monitor;
+    GstElement *pipeline;
+    GstMessage *message;
+    GstBus *bus;
+    gint ret = 1;
+
+    if (output_path) {
+      gint fd = open (output_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+
+      if (fd < 0)
+        _exit (1);
+      dup2 (fd, STDOUT_FILENO);
+      dup2 (fd, STDERR_FILENO);
+      close (fd);
+    }
+
+    g_setenv ("GST_VALIDATE_CONFIG", config_path, TRUE);
+    gst_validate_init ();
+
+    runner = gst_validate_runner_new ();
+    pipeline = gst_parse_launch (pipeline_desc, NULL);
+    if (!pipeline)
+      _exit (1);
+    monitor = gst_validate_monitor_factory_create (GST_OBJECT (pipeline),
+        runner, NULL);
+
+    bus = gst_element_get_bus (pipeline);
+    gst_element_set_state (pipeline, GST_STATE_PLAYING);
+    message = gst_bus_timed_pop_filtered (bus, GST_CLOCK_TIME_NONE,
+        GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+    gst_element_set_state (pipeline, GST_STATE_NULL);
+
+    if (GST_MESSAGE_TYPE (message) == GST_MESSAGE_EOS)
+      ret = gst_validate_runner_exit (runner, FALSE);
+
+    gst_message_unref (message);
+    gst_object_unref (bus);
+    gst_object_unref (monitor);
+    gst_object_unref (pipeline);
+    fflush (stdout);
+    fflush (stderr);
+    _exit (ret);
+  }
+
+  fail_unless (waitpid (pid, &status, 0) == pid);
+  fail_unless (WIFEXITED (status));
+
+  g_remove (config_path);
+  g_free (config_path);
+
+  return WEXITSTATUS (status);
+}
+
+static gchar *
+get_log (const gchar * dir, const gchar * name)
+{
+  gchar *path = g_build_filename (dir, name, NULL);
+  gchar *contents;
+
+  fail_unless (g_file_get_contents (path, &contents, NULL, NULL),
+      "Could not read %s", path);
+  g_free (path);
+
+  return contents;
+}
+
+static gchar *
+get_gzip_log (const gchar * dir, const gchar * name)
+{
+  gchar *path = g_build_filename (dir, name, NULL);
+  GFile *file = g_file_new_for_path (path);
+  GInputStream *stream = G_INPUT_STREAM (g_file_read (file, NULL, NULL));
+  GConverter *decompressor =
+      G_CONVERTER (g_zlib_decompressor_new (G_ZLIB_COMPRESSOR_FORMAT_GZIP));
+  GInputStream *decompressed;
+  GOutputStream *output = g_memory_output_stream_new_resizable ();
+  gchar *contents;
+
+  fail_unless (stream != NULL, "Could not read %s", path);
+  decompressed = g_converter_input_stream_new (stream, decompressor);
+  fail_unless (g_output_stream_splice (output, decompressed,
+          G_OUTPUT_STREAM_SPLICE_CLOSE_SOURCE, NULL, NULL) >= 0,
+      "Could not decompress %s", path);
+  fail_unless (g_output_stream_write_all (output, "", 1, NULL, NULL, NULL));
+  fail_unless (g_output_stream_close (output, NULL, NULL));
+  contents =
+      g_memory_output_stream_steal_data (G_MEMORY_OUTPUT_STREAM (output));
+
+  g_object_unref (output);
+  g_object_unref (decompressed);
+  g_object_unref (decompressor);
+  g_object_unref (stream);
+  g_object_unref (file);
+  g_free (path);
+
+  return contents;
+}
+
+static void
+remove_dir (gchar * dir)
+{
+  GDir *d = g_dir_open (dir, 0, NULL);
+  const gchar *name;
+
+  while ((name = g_dir_read_name (d))) {
+    gchar *path = g_build_filename (dir, name, NULL);
+
+    g_remove (path);
+    g_free (path);
+  }
+  g_dir_close (d);
+  g_rmdir (dir);
+  g_free (dir);
+}
+
+static guint
+count_lines (const gchar * log, const gchar * prefix)
+{
+  gchar **lines = g_strsplit (log, "\n", -1);
+  guint i, n = 0;
+
+  for (i = 0; lines[i]; i++) {
+    if (g_str_has_prefix (lines[i], prefix))
+      n++;
+  }
+  g_strfreev (lines);
+
+  return n;
+}
+
+GST_START_TEST (test_checksum_threads)
+{
+  gchar *dir = g_dir_make_tmp ("validateflow-XXXXXX", NULL);
+  gchar *configs = g_strdup_printf (
+      "validateflow, pad=inline:sink, buffers-checksum=true,"
+      " checksum-threads=0, expectations-dir=\"%s\"\n"
+      "validateflow, pad=pool:sink, buffers-checksum=true,"
+      " checksum-threads=4, expectations-dir=\"%s\"\n"
+      "validateflow, pad=bounded:sink, buffers-checksum=true,"
+      " checksum-threads=4, checksum-max-pending-bytes=1,"
+      " expectations-dir=\"%s\"\n", dir, dir, dir);
+  gchar *inline_log, *pool_log, *bounded_log;
+
+  fail_unless_equals_int (run_flow_pipeline (dir, configs,
+          "videotestsrc num-buffers=" G_STRINGIFY (N_BUFFERS)
+          " pattern=ball animation-mode=frames"
+          " ! video/x-raw,width=320,height=240 ! tee name=t"
+          " t. ! queue ! fakesink name=inline"
+          " t. ! queue ! fakesink name=pool"
+          " t. ! queue ! fakesink name=bounded", NULL), 0);
+
+  /* Lines checksummed on the thread pool come out in stream order, and
+   * all of them were written before the logs got closed */
+  inline_log = get_log (dir, "log-inline-sink-expected");
+  pool_log = get_log (dir, "log-pool-sink-expected");
+  bounded_log = get_log (dir, "log-bounded-sink-expected");
+  fail_unless_equals_int (count_lines (inline_log, "buffer: checksum="),
+      N_BUFFERS);
+  fail_unless (g_str_has_suffix (inline_log, "event eos: (no structure)\n"));
+  fail_unless_equals_string (pool_log, inline_log);
+  fail_unless_equals_string (bounded_log, inline_log);
+
+  g_free (inline_log);
+  g_free (pool_log);
+  g_free (bounded_log);
+  g_free (configs);
+  remove_dir (dir);
+}
+
+GST_END_TEST;
+
+#define GZIP_PIPELINE "videotestsrc num-buffers=" G_STRINGIFY (N_BUFFERS) \
+    " pattern=ball animation-mode=frames ! tee name=t" \
+    " t. ! queue ! fakesink name=plain t. ! queue ! fakesink name=gzip"
+
+GST_START_TEST (test_gzip_logs)
+{
+  gchar *dir = g_dir_make_tmp ("validateflow-XXXXXX", NULL);
+  gchar *configs = g_strdup_printf (
+      "validateflow, pad=plain:sink, buffers-checksum=true,"
+      " expectations-dir=\"%s\", actual-results-dir=\"%s\"\n"
+      "validateflow, pad=gzip:sink, buffers-checksum=true, compress=gzip,"
+      " expectations-dir=\"%s\", actual-results-dir=\"%s\"\n",
+      dir, dir, dir, dir);
+  gchar *plain_log, *gzip_log, *raw_gzip_log, *path;
+
+  /* Writing the expectations */
+  fail_unless_equals_int (run_flow_pipeline (dir, configs, GZIP_PIPELINE,
+          NULL), 0);
+
+  plain_log = get_log (dir, "log-plain-sink-expected");
+  raw_gzip_log = get_log (dir, "log-gzip-sink-expected.gz");
+  fail_unless (raw_gzip_log[0] == '\x1f' && raw_gzip_log[1] == '\x8b');
+  gzip_log = get_gzip_log (dir, "log-gzip-sink-expected.gz");
+  fail_unless_equals_int (count_lines (plain_log, "buffer: checksum="),
+      N_BUFFERS);
+  fail_unless_equals_string (gzip_log, plain_log);
+  path = g_build_filename (dir, "log-gzip-sink-expected", NULL);
+  fail_if (g_file_test (path, G_FILE_TEST_EXISTS));
+  g_free (path);
+  g_free (gzip_log);
+  g_free (raw_gzip_log);
+  g_free (configs);
+
+  /* Without `compress`, the gzip expectations are found and the actual
+   * results compressed the same way before being compared */
+  configs = g_strdup_printf (
+      "validateflow, pad=plain:sink, buffers-checksum=true,"
+      " expectations-dir=\"%s\", actual-results-dir=\"%s\"\n"
+      "validateflow, pad=gzip:sink, buffers-checksum=true,"
+      " expectations-dir=\"%s\", actual-results-dir=\"%s\"\n",
+      dir, dir, dir, dir);
+  fail_unless_equals_int (run_flow_pipeline (dir, configs, GZIP_PIPELINE,
+          NULL), 0);
+
+  gzip_log = get_gzip_log (dir, "log-gzip-sink-actual.gz");
+  fail_unless_equals_string (gzip_log, plain_log);
+
+  g_free (gzip_log);
+  g_free (plain_log);
+  g_free (configs);
+  remove_dir (dir);
+}
+
+GST_END_TEST;
+
+static gint
+get_content_id (ValidateFlowContentIds * content_ids, const gchar * data)
+{
+  GstBuffer *buffer = gst_buffer_new_wrapped (g_strdup (data), strlen (data));
+  gchar *digest = validate_flow_buffer_checksum (buffer, CHECKSUM_TYPE_AS_ID);
+  gint id = validate_flow_content_ids_get (content_ids, (guint8 *) digest);
+
+  g_free (digest);
+  gst_buffer_unref (buffer);
+
+  return id;
+}
+
+GST_START_TEST (test_content_ids)
+{
+  ValidateFlowContentIds *content_ids = validate_flow_content_ids_new ();
+  gint first = get_content_id (content_ids, "first");
+  gint second = get_content_id (content_ids, "second");
+  guint i, pass;
+
+  fail_unless (first != second);
+  fail_unless_equals_int (get_content_id (content_ids, "first"), first);
+  fail_unless_equals_int (get_content_id (content_ids, "second"), second);
+
+  /* Ids follow the order in which contents are first seen, whatever the
+   * shard their digest falls in */
+  for (pass = 0; pass < 2; pass++) {
+    for (i = 0; i < 100; i++) {
+      gchar *data = g_strdup_printf ("content %u", i);
+
+      fail_unless_equals_int (get_content_id (content_ids, data),
+          second + 1 + i);
+      g_free (data);
+    }
+  }
+
+  validate_flow_content_ids_free (content_ids);
+}
+
+GST_END_TEST;
+
+static void
+check_diff (gchar ** expected, gchar ** actual, guint context,
+    gsize max_size, const gchar * result)
+{
+  GString *diff = g_string_new (NULL);
+
+  validate_flow_diff (diff, "expected", "actual", expected,
+      g_strv_length (expected), actual, g_strv_length (actual), 1, context,
+      max_size, FALSE);
+  fail_unless_equals_string (diff->str, result);
+  g_string_free (diff, TRUE);
+}
+
+GST_START_TEST (test_diff)
+{
+  gchar *lines[] = { "line 0", "line 1", "line 2", "line 3", "line 4",
+    "line 5", "line 6", "line 7", "line 8", "line 9", NULL
+  };
+  gchar *changed[] = { "line 0", "line 1", "line 2", "line 3", "line 4",
+    "changed", "line 6", "line 7", "line 8", "line 9", NULL
+  };
+  gchar *two_changes[] = { "changed", "line 1", "line 2", "line 3",
+    "line 4", "line 5", "line 6", "line 7", "line 8", "line 9", "added", NULL
+  };
+
+  check_diff (lines, lines, 3, 1024, "--- expected\n+++ actual\n");
+
+  check_diff (lines, changed, 3, 1024,
+      "--- expected\n+++ actual\n"
+      "@@ -3,7 +3,7 @@\n"
+      " line 2\n line 3\n line 4\n-line 5\n+changed\n line 6\n line 7\n"
+      " line 8\n");
+
+  /* Changes further apart than twice the context get their own hunk */
+  check_diff (lines, two_changes, 1, 1024,
+      "--- expected\n+++ actual\n"
+      "@@ -1,2 +1,2 @@\n-line 0\n+changed\n line 1\n"
+      "@@ -10,1 +10,2 @@\n line 9\n+added\n");
+
+  check_diff (lines, two_changes, 1, 16,
+      "--- expected\n+++ actual\n"
+      "@@ -1,2 +1,2 @@\n[... diff truncated ...]\n");
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_mismatch_diff)
+{
+  gchar *dir = g_dir_make_tmp ("validateflow-XXXXXX", NULL);
+  gchar *output_path = g_build_filename (dir, "output", NULL);
+  gchar *configs = g_strdup_printf ("validateflow, pad=sink:sink,"
+      " buffers-checksum=true, expectations-dir=\"%s\","
+      " actual-results-dir=\"%s\"\n", dir, dir);
+  gchar *output;
+
+  fail_unless_equals_int (run_flow_pipeline (dir, configs,
+          "fakesrc num-buffers=10 sizetype=fixed filltype=zero"
+          " ! fakesink name=sink", NULL), 0);
+
+  /* The actual results go on for much longer than the window compared
+   * after the first mismatch */
+  fail_unless_equals_int (run_flow_pipeline (dir, configs,
+          "fakesrc num-buffers=2000 sizetype=fixed filltype=zero"
+          " ! fakesink name=sink", output_path), 18);
+
+  output = get_log (dir, "output");
+  fail_unless (strstr (output, "--- ") && strstr (output, "+++ "), "%s",
+      output);
+  fail_unless (strstr (output, "@@ -") != NULL, "%s", output);
+  fail_unless (strstr (output, "-event eos: (no structure)\n") != NULL, "%s",
+      output);
+  fail_unless (strstr (output, "+buffer: checksum=") != NULL, "%s", output);
+  fail_unless (strstr (output, "[... only the first 1024 lines after the "
+          "mismatch were compared ...]") != NULL, "%s", output);
+  fail_if (strstr (output, "OK\n") != NULL, "%s", output);
+
+  g_free (output);
+  g_free (output_path);
+  g_free (configs);
+  remove_dir (dir);
+}
+
+GST_END_TEST;
+
+static Suite *
+gst_validate_suite (void)
+{
+  Suite *s = suite_create ("flow");
+  TCase *tc_chain = tcase_create ("flow");
+  suite_add_tcase (s, tc_chain);
+
+  /* GstValidate gets initialized by each test, with its own validateflow
+   * configuration */
+  tcase_add_test (tc_chain, test_checksum_threads);
+  tcase_add_test (tc_chain, test_content_ids);
+  tcase_add_test (tc_chain, test_gzip_logs);
+  tcase_add_test (tc_chain, test_diff);
+  tcase_add_test (tc_chain, test_mismatch_diff);
+
+  return s;
+}
+
+GST_CHECK_MAIN (gst_validate);
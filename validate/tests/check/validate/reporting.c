@@ -250,6 +250,42 @@ TEST_LEVELS (issue_type, "event::flush-stop-unexpected:none", 0);
 
 #undef TEST_LEVELS
 
+GST_START_TEST (test_runners_for_tests)
+{
+  GError *error = NULL;
+  GstElement *pipeline1, *pipeline2;
+  GstValidateMonitor *monitor1, *monitor2;
+  GstValidateRunner *runner1, *runner2;
+
+  runner1 = gst_validate_runner_new_for_test (NULL);
+  pipeline1 = gst_parse_launch ("fakesrc ! fakesink", &error);
+  fail_unless (pipeline1 != NULL);
+  monitor1 = gst_validate_monitor_factory_create (GST_OBJECT (pipeline1),
+      runner1, NULL);
+
+  /* Pipelines of previous tests have already been created */
+  runner2 = gst_validate_runner_new_for_test (NULL);
+  fail_unless (runner2 != NULL);
+  fail_unless (runner2 != runner1);
+  pipeline2 = gst_parse_launch ("fakesrc ! fakesink", &error);
+  fail_unless (pipeline2 != NULL);
+  monitor2 = gst_validate_monitor_factory_create (GST_OBJECT (pipeline2),
+      runner2, NULL);
+
+  GST_VALIDATE_REPORT (monitor2, WARNING_ON_BUS, "Reported on the 2nd test");
+  assert_equals_int (gst_validate_runner_get_reports_count (runner1), 0);
+  assert_equals_int (gst_validate_runner_get_reports_count (runner2), 1);
+
+  gst_object_unref (pipeline1);
+  gst_object_unref (pipeline2);
+  g_object_unref (monitor1);
+  g_object_unref (monitor2);
+  g_object_unref (runner1);
+  g_object_unref (runner2);
+}
+
+GST_END_TEST;
+
 static Suite *
 gst_validate_suite (void)
 {
@@ -279,6 +315,7 @@ gst_validate_suite (void)
       test_global_level_synthetic_fakesrc1_subchain_fakesrc2_subchain_fakemixer_src_monitor);
   tcase_add_test (tc_chain, test_global_level_none_fakesink_all);
   tcase_add_test (tc_chain, test_global_level_issue_type);
+  tcase_add_test (tc_chain, test_runners_for_tests);
 
   return s;
 }
@@ -1,3 +1,4 @@
+#include <string.h>
 #include <gst/check/gstcheck.h>
 #include <glib/gstdio.h>
 #include <gst/validate/validate.h>
@@ -42,6 +43,305 @@ GST_START_TEST (test_expression_parser)
 
 GST_END_TEST;
 
+GST_START_TEST (test_escaped_variable_clocktime)
+{
+  GstClockTime start;
+  GstValidateRunner *runner = gst_validate_runner_new ();
+  GstValidateActionType *set_vars = gst_validate_get_action_type ("set-vars");
+  GstValidateActionType *seek_type = gst_validate_get_action_type ("seek");
+  GstValidateScenario *scenario =
+      g_object_new (GST_TYPE_VALIDATE_SCENARIO, "validate-runner",
+      runner, NULL);
+  GstValidateAction *action;
+  GstStructure *st;
+
+  st = gst_structure_from_string ("set-vars, a=(string)\"50\"", NULL);
+  action = gst_validate_action_new (scenario, set_vars, st, FALSE);
+  fail_unless_equals_int (gst_validate_execute_action (set_vars, action),
+      GST_VALIDATE_EXECUTE_ACTION_OK);
+  gst_structure_free (st);
+  gst_validate_action_unref (action);
+
+  /* Variables of actions that were not prepared are replaced */
+  st = gst_structure_new ("seek", "start", G_TYPE_STRING, "$(a)", NULL);
+  action = gst_validate_action_new (scenario, seek_type, st, FALSE);
+  gst_structure_free (st);
+  fail_unless (gst_validate_action_get_clocktime (scenario, action, "start",
+          &start));
+  fail_unless_equals_uint64 (start, 50 * GST_SECOND);
+  gst_validate_action_unref (action);
+
+  /* Preparing the action unescapes the reference, which must then be kept
+   * as is */
+  st = gst_structure_new ("seek", "start", G_TYPE_STRING, "\\$(a)", NULL);
+  action = gst_validate_action_new (scenario, seek_type, st, FALSE);
+  gst_structure_free (st);
+  fail_unless (seek_type->prepare (action));
+  fail_if (gst_validate_action_get_clocktime (scenario, action, "start",
+          &start));
+  fail_unless_equals_string (gst_structure_get_string (action->structure,
+          "start"), "$(a)");
+  gst_validate_action_unref (action);
+
+  gst_object_unref (runner);
+}
+
+GST_END_TEST;
+
+static GstValidateExecuteActionReturn
+_execute_noop (GstValidateScenario * scenario, GstValidateAction * action)
+{
+  return GST_VALIDATE_EXECUTE_ACTION_OK;
+}
+
+GST_START_TEST (test_action_type_rank)
+{
+  GstValidateActionType *lowest, *low, *high, *found;
+
+  fail_if (gst_validate_get_action_type ("priv_test-unknown-type"));
+
+  low = gst_validate_register_action_type_dynamic (NULL, "priv_test-rank",
+      GST_RANK_MARGINAL, _execute_noop, NULL, "Low rank", 0);
+  found = gst_validate_get_action_type ("priv_test-rank");
+  fail_unless (found == low);
+  gst_mini_object_unref (GST_MINI_OBJECT (found));
+
+  /* A higher rank replaces the registered implementation */
+  high = gst_validate_register_action_type_dynamic (NULL, "priv_test-rank",
+      GST_RANK_PRIMARY, _execute_noop, NULL, "High rank", 0);
+  fail_unless (high != low);
+  fail_unless (high->overriden_type == low);
+  found = gst_validate_get_action_type ("priv_test-rank");
+  fail_unless (found == high);
+  gst_mini_object_unref (GST_MINI_OBJECT (found));
+
+  /* And a lower rank does not */
+  lowest = gst_validate_register_action_type_dynamic (NULL, "priv_test-rank",
+      GST_RANK_NONE, _execute_noop, NULL, "Lowest rank", 0);
+  fail_unless (lowest == high);
+  found = gst_validate_get_action_type ("priv_test-rank");
+  fail_unless (found == high);
+  gst_mini_object_unref (GST_MINI_OBJECT (found));
+}
+
+GST_END_TEST;
+
+/* A system clock counting the asynchronous waits, which only the scenario
+ * uses in these pipelines */
+typedef GstSystemClock CountingClock;
+typedef GstSystemClockClass CountingClockClass;
+
+static GType counting_clock_get_type (void);
+G_DEFINE_TYPE (CountingClock, counting_clock, GST_TYPE_SYSTEM_CLOCK);
+
+static gint n_async_waits = 0;
+
+static GstClockReturn
+counting_clock_wait_async (GstClock * clock, GstClockEntry * entry)
+{
+  g_atomic_int_inc (&n_async_waits);
+
+  return
+      GST_CLOCK_CLASS (counting_clock_parent_class)->wait_async (clock, entry);
+}
+
+static void
+counting_clock_class_init (CountingClockClass * klass)
+{
+  GST_CLOCK_CLASS (klass)->wait_async = counting_clock_wait_async;
+}
+
+static void
+counting_clock_init (CountingClock * clock)
+{
+}
+
+typedef struct
+{
+  GMainLoop *loop;
+  GstElement *pipeline;
+  gint64 start_time, resume_time, marker_time;
+  GstClockTime marker_position;
+} PlaybackTimeTest;
+
+static PlaybackTimeTest playback_time_test;
+
+static GstValidateExecuteActionReturn
+_execute_marker (GstValidateScenario * scenario, GstValidateAction * action)
+{
+  gint64 position = -1;
+
+  gst_element_query_position (playback_time_test.pipeline, GST_FORMAT_TIME,
+      &position);
+  playback_time_test.marker_position = position;
+  playback_time_test.marker_time = g_get_monotonic_time ();
+  g_main_loop_quit (playback_time_test.loop);
+
+  return GST_VALIDATE_EXECUTE_ACTION_OK;
+}
+
+static gboolean
+_playback_time_test_timeout (gpointer unused)
+{
+  g_main_loop_quit (playback_time_test.loop);
+
+  return G_SOURCE_CONTINUE;
+}
+
+/* Plays a pipeline running a scenario with a single marker action executed at
+ * @playback_time, with @func called after @interval_ms. Returns the time it
+ * took for the marker to be executed, in seconds. */
+static gdouble
+run_playback_time_test (gdouble playback_time, GSourceFunc func,
+    guint interval_ms)
+{
+  GstValidateRunner *runner = gst_validate_runner_new ();
+  gchar *dir = g_dir_make_tmp ("validatescenario-XXXXXX", NULL);
+  gchar *path = g_build_filename (dir, "marker.scenario", NULL);
+  gchar *contents = g_strdup_printf ("priv_test-marker, playback-time=%f\n",
+      playback_time);
+  GstClock *clock =
+      gst_object_ref_sink (g_object_new (counting_clock_get_type (), NULL));
+  GstValidateScenario *scenario;
+  guint timeout_id;
+
+  gst_validate_register_action_type_dynamic (NULL,
+      "priv_test-marker", GST_RANK_PRIMARY, _execute_marker, NULL,
+      "Records when it got executed", 0);
+  fail_unless (g_file_set_contents (path, contents, -1, NULL));
+
+  memset (&playback_time_test, 0, sizeof (playback_time_test));
+  playback_time_test.marker_position = GST_CLOCK_TIME_NONE;
+  playback_time_test.loop = g_main_loop_new (NULL, FALSE);
+  playback_time_test.pipeline = gst_parse_launch ("videotestsrc"
+      " ! video/x-raw,width=64,height=64,framerate=30/1"
+      " ! fakesink sync=true", NULL);
+  fail_unless (playback_time_test.pipeline != NULL);
+  gst_pipeline_use_clock (GST_PIPELINE (playback_time_test.pipeline), clock);
+
+  scenario = gst_validate_scenario_factory_create (runner,
+      playback_time_test.pipeline, path);
+  fail_unless (scenario != NULL);
+
+  if (func)
+    g_timeout_add (interval_ms, func, NULL);
+  timeout_id = g_timeout_add_seconds (10, _playback_time_test_timeout, NULL);
+
+  playback_time_test.start_time = g_get_monotonic_time ();
+  gst_element_set_state (playback_time_test.pipeline, GST_STATE_PLAYING);
+  g_main_loop_run (playback_time_test.loop);
+  gst_element_set_state (playback_time_test.pipeline, GST_STATE_NULL);
+  g_source_remove (timeout_id);
+
+  fail_unless (playback_time_test.marker_time, "Marker never executed");
+  fail_unless (playback_time_test.marker_position >=
+      playback_time * GST_SECOND, "Marker executed at %" GST_TIME_FORMAT,
+      GST_TIME_ARGS (playback_time_test.marker_position));
+
+  g_remove (path);
+  g_rmdir (dir);
+  g_free (contents);
+  g_free (path);
+  g_free (dir);
+  gst_object_unref (scenario);
+  gst_object_unref (playback_time_test.pipeline);
+  gst_object_unref (clock);
+  g_main_loop_unref (playback_time_test.loop);
+  gst_object_unref (runner);
+
+  return (playback_time_test.marker_time -
+      playback_time_test.start_time) / (gdouble) G_USEC_PER_SEC;
+}
+
+GST_START_TEST (test_playback_time_on_clock)
+{
+  gdouble elapsed = run_playback_time_test (0.5, NULL, 0);
+
+  /* The playback time was waited for on the pipeline clock instead of
+   * querying the position on idle */
+  fail_unless (g_atomic_int_get (&n_async_waits) > 0);
+  fail_unless (elapsed < 3.0, "Took %f seconds", elapsed);
+}
+
+GST_END_TEST;
+
+static gboolean
+_seek_close_to_marker (gpointer unused)
+{
+  fail_unless (gst_element_seek_simple (playback_time_test.pipeline,
+          GST_FORMAT_TIME, GST_SEEK_FLAG_FLUSH | GST_SEEK_FLAG_ACCURATE,
+          4800 * GST_MSECOND));
+
+  return G_SOURCE_REMOVE;
+}
+
+GST_START_TEST (test_playback_time_after_seek)
+{
+  /* Without re-arming the wait after the seek, the marker would only be
+   * executed after about 5 seconds */
+  gdouble elapsed = run_playback_time_test (5.0, _seek_close_to_marker, 300);
+
+  fail_unless (elapsed < 3.0, "Took %f seconds", elapsed);
+}
+
+GST_END_TEST;
+
+static gboolean
+_change_rate (gpointer unused)
+{
+  fail_unless (gst_element_seek (playback_time_test.pipeline, 8.0,
+          GST_FORMAT_TIME, GST_SEEK_FLAG_FLUSH | GST_SEEK_FLAG_ACCURATE,
+          GST_SEEK_TYPE_SET, 300 * GST_MSECOND, GST_SEEK_TYPE_NONE,
+          GST_CLOCK_TIME_NONE));
+
+  return G_SOURCE_REMOVE;
+}
+
+GST_START_TEST (test_playback_time_after_rate_change)
+{
+  /* The remaining 4.7 seconds take less than a second at rate 8 */
+  gdouble elapsed = run_playback_time_test (5.0, _change_rate, 300);
+
+  fail_unless (elapsed < 3.0, "Took %f seconds", elapsed);
+}
+
+GST_END_TEST;
+
+static gboolean
+_resume (gpointer unused)
+{
+  playback_time_test.resume_time = g_get_monotonic_time ();
+  gst_element_set_state (playback_time_test.pipeline, GST_STATE_PLAYING);
+
+  return G_SOURCE_REMOVE;
+}
+
+static gboolean
+_pause (gpointer unused)
+{
+  gst_element_set_state (playback_time_test.pipeline, GST_STATE_PAUSED);
+  g_timeout_add (1500, _resume, NULL);
+
+  return G_SOURCE_REMOVE;
+}
+
+GST_START_TEST (test_playback_time_after_pause)
+{
+  gdouble since_resume;
+
+  /* The wait is cancelled when pausing, and re-armed for the remaining 0.7
+   * seconds once playing again */
+  run_playback_time_test (1.0, _pause, 300);
+
+  fail_unless (playback_time_test.resume_time != 0);
+  since_resume = (playback_time_test.marker_time -
+      playback_time_test.resume_time) / (gdouble) G_USEC_PER_SEC;
+  fail_unless (since_resume > 0.4 && since_resume < 2.5,
+      "Executed %f seconds after resuming", since_resume);
+}
+
+GST_END_TEST;
+
 static Suite *
 gst_validate_suite (void)
 {
@@ -56,6 +356,12 @@ gst_validate_suite (void)
   g_setenv ("GST_VALIDATE_REPORTING_DETAILS", "all", TRUE);
   gst_validate_init ();
   tcase_add_test (tc_chain, test_expression_parser);
+  tcase_add_test (tc_chain, test_escaped_variable_clocktime);
+  tcase_add_test (tc_chain, test_action_type_rank);
+  tcase_add_test (tc_chain, test_playback_time_on_clock);
+  tcase_add_test (tc_chain, test_playback_time_after_seek);
+  tcase_add_test (tc_chain, test_playback_time_after_rate_change);
+  tcase_add_test (tc_chain, test_playback_time_after_pause);
   gst_validate_deinit ();
 
   return s;
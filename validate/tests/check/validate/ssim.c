@@ -0,0 +1,681 @@
+/* GstValidate
+ *
+ * ssim.c: Checks the similarity computations used to compare video frames.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <math.h>
+#include <glib/gstdio.h>
+#include <gst/check/gstcheck.h>
+#include "../../../gst-libs/gst/video/gssim.h"
+#include "../../../gst-libs/gst/video/gstvalidatessim.h"
+#include "../../../gst-libs/gst/video/gstvalidateframestore.h"
+
+/* Smooth gradients with noise on the modified frame, and a flat area so that
+ * the variances are small compared to the means there */
+static void
+fill_frames (guint8 * org, guint8 * mod, gint width, gint height)
+{
+  GRand *rand = g_rand_new_with_seed (42);
+  gint x, y;
+
+  for (y = 0; y < height; y++) {
+    for (x = 0; x < width; x++) {
+      gdouble v = 128 + 100 * sin (x * 0.05) * cos (y * 0.07);
+
+      if (x < width / 4 && y < height / 4)
+        v = 200;
+
+      org[y * width + x] = v;
+      mod[y * width + x] = CLAMP (v + g_rand_int_range (rand, -20, 20), 0,
+          255);
+    }
+  }
+
+  g_rand_free (rand);
+}
+
+static void
+compare_engines (gint width, gint height)
+{
+  guint8 *org = g_malloc (width * height);
+  guint8 *mod = g_malloc (width * height);
+  guint8 *out[2];
+  gfloat mean[2], lowest[2], highest[2];
+  gint i;
+
+  fill_frames (org, mod, width, height);
+
+  for (i = 0; i < 2; i++) {
+    Gssim *ssim = gssim_new ();
+
+    gssim_configure (ssim, width, height);
+    gssim_set_engine (ssim,
+        i == 0 ? GSSIM_ENGINE_REFERENCE : GSSIM_ENGINE_SEPARABLE);
+    out[i] = g_malloc (width * height);
+    gssim_compare (ssim, org, mod, out[i], &mean[i], &lowest[i], &highest[i]);
+    gst_object_unref (ssim);
+  }
+
+  fail_unless (fabs (mean[0] - mean[1]) < GSSIM_SEPARABLE_TOLERANCE,
+      "Means differ: %f != %f", mean[0], mean[1]);
+  fail_unless (fabs (lowest[0] - lowest[1]) < GSSIM_SEPARABLE_TOLERANCE,
+      "Lowest differ: %f != %f", lowest[0], lowest[1]);
+  fail_unless (fabs (highest[0] - highest[1]) < GSSIM_SEPARABLE_TOLERANCE,
+      "Highest differ: %f != %f", highest[0], highest[1]);
+  for (i = 0; i < width * height; i++)
+    fail_unless (ABS (out[0][i] - out[1][i]) <= 1,
+        "Output pixels %d differ: %d != %d", i, out[0][i], out[1][i]);
+
+  g_free (out[0]);
+  g_free (out[1]);
+  g_free (org);
+  g_free (mod);
+}
+
+GST_START_TEST (test_separable_engine)
+{
+  compare_engines (64, 48);
+  compare_engines (333, 217);
+  /* Smaller than the window */
+  compare_engines (7, 5);
+}
+
+GST_END_TEST;
+
+static void
+compare_simd (gint width, gint height, GssimSimd simd)
+{
+  guint8 *org = g_malloc (width * height);
+  guint8 *mod = g_malloc (width * height);
+  guint8 *out[2];
+  gfloat mean[2], lowest[2], highest[2];
+  gint i;
+
+  fill_frames (org, mod, width, height);
+
+  for (i = 0; i < 2; i++) {
+    Gssim *ssim = gssim_new ();
+
+    gssim_configure (ssim, width, height);
+    fail_unless (gssim_set_simd (ssim, i == 0 ? GSSIM_SIMD_NONE : simd));
+    out[i] = g_malloc (width * height);
+    gssim_compare (ssim, org, mod, out[i], &mean[i], &lowest[i], &highest[i]);
+    gst_object_unref (ssim);
+  }
+
+  /* Operations are done in the same order, only contractions into fused
+   * multiply-adds by the compiler could make them differ */
+  fail_unless (fabs (mean[0] - mean[1]) < 1e-6,
+      "Means differ: %f != %f", mean[0], mean[1]);
+  fail_unless (fabs (lowest[0] - lowest[1]) < 1e-6,
+      "Lowest differ: %f != %f", lowest[0], lowest[1]);
+  fail_unless (fabs (highest[0] - highest[1]) < 1e-6,
+      "Highest differ: %f != %f", highest[0], highest[1]);
+  for (i = 0; i < width * height; i++)
+    fail_unless (ABS (out[0][i] - out[1][i]) <= 1,
+        "Output pixels %d differ: %d != %d", i, out[0][i], out[1][i]);
+
+  g_free (out[0]);
+  g_free (out[1]);
+  g_free (org);
+  g_free (mod);
+}
+
+GST_START_TEST (test_simd_kernels)
+{
+  GssimSimd simds[] = { GSSIM_SIMD_SSE2, GSSIM_SIMD_AVX2 };
+  guint i;
+
+  for (i = 0; i < G_N_ELEMENTS (simds); i++) {
+    Gssim *ssim = gssim_new ();
+    gboolean supported = gssim_set_simd (ssim, simds[i]);
+
+    gst_object_unref (ssim);
+    if (!supported)
+      continue;
+
+    /* Widths that are not multiples of the vector sizes */
+    compare_simd (64, 48, simds[i]);
+    compare_simd (333, 217, simds[i]);
+    compare_simd (13, 11, simds[i]);
+  }
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_threads)
+{
+  guint8 *org = g_malloc (333 * 517);
+  guint8 *mod = g_malloc (333 * 517);
+  guint8 *out[2];
+  gfloat mean[2], lowest[2], highest[2];
+  guint n_threads[] = { 1, 2, 3, 8 };
+  guint i;
+
+  fill_frames (org, mod, 333, 517);
+
+  /* Bands are combined exactly, whatever their number */
+  for (i = 0; i < G_N_ELEMENTS (n_threads); i++) {
+    Gssim *ssim = gssim_new ();
+    guint8 *res = g_malloc (333 * 517);
+    guint j = MIN (i, 1);
+
+    gssim_set_n_threads (ssim, n_threads[i]);
+    gssim_configure (ssim, 333, 517);
+    out[j] = res;
+    gssim_compare (ssim, org, mod, res, &mean[j], &lowest[j], &highest[j]);
+    gst_object_unref (ssim);
+
+    if (j == 0)
+      continue;
+
+    fail_unless_equals_float (mean[0], mean[1]);
+    fail_unless_equals_float (lowest[0], lowest[1]);
+    fail_unless_equals_float (highest[0], highest[1]);
+    fail_unless (!memcmp (out[0], out[1], 333 * 517));
+    g_free (out[1]);
+  }
+
+  g_free (out[0]);
+  g_free (org);
+  g_free (mod);
+}
+
+GST_END_TEST;
+
+/* The SSIM constants scale with the dynamic range, so frames whose 16 bits
+ * samples are the 8 bits ones times 257 have the same similarity */
+GST_START_TEST (test_high_bit_depth)
+{
+  guint8 *org = g_malloc (160 * 120);
+  guint8 *mod = g_malloc (160 * 120);
+  guint16 *org16 = g_new (guint16, 2 * 160 * 120);
+  guint16 *mod16 = g_new (guint16, 2 * 160 * 120);
+  GssimSamples org_samples = { (guint8 *) org16, 4 * 160, 4, 16, 16, 0,
+    G_BYTE_ORDER == G_BIG_ENDIAN
+  };
+  GssimSamples mod_samples = { (guint8 *) mod16, 4 * 160, 4, 16, 16, 0,
+    G_BYTE_ORDER == G_BIG_ENDIAN
+  };
+  Gssim *ssim = gssim_new ();
+  gfloat mean[2], lowest[2], highest[2];
+  gint i;
+
+  fill_frames (org, mod, 160, 120);
+  /* Interleaved with another component that must be skipped */
+  for (i = 0; i < 160 * 120; i++) {
+    org16[2 * i] = org[i] * 257;
+    mod16[2 * i] = mod[i] * 257;
+    org16[2 * i + 1] = mod16[2 * i + 1] = i;
+  }
+
+  gssim_configure (ssim, 160, 120);
+  gssim_compare (ssim, org, mod, NULL, &mean[0], &lowest[0], &highest[0]);
+  gssim_set_depth (ssim, 16);
+  gssim_compare_samples (ssim, &org_samples, &mod_samples, NULL, 0, &mean[1],
+      &lowest[1], &highest[1]);
+
+  fail_unless (fabs (mean[0] - mean[1]) < 1e-6, "Means differ: %f != %f",
+      mean[0], mean[1]);
+  fail_unless (fabs (lowest[0] - lowest[1]) < 1e-6, "Lowest differ: %f != %f",
+      lowest[0], lowest[1]);
+
+  gst_object_unref (ssim);
+  g_free (org16);
+  g_free (mod16);
+  g_free (org);
+  g_free (mod);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_identical_frames)
+{
+  guint8 *org = g_malloc (320 * 240);
+  guint8 *mod = g_malloc (320 * 240);
+  Gssim *ssim = gssim_new ();
+  gfloat mean, lowest, highest;
+
+  fill_frames (org, mod, 320, 240);
+  gssim_configure (ssim, 320, 240);
+  gssim_compare (ssim, org, org, NULL, &mean, &lowest, &highest);
+  fail_unless (fabs (mean - 1) < 1e-6, "Mean: %f", mean);
+  fail_unless (fabs (lowest - 1) < 1e-6, "Lowest: %f", lowest);
+
+  gst_object_unref (ssim);
+  g_free (org);
+  g_free (mod);
+}
+
+GST_END_TEST;
+
+static void
+map_gray_frame (GstVideoFrame * frame, guint8 * data, gint width, gint height)
+{
+  GstVideoInfo info;
+  GstBuffer *buffer = gst_buffer_new_wrapped_full (GST_MEMORY_FLAG_READONLY,
+      data, width * height, 0, width * height, NULL, NULL);
+
+  gst_video_info_set_format (&info, GST_VIDEO_FORMAT_GRAY8, width, height);
+  fail_unless (gst_video_frame_map (frame, &info, buffer, GST_MAP_READ));
+  gst_buffer_unref (buffer);
+}
+
+GST_START_TEST (test_modes)
+{
+  guint8 *org = g_malloc (256 * 256);
+  guint8 *mod = g_malloc (256 * 256);
+  GstValidateSsim *ssim = gst_validate_ssim_new (NULL, 0.95, -1, 0, 1, 1);
+  gfloat mean[4], lowest, highest;
+  GstVideoFrame org_frame, mod_frame;
+  GstBuffer *outbuf;
+  GstValidateSsimMode mode;
+
+  fill_frames (org, mod, 256, 256);
+  map_gray_frame (&org_frame, org, 256, 256);
+  map_gray_frame (&mod_frame, mod, 256, 256);
+
+  for (mode = GST_VALIDATE_SSIM_MODE_FULL;
+      mode <= GST_VALIDATE_SSIM_MODE_MS_SSIM; mode++) {
+    gst_validate_ssim_set_mode (ssim, mode);
+    gst_validate_ssim_compare_frames (ssim, &org_frame, &mod_frame, &outbuf,
+        &mean[mode], &lowest, &highest);
+    fail_unless (mean[mode] > 0 && mean[mode] <= 1, "Mean: %f", mean[mode]);
+    fail_unless_equals_int (gst_buffer_get_size (outbuf), 256 * 256);
+    gst_buffer_unref (outbuf);
+  }
+
+  /* Downscaling averages the noise out */
+  fail_unless (mean[GST_VALIDATE_SSIM_MODE_DECIMATE_2] >
+      mean[GST_VALIDATE_SSIM_MODE_FULL]);
+  fail_unless (mean[GST_VALIDATE_SSIM_MODE_DECIMATE_4] >
+      mean[GST_VALIDATE_SSIM_MODE_DECIMATE_2]);
+  fail_unless (mean[GST_VALIDATE_SSIM_MODE_MS_SSIM] >
+      mean[GST_VALIDATE_SSIM_MODE_FULL]);
+
+  fail_unless (gst_validate_ssim_mode_from_string ("ms-ssim", &mode));
+  fail_unless_equals_int (mode, GST_VALIDATE_SSIM_MODE_MS_SSIM);
+  fail_if (gst_validate_ssim_mode_from_string ("decimate-3", &mode));
+
+  gst_video_frame_unmap (&org_frame);
+  gst_video_frame_unmap (&mod_frame);
+  gst_object_unref (ssim);
+  g_free (org);
+  g_free (mod);
+}
+
+GST_END_TEST;
+
+static gboolean
+compare_with_reference (GstValidateSsim * ssim, const gchar * pattern,
+    guint8 * data, gfloat * mean)
+{
+  GstVideoInfo info;
+  GstVideoFrame frame;
+  GstBuffer *buffer = gst_buffer_new_allocate (NULL, 64 * 64, NULL);
+  gfloat lowest, highest;
+  gboolean res;
+
+  gst_buffer_fill (buffer, 0, data, 64 * 64);
+  gst_video_info_set_format (&info, GST_VIDEO_FORMAT_GRAY8, 64, 64);
+  fail_unless (gst_video_frame_map (&frame, &info, buffer, GST_MAP_READ));
+  res = gst_validate_ssim_compare_frame_with_reference (ssim, pattern, &frame,
+      0, "frame", mean, &lowest, &highest, NULL);
+  gst_video_frame_unmap (&frame);
+  gst_buffer_unref (buffer);
+
+  return res;
+}
+
+GST_START_TEST (test_compare_frame_with_reference)
+{
+  gchar *dir = g_dir_make_tmp ("validatessim-XXXXXX", NULL);
+  gchar *ref_file = g_build_filename (dir, "0-00-00.000000000.64x64.GRAY8",
+      NULL);
+  gchar *pattern = g_build_filename (dir, "*.64x64.GRAY8", NULL);
+  guint8 *org = g_malloc (64 * 64);
+  guint8 *mod = g_malloc (64 * 64);
+  GstValidateRunner *runner = gst_validate_runner_new ();
+  GstValidateSsim *ssim = gst_validate_ssim_new (runner, 0.95, -1, 0, 1, 1);
+  guint64 hits, misses;
+  gfloat mean;
+  gint i;
+
+  fill_frames (org, mod, 64, 64);
+  fail_unless (g_file_set_contents (ref_file, (gchar *) org, 64 * 64, NULL));
+
+  /* The prefetched reference is used by the comparison */
+  gst_validate_ssim_prefetch_reference (ssim, pattern, 0);
+  fail_unless (compare_with_reference (ssim, pattern, org, &mean));
+  fail_unless (fabs (mean - 1) < 1e-6, "Mean: %f", mean);
+  fail_unless_equals_int (gst_validate_runner_get_reports_count (runner), 0);
+
+  for (i = 0; i < 64 * 64; i++)
+    mod[i] = 255 - org[i];
+  fail_if (compare_with_reference (ssim, pattern, mod, &mean));
+  fail_unless_equals_int (gst_validate_runner_get_reports_count (runner), 1);
+
+  /* The reference was decoded once and then taken from the cache */
+  gst_validate_ssim_get_reference_cache_stats (ssim, &hits, &misses);
+  fail_unless_equals_uint64 (hits, 1);
+  fail_unless_equals_uint64 (misses, 1);
+
+  gst_validate_ssim_set_reference_cache_size (ssim, 0);
+  fail_unless (compare_with_reference (ssim, pattern, org, &mean));
+  gst_validate_ssim_get_reference_cache_stats (ssim, &hits, &misses);
+  fail_unless_equals_uint64 (hits, 1);
+  fail_unless_equals_uint64 (misses, 2);
+
+  /* Identical frames are accepted without computing their SSIM */
+  fail_unless_equals_uint64 (gst_validate_ssim_get_n_resolved_frames (ssim,
+          GST_VALIDATE_SSIM_STAGE_IDENTICAL), 2);
+  fail_unless_equals_uint64 (gst_validate_ssim_get_n_resolved_frames (ssim,
+          GST_VALIDATE_SSIM_STAGE_SSIM), 1);
+
+  gst_validate_ssim_set_psnr_thresholds (ssim, 60, 10);
+  fail_if (compare_with_reference (ssim, pattern, mod, &mean));
+  fail_unless_equals_float (mean, 0);
+  fail_unless_equals_uint64 (gst_validate_ssim_get_n_resolved_frames (ssim,
+          GST_VALIDATE_SSIM_STAGE_PSNR_REJECTED), 1);
+
+  memcpy (mod, org, 64 * 64);
+  mod[0] ^= 1;
+  fail_unless (compare_with_reference (ssim, pattern, mod, &mean));
+  fail_unless_equals_float (mean, 1);
+  fail_unless_equals_uint64 (gst_validate_ssim_get_n_resolved_frames (ssim,
+          GST_VALIDATE_SSIM_STAGE_PSNR_ACCEPTED), 1);
+  fail_unless_equals_uint64 (gst_validate_ssim_get_n_resolved_frames (ssim,
+          GST_VALIDATE_SSIM_STAGE_SSIM), 1);
+
+  gst_object_unref (ssim);
+  gst_object_unref (runner);
+  g_remove (ref_file);
+  g_rmdir (dir);
+  g_free (pattern);
+  g_free (ref_file);
+  g_free (dir);
+  g_free (org);
+  g_free (mod);
+}
+
+GST_END_TEST;
+
+typedef struct
+{
+  GstValidateSsim *ssim;
+  const gchar *pattern;
+  guint8 *org;
+} PrefetchThreadData;
+
+/* Returns the number of failed comparisons */
+static gpointer
+prefetch_and_compare (PrefetchThreadData * data)
+{
+  gfloat mean;
+  gint i, n_failed = 0;
+
+  for (i = 0; i < 200; i++) {
+    gst_validate_ssim_prefetch_reference (data->ssim, data->pattern, 0);
+    if (!compare_with_reference (data->ssim, data->pattern, data->org, &mean))
+      n_failed++;
+  }
+
+  return GINT_TO_POINTER (n_failed);
+}
+
+GST_START_TEST (test_prefetch_cached_reference)
+{
+  gchar *dir = g_dir_make_tmp ("validatessim-XXXXXX", NULL);
+  gchar *ref_file = g_build_filename (dir, "0-00-00.000000000.64x64.GRAY8",
+      NULL);
+  gchar *pattern = g_build_filename (dir, "*.64x64.GRAY8", NULL);
+  guint8 *org = g_malloc (64 * 64);
+  guint8 *mod = g_malloc (64 * 64);
+  GstValidateRunner *runner = gst_validate_runner_new ();
+  GstValidateSsim *ssim = gst_validate_ssim_new (runner, 0.95, -1, 0, 1, 1);
+  PrefetchThreadData data = { ssim, pattern, org };
+  GThread *threads[4];
+  gfloat mean;
+  guint i, j;
+
+  fill_frames (org, mod, 64, 64);
+  fail_unless (g_file_set_contents (ref_file, (gchar *) org, 64 * 64, NULL));
+
+  /* A reference that got cached is not prefetched again */
+  fail_unless (compare_with_reference (ssim, pattern, org, &mean));
+  gst_validate_ssim_prefetch_reference (ssim, pattern, 0);
+  fail_unless_equals_int (gst_validate_ssim_get_n_prefetched_references
+      (ssim), 0);
+
+  /* References prefetched while they get cached by other comparisons are
+   * dropped instead of being kept until the end */
+  for (i = 0; i < G_N_ELEMENTS (threads); i++)
+    threads[i] = g_thread_new ("compare", (GThreadFunc) prefetch_and_compare,
+        &data);
+  for (j = 0; j < 200; j++) {
+    gst_validate_ssim_set_reference_cache_size (ssim, 0);
+    g_thread_yield ();
+    gst_validate_ssim_set_reference_cache_size (ssim, 64 * 64 * 4);
+  }
+  for (i = 0; i < G_N_ELEMENTS (threads); i++)
+    fail_unless_equals_int (GPOINTER_TO_INT (g_thread_join (threads[i])), 0);
+
+  fail_unless_equals_int (gst_validate_ssim_get_n_prefetched_references
+      (ssim), 0);
+  fail_unless_equals_int (gst_validate_runner_get_reports_count (runner), 0);
+
+  gst_object_unref (ssim);
+  gst_object_unref (runner);
+  g_remove (ref_file);
+  g_rmdir (dir);
+  g_free (pattern);
+  g_free (ref_file);
+  g_free (dir);
+  g_free (org);
+  g_free (mod);
+}
+
+GST_END_TEST;
+
+static gboolean
+check_directory (const gchar * ref_dir, const gchar * dir, guint n_threads,
+    gfloat * mean, gfloat * lowest, guint * n_reports)
+{
+  GstValidateRunner *runner = gst_validate_runner_new ();
+  GstValidateSsim *ssim =
+      gst_validate_ssim_new (runner, 0.95, -1, 0, 1, n_threads);
+  gfloat highest;
+  gboolean res;
+
+  res = gst_validate_ssim_compare_image_files (ssim, ref_dir, dir, mean,
+      lowest, &highest, NULL);
+  *n_reports = gst_validate_runner_get_reports_count (runner);
+
+  gst_object_unref (ssim);
+  gst_object_unref (runner);
+
+  return res;
+}
+
+GST_START_TEST (test_check_directory)
+{
+  gchar *ref_dir = g_dir_make_tmp ("validatessim-XXXXXX", NULL);
+  gchar *dir = g_dir_make_tmp ("validatessim-XXXXXX", NULL);
+  guint8 *org = g_malloc (64 * 64);
+  guint8 *mod = g_malloc (64 * 64);
+  guint8 *blend = g_malloc (64 * 64);
+  gfloat mean[2], lowest[2];
+  guint n_reports[2];
+  gboolean res[2];
+  gint i, j;
+
+  fill_frames (org, mod, 64, 64);
+  /* Frames further and further from their reference */
+  for (i = 0; i < 8; i++) {
+    gchar *name = g_strdup_printf ("0-00-%02d.000000000.64x64.GRAY8", i);
+    gchar *ref_file = g_build_filename (ref_dir, name, NULL);
+    gchar *file = g_build_filename (dir, name, NULL);
+
+    for (j = 0; j < 64 * 64; j++)
+      blend[j] = CLAMP (org[j] + (mod[j] - org[j]) * i / 4, 0, 255);
+
+    fail_unless (g_file_set_contents (ref_file, (gchar *) org, 64 * 64,
+            NULL));
+    fail_unless (g_file_set_contents (file, (gchar *) blend, 64 * 64, NULL));
+    g_free (file);
+    g_free (ref_file);
+    g_free (name);
+  }
+
+  res[0] = check_directory (ref_dir, dir, 1, &mean[0], &lowest[0],
+      &n_reports[0]);
+  res[1] = check_directory (ref_dir, dir, 4, &mean[1], &lowest[1],
+      &n_reports[1]);
+
+  fail_unless_equals_int (res[0], res[1]);
+  fail_unless_equals_int (n_reports[0], n_reports[1]);
+  fail_unless_equals_float (mean[0], mean[1]);
+  fail_unless_equals_float (lowest[0], lowest[1]);
+
+  for (i = 0; i < 8; i++) {
+    gchar *name = g_strdup_printf ("0-00-%02d.000000000.64x64.GRAY8", i);
+    gchar *ref_file = g_build_filename (ref_dir, name, NULL);
+    gchar *file = g_build_filename (dir, name, NULL);
+
+    g_remove (ref_file);
+    g_remove (file);
+    g_free (file);
+    g_free (ref_file);
+    g_free (name);
+  }
+  g_rmdir (ref_dir);
+  g_rmdir (dir);
+  g_free (ref_dir);
+  g_free (dir);
+  g_free (org);
+  g_free (mod);
+  g_free (blend);
+}
+
+GST_END_TEST;
+
+static void
+check_frame_store (GstValidateFrameStoreCompression compression)
+{
+  gchar *dir = g_dir_make_tmp ("validatessim-XXXXXX", NULL);
+  gchar *path = g_build_filename (dir, "test.frames", NULL);
+  gchar *frame_path, *store_path;
+  GstValidateFrameStore *store;
+  GstVideoInfo info;
+  GstVideoFrame frame;
+  GstBuffer *buffer;
+  guint8 *data = g_malloc (64 * 48);
+  guint8 *noise = g_malloc (64 * 48);
+  guint i, index;
+
+  fill_frames (data, noise, 64, 48);
+  /* Rows are padded so that the frame is not in the default layout */
+  gst_video_info_set_format (&info, GST_VIDEO_FORMAT_GRAY8, 64, 48);
+  info.stride[0] = 80;
+  info.size = 80 * 48;
+  buffer = gst_buffer_new_allocate (NULL, info.size, NULL);
+
+  store = gst_validate_frame_store_create (path, compression, NULL);
+  fail_unless (store != NULL);
+  for (i = 0; i < 3; i++) {
+    fail_unless (gst_video_frame_map (&frame, &info, buffer, GST_MAP_WRITE));
+    for (index = 0; index < 48; index++)
+      memcpy (GST_VIDEO_FRAME_PLANE_DATA (&frame, 0) + index * 80,
+          (i == 1 ? noise : data) + index * 64, 64);
+    fail_unless_equals_int (gst_validate_frame_store_append (store,
+            (3 - i) * GST_SECOND, &frame, NULL), i);
+    gst_video_frame_unmap (&frame);
+  }
+  gst_validate_frame_store_free (store);
+
+  store = gst_validate_frame_store_open (path, NULL);
+  fail_unless (store != NULL);
+  fail_unless_equals_int (gst_validate_frame_store_get_n_frames (store), 3);
+  for (i = 0; i < 3; i++) {
+    fail_unless_equals_uint64 (gst_validate_frame_store_get_timestamp (store,
+            i), (3 - i) * GST_SECOND);
+    fail_unless (gst_validate_frame_store_get_frame (store, i, &frame, NULL));
+    fail_unless_equals_int (GST_VIDEO_FRAME_PLANE_STRIDE (&frame, 0), 64);
+    fail_unless (memcmp (GST_VIDEO_FRAME_PLANE_DATA (&frame, 0),
+            i == 1 ? noise : data, 64 * 48) == 0);
+    gst_video_frame_unmap (&frame);
+  }
+  gst_validate_frame_store_free (store);
+
+  frame_path = gst_validate_frame_store_get_frame_path (path, 2);
+  fail_unless (gst_validate_frame_store_parse_frame_path (frame_path,
+          &store_path, &index));
+  fail_unless_equals_string (store_path, path);
+  fail_unless_equals_int (index, 2);
+  fail_if (gst_validate_frame_store_parse_frame_path ("frame.png#2",
+          &store_path, &index));
+
+  g_remove (path);
+  g_rmdir (dir);
+  g_free (store_path);
+  g_free (frame_path);
+  g_free (path);
+  g_free (dir);
+  g_free (data);
+  g_free (noise);
+  gst_buffer_unref (buffer);
+}
+
+GST_START_TEST (test_frame_store)
+{
+  check_frame_store (GST_VALIDATE_FRAME_STORE_COMPRESSION_NONE);
+  check_frame_store (GST_VALIDATE_FRAME_STORE_COMPRESSION_DEFLATE);
+}
+
+GST_END_TEST;
+
+static Suite *
+gst_validate_suite (void)
+{
+  Suite *s = suite_create ("ssim");
+  TCase *tc_chain = tcase_create ("ssim");
+  suite_add_tcase (s, tc_chain);
+
+  tcase_add_test (tc_chain, test_separable_engine);
+  tcase_add_test (tc_chain, test_simd_kernels);
+  tcase_add_test (tc_chain, test_threads);
+  tcase_add_test (tc_chain, test_high_bit_depth);
+  tcase_add_test (tc_chain, test_identical_frames);
+  tcase_add_test (tc_chain, test_frame_store);
+
+  if (atexit (gst_validate_deinit) != 0) {
+    GST_ERROR ("failed to set gst_validate_deinit as exit function");
+  }
+
+  g_setenv ("GST_VALIDATE_REPORTING_DETAILS", "all", TRUE);
+  gst_validate_init ();
+  tcase_add_test (tc_chain, test_compare_frame_with_reference);
+  tcase_add_test (tc_chain, test_prefetch_cached_reference);
+  tcase_add_test (tc_chain, test_modes);
+  tcase_add_test (tc_chain, test_check_directory);
+  gst_validate_deinit ();
+
+  return s;
+}
+
+GST_CHECK_MAIN (gst_validate);
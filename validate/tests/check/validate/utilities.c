@@ -1,4 +1,6 @@
+#include <utime.h>
 #include <gst/check/gstcheck.h>
+#include <glib/gstdio.h>
 #include <gst/validate/validate.h>
 #include <gst/validate/gst-validate-utils.h>
 
@@ -16,6 +18,149 @@ GST_START_TEST (test_resolve_variables)
 
 GST_END_TEST;
 
+GST_START_TEST (test_replace_nested_variables)
+{
+  gchar *res;
+  GstStructure *vars = gst_structure_from_string ("vars, index=(string)2,"
+      " uri_2=(string)\"file:///$(name).ogg\", name=(string)video,"
+      " position=(double)1.0", NULL);
+
+  /* Values and names built from other variables are expanded */
+  res = gst_validate_replace_variables_in_string (NULL, vars,
+      "$(uri_$(index)) $(name)");
+  fail_unless_equals_string (res, "file:///video.ogg video");
+  g_free (res);
+
+  /* Variables holding doubles are left for the expression parser */
+  res = gst_validate_replace_variables_in_string (NULL, vars,
+      "min($(position), 2) (x) $ \\$(name)");
+  fail_unless_equals_string (res, "min(position, 2) (x) $ $(name)");
+  g_free (res);
+
+  gst_structure_free (vars);
+}
+
+GST_END_TEST;
+
+static GList *
+parse_structures (const gchar * path)
+{
+  return gst_validate_utils_structs_parse_from_filename (path, NULL, NULL);
+}
+
+/* Makes @path look like it was not modified recently, so that the cache
+ * only relies on its modification time */
+static void
+set_old_mtime (const gchar * path)
+{
+  struct utimbuf times;
+
+  times.actime = times.modtime = g_get_real_time () / G_USEC_PER_SEC - 60;
+  fail_unless (g_utime (path, &times) == 0);
+}
+
+/* Adds a `from-cache` field to the first structure of @cache_entry */
+static void
+mark_cached_structures (const gchar * cache_entry)
+{
+  GKeyFile *kf = g_key_file_new ();
+  GstStructure *structure;
+  gchar **strs;
+  gsize n_strs;
+
+  fail_unless (g_key_file_load_from_file (kf, cache_entry, G_KEY_FILE_NONE,
+          NULL));
+  strs = g_key_file_get_string_list (kf, "cache", "structures", &n_strs,
+      NULL);
+  fail_unless (strs && n_strs > 0);
+  structure = gst_structure_from_string (strs[0], NULL);
+  fail_unless (structure);
+  gst_structure_set (structure, "from-cache", G_TYPE_BOOLEAN, TRUE, NULL);
+  g_free (strs[0]);
+  strs[0] = gst_structure_to_string (structure);
+  g_key_file_set_string_list (kf, "cache", "structures",
+      (const gchar * const *) strs, n_strs);
+  fail_unless (g_key_file_save_to_file (kf, cache_entry, NULL));
+
+  gst_structure_free (structure);
+  g_strfreev (strs);
+  g_key_file_free (kf);
+}
+
+GST_START_TEST (test_structures_cache)
+{
+  GList *structures;
+  gchar *dir = g_dir_make_tmp ("validate-structures-cache-XXXXXX", NULL);
+  gchar *cache_dir = g_build_filename (dir, "cache", NULL);
+  gchar *path = g_build_filename (dir, "main.structs", NULL);
+  gchar *included = g_build_filename (dir, "included.structs", NULL);
+  gchar *cache_file = g_compute_checksum_for_string (G_CHECKSUM_SHA1, path, -1);
+  gchar *cache_entry = g_build_filename (cache_dir, cache_file, NULL);
+  gboolean from_cache = FALSE;
+  gint value = 0;
+
+  fail_unless (dir);
+  g_setenv ("GST_VALIDATE_STRUCTURES_CACHE_DIR", cache_dir, TRUE);
+  fail_unless (g_file_set_contents (path,
+          "first, a=1\ninclude, location=included.structs\n", -1, NULL));
+  fail_unless (g_file_set_contents (included, "second, b=2\n", -1, NULL));
+  set_old_mtime (path);
+  set_old_mtime (included);
+
+  /* One entry per parsed file */
+  structures = parse_structures (path);
+  fail_unless_equals_int (g_list_length (structures), 2);
+  fail_if (gst_structure_has_field (structures->data, "from-cache"));
+  g_list_free_full (structures, (GDestroyNotify) gst_structure_free);
+  fail_unless (g_file_test (cache_entry, G_FILE_TEST_EXISTS));
+
+  /* Parsed from the cache, with the fields keeping track of the origin */
+  mark_cached_structures (cache_entry);
+  structures = parse_structures (path);
+  fail_unless_equals_int (g_list_length (structures), 2);
+  fail_unless (gst_structure_get_boolean (structures->data, "from-cache",
+          &from_cache) && from_cache);
+  fail_unless (gst_structure_has_name (structures->next->data, "second"));
+  fail_unless_equals_string (gst_structure_get_string (structures->next->data,
+          "__filename__"), included);
+  g_list_free_full (structures, (GDestroyNotify) gst_structure_free);
+
+  /* Changing an included file invalidates the cache */
+  fail_unless (g_file_set_contents (included,
+          "second, b=2\nthird, c=3\n", -1, NULL));
+  structures = parse_structures (path);
+  fail_unless_equals_int (g_list_length (structures), 3);
+  fail_if (gst_structure_has_field (structures->data, "from-cache"));
+  g_list_free_full (structures, (GDestroyNotify) gst_structure_free);
+
+  /* Even when rewritten within the same second with the same size */
+  mark_cached_structures (cache_entry);
+  fail_unless (g_file_set_contents (included,
+          "second, b=2\nthird, c=4\n", -1, NULL));
+  structures = parse_structures (path);
+  fail_unless_equals_int (g_list_length (structures), 3);
+  fail_if (gst_structure_has_field (structures->data, "from-cache"));
+  fail_unless (gst_structure_get_int (structures->next->next->data, "c",
+          &value));
+  fail_unless_equals_int (value, 4);
+  g_list_free_full (structures, (GDestroyNotify) gst_structure_free);
+
+  g_unsetenv ("GST_VALIDATE_STRUCTURES_CACHE_DIR");
+  g_remove (cache_entry);
+  g_remove (cache_dir);
+  g_remove (included);
+  g_remove (path);
+  g_remove (dir);
+  g_free (cache_entry);
+  g_free (cache_file);
+  g_free (cache_dir);
+  g_free (included);
+  g_free (path);
+  g_free (dir);
+}
+
+GST_END_TEST;
+
 static Suite *
 gst_validate_suite (void)
 {
@@ -29,6 +174,8 @@ gst_validate_suite (void)
 
   gst_validate_init ();
   tcase_add_test (tc_chain, test_resolve_variables);
+  tcase_add_test (tc_chain, test_replace_nested_variables);
+  tcase_add_test (tc_chain, test_structures_cache);
   gst_validate_deinit ();
 
   return s;
@@ -21,12 +21,23 @@
  */
 
 #include "../gst-libs/gst/video/gstvalidatessim.h"
+#include "../gst-libs/gst/video/gstvalidateframestore.h"
 
 #include <gst/gst.h>
 #include <gst/validate/validate.h>
 #include <gst/video/video.h>
 #include <locale.h>             /* for LC_ALL */
 
+/* Accepts both URIs and file names */
+static gchar *
+_get_uri (const gchar * location)
+{
+  if (gst_uri_is_valid (location))
+    return g_strdup (location);
+
+  return gst_filename_to_uri (location, NULL);
+}
+
 int
 main (int argc, char **argv)
 {
@@ -38,6 +49,13 @@ main (int argc, char **argv)
   gchar *outfolder = NULL;
   gfloat mssim = 0, lowest = 1, highest = -1;
   gdouble min_avg_similarity = 0.95, min_lowest_similarity = -1.0;
+  gdouble accept_psnr = 0, reject_psnr = 0;
+  gchar *mode_name = NULL;
+  GstValidateSsimMode mode = GST_VALIDATE_SSIM_MODE_FULL;
+  gint jobs = 0;
+  gboolean compare_chroma = FALSE, videos = FALSE;
+  gchar *sync_name = NULL;
+  GstValidateSsimVideoSync sync = GST_VALIDATE_SSIM_VIDEO_SYNC_PTS;
 
   GOptionEntry options[] = {
     {"min-avg-similarity", 'a', 0, G_OPTION_ARG_DOUBLE,
@@ -57,6 +75,46 @@ main (int argc, char **argv)
           " images with the structural difference between"
           " the reference frame and the failed one",
         NULL},
+    {"jobs", 'j', 0, G_OPTION_ARG_INT,
+          &jobs,
+          "The number of threads used to compare images, defaults to the"
+          " number of processors. The files of directories are compared in"
+          " parallel, and each image is split in bands otherwise",
+        NULL},
+    {"compare-chroma", 'c', 0, G_OPTION_ARG_NONE,
+          &compare_chroma,
+          "Also compare the chroma of YUV images, the average similarity"
+          " being weighted by the number of samples of each component",
+        NULL},
+    {"mode", 'm', 0, G_OPTION_ARG_STRING,
+          &mode_name,
+          "How the similarity is computed: 'full' (the default),"
+          " 'decimate-2' or 'decimate-4' to compare images downscaled by 2"
+          " or 4, or 'ms-ssim' for the multi-scale SSIM. The last three are"
+          " much faster on big images",
+        NULL},
+    {"videos", 'v', 0, G_OPTION_ARG_NONE,
+          &videos,
+          "Compare two videos, given as URIs or file names, instead of images."
+          " Both videos are decoded in parallel and their frames are compared"
+          " as they are decoded, without being saved",
+        NULL},
+    {"sync", 's', 0, G_OPTION_ARG_STRING,
+          &sync_name,
+          "How the frames of compared videos are matched: 'pts' (the"
+          " default) by their position, or 'frame-number' by their number",
+        NULL},
+    {"accept-psnr", 0, 0, G_OPTION_ARG_DOUBLE,
+          &accept_psnr,
+          "The PSNR, in dB, above which images are considered similar"
+          " without computing their SSIM. Bit-identical images are always"
+          " accepted without computing it",
+        NULL},
+    {"reject-psnr", 0, 0, G_OPTION_ARG_DOUBLE,
+          &reject_psnr,
+          "The PSNR, in dB, under which images are considered different"
+          " without computing their SSIM",
+        NULL},
     {NULL}
   };
 
@@ -69,7 +127,11 @@ main (int argc, char **argv)
       "The gst-validate-images-check calculates SSIM (Structural SIMilarity)"
       " index for the images. And according to min-lowest-similarity and"
       " min-avg-similarity, it will consider the images similar enough"
-      " or report critical issues in the GstValidate reporting system");
+      " or report critical issues in the GstValidate reporting system."
+      " The compared path can be an image, a directory of images or a"
+      " frame store (" GST_VALIDATE_FRAME_STORE_EXTENSION ") written by"
+      " the validatessim override. With --videos, two videos are compared"
+      " frame by frame.");
   g_option_context_add_main_entries (ctx, options, NULL);
 
   if (!g_option_context_parse (ctx, &argc, &argv, &err)) {
@@ -88,21 +150,59 @@ main (int argc, char **argv)
     return -1;
   }
 
+  if (mode_name && !gst_validate_ssim_mode_from_string (mode_name, &mode)) {
+    g_printerr ("Unknown mode: %s\n", mode_name);
+    g_option_context_free (ctx);
+    g_free (mode_name);
+
+    return -1;
+  }
+  g_free (mode_name);
+
+  if (!g_strcmp0 (sync_name, "frame-number")) {
+    sync = GST_VALIDATE_SSIM_VIDEO_SYNC_FRAME_NUMBER;
+  } else if (sync_name && g_strcmp0 (sync_name, "pts")) {
+    g_printerr ("Unknown sync: %s\n", sync_name);
+    g_option_context_free (ctx);
+    g_free (sync_name);
+
+    return -1;
+  }
+  g_free (sync_name);
+
   gst_init (&argc, &argv);
   gst_validate_init ();
 
   runner = gst_validate_runner_new ();
   ssim =
       gst_validate_ssim_new (runner, min_avg_similarity, min_lowest_similarity,
-      0, 1);
-
-  gst_validate_ssim_compare_image_files (ssim, argv[1], argv[2], &mssim,
-      &lowest, &highest, outfolder);
+      0, 1, MAX (jobs, 0));
+  gst_validate_ssim_set_compare_chroma (ssim, compare_chroma);
+  gst_validate_ssim_set_mode (ssim, mode);
+  gst_validate_ssim_set_psnr_thresholds (ssim, accept_psnr, reject_psnr);
+
+  if (videos) {
+    gchar *ref_uri = _get_uri (argv[1]), *uri = _get_uri (argv[2]);
+
+    if (!ref_uri || !uri) {
+      g_printerr ("Invalid video location\n");
+      ret = -1;
+    } else {
+      gst_validate_ssim_compare_videos (ssim, ref_uri, uri, sync, &mssim,
+          &lowest, &highest, outfolder);
+    }
+    g_free (ref_uri);
+    g_free (uri);
+  } else {
+    gst_validate_ssim_compare_image_files (ssim, argv[1], argv[2], &mssim,
+        &lowest, &highest, outfolder);
+  }
 
-  if (!g_file_test (argv[1], G_FILE_TEST_IS_DIR)) {
+  if (!videos && !g_file_test (argv[1], G_FILE_TEST_IS_DIR)) {
     gst_validate_printf (ssim, "Compared %s with %s, average: %f, Min %f\n",
         argv[1], argv[2], mssim, lowest);
   }
+  gst_validate_ssim_print_resolved_frames (ssim);
 
   rep_err = gst_validate_runner_exit (runner, TRUE);
   if (ret == 0) {
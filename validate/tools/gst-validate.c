@@ -39,6 +39,13 @@
 
 #ifdef G_OS_UNIX
 #include <glib-unix.h>
+#include <json-glib/json-glib.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
 #endif
 #include <locale.h>             /* for LC_ALL */
 
@@ -46,9 +53,7 @@ static gint ret = 0;
 static GMainLoop *mainloop;
 static GstElement *pipeline;
 static gboolean is_testfile;
-static gboolean buffering = FALSE;
-
-static gboolean is_live = FALSE;
+static gboolean is_forked_test = FALSE;
 
 #ifdef G_OS_UNIX
 static gboolean
@@ -68,18 +73,36 @@ intr_handler (gpointer user_data)
 }
 #endif /* G_OS_UNIX */
 
-typedef struct
+typedef struct _BusCallbackData BusCallbackData;
+
+struct _BusCallbackData
 {
   GMainLoop *mainloop;
   GstValidateMonitor *monitor;
-} BusCallbackData;
+  GstElement *pipeline;
+  gboolean buffering;
+  gboolean is_live;
+  gboolean quit_on_eos;
+
+  /* Called instead of quitting the mainloop when the test is over, when set */
+  void (*done) (BusCallbackData * data);
+};
+
+static void
+bus_callback_data_done (BusCallbackData * data)
+{
+  if (data->done)
+    data->done (data);
+  else
+    g_main_loop_quit (data->mainloop);
+}
 
 static gboolean
 bus_callback (GstBus * bus, GstMessage * message, gpointer data)
 {
   BusCallbackData *bus_callback_data = data;
-  GMainLoop *loop = bus_callback_data->mainloop;
   GstValidateMonitor *monitor = bus_callback_data->monitor;
+  GstElement *pipeline = bus_callback_data->pipeline;
 
   switch (GST_MESSAGE_TYPE (message)) {
     case GST_MESSAGE_ERROR:
@@ -87,12 +110,12 @@ bus_callback (GstBus * bus, GstMessage * message, gpointer data)
       GST_DEBUG_BIN_TO_DOT_FILE_WITH_TS (GST_BIN (pipeline),
           GST_DEBUG_GRAPH_SHOW_ALL, "gst-validate.error");
 
-      g_main_loop_quit (loop);
+      bus_callback_data_done (bus_callback_data);
       break;
     }
     case GST_MESSAGE_EOS:
-      if (!g_getenv ("GST_VALIDATE_SCENARIO") && !is_testfile)
-        g_main_loop_quit (loop);
+      if (bus_callback_data->quit_on_eos)
+        bus_callback_data_done (bus_callback_data);
       break;
     case GST_MESSAGE_ASYNC_DONE:
       break;
@@ -160,7 +183,7 @@ bus_callback (GstBus * bus, GstMessage * message, gpointer data)
             (monitor)->scenario);
       }
 
-      if (!buffering) {
+      if (!bus_callback_data->buffering) {
         gst_validate_printf (NULL, "\n");
       }
 
@@ -169,14 +192,14 @@ bus_callback (GstBus * bus, GstMessage * message, gpointer data)
 
       /* no state management needed for live pipelines */
       if (mode == GST_BUFFERING_LIVE) {
-        is_live = TRUE;
+        bus_callback_data->is_live = TRUE;
         break;
       }
 
       if (percent == 100) {
         /* a 100% message means buffering is done */
-        if (buffering) {
-          buffering = FALSE;
+        if (bus_callback_data->buffering) {
+          bus_callback_data->buffering = FALSE;
 
           if (target_state == GST_STATE_PLAYING) {
             gst_element_set_state (pipeline, GST_STATE_PLAYING);
@@ -184,9 +207,9 @@ bus_callback (GstBus * bus, GstMessage * message, gpointer data)
         }
       } else {
         /* buffering... */
-        if (!buffering) {
+        if (!bus_callback_data->buffering) {
           gst_element_set_state (pipeline, GST_STATE_PAUSED);
-          buffering = TRUE;
+          bus_callback_data->buffering = TRUE;
         }
       }
       break;
@@ -201,7 +224,7 @@ bus_callback (GstBus * bus, GstMessage * message, gpointer data)
           && state == GST_STATE_NULL) {
         gst_validate_printf (GST_MESSAGE_SRC (message),
             "State change request NULL, quitting mainloop\n");
-        g_main_loop_quit (mainloop);
+        bus_callback_data_done (bus_callback_data);
       }
       break;
     }
@@ -332,12 +355,715 @@ run_test_from_file (gchar * testfile, gboolean use_fakesinks)
   return ret;
 }
 
+/* Makes the overrides registered for the whole process, like the
+ * validateflow and ssim ones, report to @runner if set. Returns %FALSE if
+ * there is none. */
+static gboolean
+_set_overrides_runner (GstValidateRunner * runner)
+{
+  GList *tmp, *overrides =
+      gst_validate_override_registry_get_override_list
+      (gst_validate_override_registry_get ());
+
+  for (tmp = overrides; tmp && runner; tmp = tmp->next)
+    gst_validate_reporter_set_runner (GST_VALIDATE_REPORTER (tmp->data),
+        runner);
+  g_list_free (overrides);
+
+  return overrides != NULL;
+}
+
+/* Tests run by --batch, all sharing the process and its mainloop */
+typedef struct
+{
+  GMainLoop *mainloop;
+  GQueue pending;
+  GList *running;
+  guint n_jobs;
+  const gchar *verbosity;
+  gboolean has_playbin;
+
+  guint n_passed, n_failed, n_skipped;
+  gboolean interrupted;
+} Batch;
+
+typedef struct
+{
+  /* Must be first, so that the test is passed to `done` */
+  BusCallbackData bus_data;
+
+  Batch *batch;
+  gchar *name;
+  gchar *uuid;
+  gchar *pipeline_desc;
+  gchar *scenarios;
+
+  GstValidateRunner *runner;
+  GstBus *bus;
+  guint finish_id;
+  gboolean skipped;
+  gint ret;
+} BatchTest;
+
+static void batch_start_tests (Batch * batch);
+
+static void
+batch_test_free (BatchTest * test)
+{
+  g_free (test->name);
+  g_free (test->uuid);
+  g_free (test->pipeline_desc);
+  g_free (test->scenarios);
+  g_free (test);
+}
+
+/* Parses the `test` structures of @batch_file, which set the `pipeline`
+ * description to run and optionally the `scenario` to run on it, the `name`
+ * of the test and the `uuid` gst-validate-launcher identifies it with */
+static gboolean
+batch_load (Batch * batch, const gchar * batch_file, const gchar * configs)
+{
+  GList *tmp, *structures =
+      gst_validate_utils_structs_parse_from_filename (batch_file, NULL, NULL);
+
+  if (!structures) {
+    g_printerr ("No test found in %s\n", batch_file);
+    return FALSE;
+  }
+
+  for (tmp = structures; tmp; tmp = tmp->next) {
+    GstStructure *structure = tmp->data;
+    const gchar *pipeline_desc = gst_structure_get_string (structure,
+        "pipeline");
+    const gchar *scenario = gst_structure_get_string (structure, "scenario");
+    const gchar *name = gst_structure_get_string (structure, "name");
+    BatchTest *test;
+
+    if (!gst_structure_has_name (structure, "test") || !pipeline_desc) {
+      gchar *str = gst_structure_to_string (structure);
+
+      g_printerr ("Invalid test in %s, expected a 'test' with a 'pipeline'"
+          " field: %s\n", batch_file, str);
+      g_free (str);
+      g_list_free_full (structures, (GDestroyNotify) gst_structure_free);
+
+      return FALSE;
+    }
+
+    batch->has_playbin |= _is_playbin_pipeline (1, (gchar **) & pipeline_desc);
+
+    test = g_new0 (BatchTest, 1);
+    test->batch = batch;
+    test->pipeline_desc = g_strdup (pipeline_desc);
+    test->uuid = g_strdup (gst_structure_get_string (structure, "uuid"));
+    test->name = name ? g_strdup (name) :
+        g_strdup_printf ("test%u", batch->pending.length);
+    if (scenario)
+      test->scenarios = g_strjoin (":", scenario, configs, NULL);
+    else
+      test->scenarios = g_strdup (configs);
+
+    g_queue_push_tail (&batch->pending, test);
+  }
+
+  g_list_free_full (structures, (GDestroyNotify) gst_structure_free);
+
+  return TRUE;
+}
+
+static void
+batch_test_set_result (BatchTest * test)
+{
+  Batch *batch = test->batch;
+
+  if (test->skipped)
+    batch->n_skipped++;
+  else if (test->ret == 0)
+    batch->n_passed++;
+  else
+    batch->n_failed++;
+
+  gst_validate_printf (NULL, "\n=======> Test %s %s (Return value: %i)\n\n",
+      test->name, test->skipped ? "SKIPPED" : test->ret == 0 ? "PASSED" :
+      "FAILED", test->ret);
+}
+
+static void
+batch_test_cleanup (BatchTest * test)
+{
+  Batch *batch = test->batch;
+  gint rep_err;
+
+  if (test->finish_id)
+    g_source_remove (test->finish_id);
+  test->finish_id = 0;
+
+  gst_element_set_state (test->bus_data.pipeline, GST_STATE_NULL);
+  gst_element_get_state (test->bus_data.pipeline, NULL, NULL,
+      GST_CLOCK_TIME_NONE);
+
+  /* Clean the bus */
+  gst_bus_set_flushing (test->bus, TRUE);
+  gst_bus_remove_signal_watch (test->bus);
+  g_signal_handlers_disconnect_by_data (test->bus, &test->bus_data);
+  gst_object_unref (test->bus);
+
+  rep_err = gst_validate_runner_exit (test->runner, TRUE);
+  if (test->ret == 0) {
+    test->ret = rep_err;
+    if (rep_err != 0)
+      gst_validate_printf (NULL, "Returning %d as errors were found\n",
+          rep_err);
+  }
+
+  gst_object_unref (test->bus_data.pipeline);
+  gst_object_unref (test->runner);
+  gst_validate_reporter_purge_reports (GST_VALIDATE_REPORTER
+      (test->bus_data.monitor));
+  gst_object_unref (test->bus_data.monitor);
+
+  batch->running = g_list_remove (batch->running, test);
+  batch_test_set_result (test);
+  batch_test_free (test);
+}
+
+static gboolean
+batch_test_finish (BatchTest * test)
+{
+  Batch *batch = test->batch;
+
+  test->finish_id = 0;
+  batch_test_cleanup (test);
+
+  batch_start_tests (batch);
+  if (!batch->running)
+    g_main_loop_quit (batch->mainloop);
+
+  return G_SOURCE_REMOVE;
+}
+
+/* The pipeline can't be torn down from its own bus callback */
+static void
+batch_test_done (BusCallbackData * data)
+{
+  BatchTest *test = (BatchTest *) data;
+
+  if (!test->finish_id)
+    test->finish_id = g_idle_add ((GSourceFunc) batch_test_finish, test);
+}
+
+/* Returns %FALSE if the test is already over, without a pipeline to run */
+static gboolean
+batch_test_start (BatchTest * test)
+{
+  GError *err = NULL;
+  GstElement *pipeline;
+  GstValidateMonitor *monitor;
+  gboolean monitor_handles_state;
+
+  gst_validate_printf (NULL, "**-> Test %s: '%s'**\n", test->name,
+      test->pipeline_desc);
+
+  /* Scenarios are created with the monitor, from the environment */
+  if (test->scenarios)
+    g_setenv ("GST_VALIDATE_SCENARIO", test->scenarios, TRUE);
+  else
+    g_unsetenv ("GST_VALIDATE_SCENARIO");
+
+  test->runner = gst_validate_runner_new_for_test (test->uuid);
+  /* Only one test runs at a time when there are overrides */
+  _set_overrides_runner (test->runner);
+  pipeline = (GstElement *) gst_parse_launch (test->pipeline_desc, &err);
+  if (!pipeline || err) {
+    if (g_error_matches (err, GST_PARSE_ERROR, GST_PARSE_ERROR_NO_SUCH_ELEMENT)
+        && !gst_validate_fail_on_missing_plugin ()) {
+      gst_validate_runner_skip_test (test->runner, "missing plugin: %s",
+          err->message);
+      test->skipped = TRUE;
+    } else {
+      test->ret = 1;
+    }
+
+    gst_validate_printf (NULL, "Failed to create pipeline: %s\n",
+        err ? err->message : "unknown reason");
+    g_clear_error (&err);
+    gst_validate_runner_exit (test->runner, FALSE);
+    gst_object_unref (test->runner);
+    if (pipeline)
+      gst_object_unref (pipeline);
+
+    return FALSE;
+  }
+
+  if (!GST_IS_PIPELINE (pipeline)) {
+    GstElement *new_pipeline = gst_pipeline_new ("");
+
+    gst_bin_add (GST_BIN (new_pipeline), pipeline);
+    pipeline = new_pipeline;
+  }
+  gst_pipeline_set_auto_flush_bus (GST_PIPELINE (pipeline), FALSE);
+
+  monitor = gst_validate_monitor_factory_create (GST_OBJECT_CAST (pipeline),
+      test->runner, NULL);
+  if (test->batch->verbosity)
+    gst_util_set_object_arg (G_OBJECT (monitor), "verbosity",
+        test->batch->verbosity);
+  gst_validate_reporter_set_handle_g_logs (GST_VALIDATE_REPORTER (monitor));
+
+  test->bus_data.mainloop = test->batch->mainloop;
+  test->bus_data.monitor = monitor;
+  test->bus_data.pipeline = pipeline;
+  test->bus_data.quit_on_eos = test->scenarios == NULL;
+  test->bus_data.done = batch_test_done;
+
+  test->bus = gst_element_get_bus (pipeline);
+  gst_bus_add_signal_watch (test->bus);
+  g_signal_connect (test->bus, "message", (GCallback) bus_callback,
+      &test->bus_data);
+  test->batch->running = g_list_append (test->batch->running, test);
+
+  g_object_get (monitor, "handles-states", &monitor_handles_state, NULL);
+  if (monitor_handles_state)
+    return TRUE;
+
+  switch (gst_element_set_state (pipeline, GST_STATE_PLAYING)) {
+    case GST_STATE_CHANGE_FAILURE:
+      gst_validate_printf (NULL, "Pipeline failed to go to PLAYING state\n");
+      test->ret = -1;
+      batch_test_done (&test->bus_data);
+      break;
+    case GST_STATE_CHANGE_NO_PREROLL:
+      test->bus_data.is_live = TRUE;
+      break;
+    default:
+      break;
+  }
+
+  return TRUE;
+}
+
+static void
+batch_start_tests (Batch * batch)
+{
+  while (!batch->interrupted && g_list_length (batch->running) < batch->n_jobs
+      && !g_queue_is_empty (&batch->pending)) {
+    BatchTest *test = g_queue_pop_head (&batch->pending);
+
+    if (!batch_test_start (test)) {
+      batch_test_set_result (test);
+      batch_test_free (test);
+    }
+  }
+}
+
+#ifdef G_OS_UNIX
+static gboolean
+batch_intr_handler (Batch * batch)
+{
+  gst_validate_printf (NULL, "interrupt received.\n");
+
+  batch->interrupted = TRUE;
+  g_main_loop_quit (batch->mainloop);
+
+  return TRUE;
+}
+#endif /* G_OS_UNIX */
+
+/* Runs all the tests of @batch_file in this process, up to @n_jobs at once,
+ * each with its own runner so their reports and results are kept apart */
+static int
+run_batch (const gchar * batch_file, gint n_jobs, const gchar * configs,
+    const gchar * verbosity)
+{
+  Batch batch = { 0, };
+  gint res;
+#ifdef G_OS_UNIX
+  guint signal_watch_id;
+#endif
+
+  g_queue_init (&batch.pending);
+  batch.n_jobs = MAX (n_jobs, 1);
+  batch.verbosity = verbosity;
+  if (!batch_load (&batch, batch_file, configs))
+    return 1;
+
+  /* Overrides are shared by all the tests, their reports could not be told
+   * apart */
+  if (batch.n_jobs > 1 && _set_overrides_runner (NULL)) {
+    g_printerr ("Tests can not be run in parallel with overrides, like the"
+        " validateflow or ssim ones, use --batch-jobs=1\n");
+    return 1;
+  }
+
+  gst_validate_spin_on_fault_signals ();
+  if (batch.has_playbin)
+    _register_playbin_actions ();
+
+  batch.mainloop = g_main_loop_new (NULL, FALSE);
+#ifdef G_OS_UNIX
+  signal_watch_id =
+      g_unix_signal_add (SIGINT, (GSourceFunc) batch_intr_handler, &batch);
+#endif
+
+  batch_start_tests (&batch);
+  if (batch.running)
+    g_main_loop_run (batch.mainloop);
+
+  while (batch.running) {
+    BatchTest *test = batch.running->data;
+
+    test->ret = SIGINT;
+    batch_test_cleanup (test);
+  }
+  g_queue_foreach (&batch.pending, (GFunc) batch_test_free, NULL);
+  g_queue_clear (&batch.pending);
+
+#ifdef G_OS_UNIX
+  g_source_remove (signal_watch_id);
+#endif
+  g_main_loop_unref (batch.mainloop);
+
+  gst_validate_printf (NULL, "=======> %u tests: %u passed, %u failed,"
+      " %u skipped\n", batch.n_passed + batch.n_failed + batch.n_skipped,
+      batch.n_passed, batch.n_failed, batch.n_skipped);
+
+  if (batch.interrupted)
+    res = SIGINT;
+  else
+    res = batch.n_failed ? 1 : 0;
+
+  gst_validate_deinit ();
+  gst_deinit ();
+
+  return res;
+}
+
+#ifdef G_OS_UNIX
+/* Variables read when GStreamer and GstValidate are initialized, tests setting
+ * them differently than the fork server are executed from scratch */
+static const gchar *fork_server_init_variables[] = {
+  "LD_PRELOAD", "GST_DEBUG", "GST_DEBUG_FILE", "GST_DEBUG_NO_COLOR",
+  "GST_DEBUG_COLOR_MODE", "GST_PLUGIN_PATH", "GST_PLUGIN_PATH_1_0",
+  "GST_PLUGIN_SYSTEM_PATH", "GST_PLUGIN_SYSTEM_PATH_1_0", "GST_REGISTRY",
+  "GST_REGISTRY_1_0", "GST_REGISTRY_UPDATE", "GST_PLUGIN_LOADING_WHITELIST",
+  "GST_PLUGIN_FEATURE_RANK", "GST_TRACERS", "GST_VALIDATE",
+  "GST_VALIDATE_CONFIG", "GST_VALIDATE_FILE", "GST_VALIDATE_OVERRIDE",
+  "GST_VALIDATE_PLUGIN_PATH", NULL
+};
+
+static gchar **fork_server_environ = NULL;
+
+/* Only the thread calling fork() exists in the child, which can not rely on
+ * what the other threads might have been doing (holding locks, writing to
+ * a queue, ...). Tests are executed from scratch when GStreamer or
+ * GstValidate started threads while being initialized. */
+static gboolean fork_server_threaded = FALSE;
+
+static gboolean
+fork_server_read (gint fd, gpointer data, gsize size)
+{
+  gsize done = 0;
+
+  while (done < size) {
+    gssize res = read (fd, (guint8 *) data + done, size - done);
+
+    if (res < 0 && errno == EINTR)
+      continue;
+    if (res <= 0)
+      return FALSE;
+    done += res;
+  }
+
+  return TRUE;
+}
+
+/* Messages are framed like the ones sent to gst-validate-launcher, JSON
+ * prefixed by their length in big endian */
+static void
+fork_server_send (gint fd, const gchar * name, gint value)
+{
+  gchar *message = g_strdup_printf ("xxxx{\"%s\": %d}", name, value);
+  gsize size = strlen (message), done = 0;
+
+  GST_WRITE_UINT32_BE (message, size - 4);
+  while (done < size) {
+    gssize res = write (fd, message + done, size - done);
+
+    if (res < 0 && errno == EINTR)
+      continue;
+    if (res <= 0)
+      break;
+    done += res;
+  }
+  g_free (message);
+}
+
+/* Receives the request of a test: its `args`, `env` and `cwd`, along with
+ * the file descriptor its output goes to */
+static JsonObject *
+fork_server_receive_request (gint fd, gint * output_fd)
+{
+  guint8 header[4];
+  gchar *data;
+  guint32 size;
+  gssize res;
+  JsonNode *root;
+  JsonObject *request = NULL;
+  struct iovec iov = { header, sizeof (header) };
+  union
+  {
+    struct cmsghdr hdr;
+    gchar buf[CMSG_SPACE (sizeof (gint))];
+  } control;
+  struct msghdr msg = { 0, };
+  struct cmsghdr *cmsg;
+
+  *output_fd = -1;
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control.buf;
+  msg.msg_controllen = sizeof (control.buf);
+
+  do {
+    res = recvmsg (fd, &msg, 0);
+  } while (res < 0 && errno == EINTR);
+  if (res <= 0)
+    return NULL;
+
+  for (cmsg = CMSG_FIRSTHDR (&msg); cmsg; cmsg = CMSG_NXTHDR (&msg, cmsg)) {
+    if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS)
+      memcpy (output_fd, CMSG_DATA (cmsg), sizeof (gint));
+  }
+
+  if (!fork_server_read (fd, header + res, sizeof (header) - res))
+    return NULL;
+
+  size = GST_READ_UINT32_BE (header);
+  data = g_malloc (size + 1);
+  if (fork_server_read (fd, data, size)) {
+    data[size] = '\0';
+    root = json_from_string (data, NULL);
+    if (root && JSON_NODE_HOLDS_OBJECT (root))
+      request = json_object_ref (json_node_get_object (root));
+    if (root)
+      json_node_unref (root);
+  }
+  g_free (data);
+
+  return request;
+}
+
+static void
+fork_server_set_environment (JsonObject * env)
+{
+  GList *tmp, *names = json_object_get_members (env);
+  gchar **variables = g_listenv ();
+  gint i;
+
+  for (i = 0; variables[i]; i++)
+    g_unsetenv (variables[i]);
+  g_strfreev (variables);
+
+  for (tmp = names; tmp; tmp = tmp->next)
+    g_setenv (tmp->data, json_object_get_string_member (env, tmp->data), TRUE);
+  g_list_free (names);
+}
+
+static gboolean
+fork_server_environment_changed (void)
+{
+  gint i;
+
+  for (i = 0; fork_server_init_variables[i]; i++) {
+    const gchar *name = fork_server_init_variables[i];
+
+    if (g_strcmp0 (g_environ_getenv (fork_server_environ, name),
+            g_getenv (name)))
+      return TRUE;
+  }
+
+  return FALSE;
+}
+
+/* Returns %TRUE when the process is known to run a single thread */
+static gboolean
+fork_server_is_single_threaded (void)
+{
+  GDir *dir = g_dir_open ("/proc/self/task", 0, NULL);
+  gint n_threads = 0;
+
+  /* Can only be checked on Linux, other platforms are assumed to be fine as
+   * neither GStreamer nor GstValidate start threads when initialized */
+  if (!dir)
+    return TRUE;
+
+  while (g_dir_read_name (dir))
+    n_threads++;
+  g_dir_close (dir);
+
+  return n_threads == 1;
+}
+
+/* Runs in the process forked for the request received on @fd, which forks
+ * again to run the test and reports its pid and how it exited */
+static gint
+fork_server_handle_request (gint fd)
+{
+  gint output_fd, status, argc = 0;
+  gchar **argv = NULL;
+  JsonArray *args = NULL;
+  JsonObject *request = fork_server_receive_request (fd, &output_fd);
+  pid_t pid;
+
+  if (request && json_object_has_member (request, "args"))
+    args = json_object_get_array_member (request, "args");
+  if (!args || output_fd < 0) {
+    g_printerr ("Invalid fork server request\n");
+    return 1;
+  }
+
+  argv = g_new0 (gchar *, json_array_get_length (args) + 1);
+  for (argc = 0; argc < (gint) json_array_get_length (args); argc++)
+    argv[argc] = g_strdup (json_array_get_string_element (args, argc));
+
+  signal (SIGCHLD, SIG_DFL);
+  pid = fork ();
+  if (pid < 0) {
+    g_printerr ("Could not fork: %s\n", g_strerror (errno));
+    return 1;
+  }
+
+  if (pid == 0) {
+    close (fd);
+    dup2 (output_fd, STDOUT_FILENO);
+    dup2 (output_fd, STDERR_FILENO);
+    close (output_fd);
+
+    if (json_object_has_member (request, "cwd")
+        && chdir (json_object_get_string_member (request, "cwd")) < 0)
+      g_printerr ("Could not change directory: %s\n", g_strerror (errno));
+    if (json_object_has_member (request, "env"))
+      fork_server_set_environment (json_object_get_object_member (request,
+              "env"));
+
+    if (fork_server_threaded || fork_server_environment_changed ()) {
+      execvp (argv[0], argv);
+      g_printerr ("Could not execute %s: %s\n", argv[0], g_strerror (errno));
+      _exit (127);
+    }
+
+    is_forked_test = TRUE;
+    exit (main (argc, argv));
+  }
+
+  close (output_fd);
+  fork_server_send (fd, "pid", pid);
+
+  while (waitpid (pid, &status, 0) < 0) {
+    if (errno != EINTR) {
+      g_printerr ("Could not wait for the test: %s\n", g_strerror (errno));
+      return 1;
+    }
+  }
+
+  /* Same as the returncode of python subprocesses */
+  fork_server_send (fd, "returncode", WIFSIGNALED (status) ?
+      -WTERMSIG (status) : WEXITSTATUS (status));
+
+  g_strfreev (argv);
+  json_object_unref (request);
+
+  return 0;
+}
+
+/* Waits for tests to run on @socket_path, forking a process for each of them
+ * so they start with GStreamer and GstValidate already initialized */
+static int
+run_fork_server (const gchar * socket_path)
+{
+  gint fd;
+  gchar *tmp_path;
+  struct sockaddr_un addr = { 0, };
+
+  if (strlen (socket_path) >= sizeof (addr.sun_path)) {
+    g_printerr ("Socket path too long: %s\n", socket_path);
+    return 1;
+  }
+
+  fd = socket (AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0) {
+    g_printerr ("Could not create socket: %s\n", g_strerror (errno));
+    return 1;
+  }
+
+  /* Only make the socket visible once it accepts connections */
+  tmp_path = g_strdup_printf ("%s.tmp", socket_path);
+  addr.sun_family = AF_UNIX;
+  g_strlcpy (addr.sun_path, tmp_path, sizeof (addr.sun_path));
+  unlink (tmp_path);
+  if (bind (fd, (struct sockaddr *) &addr, sizeof (addr)) < 0
+      || listen (fd, 128) < 0 || rename (tmp_path, socket_path) < 0) {
+    g_printerr ("Could not listen on %s: %s\n", socket_path,
+        g_strerror (errno));
+    g_free (tmp_path);
+    close (fd);
+    return 1;
+  }
+  g_free (tmp_path);
+
+  fork_server_environ = g_get_environ ();
+  fork_server_threaded = !fork_server_is_single_threaded ();
+  if (fork_server_threaded)
+    g_printerr ("Threads were started during initialization, tests will be"
+        " executed from scratch\n");
+  /* Request processes are never waited for */
+  signal (SIGCHLD, SIG_IGN);
+  gst_validate_printf (NULL, "**-> Fork server listening on %s**\n",
+      socket_path);
+
+  while (TRUE) {
+    pid_t pid;
+    gint connection = accept (fd, NULL, NULL);
+
+    if (connection < 0) {
+      if (errno == EINTR || errno == ECONNABORTED)
+        continue;
+
+      g_printerr ("Could not accept connection: %s\n", g_strerror (errno));
+      break;
+    }
+
+    fflush (stdout);
+    fflush (stderr);
+    pid = fork ();
+    if (pid == 0) {
+      close (fd);
+      _exit (fork_server_handle_request (connection));
+    } else if (pid < 0) {
+      g_printerr ("Could not fork: %s\n", g_strerror (errno));
+    }
+
+    close (connection);
+  }
+
+  close (fd);
+  unlink (socket_path);
+  g_strfreev (fork_server_environ);
+
+  return 1;
+}
+#endif /* G_OS_UNIX */
+
 int
 main (int argc, gchar ** argv)
 {
   GError *err = NULL;
   gchar *scenario = NULL, *configs = NULL, *media_info = NULL,
-      *verbosity = NULL, *testfile = NULL;
+      *verbosity = NULL, *testfile = NULL, *batch_file = NULL;
+  gint batch_jobs = 1;
+#ifdef G_OS_UNIX
+  gchar *fork_server = NULL;
+#endif
   gboolean list_scenarios = FALSE, monitor_handles_state,
       inspect_action_type = FALSE, print_issue_types = FALSE;
   GstStateChangeReturn sret;
@@ -388,6 +1114,21 @@ main (int argc, gchar ** argv)
           " description). Specify multiple ones using ':' as separator."
           " This option overrides the GST_VALIDATE_SCENARIO environment variable.",
         NULL},
+    {"batch", '\0', 0, G_OPTION_ARG_FILENAME, &batch_file,
+          "Run all the tests described in the given file in this process,"
+          " one 'test, pipeline=\"<PIPELINE-DESCRIPTION>\"' structure per test,"
+          " with optional 'scenario', 'name' and 'uuid' fields.",
+        NULL},
+    {"batch-jobs", '\0', 0, G_OPTION_ARG_INT, &batch_jobs,
+          "Number of tests of the --batch file to run at the same time,"
+          " which has to be 1 when overrides are used",
+        NULL},
+#ifdef G_OS_UNIX
+    {"fork-server", '\0', 0, G_OPTION_ARG_FILENAME, &fork_server,
+          "Initialize GStreamer and GstValidate then wait for tests to run on"
+          " the given UNIX socket path, forking a process for each of them",
+        NULL},
+#endif
     {NULL}
   };
   GOptionContext *ctx;
@@ -430,7 +1171,11 @@ main (int argc, gchar ** argv)
     return run_test_from_file (testfile, use_fakesinks);
   }
 
-  if (scenario || configs) {
+  if (batch_file && scenario)
+    gst_validate_abort ("Can not specify scenario and batch file at the same"
+        " time, set scenarios in the batch file instead");
+
+  if (!batch_file && (scenario || configs)) {
     gchar *scenarios;
 
     if (scenario)
@@ -446,6 +1191,18 @@ main (int argc, gchar ** argv)
 
   gst_validate_init ();
 
+#ifdef G_OS_UNIX
+  if (fork_server) {
+    gint res;
+
+    g_option_context_free (ctx);
+    res = run_fork_server (fork_server);
+    g_free (fork_server);
+
+    return res;
+  }
+#endif
+
   if (list_scenarios || output_file) {
     g_option_context_free (ctx);
     if (gst_validate_list_scenarios (argv + 1, argc - 1, output_file))
@@ -469,6 +1226,17 @@ main (int argc, gchar ** argv)
     return 0;
   }
 
+  if (batch_file) {
+    gint res;
+
+    g_option_context_free (ctx);
+    res = run_batch (batch_file, batch_jobs, configs, verbosity);
+    g_free (batch_file);
+    g_free (configs);
+
+    return res;
+  }
+
   if (argc == 1) {
     gst_validate_printf (NULL, "%s", g_option_context_get_help (ctx, FALSE,
             NULL));
@@ -478,7 +1246,11 @@ main (int argc, gchar ** argv)
 
   g_option_context_free (ctx);
 
-  runner = gst_validate_runner_new ();
+  if (is_forked_test) {
+    runner = gst_validate_runner_new_for_test (g_getenv ("GST_VALIDATE_UUID"));
+    _set_overrides_runner (runner);
+  } else
+    runner = gst_validate_runner_new ();
   if (!runner) {
     g_printerr ("Failed to setup Validate Runner\n");
     exit (1);
@@ -505,7 +1277,8 @@ main (int argc, gchar ** argv)
   } else if (err) {
     if (g_error_matches (err, GST_PARSE_ERROR, GST_PARSE_ERROR_NO_SUCH_ELEMENT)) {
       if (!gst_validate_fail_on_missing_plugin ())
-        gst_validate_skip_test ("missing plugin: %s", err->message);
+        gst_validate_runner_skip_test (runner, "missing plugin: %s",
+            err->message);
     }
     g_printerr ("Erroneous pipeline: %s\n",
         err->message ? err->message : "unknown reason");
@@ -564,6 +1337,9 @@ main (int argc, gchar ** argv)
   gst_bus_add_signal_watch (bus);
   bus_callback_data.mainloop = mainloop;
   bus_callback_data.monitor = monitor;
+  bus_callback_data.pipeline = pipeline;
+  bus_callback_data.quit_on_eos = !g_getenv ("GST_VALIDATE_SCENARIO")
+      && !is_testfile;
   g_signal_connect (bus, "message", (GCallback) bus_callback,
       &bus_callback_data);
 
@@ -581,7 +1357,7 @@ main (int argc, gchar ** argv)
         goto exit;
       case GST_STATE_CHANGE_NO_PREROLL:
         gst_validate_printf (NULL, "Pipeline is live.\n");
-        is_live = TRUE;
+        bus_callback_data.is_live = TRUE;
         break;
       case GST_STATE_CHANGE_ASYNC:
         gst_validate_printf (NULL, "Prerolling...\r");